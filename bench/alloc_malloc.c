@@ -0,0 +1,27 @@
+/* Allocation baseline for run_alloc_bench.sh: alloc_heap.1im written by
+   hand in C, growing each list by doubling from eight elements. */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+int main(void) {
+    int64_t rounds = 200000, lists = 50, items = 20, total = 0;
+    for (int64_t r = 0; r < rounds; r++) {
+        for (int64_t k = 0; k < lists; k++) {
+            int64_t* data = NULL;
+            size_t len = 0, cap = 0;
+            for (int64_t i = 0; i < items; i++) {
+                if (len == cap) {
+                    cap = cap ? cap * 2 : 8;
+                    data = realloc(data, cap * sizeof(int64_t));
+                    if (data == NULL) abort();
+                }
+                data[len++] = i + k;
+            }
+            total += data[items - 1];
+            free(data);
+        }
+    }
+    printf("%lld\n", (long long)total);
+    return 0;
+}
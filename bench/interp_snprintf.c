@@ -0,0 +1,55 @@
+/* Interpolation baseline for run_interp_bench.sh: interp_build.1im and
+   interp_print.1im lowered the usual way, with one snprintf to size the
+   result and another to fill a malloc'd buffer. `build` keeps every string,
+   like the 1im version; `print` writes each line and frees it. */
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char* interp(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    char* s = malloc((size_t)n + 1);
+    if (s == NULL) abort();
+    va_start(ap, fmt);
+    vsnprintf(s, (size_t)n + 1, fmt, ap);
+    va_end(ap);
+    return s;
+}
+
+static void build(void) {
+    const char* name = "widget";
+    int64_t rounds = 1000000;
+    int32_t total = 0;
+    for (int64_t i = 0; i < rounds; i++) {
+        char* row = interp("row %" PRId64 " of %" PRId64 ": %s x%" PRId64, i, rounds, name, i % 7);
+        total += (int32_t)strlen(row);
+    }
+    printf("%" PRId32 "\n", total);
+}
+
+static void print(void) {
+    const char* name = "widget";
+    double price = 0.0;
+    for (int64_t i = 0; i < 1000000; i++) {
+        price += 0.25;
+        char* line = interp("%s #%" PRId64 ": %f (%s)", name, i, price, i % 2 == 0 ? "true" : "false");
+        puts(line);
+        free(line);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc == 2 && strcmp(argv[1], "build") == 0) build();
+    else if (argc == 2 && strcmp(argv[1], "print") == 0) print();
+    else {
+        fprintf(stderr, "usage: %s build|print\n", argv[0]);
+        return 2;
+    }
+    return 0;
+}
@@ -0,0 +1,47 @@
+const std = @import("std");
+const Lexer = @import("lexer").Lexer;
+
+/// Lexes a file start to finish REPEAT times and prints the best run as
+/// tokens and MB/s. Usage: lexer_bench <file> [repeat]
+pub fn main() !void {
+    var gpa_state: std.heap.GeneralPurposeAllocator(.{}) = .init;
+    defer _ = gpa_state.deinit();
+    const gpa = gpa_state.allocator();
+
+    const args = try std.process.argsAlloc(gpa);
+    defer std.process.argsFree(gpa, args);
+    if (args.len < 2) {
+        try std.fs.File.stderr().writeAll("usage: lexer_bench <file> [repeat]\n");
+        std.process.exit(1);
+    }
+    const repeat = if (args.len > 2) try std.fmt.parseInt(usize, args[2], 10) else 10;
+
+    const source = try std.fs.cwd().readFileAlloc(gpa, args[1], 1 << 30);
+    defer gpa.free(source);
+
+    var best_ns: u64 = std.math.maxInt(u64);
+    var tokens: usize = 0;
+    for (0..repeat) |_| {
+        var timer = try std.time.Timer.start();
+        var lexer = Lexer.init(source);
+        var count: usize = 0;
+        while (true) {
+            const tok = try lexer.next();
+            count += 1;
+            if (tok.tag == .eof) break;
+        }
+        best_ns = @min(best_ns, timer.read());
+        tokens = count;
+    }
+
+    const seconds = @as(f64, @floatFromInt(best_ns)) / std.time.ns_per_s;
+    const mb = @as(f64, @floatFromInt(source.len)) / 1e6;
+    var buf: [256]u8 = undefined;
+    const msg = try std.fmt.bufPrint(&buf, "{d} bytes, {d} tokens, {d:.2} ms, {d:.1} MB/s\n", .{
+        source.len,
+        tokens,
+        seconds * 1e3,
+        mb / seconds,
+    });
+    try std.fs.File.stdout().writeAll(msg);
+}
@@ -0,0 +1,55 @@
+#!/bin/bash
+set -euo pipefail
+
+# Allocation-heavy code: ten million short-lived lists of twenty values,
+# built with `append` and dropped right away. alloc_heap.1im frees each
+# list (malloc, realloc and free underneath), alloc_arena.1im takes them
+# from an arena reset once per round, and alloc_malloc.c is the heap
+# version written by hand in C. All three must print the same total.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+for name in alloc_heap alloc_arena; do
+    "$COMPILER" --emit-c "$ROOT_DIR/bench/$name.1im" > "$OUT_DIR/$name.c"
+    cc -O3 -march=native -pthread -o "$OUT_DIR/$name" "$OUT_DIR/$name.c"
+done
+cc -O3 -march=native -o "$OUT_DIR/alloc_malloc" "$ROOT_DIR/bench/alloc_malloc.c"
+
+expected=$("$OUT_DIR/alloc_malloc")
+
+# Average wall time (ms) over $REPEAT runs; fails on a wrong total.
+measure() {
+    local total_ms=0 start end got
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        got=$("$OUT_DIR/$1")
+        end=$(date +%s%N)
+        if [ "$got" != "$expected" ]; then
+            echo "FAIL: $1 printed $got, expected $expected" >&2
+            exit 1
+        fi
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/alloc_bench.txt"
+printf "%-14s %10s %10s\n" "program" "time (ms)" "vs C" | tee "$RESULTS"
+
+c_ms=$(measure alloc_malloc)
+for name in alloc_malloc alloc_heap alloc_arena; do
+    ms=$([ "$name" = alloc_malloc ] && echo "$c_ms" || measure "$name")
+    ratio=$(awk -v a="$ms" -v b="$c_ms" 'BEGIN { printf "%.2fx", (b > 0 ? a / b : 0) }')
+    printf "%-14s %10d %10s\n" "$name" "$ms" "$ratio" | tee -a "$RESULTS"
+done
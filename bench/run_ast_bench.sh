@@ -0,0 +1,88 @@
+#!/bin/bash
+set -euo pipefail
+
+# Front-end wall time and peak memory on a large generated program mixing
+# every statement kind the parser builds (functions, typed and untyped
+# sets, if/else-if/else chains, while and range loops, arrays, calls).
+# `--emit-c` stops before cc, so the numbers are lex + parse + analysis +
+# codegen; peak RSS is dominated by the AST (tokens are streamed).
+#
+# Set BASELINE=/path/to/older/1im to compare against another build, e.g.
+# one from before the flat AST, on the same input.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+LINES=${LINES:-200000}
+REPEAT=${REPEAT:-3}
+BASELINE=${BASELINE:-}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+if [ ! -x /usr/bin/time ]; then
+    echo "/usr/bin/time is required for peak memory"
+    exit 1
+fi
+
+SRC="$OUT_DIR/ast_bench.1im"
+
+# 17-line functions (blank line included) until $LINES is reached, then a
+# call so the program is not trivially dead.
+awk -v lines="$LINES" 'BEGIN {
+    fns = int((lines - 2) / 17)
+    for (i = 0; i < fns; i++) {
+        printf "fun g%d with n as i32, k as i32 returns i32\n", i
+        printf "    set acc as i32 to 0\n"
+        printf "    set xs to [1, 2, 3, 4]\n"
+        printf "    loop for j in 0..n\n"
+        printf "        if j %% 3 == 0 and k > 1 then\n"
+        printf "            set acc to acc + j * 2 - (k + xs[1])\n"
+        printf "        else if j %% 3 == 1 then\n"
+        printf "            set acc to acc - (j / 2)\n"
+        printf "        else\n"
+        printf "            set acc to acc + 1\n"
+        printf "    set m to k\n"
+        printf "    loop while m > 0\n"
+        printf "        set m to m - 1\n"
+        printf "        if not (m == 3) then\n"
+        printf "            continue\n"
+        printf "    return acc + len(xs)\n\n"
+    }
+    printf "set r to g0(10, 2)\nprint(r)\n"
+}' > "$SRC"
+
+lines=$(wc -l < "$SRC")
+bytes=$(wc -c < "$SRC")
+
+# Average wall time (ms) and max peak RSS (KiB) over $REPEAT runs.
+measure() {
+    local total_ms=0 peak_kb=0 start end kb
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        kb=$(/usr/bin/time -f "%M" "$@" 2>&1 >/dev/null | tail -n 1)
+        end=$(date +%s%N)
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+        [ "$kb" -gt "$peak_kb" ] && peak_kb=$kb
+    done
+    echo "$(( total_ms / REPEAT )) $peak_kb"
+}
+
+RESULTS="$OUT_DIR/ast_bench.txt"
+{
+    echo "input: $lines lines, $bytes bytes"
+    printf "%-10s %12s %14s\n" "build" "emit-c (ms)" "peak RSS (KiB)"
+} | tee "$RESULTS"
+
+read -r ms kb < <(measure "$COMPILER" --emit-c "$SRC")
+printf "%-10s %12d %14d\n" "current" "$ms" "$kb" | tee -a "$RESULTS"
+
+if [ -n "$BASELINE" ]; then
+    read -r ms kb < <(measure "$BASELINE" --emit-c "$SRC")
+    printf "%-10s %12d %14d\n" "baseline" "$ms" "$kb" | tee -a "$RESULTS"
+fi
@@ -0,0 +1,53 @@
+#!/bin/bash
+set -euo pipefail
+
+# Bounds checks: bounds_sum.1im built with --mode=safe, which checks the
+# strided index but proves the in-order one in range, and with
+# --mode=fast, which checks neither. Both must print the same total.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+for mode in safe fast; do
+    "$COMPILER" --emit-c --mode=$mode "$ROOT_DIR/bench/bounds_sum.1im" > "$OUT_DIR/bounds_$mode.c"
+    cc -O3 -march=native -pthread -o "$OUT_DIR/bounds_$mode" "$OUT_DIR/bounds_$mode.c"
+done
+"$COMPILER" --emit-c --bounds-report "$ROOT_DIR/bench/bounds_sum.1im" 2>&1 >/dev/null
+
+expected=$("$OUT_DIR/bounds_fast")
+
+# Average wall time (ms) over $REPEAT runs; fails on a wrong total.
+measure() {
+    local total_ms=0 start end got
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        got=$("$OUT_DIR/$1")
+        end=$(date +%s%N)
+        if [ "$got" != "$expected" ]; then
+            echo "FAIL: $1 printed $got, expected $expected" >&2
+            exit 1
+        fi
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/bounds_bench.txt"
+printf "%-12s %10s %10s\n" "mode" "time (ms)" "vs fast" | tee "$RESULTS"
+
+fast_ms=$(measure bounds_fast)
+for mode in fast safe; do
+    ms=$([ "$mode" = fast ] && echo "$fast_ms" || measure "bounds_$mode")
+    ratio=$(awk -v a="$ms" -v b="$fast_ms" 'BEGIN { printf "%.2fx", (b > 0 ? a / b : 0) }')
+    printf "%-12s %10d %10s\n" "$mode" "$ms" "$ratio" | tee -a "$RESULTS"
+done
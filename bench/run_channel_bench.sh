@@ -0,0 +1,62 @@
+#!/bin/bash
+set -euo pipefail
+
+# Channel throughput: four million one-word messages through a single
+# bounded channel, from one producer to one consumer (channel_1_to_1.1im),
+# from one producer to four consumers (channel_1_to_n.1im), and from four
+# producers to four consumers (channel_n_to_n.1im). Consumers add up what
+# they receive, so every program must print four million. Each runs with
+# one thread (spare workers keep it from deadlocking), one per task, and
+# one per CPU.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+COUNT=4000000
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+for shape in 1_to_1 1_to_n n_to_n; do
+    "$COMPILER" --emit-c "$ROOT_DIR/bench/channel_$shape.1im" > "$OUT_DIR/channel_$shape.c"
+    cc -O3 -march=native -pthread -o "$OUT_DIR/channel_$shape" "$OUT_DIR/channel_$shape.c"
+done
+
+# Average wall time (ms) over $REPEAT runs; fails on a wrong count.
+measure() {
+    local total_ms=0 start end got
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        got=$("$OUT_DIR/$1")
+        end=$(date +%s%N)
+        if [ "$got" != "$COUNT" ]; then
+            echo "FAIL: $1 received $got, expected $COUNT" >&2
+            exit 1
+        fi
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/channel_bench.txt"
+printf "%-8s %-8s %10s %12s\n" "shape" "threads" "time (ms)" "Mmsgs/s" | tee "$RESULTS"
+
+for shape in 1_to_1 1_to_n n_to_n; do
+    case $shape in
+        1_to_1) tasks=2 ;;
+        1_to_n) tasks=5 ;;
+        n_to_n) tasks=8 ;;
+    esac
+    for threads in $(printf "%s\n" 1 "$tasks" "$(nproc)" | sort -nu); do
+        export ONEIM_THREADS=$threads
+        ms=$(measure "channel_$shape")
+        rate=$(awk -v n="$COUNT" -v t="$ms" 'BEGIN { printf "%.1f", (t > 0 ? n / t / 1000 : 0) }')
+        printf "%-8s %-8d %10d %12s\n" "$shape" "$threads" "$ms" "$rate" | tee -a "$RESULTS"
+    done
+done
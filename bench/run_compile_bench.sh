@@ -0,0 +1,79 @@
+#!/bin/bash
+set -euo pipefail
+
+# Front-end compile time (lex → parse → analyze → C codegen, no cc) on a
+# generated ~100k-line program whose functions each hold one left-nested
+# arithmetic expression. Expression types come from the analyzer's side
+# table, so time per expression node should stay flat as DEPTHS grows;
+# re-inferring types at every nesting level made it grow with depth.
+#
+# Set BASELINE=/path/to/older/1im to time another build on the same inputs.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+LINES=${LINES:-100000}
+DEPTHS=${DEPTHS:-"4 16 64"}
+REPEAT=${REPEAT:-3}
+BASELINE=${BASELINE:-}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+# Writes $LINES lines: 4-line functions with one depth-$1 expression each,
+# plus a call so the program is not trivially dead.
+generate() {
+    local depth=$1 out=$2
+    awk -v lines="$LINES" -v depth="$depth" 'BEGIN {
+        ops[0] = "+"; ops[1] = "*"; ops[2] = "-"; ops[3] = "%"
+        expr = "a"
+        for (d = 0; d < depth; d++) {
+            operand = (d % 2 == 0) ? "b" : (d % 7 + 1)
+            expr = "(" expr " " ops[d % 4] " " operand ")"
+        }
+        fns = int((lines - 2) / 4)
+        for (i = 0; i < fns; i++) {
+            printf "fun f%d with a as i64, b as i64 returns i64\n", i
+            printf "    set t to %s\n", expr
+            printf "    return t\n\n"
+        }
+        printf "set r to f0(7, 3)\nprint(r)\n"
+    }' > "$out"
+}
+
+# Average wall time in milliseconds over $REPEAT runs.
+time_ms() {
+    local start end
+    start=$(date +%s%N)
+    for _ in $(seq "$REPEAT"); do
+        "$@" >/dev/null
+    done
+    end=$(date +%s%N)
+    echo $(( (end - start) / REPEAT / 1000000 ))
+}
+
+RESULTS="$OUT_DIR/compile_bench.txt"
+header=$(printf "%-6s %10s %12s %14s" "depth" "lines" "emit-c (ms)" "ns/expr node")
+[ -n "$BASELINE" ] && header="$header $(printf "%14s" "baseline (ms)")"
+echo "$header" | tee "$RESULTS"
+
+for depth in $DEPTHS; do
+    src="$OUT_DIR/compile_bench_d${depth}.1im"
+    generate "$depth" "$src"
+    lines=$(wc -l < "$src")
+    # Each nesting level adds a binary node and a leaf.
+    nodes=$(( (LINES / 4) * (2 * depth + 2) ))
+
+    ms=$(time_ms "$COMPILER" --emit-c "$src")
+    row=$(printf "%-6d %10d %12d %14d" "$depth" "$lines" "$ms" $(( ms * 1000000 / nodes )))
+    if [ -n "$BASELINE" ]; then
+        base_ms=$(time_ms "$BASELINE" --emit-c "$src")
+        row="$row $(printf "%14d" "$base_ms")"
+    fi
+    echo "$row" | tee -a "$RESULTS"
+done
@@ -0,0 +1,56 @@
+#!/bin/bash
+set -euo pipefail
+
+# Shared updates from a parallel loop: twenty million iterations each add
+# one to a counter held in an atomic (contention_atomic.1im), behind a
+# mutex (contention_mutex.1im), or in a reduction whose partials are never
+# shared (contention_reduce.1im). Every program must count to twenty
+# million.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+COUNT=20000000
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+for name in contention_atomic contention_mutex contention_reduce; do
+    "$COMPILER" --emit-c "$ROOT_DIR/bench/$name.1im" > "$OUT_DIR/$name.c"
+    cc -O3 -march=native -pthread -o "$OUT_DIR/$name" "$OUT_DIR/$name.c"
+done
+
+# Average wall time (ms) over $REPEAT runs; fails on a wrong count.
+measure() {
+    local total_ms=0 start end got
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        got=$("$OUT_DIR/$1")
+        end=$(date +%s%N)
+        if [ "$got" != "$COUNT" ]; then
+            echo "FAIL: $1 counted $got, expected $COUNT" >&2
+            exit 1
+        fi
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/contention_bench.txt"
+printf "%-8s %-10s %10s %14s\n" "threads" "counter" "time (ms)" "Mupdates/s" | tee "$RESULTS"
+
+for threads in 1 "$(nproc)"; do
+    export ONEIM_THREADS=$threads
+    for kind in atomic mutex reduce; do
+        ms=$(measure "contention_$kind")
+        rate=$(awk -v n="$COUNT" -v t="$ms" 'BEGIN { printf "%.1f", (t > 0 ? n / t / 1000 : 0) }')
+        printf "%-8d %-10s %10d %14s\n" "$threads" "$kind" "$ms" "$rate" | tee -a "$RESULTS"
+    done
+    [ "$(nproc)" -eq 1 ] && break
+done
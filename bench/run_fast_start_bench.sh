@@ -0,0 +1,53 @@
+#!/bin/bash
+set -euo pipefail
+
+# End-to-end wall time (compile + run) for every example, comparing the
+# default `cc -O3` path with `--fast-start`. The compile cache is bypassed
+# so both columns measure a cold compile.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+EXAMPLES_DIR="$ROOT_DIR/examples"
+REPEAT=${REPEAT:-5}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+if command -v "${ONEIM_FAST_CC:-tcc}" >/dev/null 2>&1; then
+    echo "fast-start backend: ${ONEIM_FAST_CC:-tcc} (cc -O0 for threaded programs)"
+else
+    echo "fast-start backend: cc -O0 (tcc not found)"
+fi
+
+# Average wall time in milliseconds over $REPEAT runs.
+time_ms() {
+    local start end
+    start=$(date +%s%N)
+    for _ in $(seq "$REPEAT"); do
+        "$@" >/dev/null 2>&1 || true
+    done
+    end=$(date +%s%N)
+    echo $(( (end - start) / REPEAT / 1000000 ))
+}
+
+RESULTS="$OUT_DIR/fast_start_bench.txt"
+printf "%-22s %10s %12s\n" "example" "cc (ms)" "fast (ms)" | tee "$RESULTS"
+
+total_cc=0
+total_fast=0
+for example in "$EXAMPLES_DIR"/*.1im; do
+    name=$(basename "$example" .1im)
+    cc_ms=$(time_ms "$COMPILER" --no-cache "$example")
+    fast_ms=$(time_ms "$COMPILER" --no-cache --fast-start "$example")
+    total_cc=$((total_cc + cc_ms))
+    total_fast=$((total_fast + fast_ms))
+    printf "%-22s %10d %12d\n" "$name" "$cc_ms" "$fast_ms" | tee -a "$RESULTS"
+done
+
+printf "%-22s %10d %12d\n" "TOTAL" "$total_cc" "$total_fast" | tee -a "$RESULTS"
@@ -0,0 +1,55 @@
+#!/bin/bash
+set -euo pipefail
+
+# String interpolation: interp_build.1im makes a million strings from
+# integers and text, and interp_print.1im prints a million lines that also
+# hold a float and a bool. The generated code sizes each result first and
+# then writes it once; interp_snprintf.c lowers the same templates to two
+# snprintf calls and a malloc. Both versions must print the same bytes.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+# Average wall time (ms) over $REPEAT runs of "$@", output to $1.
+measure() {
+    local out=$1 total_ms=0 start end
+    shift
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        "$@" > "$out"
+        end=$(date +%s%N)
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+cc -O3 -march=native -o "$OUT_DIR/interp_snprintf" "$ROOT_DIR/bench/interp_snprintf.c"
+
+RESULTS="$OUT_DIR/interp_bench.txt"
+printf "%-14s %14s %14s %8s\n" "program" "1im (ms)" "snprintf (ms)" "speedup" | tee "$RESULTS"
+
+for mode in build print; do
+    name="interp_$mode"
+    BIN="$OUT_DIR/$name"
+    "$COMPILER" --emit-c "$ROOT_DIR/bench/$name.1im" > "$BIN.c"
+    cc -O3 -march=native -pthread -o "$BIN" "$BIN.c"
+
+    im_ms=$(measure "$OUT_DIR/$name.out" "$BIN")
+    snprintf_ms=$(measure "$OUT_DIR/${name}_snprintf.out" "$OUT_DIR/interp_snprintf" "$mode")
+    if ! cmp -s "$OUT_DIR/$name.out" "$OUT_DIR/${name}_snprintf.out"; then
+        echo "FAIL: $name prints differently from snprintf"
+        exit 1
+    fi
+    speedup=$(awk -v a="$im_ms" -v s="$snprintf_ms" 'BEGIN { printf "%.2f", (a > 0 ? s / a : 0) }')
+    printf "%-14s %14d %14d %7sx\n" "$name" "$im_ms" "$snprintf_ms" "$speedup" | tee -a "$RESULTS"
+done
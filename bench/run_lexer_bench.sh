@@ -0,0 +1,79 @@
+#!/bin/bash
+set -euo pipefail
+
+# Lexer throughput in MB/s on two generated multi-megabyte programs:
+#   mixed  deep indentation, long identifiers, comments, numbers and
+#          strings: the runs the lexer scans a vector at a time
+#   names  short identifiers and keywords only, so the time goes into
+#          keyword recognition
+# Builds bench/lexer_bench.zig against compiler/src/lexer.zig, so no
+# compiler binary is needed.
+#
+# Set INPUT=/path/to/file.1im to measure an existing source instead, and
+# BASELINE_SRC=/path/to/other/compiler/src to compare another lexer.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+OUT_DIR="$ROOT_DIR/bench/out"
+ZIG_CACHE_DIR="$OUT_DIR/zig-cache"
+LINES=${LINES:-200000}
+REPEAT=${REPEAT:-10}
+INPUT=${INPUT:-}
+BASELINE_SRC=${BASELINE_SRC:-}
+
+mkdir -p "$OUT_DIR" "$ZIG_CACHE_DIR"
+
+# build <lexer.zig> <out-bin>
+build() {
+    zig build-exe -OReleaseFast --dep lexer -Mroot="$ROOT_DIR/bench/lexer_bench.zig" \
+      -OReleaseFast -Mlexer="$1" \
+      -femit-bin="$2" --cache-dir "$ZIG_CACHE_DIR" --global-cache-dir "$ZIG_CACHE_DIR" >/dev/null
+}
+
+echo "--- Building lexer benchmark ---"
+build "$ROOT_DIR/compiler/src/lexer.zig" "$OUT_DIR/lexer_bench"
+if [ -n "$BASELINE_SRC" ]; then
+    build "$BASELINE_SRC/lexer.zig" "$OUT_DIR/lexer_bench_baseline"
+fi
+
+if [ -n "$INPUT" ]; then
+    inputs="$INPUT"
+else
+    inputs="$OUT_DIR/lexer_bench_mixed.1im $OUT_DIR/lexer_bench_names.1im"
+    awk -v lines="$LINES" 'BEGIN {
+        fns = int(lines / 8)
+        for (i = 0; i < fns; i++) {
+            printf "# helper %d: accumulates the weighted sum of its inputs over a range\n", i
+            printf "fun accumulate_weighted_total_%d with first_value as i64, second_value as i64 returns i64\n", i
+            printf "    set running_total_value as i64 to 1234567890\n"
+            printf "    loop for loop_index_variable in 0..first_value\n"
+            printf "        set running_total_value to running_total_value + loop_index_variable * 31415926\n"
+            printf "        print(\"intermediate running total for helper number %d is\")\n", i
+            printf "    return running_total_value + second_value * 2.718281828\n"
+            printf "\n"
+        }
+    }' > "$OUT_DIR/lexer_bench_mixed.1im"
+    # Every keyword plus non-keyword names that share a keyword length,
+    # first or last byte, so misses are exercised as much as hits.
+    awk -v lines="$LINES" 'BEGIN {
+        nkw = split("set to with as returns return if then else loop while for in break continue import from parallel fun true false null and or not try catch fn i8 i16 i32 i64 u8 u16 u32 u64 f32 f64 bool str void", kw, " ")
+        nnk = split("sat tx wish ab retired retain id thin elsa look whale fur on brake contain impart form parcel fin tree fable nail add of net tiy match fx i9 i17 x u9 u17 f33 f65 boot stir void_", nk, " ")
+        for (i = 0; i < lines; i++) {
+            line = ""
+            for (j = 0; j < 12; j++) {
+                w = (j % 2 == 0) ? kw[(i + j) % nkw + 1] : nk[(i * 7 + j) % nnk + 1]
+                line = line w " "
+            }
+            print line
+        }
+    }' > "$OUT_DIR/lexer_bench_names.1im"
+fi
+
+RESULTS="$OUT_DIR/lexer_bench.txt"
+: > "$RESULTS"
+for input in $inputs; do
+    echo "--- $(basename "$input") ---" | tee -a "$RESULTS"
+    printf "current:  %s\n" "$("$OUT_DIR/lexer_bench" "$input" "$REPEAT")" | tee -a "$RESULTS"
+    if [ -n "$BASELINE_SRC" ]; then
+        printf "baseline: %s\n" "$("$OUT_DIR/lexer_bench_baseline" "$input" "$REPEAT")" | tee -a "$RESULTS"
+    fi
+done
@@ -68,7 +68,7 @@ ZIG_BIN_SAFE="$OUT_DIR/parallel_block_zig_safe"
 ZIG_BIN_FAST="$OUT_DIR/parallel_block_zig_fast"
 ZIG_BIN_PAR="$OUT_DIR/parallel_block_zig_par"
 
-export OMP_NUM_THREADS=${OMP_NUM_THREADS:-4}
+export ONEIM_THREADS=${ONEIM_THREADS:-4}
 
 echo "--- Running Zig sequential binary (Debug) ---"
 TIME_ZIG_O0="$OUT_DIR/time_zig_parallel_o0.txt"
@@ -80,12 +80,12 @@ TIME_1IM_SEQ="$OUT_DIR/time_1im_parallel_seq.txt"
 /usr/bin/time -p -o "$TIME_1IM_SEQ" "$ONEIM_SEQ_BIN" >/dev/null 2>&1
 cat "$TIME_1IM_SEQ"
 
-echo "--- Running 1im parallel binary (OMP_NUM_THREADS=$OMP_NUM_THREADS) ---"
+echo "--- Running 1im parallel binary (ONEIM_THREADS=$ONEIM_THREADS) ---"
 TIME_1IM_PAR="$OUT_DIR/time_1im_parallel.txt"
 /usr/bin/time -p -o "$TIME_1IM_PAR" "$ONEIM_PAR_BIN" >/dev/null 2>&1
 cat "$TIME_1IM_PAR"
 
-echo "--- Running 1im parallel optimized binary (OMP_NUM_THREADS=$OMP_NUM_THREADS) ---"
+echo "--- Running 1im parallel optimized binary (ONEIM_THREADS=$ONEIM_THREADS) ---"
 TIME_1IM_PAR_OPT="$OUT_DIR/time_1im_parallel_opt.txt"
 /usr/bin/time -p -o "$TIME_1IM_PAR_OPT" "$ONEIM_PAR_OPT_BIN" >/dev/null 2>&1
 cat "$TIME_1IM_PAR_OPT"
@@ -0,0 +1,54 @@
+#!/bin/bash
+set -euo pipefail
+
+# Scaling of a `parallel loop for` on the task runtime: runs
+# parallel_for.1im with ONEIM_THREADS=1, 2, 4, ... up to the CPU count and
+# reports wall time and speedup over one thread.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+MAX_THREADS=${MAX_THREADS:-$(nproc)}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+BIN="$OUT_DIR/parallel_for"
+"$COMPILER" --emit-c "$ROOT_DIR/bench/parallel_for.1im" > "$BIN.c"
+cc -O3 -march=native -pthread -o "$BIN" "$BIN.c"
+
+# Average wall time (ms) over $REPEAT runs.
+measure() {
+    local total_ms=0 start end
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        "$@" >/dev/null
+        end=$(date +%s%N)
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/parallel_for_bench.txt"
+printf "%-8s %10s %8s\n" "threads" "time (ms)" "speedup" | tee "$RESULTS"
+
+base_ms=0
+threads=1
+while [ "$threads" -le "$MAX_THREADS" ]; do
+    export ONEIM_THREADS=$threads
+    ms=$(measure "$BIN")
+    [ "$threads" -eq 1 ] && base_ms=$ms
+    speedup=$(awk -v b="$base_ms" -v t="$ms" 'BEGIN { printf "%.2f", (t > 0 ? b / t : 0) }')
+    printf "%-8d %10d %7sx\n" "$threads" "$ms" "$speedup" | tee -a "$RESULTS"
+    if [ "$threads" -lt "$MAX_THREADS" ] && [ $(( threads * 2 )) -gt "$MAX_THREADS" ]; then
+        threads=$MAX_THREADS
+    else
+        threads=$(( threads * 2 ))
+    fi
+done
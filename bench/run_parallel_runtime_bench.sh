@@ -0,0 +1,61 @@
+#!/bin/bash
+set -euo pipefail
+
+# Wall time of `parallel` blocks on the task runtime:
+#   toyhash_parallel       four long workers, run once
+#   toyhash_parallel_args  the same work as one worker called with four
+#                          seeds by `set (...) to parallel`; should match
+#                          toyhash_parallel
+#   parallel_nested        four short workers, run 10000 times in a loop,
+#                          so block start-up and join dominate
+# Each program is emitted with --emit-c and built with the same cc flags
+# as the compiler uses.
+#
+# Set BASELINE=/path/to/older/1im to compare against another build, e.g.
+# one from before the runtime, which started a thread per call.
+# Set ONEIM_THREADS to size the pool.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+BASELINE=${BASELINE:-}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+# build <compiler> <source.1im> <out-bin>
+build() {
+    "$1" --emit-c "$2" > "$3.c"
+    cc -O3 -march=native -pthread -o "$3" "$3.c"
+}
+
+# Average wall time (ms) over $REPEAT runs.
+measure() {
+    local total_ms=0 start end
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        "$@" >/dev/null
+        end=$(date +%s%N)
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/parallel_runtime_bench.txt"
+printf "%-22s %-10s %10s\n" "program" "build" "time (ms)" | tee "$RESULTS"
+
+for name in toyhash_parallel toyhash_parallel_args parallel_nested; do
+    src="$ROOT_DIR/bench/$name.1im"
+    build "$COMPILER" "$src" "$OUT_DIR/${name}_runtime"
+    printf "%-22s %-10s %10d\n" "$name" "current" "$(measure "$OUT_DIR/${name}_runtime")" | tee -a "$RESULTS"
+    if [ -n "$BASELINE" ]; then
+        build "$BASELINE" "$src" "$OUT_DIR/${name}_baseline"
+        printf "%-22s %-10s %10d\n" "$name" "baseline" "$(measure "$OUT_DIR/${name}_baseline")" | tee -a "$RESULTS"
+    fi
+done
@@ -0,0 +1,59 @@
+#!/bin/bash
+set -euo pipefail
+
+# Cost of `print` on output-heavy programs: print_ints.1im and
+# print_floats.1im each write millions of lines. The generated code, which
+# formats into a 64 KiB buffer flushed with write(2), is compared with the
+# printf lowering it replaced, made by rewriting the generated C. Both
+# versions must print the same bytes.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+# Average wall time (ms) over $REPEAT runs, output to $2.
+measure() {
+    local total_ms=0 start end
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        "$1" > "$2"
+        end=$(date +%s%N)
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/print_bench.txt"
+printf "%-14s %10s %14s %14s %8s\n" "program" "lines" "buffered (ms)" "printf (ms)" "speedup" | tee "$RESULTS"
+
+for name in print_ints print_floats; do
+    BIN="$OUT_DIR/$name"
+    "$COMPILER" --emit-c "$ROOT_DIR/bench/$name.1im" > "$BIN.c"
+    sed -e 's/^\( *\)__1im_print_i64((int64_t)/\1printf("%" PRId64 "\\n", (int64_t)/' \
+        -e 's/^\( *\)__1im_print_u64((uint64_t)/\1printf("%" PRIu64 "\\n", (uint64_t)/' \
+        -e 's/^\( *\)__1im_print_f64(/\1printf("%f\\n", /' \
+        -e 's/^\( *\)__1im_print_cstr(/\1printf("%s\\n", /' \
+        "$BIN.c" > "${BIN}_printf.c"
+    for variant in "$BIN" "${BIN}_printf"; do
+        cc -O3 -march=native -pthread -o "$variant" "$variant.c"
+    done
+
+    buffered_ms=$(measure "$BIN" "$OUT_DIR/$name.out")
+    printf_ms=$(measure "${BIN}_printf" "$OUT_DIR/${name}_printf.out")
+    if ! cmp -s "$OUT_DIR/$name.out" "$OUT_DIR/${name}_printf.out"; then
+        echo "FAIL: $name prints differently from printf"
+        exit 1
+    fi
+    lines=$(wc -l < "$OUT_DIR/$name.out")
+    speedup=$(awk -v b="$buffered_ms" -v p="$printf_ms" 'BEGIN { printf "%.2f", (b > 0 ? p / b : 0) }')
+    printf "%-14s %10d %14d %14d %7sx\n" "$name" "$lines" "$buffered_ms" "$printf_ms" "$speedup" | tee -a "$RESULTS"
+done
@@ -0,0 +1,63 @@
+#!/bin/bash
+set -euo pipefail
+
+# `print` inside a parallel loop: print_parallel.1im prints 1000000
+# integers from every worker. The runtime's buffered print is compared with
+# the printf lowering it replaced, made by rewriting the generated C. Both
+# write to a file and are checked for whole, unduplicated lines.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+COUNT=1000000
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+BIN="$OUT_DIR/print_parallel"
+"$COMPILER" --emit-c "$ROOT_DIR/bench/print_parallel.1im" > "$BIN.c"
+sed 's/__1im_print_i64((int64_t)/printf("%" PRId64 "\\n", (int64_t)/' "$BIN.c" > "${BIN}_printf.c"
+for variant in "$BIN" "${BIN}_printf"; do
+    cc -O3 -march=native -pthread -o "$variant" "$variant.c"
+done
+
+# Average wall time (ms) over $REPEAT runs.
+measure() {
+    local total_ms=0 start end
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        "$@" > "$OUT_DIR/print_parallel.out"
+        end=$(date +%s%N)
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+check() {
+    local lines
+    lines=$(sort -n -u "$OUT_DIR/print_parallel.out" | grep -c -E '^[0-9]+$')
+    if [ "$lines" -ne "$COUNT" ]; then
+        echo "FAIL: $1 printed $lines distinct numbers, expected $COUNT"
+        exit 1
+    fi
+}
+
+RESULTS="$OUT_DIR/print_parallel_bench.txt"
+printf "%-8s %14s %14s %8s\n" "threads" "buffered (ms)" "printf (ms)" "speedup" | tee "$RESULTS"
+
+for threads in 1 "$(nproc)"; do
+    export ONEIM_THREADS=$threads
+    buffered_ms=$(measure "$BIN")
+    check buffered
+    printf_ms=$(measure "${BIN}_printf")
+    check printf
+    speedup=$(awk -v b="$buffered_ms" -v p="$printf_ms" 'BEGIN { printf "%.2f", (b > 0 ? p / b : 0) }')
+    printf "%-8d %14d %14d %7sx\n" "$threads" "$buffered_ms" "$printf_ms" "$speedup" | tee -a "$RESULTS"
+    [ "$(nproc)" -eq 1 ] && break
+done
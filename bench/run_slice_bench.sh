@@ -0,0 +1,54 @@
+#!/bin/bash
+set -euo pipefail
+
+# Slicing inside a loop: five million iterations each take a 512-element
+# array as a slice and a 64-element window of it. slice_view.1im uses
+# views, which copy nothing; slice_copy.1im copies both out with copy(),
+# which is what a slice of an array variable used to cost. Both must
+# print the same total.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+for name in slice_view slice_copy; do
+    "$COMPILER" --emit-c "$ROOT_DIR/bench/$name.1im" > "$OUT_DIR/$name.c"
+    cc -O3 -march=native -pthread -o "$OUT_DIR/$name" "$OUT_DIR/$name.c"
+done
+
+expected=$("$OUT_DIR/slice_view")
+
+# Average wall time (ms) over $REPEAT runs; fails on a wrong total.
+measure() {
+    local total_ms=0 start end got
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        got=$("$OUT_DIR/$1")
+        end=$(date +%s%N)
+        if [ "$got" != "$expected" ]; then
+            echo "FAIL: $1 printed $got, expected $expected" >&2
+            exit 1
+        fi
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/slice_bench.txt"
+printf "%-12s %10s %10s\n" "program" "time (ms)" "vs view" | tee "$RESULTS"
+
+view_ms=$(measure slice_view)
+for name in slice_view slice_copy; do
+    ms=$([ "$name" = slice_view ] && echo "$view_ms" || measure "$name")
+    ratio=$(awk -v a="$ms" -v b="$view_ms" 'BEGIN { printf "%.2fx", (b > 0 ? a / b : 0) }')
+    printf "%-12s %10d %10s\n" "$name" "$ms" "$ratio" | tee -a "$RESULTS"
+done
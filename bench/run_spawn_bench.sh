@@ -0,0 +1,51 @@
+#!/bin/bash
+set -euo pipefail
+
+# Per-task cost of `spawn`/`await` on the task runtime: spawn_many.1im runs
+# 100000 tiny calls as tasks, spawn_many_seq.1im makes the same calls
+# directly. The difference divided by the task count is the overhead of one
+# spawn plus its await. Runs with ONEIM_THREADS=1 and with every CPU.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+TASKS=100000
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+for name in spawn_many spawn_many_seq; do
+    "$COMPILER" --emit-c "$ROOT_DIR/bench/$name.1im" > "$OUT_DIR/$name.c"
+    cc -O3 -march=native -pthread -o "$OUT_DIR/$name" "$OUT_DIR/$name.c"
+done
+
+# Average wall time (us) over $REPEAT runs.
+measure() {
+    local total_us=0 start end
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        "$@" >/dev/null
+        end=$(date +%s%N)
+        total_us=$(( total_us + (end - start) / 1000 ))
+    done
+    echo $(( total_us / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/spawn_bench.txt"
+printf "%-8s %12s %12s %12s\n" "threads" "spawn (ms)" "direct (ms)" "us/task" | tee "$RESULTS"
+
+for threads in 1 "$(nproc)"; do
+    export ONEIM_THREADS=$threads
+    spawn_us=$(measure "$OUT_DIR/spawn_many")
+    seq_us=$(measure "$OUT_DIR/spawn_many_seq")
+    per_task=$(awk -v s="$spawn_us" -v d="$seq_us" -v n="$TASKS" 'BEGIN { printf "%.3f", (s - d) / n }')
+    printf "%-8d %12.1f %12.1f %12s\n" "$threads" "$(awk -v u="$spawn_us" 'BEGIN { print u / 1000 }')" \
+        "$(awk -v u="$seq_us" 'BEGIN { print u / 1000 }')" "$per_task" | tee -a "$RESULTS"
+    [ "$(nproc)" -eq 1 ] && break
+done
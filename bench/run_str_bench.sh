@@ -0,0 +1,52 @@
+#!/bin/bash
+set -euo pipefail
+
+# String building: str_build.1im appends eight short pieces at a time with
+# `+` until the string is 10 MB long, and str_build.c does the same with a
+# hand-written buffer that doubles when it is full. Both must print the
+# same length.
+
+ROOT_DIR="$(cd "$(dirname "$0")/.." && pwd)"
+COMPILER="$ROOT_DIR/compiler/zig-out/bin/1im"
+OUT_DIR="$ROOT_DIR/bench/out"
+REPEAT=${REPEAT:-5}
+
+mkdir -p "$OUT_DIR"
+
+if [ ! -f "$COMPILER" ]; then
+    echo "Compiler not found at $COMPILER"
+    echo "Building compiler..."
+    (cd "$ROOT_DIR/compiler" && zig build -Doptimize=ReleaseFast)
+fi
+
+"$COMPILER" --emit-c "$ROOT_DIR/bench/str_build.1im" > "$OUT_DIR/str_build_1im.c"
+cc -O3 -march=native -pthread -o "$OUT_DIR/str_build_1im" "$OUT_DIR/str_build_1im.c"
+cc -O3 -march=native -o "$OUT_DIR/str_build_c" "$ROOT_DIR/bench/str_build.c"
+
+expected=$("$OUT_DIR/str_build_c")
+
+# Average wall time (ms) over $REPEAT runs; fails on a wrong length.
+measure() {
+    local total_ms=0 start end got
+    for _ in $(seq "$REPEAT"); do
+        start=$(date +%s%N)
+        got=$("$OUT_DIR/$1")
+        end=$(date +%s%N)
+        if [ "$got" != "$expected" ]; then
+            echo "FAIL: $1 printed $got, expected $expected" >&2
+            exit 1
+        fi
+        total_ms=$(( total_ms + (end - start) / 1000000 ))
+    done
+    echo $(( total_ms / REPEAT ))
+}
+
+RESULTS="$OUT_DIR/str_bench.txt"
+printf "%-14s %10s %10s %10s\n" "program" "bytes" "time (ms)" "vs C" | tee "$RESULTS"
+
+c_ms=$(measure str_build_c)
+for name in str_build_c str_build_1im; do
+    ms=$([ "$name" = str_build_c ] && echo "$c_ms" || measure "$name")
+    ratio=$(awk -v a="$ms" -v b="$c_ms" 'BEGIN { printf "%.2fx", (b > 0 ? a / b : 0) }')
+    printf "%-14s %10s %10d %10s\n" "$name" "$expected" "$ms" "$ratio" | tee -a "$RESULTS"
+done
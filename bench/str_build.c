@@ -0,0 +1,30 @@
+/* String building baseline for run_str_bench.sh: str_build.1im written by
+   hand in C, appending to one buffer that doubles when it is full. */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static char* buf;
+static size_t len, cap;
+
+static void put(const char* s) {
+    size_t n = strlen(s);
+    if (len + n > cap) {
+        cap = cap ? cap * 2 : 64;
+        buf = realloc(buf, cap);
+        if (buf == NULL) abort();
+    }
+    memcpy(buf + len, s, n);
+    len += n;
+}
+
+int main(void) {
+    static const char* pieces[] = { "a", "bc", "def", "ghij", "klmno", "pqrstu", "vwxyzAB", "CDEFGHIJ" };
+    for (int64_t r = 0; r < 277778; r++) {
+        for (int k = 0; k < 8; k++) put(pieces[k]);
+    }
+    printf("%zu\n", len);
+    free(buf);
+    return 0;
+}
@@ -1,24 +1,264 @@
-/// AST node types for the 1im language.
-/// Uses Zig tagged unions for type-safe tree representation.
+/// AST for the 1im language, stored data-oriented: every node is one entry
+/// in parallel `tags`/`data` arrays addressed by a u32 `Index`, and
+/// anything that does not fit in two u32s lives in the `extra` array.
+/// `Tree.node` decodes an entry into the `Node` tagged union for consumers.
+const std = @import("std");
+
+pub const Index = u32;
+
+/// Marks an absent optional child or list.
+pub const none: Index = std.math.maxInt(u32);
+
+pub const Tag = enum(u8) {
+    /// lhs..rhs: statements in `extra`
+    program,
+    /// lhs: module name offset, rhs: length
+    import_decl,
+    /// lhs: Affinity
+    affinity_decl,
+    /// lhs: value, rhs: extra[name_off, name_len]
+    set_assign,
+    /// lhs: value, rhs: extra[name_off, name_len, type]
+    typed_assign,
+    /// lhs: extra[name_off, name_len, params_start, params_end, return_type or none, body_start, body_end]
+    function_def,
+    /// lhs: value or none
+    return_stmt,
+    /// lhs: condition, rhs: extra[then_start, then_end, else_ifs_start, else_ifs_end, else_start or none, else_end]
+    if_stmt,
+    /// lhs: condition, rhs: extra[body_start, body_end]
+    else_if,
+    /// lhs: condition, rhs: extra[body_start, body_end, parallel]
+    while_loop,
+    /// lhs: iterable, rhs: extra[var_off, var_len, body_start, body_end, parallel, schedule, grain or none, reductions_start, reductions_end]
+    for_loop,
+    /// lhs..rhs: body in `extra`
+    parallel_block,
+    /// lhs: extra[targets_start, targets_end, calls_start, calls_end]
+    parallel_assign,
+    /// lhs: value or none
+    break_stmt,
+    continue_stmt,
+    /// lhs: try expression, rhs: extra[var_off or none, var_len, body_start, body_end]
+    try_catch,
+    /// lhs: operand
+    try_expr,
+    /// lhs: call
+    spawn_expr,
+    /// lhs: operand
+    await_expr,
+    /// lhs: expression
+    expr_stmt,
+    /// lhs: extra[callee_off, callee_len, args_start, args_end]
+    call,
+    /// lhs, rhs: low and high halves of the i64 value
+    int_literal,
+    /// lhs, rhs: low and high halves of the f64 bits
+    float_literal,
+    /// lhs: source offset, rhs: length (contents between the quotes)
+    string_literal,
+    /// lhs..rhs: parts in `extra`
+    interpolation,
+    /// lhs: 0 or 1
+    bool_literal,
+    null_literal,
+    /// lhs: source offset, rhs: length
+    variable,
+    // Binary operators, in `BinaryOp.Op` order. lhs: left, rhs: right.
+    add,
+    sub,
+    mul,
+    div,
+    mod,
+    eq,
+    neq,
+    lt,
+    lte,
+    gt,
+    gte,
+    bool_and,
+    bool_or,
+    /// lhs: operand
+    negate,
+    /// lhs: operand
+    bool_not,
+    /// lhs..rhs: elements in `extra`
+    array_literal,
+    /// lhs: target, rhs: index
+    index_expr,
+    /// lhs: target, rhs: value
+    index_assign,
+    /// lhs: start, rhs: end
+    range,
+    /// lhs: start, rhs: end
+    range_inclusive,
+
+    pub fn fromBinaryOp(op: BinaryOp.Op) Tag {
+        return @enumFromInt(@intFromEnum(Tag.add) + @intFromEnum(op));
+    }
+
+    comptime {
+        std.debug.assert(@intFromEnum(Tag.bool_or) - @intFromEnum(Tag.add) + 1 == @typeInfo(BinaryOp.Op).@"enum".fields.len);
+        std.debug.assert(@intFromEnum(Tag.bool_not) - @intFromEnum(Tag.negate) + 1 == @typeInfo(UnaryOp.Op).@"enum".fields.len);
+    }
+};
+
+pub const Data = struct {
+    lhs: u32,
+    rhs: u32,
+};
+
+/// A parsed program. Owns nothing; the parser's allocator owns the arrays
+/// and names are slices of `source`.
+pub const Tree = struct {
+    tags: []const Tag,
+    data: []const Data,
+    extra: []const u32,
+    types: []const Type,
+    params: []const Param,
+    reductions: []const Reduction,
+    source: []const u8,
+    root: Index,
+
+    pub fn nodeCount(self: *const Tree) u32 {
+        return @intCast(self.tags.len);
+    }
+
+    /// Top-level statements of the program.
+    pub fn rootStmts(self: *const Tree) []const Index {
+        return self.node(self.root).program.stmts;
+    }
+
+    /// Decode node `i` into its tagged-union view. Child nodes and lists
+    /// come back as indices into this tree.
+    pub fn node(self: *const Tree, i: Index) Node {
+        const d = self.data[i];
+        const x = self.extra;
+        return switch (self.tags[i]) {
+            .program => .{ .program = .{ .stmts = x[d.lhs..d.rhs] } },
+            .import_decl => .{ .import_decl = .{ .module = self.str(d.lhs, d.rhs) } },
+            .affinity_decl => .{ .affinity_decl = .{ .affinity = @enumFromInt(d.lhs) } },
+            .set_assign => .{ .set_assign = .{ .name = self.str(x[d.rhs], x[d.rhs + 1]), .value = d.lhs } },
+            .typed_assign => .{ .typed_assign = .{
+                .name = self.str(x[d.rhs], x[d.rhs + 1]),
+                .type_info = self.types[x[d.rhs + 2]],
+                .value = d.lhs,
+            } },
+            .function_def => .{ .function_def = .{
+                .name = self.str(x[d.lhs], x[d.lhs + 1]),
+                .params = self.params[x[d.lhs + 2]..x[d.lhs + 3]],
+                .return_type = if (x[d.lhs + 4] == none) null else self.types[x[d.lhs + 4]],
+                .body = x[x[d.lhs + 5]..x[d.lhs + 6]],
+            } },
+            .return_stmt => .{ .return_stmt = .{ .value = optional(d.lhs) } },
+            .if_stmt => .{ .if_stmt = .{
+                .condition = d.lhs,
+                .then_body = x[x[d.rhs]..x[d.rhs + 1]],
+                .else_ifs = x[x[d.rhs + 2]..x[d.rhs + 3]],
+                .else_body = if (x[d.rhs + 4] == none) null else x[x[d.rhs + 4]..x[d.rhs + 5]],
+            } },
+            .else_if => .{ .else_if = .{ .condition = d.lhs, .body = x[x[d.rhs]..x[d.rhs + 1]] } },
+            .while_loop => .{ .while_loop = .{
+                .condition = d.lhs,
+                .body = x[x[d.rhs]..x[d.rhs + 1]],
+                .parallel = x[d.rhs + 2] != 0,
+            } },
+            .for_loop => .{ .for_loop = .{
+                .variable = self.str(x[d.rhs], x[d.rhs + 1]),
+                .iterable = d.lhs,
+                .body = x[x[d.rhs + 2]..x[d.rhs + 3]],
+                .parallel = x[d.rhs + 4] != 0,
+                .schedule = @enumFromInt(x[d.rhs + 5]),
+                .grain = optional(x[d.rhs + 6]),
+                .reductions = self.reductions[x[d.rhs + 7]..x[d.rhs + 8]],
+            } },
+            .parallel_block => .{ .parallel_block = .{ .body = x[d.lhs..d.rhs] } },
+            .parallel_assign => .{ .parallel_assign = .{
+                .targets = x[x[d.lhs]..x[d.lhs + 1]],
+                .calls = x[x[d.lhs + 2]..x[d.lhs + 3]],
+            } },
+            .break_stmt => .{ .break_stmt = .{ .value = optional(d.lhs) } },
+            .continue_stmt => .{ .continue_stmt = .{} },
+            .try_catch => .{ .try_catch = .{
+                .try_expr = d.lhs,
+                .catch_var = if (x[d.rhs] == none) null else self.str(x[d.rhs], x[d.rhs + 1]),
+                .catch_body = x[x[d.rhs + 2]..x[d.rhs + 3]],
+            } },
+            .try_expr => .{ .try_expr = .{ .expr = d.lhs } },
+            .spawn_expr => .{ .spawn_expr = .{ .call = d.lhs } },
+            .await_expr => .{ .await_expr = .{ .expr = d.lhs } },
+            .expr_stmt => .{ .expr_stmt = .{ .expr = d.lhs } },
+            .call => .{ .call = .{
+                .callee = self.str(x[d.lhs], x[d.lhs + 1]),
+                .args = x[x[d.lhs + 2]..x[d.lhs + 3]],
+            } },
+            .int_literal => .{ .int_literal = .{ .value = @bitCast(wide(d)) } },
+            .float_literal => .{ .float_literal = .{ .value = @bitCast(wide(d)) } },
+            .string_literal => .{ .string_literal = .{ .value = self.str(d.lhs, d.rhs) } },
+            .interpolation => .{ .interpolation = .{ .parts = x[d.lhs..d.rhs] } },
+            .bool_literal => .{ .bool_literal = .{ .value = d.lhs != 0 } },
+            .null_literal => .{ .null_literal = .{} },
+            .variable => .{ .variable = .{ .name = self.str(d.lhs, d.rhs) } },
+            .add, .sub, .mul, .div, .mod, .eq, .neq, .lt, .lte, .gt, .gte, .bool_and, .bool_or => |tag| .{ .binary_op = .{
+                .op = @enumFromInt(@intFromEnum(tag) - @intFromEnum(Tag.add)),
+                .left = d.lhs,
+                .right = d.rhs,
+            } },
+            .negate, .bool_not => |tag| .{ .unary_op = .{
+                .op = @enumFromInt(@intFromEnum(tag) - @intFromEnum(Tag.negate)),
+                .operand = d.lhs,
+            } },
+            .array_literal => .{ .array_literal = .{ .elements = x[d.lhs..d.rhs] } },
+            .index_expr => .{ .index_expr = .{ .target = d.lhs, .index = d.rhs } },
+            .index_assign => .{ .index_assign = .{ .target = d.lhs, .value = d.rhs } },
+            .range, .range_inclusive => |tag| .{ .range = .{
+                .start = d.lhs,
+                .end = d.rhs,
+                .inclusive = tag == .range_inclusive,
+            } },
+        };
+    }
+
+    fn str(self: *const Tree, off: u32, len: u32) []const u8 {
+        return self.source[off..][0..len];
+    }
+
+    fn optional(i: Index) ?Index {
+        return if (i == none) null else i;
+    }
+
+    fn wide(d: Data) u64 {
+        return @as(u64, d.rhs) << 32 | d.lhs;
+    }
+};
+
+/// Decoded view of one node, as returned by `Tree.node`.
 pub const Node = union(enum) {
     program: Program,
+    import_decl: ImportDecl,
+    affinity_decl: AffinityDecl,
     set_assign: SetAssign,
     typed_assign: TypedAssign,
     function_def: FunctionDef,
     return_stmt: ReturnStmt,
     if_stmt: IfStmt,
+    else_if: ElseIf,
     while_loop: WhileLoop,
     for_loop: ForLoop,
     parallel_block: ParallelBlock,
+    parallel_assign: ParallelAssign,
     break_stmt: BreakStmt,
     continue_stmt: ContinueStmt,
     try_catch: TryCatch,
     try_expr: TryExpr,
+    spawn_expr: SpawnExpr,
+    await_expr: AwaitExpr,
     expr_stmt: ExprStmt,
     call: Call,
     int_literal: IntLiteral,
     float_literal: FloatLiteral,
     string_literal: StringLiteral,
+    interpolation: Interpolation,
     bool_literal: BoolLiteral,
     null_literal: NullLiteral,
     variable: Variable,
@@ -31,20 +271,40 @@ pub const Node = union(enum) {
 };
 
 pub const Program = struct {
-    stmts: []const Node,
+    stmts: []const Index,
+};
+
+/// `import <module>`, top level only
+pub const ImportDecl = struct {
+    module: []const u8,
+};
+
+/// `parallel affinity <mode>`, top level of the entry module only
+pub const AffinityDecl = struct {
+    affinity: Affinity,
+
+    /// Where the runtime's worker threads run; `$ONEIM_AFFINITY` overrides.
+    pub const Affinity = enum(u32) {
+        /// Wherever the OS schedules them.
+        none,
+        /// Pinned one per CPU, filling a NUMA node before the next.
+        compact,
+        /// Pinned one per CPU, dealt round-robin across NUMA nodes.
+        spread,
+    };
 };
 
 /// `set <name> to <expr>`
 pub const SetAssign = struct {
     name: []const u8,
-    value: *const Node,
+    value: Index,
 };
 
 /// `set <name> as <type> to <expr>`
 pub const TypedAssign = struct {
     name: []const u8,
     type_info: Type,
-    value: *const Node,
+    value: Index,
 };
 
 /// Function parameter
@@ -58,50 +318,97 @@ pub const FunctionDef = struct {
     name: []const u8,
     params: []const Param,
     return_type: ?Type, // null for void
-    body: []const Node,
+    body: []const Index,
 };
 
 /// `return <expr>`
 pub const ReturnStmt = struct {
-    value: ?*const Node, // null for void return
+    value: ?Index, // null for void return
 };
 
 /// `if <cond> then\n<body>\n[else if...]\n[else\n<body>]`
 pub const IfStmt = struct {
-    condition: *const Node,
-    then_body: []const Node,
-    else_ifs: []const ElseIf,
-    else_body: ?[]const Node,
+    condition: Index,
+    then_body: []const Index,
+    /// `else_if` nodes, in source order.
+    else_ifs: []const Index,
+    else_body: ?[]const Index,
 };
 
 pub const ElseIf = struct {
-    condition: *const Node,
-    body: []const Node,
+    condition: Index,
+    body: []const Index,
 };
 
 /// `loop while <cond>\n<body>`
 pub const WhileLoop = struct {
-    condition: *const Node,
-    body: []const Node,
+    condition: Index,
+    body: []const Index,
     parallel: bool,
 };
 
-/// `loop for <var> in <iter>\n<body>`
+/// `[parallel] loop for <var> in <iter> [with <schedule> [<grain>]] [reduce <reductions>]\n<body>`
 pub const ForLoop = struct {
     variable: []const u8,
-    iterable: *const Node,
-    body: []const Node,
+    iterable: Index,
+    body: []const Index,
     parallel: bool,
+    /// How a parallel loop's iterations are handed out to threads.
+    schedule: Schedule,
+    /// Iterations per chunk; null lets the runtime pick.
+    grain: ?Index,
+    /// Accumulators each thread updates privately; empty unless parallel.
+    reductions: []const Reduction,
+
+    pub const Schedule = enum(u32) {
+        /// Fixed chunks dealt round-robin, one contiguous block per thread
+        /// by default.
+        static,
+        /// Threads claim the next chunk as they finish one.
+        dynamic,
+        /// Like `dynamic`, with chunks shrinking as the work runs out.
+        guided,
+    };
+};
+
+/// `<op> <name>` or `<function> <name> from <identity>` in a parallel
+/// loop's `reduce` clause
+pub const Reduction = struct {
+    op: Op,
+    /// Accumulator, declared before the loop.
+    name: []const u8,
+    /// `fun f with a as T, b as T returns T` for `.custom`; empty otherwise.
+    combiner: []const u8,
+    /// Starting value of every partial for `.custom`.
+    identity: ?Index,
+
+    pub const Op = enum {
+        sum,
+        product,
+        min,
+        max,
+        /// Combined with `combiner`.
+        custom,
+    };
 };
 
 /// `parallel\n<body>`
 pub const ParallelBlock = struct {
-    body: []const Node,
+    body: []const Index,
+};
+
+/// `set (<name>, ...) to parallel <call>, ...`: the calls run concurrently
+/// and each result is bound to the name in the same position
+pub const ParallelAssign = struct {
+    /// `variable` nodes.
+    targets: []const Index,
+    /// `call` nodes.
+    calls: []const Index,
 };
 
 /// `break [<expr>]`
 pub const BreakStmt = struct {
-    value: ?*const Node, // for break with value
+    value: ?Index, // for break with value
 };
 
 /// `continue`
@@ -109,25 +416,112 @@ pub const ContinueStmt = struct {};
 
 /// `try <expr> catch <var>\n<body>`
 pub const TryCatch = struct {
-    try_expr: *const Node,
+    try_expr: Index,
     catch_var: ?[]const u8,
-    catch_body: []const Node,
+    catch_body: []const Index,
 };
 
 /// `try <expr>` used as an expression (propagate on error)
 pub const TryExpr = struct {
-    expr: *const Node,
+    expr: Index,
+};
+
+/// `spawn <call>`, only as the value of `set <name> to`: starts the call
+/// as a task and evaluates to a future of its result
+pub const SpawnExpr = struct {
+    call: Index,
+};
+
+/// `await <expr>`: waits for a future and evaluates to its result
+pub const AwaitExpr = struct {
+    expr: Index,
 };
 
 /// Expression used as a statement (e.g., a function call)
 pub const ExprStmt = struct {
-    expr: *const Node,
+    expr: Index,
 };
 
 /// Function call: `<callee>(<args>)`
 pub const Call = struct {
     callee: []const u8,
-    args: []const Node,
+    args: []const Index,
+};
+
+/// Functions over atomics, mutexes and channels that every program can call.
+pub const SyncBuiltin = enum {
+    /// `atomic_load(a[, order])`
+    atomic_load,
+    /// `atomic_store(a, value[, order])`
+    atomic_store,
+    /// `atomic_add(a, value[, order])`: evaluates to the previous value
+    atomic_add,
+    /// `atomic_cas(a, expected, desired[, order])`: stores `desired` if `a`
+    /// holds `expected`, and evaluates to whether it did
+    atomic_cas,
+    /// `mutex()`: a new, unlocked mutex
+    mutex,
+    lock,
+    unlock,
+    /// `channel(capacity)`: a new, empty channel; only as the value of a
+    /// `set name as channel T to ...`
+    channel,
+    /// `send(ch, value)`: waits while the channel is full
+    send,
+    /// `receive(ch)`: waits while the channel is empty
+    receive,
+
+    pub fn of(callee: []const u8) ?SyncBuiltin {
+        return std.meta.stringToEnum(SyncBuiltin, callee);
+    }
+};
+
+/// Functions over heap slices and arenas that every program can call.
+pub const AllocBuiltin = enum {
+    /// `alloc(len[, arena])`: `len` zeroed elements on the heap or in the
+    /// arena; only as the value of a `set name as []T to ...`
+    alloc,
+    /// `append(xs, value)`: grows `xs`, a slice variable, by one element,
+    /// moving it to a buffer twice the size when it is full
+    append,
+    /// `reserve(xs, n)`: makes room in `xs` for at least `n` elements
+    reserve,
+    /// `cap(xs)`: how many elements `xs` holds before `append` moves it
+    cap,
+    /// `free(xs)` releases a heap slice and leaves it empty; `free(a)`
+    /// releases all of an arena's memory
+    free,
+    /// `arena()`: a new, empty arena
+    arena,
+    /// `reset(a)`: frees everything allocated from `a` at once, keeping
+    /// its newest block for what comes next
+    reset,
+    /// `copy(xs)`: a new heap slice holding the elements of an array or
+    /// slice, where `xs[a..b]` and `set s as []T to arr` only view them
+    copy,
+
+    pub fn of(callee: []const u8) ?AllocBuiltin {
+        return std.meta.stringToEnum(AllocBuiltin, callee);
+    }
+
+    /// Whether the builtin changes the slice given as its first argument.
+    pub fn mutatesSlice(self: AllocBuiltin) bool {
+        return self == .append or self == .reserve or self == .free;
+    }
+};
+
+/// The optional last argument of the `atomic_*` builtins, a string literal;
+/// `seq_cst` when left out.
+pub const MemoryOrder = enum {
+    relaxed,
+    acquire,
+    release,
+    acq_rel,
+    seq_cst,
+
+    pub fn of(name: []const u8) ?MemoryOrder {
+        return std.meta.stringToEnum(MemoryOrder, name);
+    }
 };
 
 pub const IntLiteral = struct {
@@ -142,6 +536,12 @@ pub const StringLiteral = struct {
     value: []const u8,
 };
 
+/// `"text {expr} text"`: string literals for the text, source escapes and
+/// all, between the expressions, in order
+pub const Interpolation = struct {
+    parts: []const Index,
+};
+
 pub const BoolLiteral = struct {
     value: bool,
 };
@@ -154,8 +554,8 @@ pub const Variable = struct {
 
 pub const BinaryOp = struct {
     op: Op,
-    left: *const Node,
-    right: *const Node,
+    left: Index,
+    right: Index,
 
     pub const Op = enum {
         add,
@@ -176,7 +576,7 @@ pub const BinaryOp = struct {
 
 pub const UnaryOp = struct {
     op: Op,
-    operand: *const Node,
+    operand: Index,
 
     pub const Op = enum {
         negate,
@@ -186,25 +586,25 @@ pub const UnaryOp = struct {
 
 /// Array literal: `[a, b, c]`
 pub const ArrayLiteral = struct {
-    elements: []const Node,
+    elements: []const Index,
 };
 
 /// Indexing expression: `target[index]`
 pub const IndexExpr = struct {
-    target: *const Node,
-    index: *const Node,
+    target: Index,
+    index: Index,
 };
 
 /// Index assignment: `set target[index] to value`
 pub const IndexAssign = struct {
-    target: *const Node,
-    value: *const Node,
+    target: Index,
+    value: Index,
 };
 
 /// Range expression: `start..end` or `start..=end`
 pub const Range = struct {
-    start: *const Node,
-    end: *const Node,
+    start: Index,
+    end: Index,
     inclusive: bool,
 };
 
@@ -226,6 +626,19 @@ pub const Type = union(enum) {
     error_union: ErrorUnionType,
     array: ArrayType,
     slice: SliceType,
+    /// Result of `spawn`; only inferred, never written.
+    future: FutureType,
+    /// `atomic T` for an integer `T`. Lives where it is declared and is
+    /// shared by reference, so tasks given it update the same cell.
+    atomic: AtomicType,
+    /// Made by `mutex()`; shared by reference like an atomic.
+    mutex,
+    /// `channel T`: a bounded queue of `T` values between tasks. Lives on the
+    /// heap for the rest of the program, so it may be returned and spawned.
+    channel: ChannelType,
+    /// Made by `arena()`; lives for the rest of the program, though `free`
+    /// and `reset` release the memory allocated from it.
+    arena,
 
     pub fn toCString(self: Type) []const u8 {
         return switch (self) {
@@ -240,11 +653,16 @@ pub const Type = union(enum) {
             .f32 => "float",
             .f64 => "double",
             .bool => "bool",
-            .str => "const char*",
+            .str => "__1im_str",
             .void => "void",
             .array => |arr| arr.elem.toCString(),
             .slice => |s| s.elem.toCString(),
             .error_union => "void",
+            .future => "void*",
+            .atomic => "void*",
+            .mutex => "__1im_mutex*",
+            .channel => "__1im_channel*",
+            .arena => "__1im_arena*",
         };
     }
 
@@ -259,7 +677,7 @@ pub const Type = union(enum) {
             .str => "%s",
             .void => "",
             .array, .slice => "%p",
-            .error_union => "%p",
+            .error_union, .future, .atomic, .mutex, .channel, .arena => "%p",
         };
     }
 };
@@ -277,3 +695,16 @@ pub const ArrayType = struct {
 pub const SliceType = struct {
     elem: *const Type,
 };
+
+pub const AtomicType = struct {
+    elem: *const Type,
+};
+
+pub const ChannelType = struct {
+    elem: *const Type,
+};
+
+pub const FutureType = struct {
+    /// The spawned call's return type; may be `void` or an error union.
+    result: *const Type,
+};
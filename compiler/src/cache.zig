@@ -0,0 +1,233 @@
+/// Content-addressed on-disk cache of compiled 1im programs.
+///
+/// Each entry is an executable named by the hex digest of the compiler
+/// identity, the C compiler flags and the source bytes, so an unchanged
+/// program skips lex → parse → codegen → cc and runs straight from the cache.
+/// The directory is bounded by `max_bytes`: after every store the least
+/// recently used entries (by mtime, refreshed on each hit) are evicted.
+const std = @import("std");
+
+/// Bump whenever generated C changes shape so older entries are never reused.
+pub const compiler_version = "0.2.0";
+
+const stats_file = "stats";
+const default_max_mb: u64 = 256;
+
+pub const Key = [64]u8;
+
+const Entry = struct {
+    name: []const u8,
+    size: u64,
+    mtime: i128,
+};
+
+pub const Cache = struct {
+    allocator: std.mem.Allocator,
+    dir: std.fs.Dir,
+    dir_path: []const u8,
+    max_bytes: u64,
+    stats: Stats,
+
+    pub const Stats = struct {
+        hits: u64 = 0,
+        misses: u64 = 0,
+        evictions: u64 = 0,
+    };
+
+    pub const Usage = struct {
+        entries: usize,
+        bytes: u64,
+    };
+
+    /// Opens (creating if needed) the cache directory, or returns null when no
+    /// location can be determined. `$ONEIM_CACHE_DIR` wins over
+    /// `$XDG_CACHE_HOME/1im` and `$HOME/.cache/1im`; `$ONEIM_CACHE_MAX_MB`
+    /// overrides the size limit.
+    pub fn open(allocator: std.mem.Allocator) !?Cache {
+        const dir_path = (try resolveDir(allocator)) orelse return null;
+        errdefer allocator.free(dir_path);
+
+        const dir = try std.fs.cwd().makeOpenPath(dir_path, .{ .iterate = true });
+
+        var max_mb = default_max_mb;
+        if (std.posix.getenv("ONEIM_CACHE_MAX_MB")) |value| {
+            max_mb = std.fmt.parseInt(u64, value, 10) catch default_max_mb;
+        }
+
+        var cache: Cache = .{
+            .allocator = allocator,
+            .dir = dir,
+            .dir_path = dir_path,
+            .max_bytes = max_mb * 1024 * 1024,
+            .stats = .{},
+        };
+        cache.loadStats();
+        return cache;
+    }
+
+    pub fn close(self: *Cache) void {
+        self.dir.close();
+        self.allocator.free(self.dir_path);
+    }
+
+    /// Hashes everything that influences the produced binary: `sources` are
+    /// the program's modules, entry module first.
+    pub fn computeKey(sources: []const []const u8, cc_flags: []const []const u8) Key {
+        var hasher = std.crypto.hash.Blake3.init(.{});
+        hashCompilerIdentity(&hasher);
+        for (cc_flags) |flag| {
+            hasher.update(flag);
+            hasher.update("\x00");
+        }
+        for (sources) |source| {
+            // Length-prefixed so moving text between modules changes the key.
+            hasher.update(std.mem.asBytes(&@as(u64, source.len)));
+            hasher.update(source);
+        }
+
+        var digest: [32]u8 = undefined;
+        hasher.final(&digest);
+        return std.fmt.bytesToHex(digest, .lower);
+    }
+
+    /// Returns the path of the cached binary for `key` (caller frees), or null
+    /// on a miss. A hit refreshes the entry's mtime so eviction stays LRU.
+    pub fn lookup(self: *Cache, key: *const Key) !?[]const u8 {
+        const file = self.dir.openFile(key[0..], .{}) catch |err| switch (err) {
+            error.FileNotFound => {
+                self.stats.misses += 1;
+                self.saveStats();
+                return null;
+            },
+            else => return err,
+        };
+        defer file.close();
+
+        const now = std.time.nanoTimestamp();
+        file.updateTimes(now, now) catch {};
+
+        self.stats.hits += 1;
+        self.saveStats();
+        return try std.fs.path.join(self.allocator, &.{ self.dir_path, key[0..] });
+    }
+
+    /// Copies a freshly compiled binary into the cache, then evicts least
+    /// recently used entries until the directory fits in `max_bytes`.
+    pub fn store(self: *Cache, key: *const Key, bin_path: []const u8) !void {
+        try std.fs.cwd().copyFile(bin_path, self.dir, key[0..], .{});
+        try self.evict();
+    }
+
+    pub fn usage(self: *Cache) !Usage {
+        var entries: std.ArrayList(Entry) = .empty;
+        defer self.freeEntries(&entries);
+        const bytes = try self.scanEntries(&entries);
+        return .{ .entries = entries.items.len, .bytes = bytes };
+    }
+
+    fn evict(self: *Cache) !void {
+        var entries: std.ArrayList(Entry) = .empty;
+        defer self.freeEntries(&entries);
+
+        var total = try self.scanEntries(&entries);
+        if (total <= self.max_bytes) return;
+
+        std.mem.sort(Entry, entries.items, {}, struct {
+            fn lessThan(_: void, a: Entry, b: Entry) bool {
+                return a.mtime < b.mtime;
+            }
+        }.lessThan);
+
+        for (entries.items) |entry| {
+            if (total <= self.max_bytes) break;
+            self.dir.deleteFile(entry.name) catch continue;
+            total -= entry.size;
+            self.stats.evictions += 1;
+        }
+        self.saveStats();
+    }
+
+    fn scanEntries(self: *Cache, entries: *std.ArrayList(Entry)) !u64 {
+        var total: u64 = 0;
+        var it = self.dir.iterate();
+        while (try it.next()) |dir_entry| {
+            if (dir_entry.kind != .file or !isKeyName(dir_entry.name)) continue;
+            const st = self.dir.statFile(dir_entry.name) catch continue;
+
+            const name = try self.allocator.dupe(u8, dir_entry.name);
+            errdefer self.allocator.free(name);
+            try entries.append(self.allocator, .{ .name = name, .size = st.size, .mtime = st.mtime });
+            total += st.size;
+        }
+        return total;
+    }
+
+    fn freeEntries(self: *Cache, entries: *std.ArrayList(Entry)) void {
+        for (entries.items) |entry| self.allocator.free(entry.name);
+        entries.deinit(self.allocator);
+    }
+
+    fn loadStats(self: *Cache) void {
+        const text = self.dir.readFileAlloc(self.allocator, stats_file, 4096) catch return;
+        defer self.allocator.free(text);
+
+        var lines = std.mem.tokenizeScalar(u8, text, '\n');
+        while (lines.next()) |line| {
+            var fields = std.mem.tokenizeScalar(u8, line, ' ');
+            const name = fields.next() orelse continue;
+            const value = std.fmt.parseInt(u64, fields.next() orelse continue, 10) catch continue;
+            if (std.mem.eql(u8, name, "hits")) {
+                self.stats.hits = value;
+            } else if (std.mem.eql(u8, name, "misses")) {
+                self.stats.misses = value;
+            } else if (std.mem.eql(u8, name, "evictions")) {
+                self.stats.evictions = value;
+            }
+        }
+    }
+
+    /// Stats are best effort: concurrent compilers may race on the file.
+    fn saveStats(self: *Cache) void {
+        var buf: [128]u8 = undefined;
+        const text = std.fmt.bufPrint(&buf, "hits {d}\nmisses {d}\nevictions {d}\n", .{
+            self.stats.hits,
+            self.stats.misses,
+            self.stats.evictions,
+        }) catch return;
+        self.dir.writeFile(.{ .sub_path = stats_file, .data = text }) catch {};
+    }
+};
+
+fn resolveDir(allocator: std.mem.Allocator) !?[]const u8 {
+    if (std.posix.getenv("ONEIM_CACHE_DIR")) |dir| {
+        return try allocator.dupe(u8, dir);
+    }
+    if (std.posix.getenv("XDG_CACHE_HOME")) |xdg| {
+        return try std.fs.path.join(allocator, &.{ xdg, "1im" });
+    }
+    if (std.posix.getenv("HOME")) |home| {
+        return try std.fs.path.join(allocator, &.{ home, ".cache", "1im" });
+    }
+    return null;
+}
+
+/// Mixes in the version string plus the size and mtime of the running
+/// executable, so a rebuilt compiler never reuses binaries from an older one.
+fn hashCompilerIdentity(hasher: *std.crypto.hash.Blake3) void {
+    hasher.update(compiler_version);
+    hasher.update("\x00");
+
+    var path_buf: [std.fs.max_path_bytes]u8 = undefined;
+    const exe_path = std.fs.selfExePath(&path_buf) catch return;
+    const st = std.fs.cwd().statFile(exe_path) catch return;
+    hasher.update(std.mem.asBytes(&st.size));
+    hasher.update(std.mem.asBytes(&st.mtime));
+}
+
+fn isKeyName(name: []const u8) bool {
+    if (name.len != @sizeOf(Key)) return false;
+    for (name) |c| {
+        if (!std.ascii.isHex(c)) return false;
+    }
+    return true;
+}
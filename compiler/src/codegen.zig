@@ -2,45 +2,124 @@
 /// Walks the AST and emits C source code that can be compiled with any C compiler.
 const std = @import("std");
 const ast = @import("ast.zig");
+const ir = @import("ir.zig");
+const semantic = @import("semantic.zig");
+const runtime = @import("runtime.zig");
 
 pub const CodegenError = error{
     UnsupportedNode,
     OutOfMemory,
 };
 
-/// Tracks inferred types for variables during codegen.
+/// An expression's type as codegen sees it; `unknown` for `null`.
 const ValueType = union(enum) {
     known: ast.Type,
     unknown,
 };
 
+/// A function from an imported module, under its qualified name.
+pub const Imported = struct {
+    name: []const u8,
+    sig: ir.Signature,
+};
+
+/// How many `xs[i]` in one function were bounds-checked, and how many were
+/// proven in range and left unchecked. `main` stands for top-level code.
+pub const BoundsCount = struct {
+    function: []const u8,
+    checked: usize,
+    proven: usize,
+};
+
+/// What a loop tells `xs[i]` in its body about its variable `i`, which it
+/// counts up from a non-negative start: `i` is below `bound`, or below the
+/// length of the variable `length_of`. Both are null when the loop proves
+/// nothing; the fact then still hides any outer loop's over the same name.
+const RangeFact = struct {
+    variable: []const u8,
+    bound: ?usize,
+    length_of: ?[]const u8,
+};
+
 pub const Codegen = struct {
     output: std.ArrayList(u8),
     type_defs: std.ArrayList(u8),
+    /// The program being generated; set by `generate` and `dumpIr`.
+    tree: *const ast.Tree,
+    /// Expression types computed by the analyzer.
+    types: semantic.ExprTypes,
+    inferred_returns: *const std.StringHashMap(ast.Type),
+    /// Variables declared so far in the current C function, so a repeated
+    /// `set` becomes an assignment rather than a second declaration.
     var_types: std.StringHashMap(ValueType),
     fn_returns: std.StringHashMap(?ast.Type),
     error_types: std.StringHashMap([]const u8),
     slice_types: std.StringHashMap([]const u8),
     array_return_types: std.StringHashMap([]const u8),
-    emitted_parallel_runner: bool,
+    /// Future variable types by type key; see `futureTypeName`.
+    future_types: std.StringHashMap([]const u8),
+    /// Name of the imported module being generated, or empty for the entry
+    /// module. A module's functions are emitted as `<module>__<name>` and it
+    /// gets no `main`.
+    module_prefix: []const u8,
+    imported: std.ArrayList(Imported),
+    /// Whether the program needs the task runtime (`runtime.zig`). Set by
+    /// `generate` when this module has `parallel` or `spawn`; the module
+    /// loader also sets it on the entry module when an imported module
+    /// needs it.
+    needs_runtime: bool,
+    /// Functions outlined from parallel loop bodies, with their context
+    /// structs; `generate` splices them in at `lifted_at`, ahead of the
+    /// function definitions that call them.
+    lifted: std.ArrayList(u8),
+    lifted_at: usize,
+    /// Typedefs of `future_types`, spliced in ahead of `lifted`. Futures
+    /// are only found while emitting function bodies, after `type_defs`
+    /// has been written out.
+    future_defs: std.ArrayList(u8),
     indent_level: usize,
     tmp_counter: usize,
     current_return: ?ast.Type,
+    /// Whether `xs[i]` checks `i` against the length (`--mode=safe`).
+    bounds_checks: bool,
+    /// Facts of the loops around the statement being emitted, innermost last.
+    range_facts: std.ArrayList(RangeFact),
+    /// Index expressions so far in the function being emitted.
+    checks: BoundsCount,
+    /// One entry per function that indexes anything, for `--bounds-report`.
+    bounds_report: std.ArrayList(BoundsCount),
     allocator: std.mem.Allocator,
 
-    pub fn init(allocator: std.mem.Allocator) Codegen {
+    pub fn init(
+        allocator: std.mem.Allocator,
+        types: semantic.ExprTypes,
+        inferred_returns: *const std.StringHashMap(ast.Type),
+    ) Codegen {
         return .{
             .output = .empty,
             .type_defs = .empty,
+            .tree = undefined,
+            .types = types,
+            .inferred_returns = inferred_returns,
             .var_types = std.StringHashMap(ValueType).init(allocator),
             .fn_returns = std.StringHashMap(?ast.Type).init(allocator),
             .error_types = std.StringHashMap([]const u8).init(allocator),
             .slice_types = std.StringHashMap([]const u8).init(allocator),
             .array_return_types = std.StringHashMap([]const u8).init(allocator),
-            .emitted_parallel_runner = false,
+            .future_types = std.StringHashMap([]const u8).init(allocator),
+            .module_prefix = "",
+            .imported = .empty,
+            .needs_runtime = false,
+            .lifted = .empty,
+            .lifted_at = 0,
+            .future_defs = .empty,
             .indent_level = 1,
             .tmp_counter = 0,
             .current_return = null,
+            .bounds_checks = true,
+            .range_facts = .empty,
+            .checks = .{ .function = "main", .checked = 0, .proven = 0 },
+            .bounds_report = .empty,
             .allocator = allocator,
         };
     }
@@ -53,15 +132,32 @@ pub const Codegen = struct {
         self.error_types.deinit();
         self.slice_types.deinit();
         self.array_return_types.deinit();
+        self.future_types.deinit();
+        self.imported.deinit(self.allocator);
+        self.lifted.deinit(self.allocator);
+        self.future_defs.deinit(self.allocator);
+        self.range_facts.deinit(self.allocator);
+        self.bounds_report.deinit(self.allocator);
     }
 
-    pub fn generate(self: *Codegen, program: ast.Node) CodegenError![]const u8 {
-        const prog = switch (program) {
-            .program => |p| p,
-            else => return CodegenError.UnsupportedNode,
-        };
+    /// Makes an imported module's function callable as `name` (`module.f`);
+    /// it is declared with a prototype and linked from the module's own
+    /// translation unit. Must be called before `generate`.
+    pub fn declareImported(self: *Codegen, name: []const u8, sig: ir.Signature) CodegenError!void {
+        self.imported.append(self.allocator, .{ .name = name, .sig = sig }) catch return CodegenError.OutOfMemory;
+        self.fn_returns.put(name, sig.ret) catch return CodegenError.OutOfMemory;
+    }
+
+    pub fn generate(self: *Codegen, tree: *const ast.Tree) CodegenError![]const u8 {
+        self.tree = tree;
+        const prog = tree.node(tree.root).program;
+
+        if (programUsesRuntime(tree)) self.needs_runtime = true;
+        const runtime_defs = self.needs_runtime and self.module_prefix.len == 0;
 
         // C preamble
+        // The runtime pins threads with sched_setaffinity, a GNU extension.
+        if (runtime_defs) try self.emit("#define _GNU_SOURCE\n");
         try self.emit("#include <stdio.h>\n");
         try self.emit("#include <stdint.h>\n");
         try self.emit("#include <inttypes.h>\n");
@@ -71,26 +167,33 @@ pub const Codegen = struct {
         try self.emit("#include <pthread.h>\n");
         try self.emit("\n");
 
-        // Collect function return types (explicit or inferred).
-        for (prog.stmts) |stmt| {
-            if (stmt != .function_def) continue;
-            const fd = stmt.function_def;
-            if (fd.return_type) |ret| {
-                self.fn_returns.put(fd.name, ret) catch return CodegenError.OutOfMemory;
-            } else {
-                if (try self.inferFunctionReturnType(fd)) |ret| {
-                    self.fn_returns.put(fd.name, ret) catch return CodegenError.OutOfMemory;
-                } else {
-                    self.fn_returns.put(fd.name, null) catch return CodegenError.OutOfMemory;
-                }
+        try self.collectFunctionReturns(prog);
+        var sigs = try self.collectSignatures(prog);
+        defer sigs.deinit();
+
+        // A program without the task runtime has a single thread, so its
+        // print buffer and string owner are plain statics, which compilers
+        // without `_Thread_local` (tcc for --fast-start) accept. Every file of
+        // a multi-module program declares them alike, as thread-local.
+        const threaded = self.needs_runtime or self.module_prefix.len > 0 or self.imported.items.len > 0;
+        self.type_defs.print(self.allocator, "#define __1IM_TLS{s}\n\n", .{if (threaded) " _Thread_local" else ""}) catch return CodegenError.OutOfMemory;
+        try self.emitTo(&self.type_defs, runtime.print_decls);
+        try self.emitTo(&self.type_defs, runtime.str_decls);
+        try self.emitTo(&self.type_defs, runtime.alloc_decls);
+        if (self.needs_runtime) try self.emitTo(&self.type_defs, runtime.decls);
+        // Imported modules link against the entry module's definitions.
+        if (self.module_prefix.len == 0) {
+            try self.emitTo(&self.type_defs, runtime.print_defs);
+            try self.emitTo(&self.type_defs, runtime.str_defs);
+            try self.emitTo(&self.type_defs, runtime.alloc_defs);
+        }
+        if (runtime_defs) {
+            for (prog.stmts) |stmt| {
+                if (self.tree.tags[stmt] != .affinity_decl) continue;
+                const affinity = self.tree.node(stmt).affinity_decl.affinity;
+                self.type_defs.print(self.allocator, "#define __1IM_AFFINITY \"{s}\"\n", .{@tagName(affinity)}) catch return CodegenError.OutOfMemory;
             }
-        }
-
-        if (self.programHasParallel(prog)) {
-            self.emitted_parallel_runner = true;
-            try self.emitTo(&self.type_defs, "static void* __1im_par_runner(void* arg) { ");
-            try self.emitTo(&self.type_defs, "void (*fn)(void) = *(void (**)(void))arg; ");
-            try self.emitTo(&self.type_defs, "fn(); return NULL; }\n");
+            try self.emitTo(&self.type_defs, runtime.defs);
         }
 
         try self.collectTypes(prog);
@@ -100,51 +203,139 @@ pub const Codegen = struct {
         }
 
         // Emit function declarations first
+        for (self.imported.items) |imp| {
+            try self.emitFunctionDecl(.{ .name = imp.name, .params = imp.sig.params, .return_type = imp.sig.ret, .body = &.{} });
+        }
         for (prog.stmts) |stmt| {
-            if (stmt == .function_def) {
-                try self.emitFunctionDecl(stmt.function_def);
+            if (self.tree.tags[stmt] == .function_def) {
+                try self.emitFunctionDecl(self.tree.node(stmt).function_def);
             }
         }
         try self.emit("\n");
+        self.lifted_at = self.output.items.len;
 
-        // Emit function definitions at global scope
+        // Emit function definitions at global scope, through the SSA IR
+        // when the function stays within what it can lower.
         for (prog.stmts) |stmt| {
-            if (stmt == .function_def) {
-                try self.emitFunctionDef(stmt.function_def);
+            if (self.tree.tags[stmt] == .function_def) {
+                const fd = self.tree.node(stmt).function_def;
+                var arena = std.heap.ArenaAllocator.init(self.allocator);
+                defer arena.deinit();
+                const lowered = ir.lowerFunction(arena.allocator(), self.tree, fd, &sigs, self.types);
+                if (!try self.emitViaIr(lowered)) {
+                    try self.emitFunctionDef(fd);
+                }
             }
         }
 
+        // Imported modules hold only functions; the entry module owns `main`.
+        if (self.module_prefix.len > 0) return self.finish();
+
         // Check if we need a main wrapper
         var has_main = false;
         for (prog.stmts) |stmt| {
-            if (stmt == .function_def and std.mem.eql(u8, stmt.function_def.name, "main")) {
+            if (self.tree.tags[stmt] == .function_def and std.mem.eql(u8, self.tree.node(stmt).function_def.name, "main")) {
                 has_main = true;
                 break;
             }
         }
 
         if (!has_main) {
+            var arena = std.heap.ArenaAllocator.init(self.allocator);
+            defer arena.deinit();
+            if (try self.emitViaIr(ir.lowerTopLevel(arena.allocator(), self.tree, prog, &sigs, self.types))) {
+                return self.finish();
+            }
             try self.emit("int main(void) {\n");
         }
 
         // Emit non-function statements
         for (prog.stmts) |stmt| {
-            if (stmt != .function_def) {
+            if (self.tree.tags[stmt] != .function_def) {
                 try self.emitStmt(stmt);
             }
         }
 
+        try self.reportChecks();
+
         if (!has_main) {
             try self.emit("    return 0;\n");
             try self.emit("}\n");
         }
 
+        return self.finish();
+    }
+
+    fn finish(self: *Codegen) CodegenError![]const u8 {
+        self.output.insertSlice(self.allocator, self.lifted_at, self.lifted.items) catch return CodegenError.OutOfMemory;
+        self.output.insertSlice(self.allocator, self.lifted_at, self.future_defs.items) catch return CodegenError.OutOfMemory;
+        return self.output.items;
+    }
+
+    /// Renders the optimized IR of every function that lowers, for `--emit-ir`.
+    pub fn dumpIr(self: *Codegen, tree: *const ast.Tree) CodegenError![]const u8 {
+        self.tree = tree;
+        const prog = tree.node(tree.root).program;
+
+        try self.collectFunctionReturns(prog);
+        var sigs = try self.collectSignatures(prog);
+        defer sigs.deinit();
+
+        var has_main = false;
+        for (prog.stmts) |stmt| {
+            if (self.tree.tags[stmt] != .function_def) continue;
+            const fd = self.tree.node(stmt).function_def;
+            if (std.mem.eql(u8, fd.name, "main")) has_main = true;
+
+            var arena = std.heap.ArenaAllocator.init(self.allocator);
+            defer arena.deinit();
+            try self.dumpLowered(fd.name, ir.lowerFunction(arena.allocator(), self.tree, fd, &sigs, self.types));
+        }
+        if (!has_main and self.module_prefix.len == 0) {
+            var arena = std.heap.ArenaAllocator.init(self.allocator);
+            defer arena.deinit();
+            try self.dumpLowered("main", ir.lowerTopLevel(arena.allocator(), self.tree, prog, &sigs, self.types));
+        }
         return self.output.items;
     }
 
+    /// Signatures of this module's functions plus the imported ones, for the IR.
+    fn collectSignatures(self: *Codegen, prog: ast.Program) CodegenError!ir.Signatures {
+        var sigs = ir.collectSignatures(self.allocator, self.tree, prog, &self.fn_returns) catch return CodegenError.OutOfMemory;
+        errdefer sigs.deinit();
+        for (self.imported.items) |imp| {
+            sigs.put(imp.name, imp.sig) catch return CodegenError.OutOfMemory;
+        }
+        return sigs;
+    }
+
+    fn dumpLowered(self: *Codegen, name: []const u8, lowered: ir.LowerError!ir.Function) CodegenError!void {
+        var f = lowered catch |err| switch (err) {
+            error.Unsupported => {
+                try self.emit("; fn ");
+                try self.emit(name);
+                try self.emit(": not lowered, emitted from the AST\n\n");
+                return;
+            },
+            error.OutOfMemory => return CodegenError.OutOfMemory,
+        };
+        ir.optimize(&f) catch return CodegenError.OutOfMemory;
+        ir.dump(&f, self.allocator, &self.output) catch return CodegenError.OutOfMemory;
+    }
+
+    // Collect function return types (explicit or inferred by the analyzer).
+    fn collectFunctionReturns(self: *Codegen, prog: ast.Program) CodegenError!void {
+        for (prog.stmts) |stmt| {
+            if (self.tree.tags[stmt] != .function_def) continue;
+            const fd = self.tree.node(stmt).function_def;
+            const ret = fd.return_type orelse self.inferred_returns.get(fd.name);
+            self.fn_returns.put(fd.name, ret) catch return CodegenError.OutOfMemory;
+        }
+    }
+
     fn collectTypes(self: *Codegen, prog: ast.Program) CodegenError!void {
         for (prog.stmts) |stmt| {
-            switch (stmt) {
+            switch (self.tree.node(stmt)) {
                 .typed_assign => |ta| try self.registerType(ta.type_info),
                 .function_def => |fd| {
                     for (fd.params) |param| {
@@ -161,6 +352,26 @@ pub const Codegen = struct {
                 else => {},
             }
         }
+        for (self.imported.items) |imp| {
+            for (imp.sig.params) |param| {
+                try self.registerType(param.type_info);
+            }
+            if (imp.sig.ret) |rt| {
+                try self.registerType(rt);
+                if (rt == .array) {
+                    _ = try self.arrayReturnTypeName(rt);
+                }
+            }
+        }
+        // Slices declared inside blocks, and the views `xs[a..b]` and
+        // `copy(xs)` make, need their typedefs too.
+        for (self.tree.tags, 0..) |tag, i| {
+            const node: ast.Index = @intCast(i);
+            if (tag == .typed_assign) try self.registerType(self.tree.node(node).typed_assign.type_info);
+            if (self.types.get(node)) |t| {
+                if (t == .known) try self.registerType(t.known);
+            }
+        }
     }
 
     fn registerType(self: *Codegen, t: ast.Type) CodegenError!void {
@@ -187,13 +398,34 @@ pub const Codegen = struct {
         }
         self.slice_types.put(key, key) catch return CodegenError.OutOfMemory;
 
+        // `cap` and `arena` stay zero in views of arrays; see `runtime.alloc_decls`.
         try self.emitTo(&self.type_defs, "typedef struct { ");
         const elem = t.slice.elem.*;
         try self.emitTo(&self.type_defs, try self.cTypeName(elem));
-        try self.emitTo(&self.type_defs, "* data; size_t len; } ");
+        try self.emitTo(&self.type_defs, "* data; size_t len; size_t cap; __1im_arena* arena; } ");
         try self.emitTo(&self.type_defs, key);
         try self.emitTo(&self.type_defs, ";\n");
 
+        // `xs[i]` on a checked temporary, `xs[lo..hi]`, `copy(xs)` and the
+        // view a parameter or another variable gets of `xs`; arrays are
+        // passed in as views.
+        self.type_defs.print(self.allocator,
+            \\static inline {1s}* {0s}_at({0s} s, int64_t i) {{
+            \\    return s.data + __1im_index(i, s.len);
+            \\}}
+            \\static inline {0s} {0s}_view({0s} s, int64_t lo, int64_t hi) {{
+            \\    if (lo < 0 || lo > hi || (uint64_t)hi > s.len) __1im_range_fail(lo, hi, s.len);
+            \\    return ({0s}){{ s.data == NULL ? NULL : s.data + lo, (size_t)(hi - lo), 0, NULL }};
+            \\}}
+            \\static inline {0s} {0s}_copy({0s} s) {{
+            \\    return ({0s}){{ __1im_copy(s.data, s.len, sizeof(*s.data)), s.len, s.len, NULL }};
+            \\}}
+            \\static inline {0s} {0s}_alias({0s} s) {{
+            \\    return ({0s}){{ s.data, s.len, 0, NULL }};
+            \\}}
+            \\
+        , .{ key, try self.cTypeName(elem) }) catch return CodegenError.OutOfMemory;
+
         return key;
     }
 
@@ -262,6 +494,40 @@ pub const Codegen = struct {
         return name;
     }
 
+    /// `<key>`, a future variable, after adding its types to `future_defs` on
+    /// first use: `<key>_task` is the spawned call's `__1im_future` and
+    /// result, and `<key>` points to it until `<key>_await` has copied the
+    /// result out and freed it. Void futures have no `ret`.
+    fn futureTypeName(self: *Codegen, t: ast.Type) CodegenError![]const u8 {
+        const key = try self.typeKey(t);
+        if (self.future_types.get(key)) |name| {
+            self.allocator.free(key);
+            return name;
+        }
+        self.future_types.put(key, key) catch return CodegenError.OutOfMemory;
+
+        const result = t.future.result.*;
+        const ret_type = if (result == .void) "void" else try self.cTypeName(result);
+        const defs = &self.future_defs;
+        try self.emitTo(defs, "typedef struct { __1im_future head; ");
+        if (result != .void) try self.emitFmtTo(defs, "{s} ret; ", .{ret_type});
+        try self.emitFmtTo(defs, "}} {s}_task;\n", .{key});
+        try self.emitFmtTo(defs, "typedef struct {{ {s}_task* task; ", .{key});
+        if (result != .void) try self.emitFmtTo(defs, "{s} ret; ", .{ret_type});
+        try self.emitFmtTo(defs, "}} {s};\n", .{key});
+        try self.emitFmtTo(defs, "static inline {0s} {1s}_await({1s}* f) {{\n", .{ ret_type, key });
+        try self.emitTo(defs, "    if (f->task != NULL) {\n");
+        try self.emitTo(defs, "        __1im_await(&f->task->head);\n");
+        if (result != .void) try self.emitTo(defs, "        f->ret = f->task->ret;\n");
+        try self.emitTo(defs, "        __1im_future_free(&f->task->head);\n");
+        try self.emitTo(defs, "        f->task = NULL;\n");
+        try self.emitTo(defs, "    }\n");
+        if (result != .void) try self.emitTo(defs, "    return f->ret;\n");
+        try self.emitTo(defs, "}\n");
+
+        return key;
+    }
+
     fn typeKey(self: *Codegen, t: ast.Type) CodegenError![]const u8 {
         var buf: std.ArrayList(u8) = .empty;
         errdefer buf.deinit(self.allocator);
@@ -288,6 +554,20 @@ pub const Codegen = struct {
                 try self.emitTo(buf, "slice_");
                 try self.appendTypeKey(buf, s.elem.*);
             },
+            .future => |f| {
+                try self.emitTo(buf, "future_");
+                try self.appendTypeKey(buf, f.result.*);
+            },
+            .atomic => |at| {
+                try self.emitTo(buf, "atomic_");
+                try self.appendTypeKey(buf, at.elem.*);
+            },
+            .mutex => try self.emitTo(buf, "mutex"),
+            .arena => try self.emitTo(buf, "arena"),
+            .channel => |ch| {
+                try self.emitTo(buf, "channel_");
+                try self.appendTypeKey(buf, ch.elem.*);
+            },
             .error_union => |eu| {
                 try self.emitTo(buf, "err_");
                 try self.appendTypeKey(buf, eu.ok.*);
@@ -317,10 +597,30 @@ pub const Codegen = struct {
                 defer self.allocator.free(key);
                 break :blk self.error_types.get(key) orelse self.typeToCType(t);
             },
+            .future => try self.futureTypeName(t),
+            .atomic => |at| atomicPtrTypeName(at.elem.*),
+            .mutex => "__1im_mutex*",
+            .channel => "__1im_channel*",
+            .arena => "__1im_arena*",
             else => self.typeToCType(t),
         };
     }
 
+    /// Atomics are the address of a cell in the frame that declared them.
+    fn atomicPtrTypeName(elem: ast.Type) []const u8 {
+        return switch (elem) {
+            .i8 => "_Atomic(int8_t)*",
+            .i16 => "_Atomic(int16_t)*",
+            .i32 => "_Atomic(int32_t)*",
+            .i64 => "_Atomic(int64_t)*",
+            .u8 => "_Atomic(uint8_t)*",
+            .u16 => "_Atomic(uint16_t)*",
+            .u32 => "_Atomic(uint32_t)*",
+            .u64 => "_Atomic(uint64_t)*",
+            else => "void*",
+        };
+    }
+
     fn cReturnTypeName(self: *Codegen, t: ast.Type) CodegenError![]const u8 {
         return switch (t) {
             .array => try self.arrayReturnTypeName(t),
@@ -346,105 +646,15 @@ pub const Codegen = struct {
     }
 
     fn emitZeroValue(self: *Codegen, out: *std.ArrayList(u8), t: ast.Type) CodegenError!void {
-        switch (t) {
-            .str => try self.emitTo(out, "NULL"),
-            else => {
-                try self.emitTo(out, "(");
-                try self.emitTo(out, try self.cTypeName(t));
-                try self.emitTo(out, "){0}");
-            },
-        }
-    }
-
-    fn inferFunctionReturnType(self: *Codegen, fd: ast.FunctionDef) CodegenError!?ast.Type {
-        var has_value = false;
-        var has_void = false;
-        var inferred: ast.Type = undefined;
-
-        const PrevVar = struct {
-            name: []const u8,
-            prev: ?ValueType,
-        };
-        var prevs: std.ArrayList(PrevVar) = .empty;
-        defer {
-            for (prevs.items) |item| {
-                if (item.prev) |pv| {
-                    self.var_types.put(item.name, pv) catch {};
-                } else {
-                    _ = self.var_types.remove(item.name);
-                }
-            }
-            prevs.deinit(self.allocator);
-        }
-
-        // Seed parameter types so return inference can resolve identifiers.
-        for (fd.params) |param| {
-            try prevs.append(self.allocator, .{ .name = param.name, .prev = self.var_types.get(param.name) });
-            self.var_types.put(param.name, .{ .known = param.type_info }) catch return CodegenError.OutOfMemory;
-        }
-
-        for (fd.body) |stmt| {
-            try self.collectReturnType(stmt, &has_value, &has_void, &inferred);
-        }
-
-        if (has_void and has_value) return CodegenError.UnsupportedNode;
-        if (has_value) return inferred;
-        return null;
-    }
-
-    fn collectReturnType(
-        self: *Codegen,
-        stmt: ast.Node,
-        has_value: *bool,
-        has_void: *bool,
-        inferred: *ast.Type,
-    ) CodegenError!void {
-        switch (stmt) {
-            .return_stmt => |rs| {
-                if (rs.value == null) {
-                    has_void.* = true;
-                    return;
-                }
-
-                var ret_type: ast.Type = undefined;
-                if (rs.value.?.* == .try_expr) {
-                    const inner = self.inferType(rs.value.?.*.try_expr.expr.*);
-                    if (inner != .known or inner.known != .error_union) return CodegenError.UnsupportedNode;
-                    ret_type = inner.known;
-                } else {
-                    const value_type = self.inferType(rs.value.?.*);
-                    if (value_type != .known) return CodegenError.UnsupportedNode;
-                    ret_type = value_type.known;
-                }
-
-                if (!has_value.*) {
-                    has_value.* = true;
-                    inferred.* = ret_type;
-                    return;
-                }
-
-                if (!self.typeEquals(inferred.*, ret_type)) return CodegenError.UnsupportedNode;
-            },
-            .if_stmt => |is| {
-                for (is.then_body) |s| try self.collectReturnType(s, has_value, has_void, inferred);
-                for (is.else_ifs) |elif| {
-                    for (elif.body) |s| try self.collectReturnType(s, has_value, has_void, inferred);
-                }
-                if (is.else_body) |else_body| {
-                    for (else_body) |s| try self.collectReturnType(s, has_value, has_void, inferred);
-                }
-            },
-            .while_loop => |wl| for (wl.body) |s| try self.collectReturnType(s, has_value, has_void, inferred),
-            .for_loop => |fl| for (fl.body) |s| try self.collectReturnType(s, has_value, has_void, inferred),
-            .parallel_block => |pb| for (pb.body) |s| try self.collectReturnType(s, has_value, has_void, inferred),
-            .try_catch => |tc| for (tc.catch_body) |s| try self.collectReturnType(s, has_value, has_void, inferred),
-            .function_def => {},
-            else => {},
-        }
+        try self.emitTo(out, "(");
+        try self.emitTo(out, try self.cTypeName(t));
+        try self.emitTo(out, "){0}");
     }
 
-    fn emitStmt(self: *Codegen, node: ast.Node) CodegenError!void {
-        switch (node) {
+    fn emitStmt(self: *Codegen, node: ast.Index) CodegenError!void {
+        switch (self.tree.node(node)) {
+            .import_decl => {}, // resolved by the module loader
+            .affinity_decl => {}, // a #define ahead of the runtime, see `generate`
             .set_assign => |sa| try self.emitSetAssign(sa),
             .typed_assign => |ta| try self.emitTypedAssign(ta),
             .index_assign => |ia| try self.emitIndexAssign(ia),
@@ -454,6 +664,7 @@ pub const Codegen = struct {
             .while_loop => |wl| try self.emitWhile(wl),
             .for_loop => |fl| try self.emitFor(fl),
             .parallel_block => |pb| try self.emitParallelBlock(pb),
+            .parallel_assign => |pa| try self.emitParallelCalls(pa.calls, pa.targets),
             .break_stmt => try self.emitBreak(),
             .continue_stmt => try self.emitContinue(),
             .try_catch => |tc| try self.emitTryCatch(tc),
@@ -463,10 +674,13 @@ pub const Codegen = struct {
     }
 
     fn emitSetAssign(self: *Codegen, sa: ast.SetAssign) CodegenError!void {
-        if (sa.value.* == .try_expr) {
-            return self.emitTryAssign(sa.name, sa.value.*.try_expr, null);
+        if (self.tree.tags[sa.value] == .try_expr) {
+            return self.emitTryAssign(sa.name, self.tree.node(sa.value).try_expr, null);
+        }
+        if (self.tree.tags[sa.value] == .spawn_expr) {
+            return self.emitSpawnAssign(sa.name, sa.value);
         }
-        const val_type = self.inferType(sa.value.*);
+        const val_type = self.typeOf(sa.value);
 
         // Check if variable already declared
         const already_declared = self.var_types.contains(sa.name);
@@ -478,7 +692,7 @@ pub const Codegen = struct {
             switch (val_type) {
                 .known => |kt| {
                     if (self.isArrayType(kt)) {
-                        try self.emitArrayDeclWithValue(kt, sa.name, sa.value.*);
+                        try self.emitArrayDeclWithValue(kt, sa.name, sa.value);
                         return;
                     }
                     // Emit C declaration
@@ -487,7 +701,7 @@ pub const Codegen = struct {
                     try self.emit(" ");
                     try self.emit(sa.name);
                     try self.emit(" = ");
-                    try self.emitExpr(sa.value.*);
+                    try self.emitCopiedValue(sa.value);
                     try self.emit(";\n");
                 },
                 .unknown => return CodegenError.UnsupportedNode,
@@ -502,7 +716,7 @@ pub const Codegen = struct {
                     try self.emitIndent();
                     try self.emit(sa.name);
                     try self.emit(" = ");
-                    try self.emitErrorUnionValue(existing.known.error_union, sa.value.*);
+                    try self.emitErrorUnionValue(existing.known.error_union, sa.value);
                     try self.emit(";\n");
                     return;
                 }
@@ -510,7 +724,7 @@ pub const Codegen = struct {
             try self.emitIndent();
             try self.emit(sa.name);
             try self.emit(" = ");
-            try self.emitExpr(sa.value.*);
+            try self.emitCopiedValue(sa.value);
             try self.emit(";\n");
         }
     }
@@ -526,15 +740,25 @@ pub const Codegen = struct {
             self.var_types.put(ta.name, val_type) catch return CodegenError.OutOfMemory;
 
             if (self.isArrayType(ta.type_info)) {
-                try self.emitArrayDeclWithValue(ta.type_info, ta.name, ta.value.*);
+                try self.emitArrayDeclWithValue(ta.type_info, ta.name, ta.value);
                 return;
             }
             if (self.isSliceType(ta.type_info)) {
-                try self.emitSliceDecl(ta.type_info, ta.name, ta.value.*);
+                try self.emitSliceDecl(ta.type_info, ta.name, ta.value);
                 return;
             }
-            if (ta.value.* == .try_expr) {
-                return self.emitTryAssign(ta.name, ta.value.*.try_expr, ta.type_info);
+            if (self.tree.tags[ta.value] == .try_expr) {
+                return self.emitTryAssign(ta.name, self.tree.node(ta.value).try_expr, ta.type_info);
+            }
+            if (ta.type_info == .atomic) {
+                // The cell is a compound literal, which lives as long as the
+                // enclosing block.
+                const ptr_type = try self.cTypeName(ta.type_info);
+                try self.emitIndent();
+                try self.emitFmt("{s} {s} = &({s}){{ ", .{ ptr_type, ta.name, ptr_type[0 .. ptr_type.len - 1] });
+                try self.emitExpr(ta.value);
+                try self.emit(" };\n");
+                return;
             }
 
             // Emit C declaration with explicit type
@@ -544,23 +768,23 @@ pub const Codegen = struct {
             try self.emit(ta.name);
             try self.emit(" = ");
             if (ta.type_info == .error_union) {
-                try self.emitErrorUnionValue(ta.type_info.error_union, ta.value.*);
+                try self.emitErrorUnionValue(ta.type_info.error_union, ta.value);
             } else {
-                try self.emitExpr(ta.value.*);
+                try self.emitExpr(ta.value);
             }
             try self.emit(";\n");
         } else {
             // Emit assignment (variable already declared)
-            if (ta.value.* == .try_expr) {
-                return self.emitTryAssign(ta.name, ta.value.*.try_expr, ta.type_info);
+            if (self.tree.tags[ta.value] == .try_expr) {
+                return self.emitTryAssign(ta.name, self.tree.node(ta.value).try_expr, ta.type_info);
             }
             try self.emitIndent();
             try self.emit(ta.name);
             try self.emit(" = ");
             if (ta.type_info == .error_union) {
-                try self.emitErrorUnionValue(ta.type_info.error_union, ta.value.*);
+                try self.emitErrorUnionValue(ta.type_info.error_union, ta.value);
             } else {
-                try self.emitExpr(ta.value.*);
+                try self.emitCopiedValue(ta.value);
             }
             try self.emit(";\n");
         }
@@ -575,7 +799,7 @@ pub const Codegen = struct {
             try self.emit("void");
         }
         try self.emit(" ");
-        try self.emit(fd.name);
+        try self.emitSymbol(fd.name);
         try self.emit("(");
 
         for (fd.params, 0..) |param, i| {
@@ -612,7 +836,7 @@ pub const Codegen = struct {
             try self.emit("void");
         }
         try self.emit(" ");
-        try self.emit(fd.name);
+        try self.emitSymbol(fd.name);
         try self.emit("(");
 
         for (fd.params, 0..) |param, i| {
@@ -625,14 +849,23 @@ pub const Codegen = struct {
         self.indent_level += 1;
 
         // Emit body
+        const prev_checks = self.checks;
+        self.checks = .{ .function = fd.name, .checked = 0, .proven = 0 };
+        defer self.checks = prev_checks;
         for (fd.body) |stmt| {
             try self.emitStmt(stmt);
         }
+        try self.reportChecks();
 
         self.indent_level -= 1;
         try self.emit("}\n\n");
     }
 
+    fn reportChecks(self: *Codegen) CodegenError!void {
+        if (self.checks.checked + self.checks.proven == 0) return;
+        self.bounds_report.append(self.allocator, self.checks) catch return CodegenError.OutOfMemory;
+    }
+
     fn emitParam(self: *Codegen, param: ast.Param) CodegenError!void {
         switch (param.type_info) {
             .array => {
@@ -650,6 +883,226 @@ pub const Codegen = struct {
         }
     }
 
+    // ── SSA IR emission ─────────────────────────────────────────
+
+    /// Optimizes and emits a lowered function. Returns false when lowering
+    /// hit a construct the IR does not cover, so the caller falls back to
+    /// emitting straight from the AST.
+    fn emitViaIr(self: *Codegen, lowered: ir.LowerError!ir.Function) CodegenError!bool {
+        var f = lowered catch |err| switch (err) {
+            error.Unsupported => return false,
+            error.OutOfMemory => return CodegenError.OutOfMemory,
+        };
+        ir.optimize(&f) catch return CodegenError.OutOfMemory;
+        try self.emitIrFunction(&f);
+        return true;
+    }
+
+    /// Emits one C function: every SSA value becomes a local `__vN`, every
+    /// block a label, and each phi an `__vN_in` slot its predecessors write
+    /// before jumping.
+    fn emitIrFunction(self: *Codegen, f: *const ir.Function) CodegenError!void {
+        if (f.entry_point) {
+            try self.emit("int main(void) {\n");
+        } else {
+            if (f.ret) |rt| {
+                try self.emit(try self.cReturnTypeName(rt));
+            } else {
+                try self.emit("void");
+            }
+            try self.emit(" ");
+            try self.emitSymbol(f.name);
+            try self.emit("(");
+            for (f.params, 0..) |param, i| {
+                if (i > 0) try self.emit(", ");
+                try self.emitParam(param);
+            }
+            try self.emit(") {\n");
+        }
+
+        for (f.blocks.items) |blk| {
+            if (!blk.reachable) continue;
+            for (blk.phis.items) |v| {
+                try self.emitIrDecl(f, v, "");
+                try self.emitIrDecl(f, v, "_in");
+            }
+            for (blk.insts.items) |v| {
+                if (irNeedsSlot(f.inst(v))) try self.emitIrDecl(f, v, "");
+            }
+        }
+
+        for (f.blocks.items, 0..) |blk, block_index| {
+            if (!blk.reachable) continue;
+            if (blk.preds.items.len > 0) try self.emitFmt("__bb{d}:\n", .{block_index});
+            for (blk.phis.items) |v| try self.emitFmt("    __v{d} = __v{d}_in;\n", .{ v, v });
+            for (blk.insts.items) |v| try self.emitIrInst(f, v);
+            try self.emitIrTerminator(f, @intCast(block_index), blk.term);
+        }
+
+        try self.emit(if (f.entry_point) "}\n" else "}\n\n");
+    }
+
+    fn emitIrDecl(self: *Codegen, f: *const ir.Function, v: ir.Value, suffix: []const u8) CodegenError!void {
+        try self.emitFmt("    {s} __v{d}{s};\n", .{ self.typeToCType(f.inst(v).type_info), v, suffix });
+    }
+
+    /// Constants, params and undefined values are spelled inline at each use.
+    fn irNeedsSlot(i: ir.Inst) bool {
+        return switch (i.op) {
+            .int_const, .float_const, .bool_const, .str_const, .undef, .param => false,
+            .call => i.type_info != .void,
+            else => true,
+        };
+    }
+
+    fn emitIrInst(self: *Codegen, f: *const ir.Function, v: ir.Value) CodegenError!void {
+        const i = f.inst(v);
+        if (!irNeedsSlot(i)) {
+            if (i.op == .call) try self.emitIrCall(f, i);
+            return;
+        }
+
+        try self.emitFmt("    __v{d} = ", .{v});
+        switch (i.op) {
+            .add, .sub, .mul, .div, .mod, .eq, .neq, .lt, .lte, .gt, .gte => {
+                try self.emitIrValue(f, i.operands[0]);
+                try self.emit(switch (i.op) {
+                    .add => " + ",
+                    .sub => " - ",
+                    .mul => " * ",
+                    .div => " / ",
+                    .mod => " % ",
+                    .eq => " == ",
+                    .neq => " != ",
+                    .lt => " < ",
+                    .lte => " <= ",
+                    .gt => " > ",
+                    .gte => " >= ",
+                    else => unreachable,
+                });
+                try self.emitIrValue(f, i.operands[1]);
+            },
+            .neg => {
+                try self.emit("-(");
+                try self.emitIrValue(f, i.operands[0]);
+                try self.emit(")");
+            },
+            .not => {
+                try self.emit("!");
+                try self.emitIrValue(f, i.operands[0]);
+            },
+            .cast => {
+                try self.emitFmt("({s})", .{self.typeToCType(i.type_info)});
+                try self.emitIrValue(f, i.operands[0]);
+            },
+            .call => try self.emitIrCallExpr(f, i),
+            else => return CodegenError.UnsupportedNode,
+        }
+        try self.emit(";\n");
+    }
+
+    /// A call whose result is unused (void functions and `print`).
+    fn emitIrCall(self: *Codegen, f: *const ir.Function, i: ir.Inst) CodegenError!void {
+        try self.emit("    ");
+        if (std.mem.eql(u8, i.name, "print")) {
+            const format = printFormat(f.inst(i.operands[0]).type_info) orelse return CodegenError.UnsupportedNode;
+            try self.emit(format.open);
+            try self.emitIrValue(f, i.operands[0]);
+            try self.emit(format.close);
+            return;
+        }
+        try self.emitIrCallExpr(f, i);
+        try self.emit(";\n");
+    }
+
+    fn emitIrCallExpr(self: *Codegen, f: *const ir.Function, i: ir.Inst) CodegenError!void {
+        try self.emitSymbol(i.name);
+        try self.emit("(");
+        for (i.operands, 0..) |arg, j| {
+            if (j > 0) try self.emit(", ");
+            try self.emitIrValue(f, arg);
+        }
+        try self.emit(")");
+    }
+
+    fn emitIrValue(self: *Codegen, f: *const ir.Function, v: ir.Value) CodegenError!void {
+        const i = f.inst(v);
+        switch (i.op) {
+            .int_const => {
+                if (ir.isUnsigned(i.type_info)) {
+                    const value: u64 = @bitCast(i.int_value);
+                    if (i.type_info == .u64) {
+                        try self.emitFmt("UINT64_C({d})", .{value});
+                    } else {
+                        try self.emitFmt("{d}u", .{value});
+                    }
+                } else if (i.int_value == std.math.minInt(i64)) {
+                    try self.emit("INT64_MIN");
+                } else if (i.int_value < std.math.minInt(i32) or i.int_value > std.math.maxInt(i32)) {
+                    try self.emitFmt("INT64_C({d})", .{i.int_value});
+                } else if (i.int_value < 0) {
+                    try self.emitFmt("({d})", .{i.int_value});
+                } else {
+                    try self.emitFmt("{d}", .{i.int_value});
+                }
+            },
+            .float_const => {
+                if (i.type_info == .f32) try self.emit("(float)");
+                try self.emitFmt("({e})", .{i.float_value});
+            },
+            .bool_const => try self.emit(if (i.int_value != 0) "true" else "false"),
+            .str_const => try self.emitStrLiteral(i.name),
+            .undef => if (i.type_info == .str)
+                try self.emit("((__1im_str){ 0 })")
+            else
+                try self.emitFmt("({s})0", .{self.typeToCType(i.type_info)}),
+            .param => try self.emit(i.name),
+            else => try self.emitFmt("__v{d}", .{v}),
+        }
+    }
+
+    fn emitIrTerminator(self: *Codegen, f: *const ir.Function, block: ir.BlockId, term: ir.Terminator) CodegenError!void {
+        switch (term) {
+            .none => {},
+            .jump => |target| {
+                try self.emitIrPhiMoves(f, block, target, "    ");
+                try self.emitFmt("    goto __bb{d};\n", .{target});
+            },
+            .branch => |br| {
+                try self.emit("    if (");
+                try self.emitIrValue(f, br.cond);
+                try self.emit(") {\n");
+                try self.emitIrPhiMoves(f, block, br.then_block, "        ");
+                try self.emitFmt("        goto __bb{d};\n    }} else {{\n", .{br.then_block});
+                try self.emitIrPhiMoves(f, block, br.else_block, "        ");
+                try self.emitFmt("        goto __bb{d};\n    }}\n", .{br.else_block});
+            },
+            .ret => |ret| {
+                if (f.entry_point) {
+                    try self.emit("    return 0;\n");
+                } else if (ret) |r| {
+                    try self.emit("    return ");
+                    try self.emitIrValue(f, r);
+                    try self.emit(";\n");
+                } else {
+                    try self.emit("    return;\n");
+                }
+            },
+        }
+    }
+
+    /// Feeds `target`'s phis with the operands flowing in from `from`.
+    fn emitIrPhiMoves(self: *Codegen, f: *const ir.Function, from: ir.BlockId, target: ir.BlockId, indent: []const u8) CodegenError!void {
+        const blk = f.blocks.items[target];
+        if (blk.phis.items.len == 0) return;
+        const pred_index = std.mem.indexOfScalar(ir.BlockId, blk.preds.items, from) orelse return CodegenError.UnsupportedNode;
+        for (blk.phis.items) |phi| {
+            try self.emitFmt("{s}__v{d}_in = ", .{ indent, phi });
+            try self.emitIrValue(f, f.inst(phi).operands[pred_index]);
+            try self.emit(";\n");
+        }
+    }
+
     fn emitReturn(self: *Codegen, rs: ast.ReturnStmt) CodegenError!void {
         const ret_type = self.current_return;
 
@@ -660,16 +1113,16 @@ pub const Codegen = struct {
         }
 
         const expected = ret_type.?;
-        if (rs.value != null and rs.value.?.* == .try_expr) {
+        if (rs.value != null and self.tree.tags[rs.value.?] == .try_expr) {
             if (expected != .error_union) return CodegenError.UnsupportedNode;
-            return self.emitTryReturn(rs.value.?.*.try_expr, expected.error_union);
+            return self.emitTryReturn(self.tree.node(rs.value.?).try_expr, expected.error_union);
         }
         try self.emitIndent();
         if (expected == .array) {
             if (rs.value == null) return CodegenError.UnsupportedNode;
             const name = try self.arrayReturnTypeName(expected);
-            const val = rs.value.?.*;
-            switch (val) {
+            const val = rs.value.?;
+            switch (self.tree.node(val)) {
                 .array_literal => |lit| {
                     try self.emit("return (");
                     try self.emit(name);
@@ -703,7 +1156,7 @@ pub const Codegen = struct {
         if (expected == .error_union) {
             if (rs.value == null) return CodegenError.UnsupportedNode;
             try self.emit("return ");
-            try self.emitErrorUnionValue(expected.error_union, rs.value.?.*);
+            try self.emitErrorUnionValue(expected.error_union, rs.value.?);
             try self.emit(";\n");
             return;
         }
@@ -711,13 +1164,13 @@ pub const Codegen = struct {
         try self.emit("return");
         if (rs.value) |val| {
             try self.emit(" ");
-            try self.emitExpr(val.*);
+            try self.emitExpr(val);
         }
         try self.emit(";\n");
     }
 
     fn emitTryAssign(self: *Codegen, name: []const u8, te: ast.TryExpr, explicit_type: ?ast.Type) CodegenError!void {
-        const inner_type = self.inferType(te.expr.*);
+        const inner_type = self.typeOf(te.expr);
         if (inner_type != .known or inner_type.known != .error_union) {
             return CodegenError.UnsupportedNode;
         }
@@ -746,7 +1199,7 @@ pub const Codegen = struct {
         try self.emit(" ");
         try self.emit(tmp);
         try self.emit(" = ");
-        try self.emitExpr(te.expr.*);
+        try self.emitExpr(te.expr);
         try self.emit(";\n");
 
         try self.emitIndent();
@@ -787,7 +1240,7 @@ pub const Codegen = struct {
     }
 
     fn emitTryExprStmt(self: *Codegen, te: ast.TryExpr) CodegenError!void {
-        const inner_type = self.inferType(te.expr.*);
+        const inner_type = self.typeOf(te.expr);
         if (inner_type != .known or inner_type.known != .error_union) {
             return CodegenError.UnsupportedNode;
         }
@@ -801,7 +1254,7 @@ pub const Codegen = struct {
         try self.emit(" ");
         try self.emit(tmp);
         try self.emit(" = ");
-        try self.emitExpr(te.expr.*);
+        try self.emitExpr(te.expr);
         try self.emit(";\n");
 
         try self.emitIndent();
@@ -815,7 +1268,7 @@ pub const Codegen = struct {
     }
 
     fn emitTryReturn(self: *Codegen, te: ast.TryExpr, ret_eu: ast.ErrorUnionType) CodegenError!void {
-        const inner_type = self.inferType(te.expr.*);
+        const inner_type = self.typeOf(te.expr);
         if (inner_type != .known or inner_type.known != .error_union) {
             return CodegenError.UnsupportedNode;
         }
@@ -828,7 +1281,7 @@ pub const Codegen = struct {
         try self.emit(" ");
         try self.emit(tmp);
         try self.emit(" = ");
-        try self.emitExpr(te.expr.*);
+        try self.emitExpr(te.expr);
         try self.emit(";\n");
 
         try self.emitIndent();
@@ -848,10 +1301,10 @@ pub const Codegen = struct {
         try self.emit(".value);\n");
     }
 
-    fn emitErrorUnionValue(self: *Codegen, eu: ast.ErrorUnionType, value: ast.Node) CodegenError!void {
+    fn emitErrorUnionValue(self: *Codegen, eu: ast.ErrorUnionType, value: ast.Index) CodegenError!void {
         const eu_type = ast.Type{ .error_union = eu };
         const name = try self.errorUnionTypeName(eu_type);
-        const val_type = self.inferType(value);
+        const val_type = self.typeOf(value);
 
         if (val_type == .known and val_type.known == .error_union and self.typeEquals(val_type.known, eu_type)) {
             try self.emitExpr(value);
@@ -877,15 +1330,9 @@ pub const Codegen = struct {
         return CodegenError.UnsupportedNode;
     }
 
-    fn valueMatchesType(self: *Codegen, value: ast.Node, t: ast.Type) bool {
-        const vt = self.inferType(value);
-        if (vt == .known) {
-            return self.typeEquals(vt.known, t);
-        }
-        return switch (value) {
-            .null_literal => self.typeEquals(t, .str),
-            else => false,
-        };
+    fn valueMatchesType(self: *Codegen, value: ast.Index, t: ast.Type) bool {
+        const vt = self.typeOf(value);
+        return vt == .known and self.typeEquals(vt.known, t);
     }
 
     fn nextTmpName(self: *Codegen, prefix: []const u8) CodegenError![]const u8 {
@@ -897,7 +1344,7 @@ pub const Codegen = struct {
     fn emitIf(self: *Codegen, is: ast.IfStmt) CodegenError!void {
         try self.emitIndent();
         try self.emit("if (");
-        try self.emitExpr(is.condition.*);
+        try self.emitExpr(is.condition);
         try self.emit(") {\n");
 
         self.indent_level += 1;
@@ -907,10 +1354,11 @@ pub const Codegen = struct {
         self.indent_level -= 1;
 
         // else if clauses
-        for (is.else_ifs) |elif| {
+        for (is.else_ifs) |elif_node| {
+            const elif = self.tree.node(elif_node).else_if;
             try self.emitIndent();
             try self.emit("} else if (");
-            try self.emitExpr(elif.condition.*);
+            try self.emitExpr(elif.condition);
             try self.emit(") {\n");
 
             self.indent_level += 1;
@@ -940,7 +1388,7 @@ pub const Codegen = struct {
         if (wl.parallel) return CodegenError.UnsupportedNode;
         try self.emitIndent();
         try self.emit("while (");
-        try self.emitExpr(wl.condition.*);
+        try self.emitExpr(wl.condition);
         try self.emit(") {\n");
 
         self.indent_level += 1;
@@ -954,15 +1402,10 @@ pub const Codegen = struct {
     }
 
     fn emitFor(self: *Codegen, fl: ast.ForLoop) CodegenError!void {
-        switch (fl.iterable.*) {
+        if (fl.parallel) return self.emitParallelFor(fl);
+        switch (self.tree.node(fl.iterable)) {
             .range => |range| {
-                const start_type = self.inferType(range.start.*);
-                const end_type = self.inferType(range.end.*);
-                const loop_type: ast.Type = blk: {
-                    if (start_type == .known and (start_type.known == .i64 or start_type.known == .u64)) break :blk .i64;
-                    if (end_type == .known and (end_type.known == .i64 or end_type.known == .u64)) break :blk .i64;
-                    break :blk .i32;
-                };
+                const loop_type = self.rangeLoopType(range);
 
                 const prev = self.var_types.get(fl.variable);
                 const had_prev = prev != null;
@@ -975,21 +1418,20 @@ pub const Codegen = struct {
                     }
                 }
 
-                if (fl.parallel) {
-                    try self.emitIndent();
-                    try self.emit("#pragma omp parallel for\n");
-                }
+                try self.pushRangeFact(fl);
+                defer _ = self.range_facts.pop();
+
                 try self.emitIndent();
                 try self.emit("for (");
                 try self.emit(self.typeToCType(loop_type));
                 try self.emit(" ");
                 try self.emit(fl.variable);
                 try self.emit(" = ");
-                try self.emitExpr(range.start.*);
+                try self.emitExpr(range.start);
                 try self.emit("; ");
                 try self.emit(fl.variable);
                 try self.emit(if (range.inclusive) " <= " else " < ");
-                try self.emitExpr(range.end.*);
+                try self.emitExpr(range.end);
                 try self.emit("; ");
                 try self.emit(fl.variable);
                 try self.emit("++) {\n");
@@ -1004,7 +1446,7 @@ pub const Codegen = struct {
                 try self.emit("}\n");
             },
             else => {
-                const iter_type = self.inferType(fl.iterable.*);
+                const iter_type = self.typeOf(fl.iterable);
                 if (iter_type != .known) return CodegenError.UnsupportedNode;
 
                 var elem_type: ast.Type = undefined;
@@ -1029,6 +1471,9 @@ pub const Codegen = struct {
                     }
                 }
 
+                try self.pushRangeFact(fl);
+                defer _ = self.range_facts.pop();
+
                 const idx = try self.nextTmpName("i");
                 const iter_tmp = try self.nextTmpName("iter");
 
@@ -1042,14 +1487,10 @@ pub const Codegen = struct {
                     try self.emit(" ");
                     try self.emit(iter_tmp);
                     try self.emit(" = ");
-                    try self.emitExpr(fl.iterable.*);
+                    try self.emitExpr(fl.iterable);
                     try self.emit(";\n");
                 }
 
-                if (fl.parallel) {
-                    try self.emitIndent();
-                    try self.emit("#pragma omp parallel for\n");
-                }
                 try self.emitIndent();
                 try self.emit("for (size_t ");
                 try self.emit(idx);
@@ -1083,7 +1524,7 @@ pub const Codegen = struct {
                     try self.emit(iter_tmp);
                     try self.emit(".data[");
                 } else {
-                    try self.emitExpr(fl.iterable.*);
+                    try self.emitExpr(fl.iterable);
                     try self.emit("[");
                 }
                 try self.emit(idx);
@@ -1103,107 +1544,728 @@ pub const Codegen = struct {
         }
     }
 
-    fn emitParallelBlock(self: *Codegen, pb: ast.ParallelBlock) CodegenError!void {
-        const thread_name = try self.nextTmpName("par_threads");
-        const fn_name = try self.nextTmpName("par_fns");
-
-        const count = pb.body.len;
-        try self.emitIndent();
-        try self.emit("pthread_t ");
-        try self.emit(thread_name);
-        try self.emit("[");
-        try self.emitInt(count);
-        try self.emit("];\n");
-
-        try self.emitIndent();
-        try self.emit("void (*");
-        try self.emit(fn_name);
-        try self.emit("[");
-        try self.emitInt(count);
-        try self.emit("])(void) = { ");
-
-        for (pb.body, 0..) |stmt, i| {
-            if (i > 0) try self.emit(", ");
-            const callee = switch (stmt) {
-                .expr_stmt => |es| switch (es.expr.*) {
-                    .call => |c| blk: {
-                        if (c.args.len != 0) return CodegenError.UnsupportedNode;
-                        break :blk c.callee;
+    fn rangeLoopType(self: *Codegen, range: ast.Range) ast.Type {
+        const start_type = self.typeOf(range.start);
+        const end_type = self.typeOf(range.end);
+        if (start_type == .known and (start_type.known == .i64 or start_type.known == .u64)) return .i64;
+        if (end_type == .known and (end_type.known == .i64 or end_type.known == .u64)) return .i64;
+        return .i32;
+    }
+
+    /// A variable of the enclosing C function used by an outlined loop body.
+    const Capture = struct {
+        name: []const u8,
+        type_info: ast.Type,
+        /// Expression stored in the context instead of the variable itself.
+        init: ?ast.Index = null,
+        /// Set for an accumulator: the context holds its identity, which
+        /// starts each chunk's partial.
+        reduce: ?ast.Reduction = null,
+    };
+
+    /// Outlines the loop body into `static void f(void* ctx, int64_t lo,
+    /// int64_t hi, long part)`, which runs one chunk of iterations, and hands
+    /// it to the runtime's `__1im_par_for`. The variables the body uses travel
+    /// in a context struct. Scalars and slices are copied, since the analyzer
+    /// rejects writes to them. Arrays are passed as a pointer to their
+    /// elements, so element writes land in the caller's array.
+    ///
+    /// A reduction's accumulator is a local of the chunk, starting from the
+    /// identity; at the end of the chunk it is folded into its part's partial.
+    /// Partials live in a caller-side array with one cache-line aligned entry
+    /// per worker and are folded into the accumulator after the loop.
+    fn emitParallelFor(self: *Codegen, fl: ast.ForLoop) CodegenError!void {
+        var names: std.ArrayList([]const u8) = .empty;
+        defer names.deinit(self.allocator);
+        for (fl.body) |stmt| try self.collectNames(stmt, &names);
+
+        var captures: std.ArrayList(Capture) = .empty;
+        defer captures.deinit(self.allocator);
+        for (fl.reductions) |r| {
+            const vt = self.var_types.get(r.name) orelse return CodegenError.UnsupportedNode;
+            if (vt != .known) return CodegenError.UnsupportedNode;
+            captures.append(self.allocator, .{ .name = r.name, .type_info = vt.known, .reduce = r }) catch return CodegenError.OutOfMemory;
+        }
+        for (names.items) |name| {
+            if (std.mem.eql(u8, name, fl.variable)) continue;
+            const vt = self.var_types.get(name) orelse continue;
+            if (vt != .known) return CodegenError.UnsupportedNode;
+            const seen = for (captures.items) |c| {
+                if (std.mem.eql(u8, c.name, name)) break true;
+            } else false;
+            if (!seen) captures.append(self.allocator, .{ .name = name, .type_info = vt.known }) catch return CodegenError.OutOfMemory;
+        }
+
+        // What the body loops over: a range, an array variable (captured
+        // like any other array) or a slice, evaluated once into the context.
+        const Iter = union(enum) { range: ast.Range, array: ast.ArrayType, slice: []const u8 };
+        var elem_type: ast.Type = undefined;
+        const iter: Iter = switch (self.tree.node(fl.iterable)) {
+            .range => |range| blk: {
+                elem_type = self.rangeLoopType(range);
+                break :blk .{ .range = range };
+            },
+            else => blk: {
+                const iter_type = self.typeOf(fl.iterable);
+                if (iter_type != .known) return CodegenError.UnsupportedNode;
+                switch (iter_type.known) {
+                    .array => |arr| {
+                        elem_type = arr.elem.*;
+                        if (self.tree.tags[fl.iterable] != .variable) return CodegenError.UnsupportedNode;
+                        const name = self.tree.node(fl.iterable).variable.name;
+                        const seen = for (captures.items) |c| {
+                            if (std.mem.eql(u8, c.name, name)) break true;
+                        } else false;
+                        if (!seen) captures.append(self.allocator, .{ .name = name, .type_info = iter_type.known }) catch return CodegenError.OutOfMemory;
+                        break :blk .{ .array = arr };
+                    },
+                    .slice => |sl| {
+                        elem_type = sl.elem.*;
+                        const name = try self.nextTmpName("iter");
+                        captures.append(self.allocator, .{ .name = name, .type_info = iter_type.known, .init = fl.iterable }) catch return CodegenError.OutOfMemory;
+                        break :blk .{ .slice = name };
                     },
                     else => return CodegenError.UnsupportedNode,
-                },
-                else => return CodegenError.UnsupportedNode,
-            };
-            try self.emit("(void (*)(void))");
-            try self.emit(callee);
-        }
-        try self.emit(" };\n");
+                }
+            },
+        };
 
-        // Spawn threads
-        for (pb.body, 0..) |_, i| {
+        const ctx_type = try self.nextTmpName("par_ctx");
+        const body_fn = try self.nextTmpName("par_body");
+        const red_type = if (fl.reductions.len > 0) try self.nextTmpName("par_red") else "";
+
+        // Partials, aligned so that each worker's entry has its own cache
+        // lines.
+        if (fl.reductions.len > 0) {
+            try self.emitTo(&self.lifted, "typedef struct {\n");
+            for (captures.items[0..fl.reductions.len], 0..) |c, i| {
+                try self.emitTo(&self.lifted, if (i == 0) "    _Alignas(64) " else "    ");
+                try self.emitTypeDeclTo(&self.lifted, c.type_info, c.name);
+                try self.emitTo(&self.lifted, ";\n");
+            }
+            try self.emitTo(&self.lifted, "} ");
+            try self.emitTo(&self.lifted, red_type);
+            try self.emitTo(&self.lifted, ";\n\n");
+        }
+
+        // Context struct, ahead of the outlined function.
+        if (captures.items.len > 0) {
+            try self.emitTo(&self.lifted, "typedef struct {\n");
+            for (captures.items) |c| {
+                try self.emitTo(&self.lifted, "    ");
+                try self.emitCaptureDeclTo(&self.lifted, c);
+                try self.emitTo(&self.lifted, ";\n");
+            }
+            if (fl.reductions.len > 0) {
+                try self.emitTo(&self.lifted, "    ");
+                try self.emitTo(&self.lifted, red_type);
+                try self.emitTo(&self.lifted, "* __red;\n");
+            }
+            try self.emitTo(&self.lifted, "} ");
+            try self.emitTo(&self.lifted, ctx_type);
+            try self.emitTo(&self.lifted, ";\n\n");
+        }
+
+        // The outlined function, written to its own buffer: loops nested in
+        // the body are lifted first and so end up ahead of it.
+        var body_out: std.ArrayList(u8) = .empty;
+        defer body_out.deinit(self.allocator);
+        std.mem.swap(std.ArrayList(u8), &self.output, &body_out);
+        const emitted = self.emitLoopBodyFn(fl, captures.items, ctx_type, body_fn, iter, elem_type);
+        std.mem.swap(std.ArrayList(u8), &self.output, &body_out);
+        try emitted;
+        try self.emitTo(&self.lifted, body_out.items);
+
+        // Call site.
+        const ctx_name = try self.nextTmpName("ctx");
+        const red_name = try self.nextTmpName("red");
+        const workers = try self.nextTmpName("nw");
+        try self.emitIndent();
+        try self.emit("{\n");
+        self.indent_level += 1;
+        if (fl.reductions.len > 0) {
             try self.emitIndent();
-            try self.emit("pthread_create(&");
-            try self.emit(thread_name);
-            try self.emit("[");
-            try self.emitInt(i);
-            try self.emit("], NULL, __1im_par_runner, (void*)&");
-            try self.emit(fn_name);
-            try self.emit("[");
-            try self.emitInt(i);
-            try self.emit("]);\n");
-        }
-
-        // Join threads
-        for (pb.body, 0..) |_, i| {
+            try self.emitFmt("long {s} = __1im_workers();\n", .{workers});
             try self.emitIndent();
-            try self.emit("pthread_join(");
-            try self.emit(thread_name);
-            try self.emit("[");
-            try self.emitInt(i);
-            try self.emit("], NULL);\n");
+            try self.emitFmt("{s} {s}[{s}];\n", .{ red_type, red_name, workers });
         }
-    }
-
-    fn programHasParallel(self: *Codegen, prog: ast.Program) bool {
-        for (prog.stmts) |stmt| {
-            if (self.nodeHasParallel(stmt)) return true;
-        }
-        return false;
-    }
-
-    fn nodeHasParallel(self: *Codegen, node: ast.Node) bool {
-        return switch (node) {
-            .parallel_block => true,
-            .if_stmt => |is| blk: {
-                for (is.then_body) |s| if (self.nodeHasParallel(s)) break :blk true;
-                for (is.else_ifs) |elif| {
-                    for (elif.body) |s| if (self.nodeHasParallel(s)) break :blk true;
-                }
-                if (is.else_body) |else_body| {
-                    for (else_body) |s| if (self.nodeHasParallel(s)) break :blk true;
+        if (captures.items.len > 0) {
+            try self.emitIndent();
+            try self.emit(ctx_type);
+            try self.emit(" ");
+            try self.emit(ctx_name);
+            try self.emit(" = { ");
+            for (captures.items, 0..) |c, i| {
+                if (i > 0) try self.emit(", ");
+                if (c.reduce) |r| {
+                    try self.emitReductionIdentity(r, c.type_info);
+                } else if (c.init) |value| {
+                    try self.emitExpr(value);
+                } else {
+                    try self.emit(c.name);
                 }
-                break :blk false;
+            }
+            if (fl.reductions.len > 0) {
+                try self.emit(", ");
+                try self.emit(red_name);
+            }
+            try self.emit(" };\n");
+        }
+        if (fl.reductions.len > 0) {
+            try self.emitIndent();
+            try self.emitFmt("for (long __w = 0; __w < {s}; __w++) {{\n", .{workers});
+            for (fl.reductions) |r| {
+                try self.emitIndent();
+                try self.emitFmt("    {s}[__w].{s} = {s}.{s};\n", .{ red_name, r.name, ctx_name, r.name });
+            }
+            try self.emitIndent();
+            try self.emit("}\n");
+        }
+        try self.emitIndent();
+        try self.emit("__1im_par_for(");
+        switch (iter) {
+            .range => |range| {
+                try self.emit("(int64_t)(");
+                try self.emitExpr(range.start);
+                try self.emit("), (int64_t)(");
+                try self.emitExpr(range.end);
+                try self.emit(if (range.inclusive) ") + 1" else ")");
             },
-            .while_loop => |wl| {
-                for (wl.body) |s| if (self.nodeHasParallel(s)) return true;
-                return false;
+            .array => |arr| {
+                try self.emit("0, ");
+                try self.emitInt(arr.len);
             },
-            .for_loop => |fl| {
-                for (fl.body) |s| if (self.nodeHasParallel(s)) return true;
-                return false;
+            .slice => |name| {
+                try self.emit("0, (int64_t)");
+                try self.emit(ctx_name);
+                try self.emit(".");
+                try self.emit(name);
+                try self.emit(".len");
+            },
+        }
+        try self.emit(switch (fl.schedule) {
+            .static => ", __1IM_STATIC, ",
+            .dynamic => ", __1IM_DYNAMIC, ",
+            .guided => ", __1IM_GUIDED, ",
+        });
+        if (fl.grain) |grain| {
+            try self.emit("(int64_t)(");
+            try self.emitExpr(grain);
+            try self.emit(")");
+        } else {
+            try self.emit("0");
+        }
+        try self.emit(", ");
+        try self.emit(body_fn);
+        if (captures.items.len > 0) {
+            try self.emit(", &");
+            try self.emit(ctx_name);
+            try self.emit(");\n");
+        } else {
+            try self.emit(", NULL);\n");
+        }
+        if (fl.reductions.len > 0) {
+            try self.emitIndent();
+            try self.emitFmt("for (long __w = 0; __w < {s}; __w++) {{\n", .{workers});
+            for (fl.reductions) |r| {
+                const part = try std.fmt.allocPrint(self.allocator, "{s}[__w].{s}", .{ red_name, r.name });
+                defer self.allocator.free(part);
+                try self.emitIndent();
+                try self.emitFmt("    {s} = ", .{r.name});
+                try self.emitCombine(r, r.name, part);
+                try self.emit(";\n");
+            }
+            try self.emitIndent();
+            try self.emit("}\n");
+        }
+        self.indent_level -= 1;
+        try self.emitIndent();
+        try self.emit("}\n");
+    }
+
+    /// The starting value of every partial of `r`.
+    fn emitReductionIdentity(self: *Codegen, r: ast.Reduction, t: ast.Type) CodegenError!void {
+        switch (r.op) {
+            .sum => try self.emit("0"),
+            .product => try self.emit("1"),
+            .min => try self.emit(switch (t) {
+                .i8 => "INT8_MAX",
+                .i16 => "INT16_MAX",
+                .i32 => "INT32_MAX",
+                .i64 => "INT64_MAX",
+                .u8 => "UINT8_MAX",
+                .u16 => "UINT16_MAX",
+                .u32 => "UINT32_MAX",
+                .u64 => "UINT64_MAX",
+                .f32, .f64 => "(1.0 / 0.0)",
+                else => return CodegenError.UnsupportedNode,
+            }),
+            .max => try self.emit(switch (t) {
+                .i8 => "INT8_MIN",
+                .i16 => "INT16_MIN",
+                .i32 => "INT32_MIN",
+                .i64 => "INT64_MIN",
+                .u8, .u16, .u32, .u64 => "0",
+                .f32, .f64 => "(-1.0 / 0.0)",
+                else => return CodegenError.UnsupportedNode,
+            }),
+            .custom => try self.emitExpr(r.identity orelse return CodegenError.UnsupportedNode),
+        }
+    }
+
+    /// `a` combined with `b` under `r`'s operator.
+    fn emitCombine(self: *Codegen, r: ast.Reduction, a: []const u8, b: []const u8) CodegenError!void {
+        switch (r.op) {
+            .sum => try self.emitFmt("{s} + {s}", .{ a, b }),
+            .product => try self.emitFmt("{s} * {s}", .{ a, b }),
+            .min => try self.emitFmt("({1s} < {0s} ? {1s} : {0s})", .{ a, b }),
+            .max => try self.emitFmt("({1s} > {0s} ? {1s} : {0s})", .{ a, b }),
+            .custom => {
+                try self.emitSymbol(r.combiner);
+                try self.emitFmt("({s}, {s})", .{ a, b });
+            },
+        }
+    }
+
+    fn emitLoopBodyFn(
+        self: *Codegen,
+        fl: ast.ForLoop,
+        captures: []const Capture,
+        ctx_type: []const u8,
+        body_fn: []const u8,
+        iter: anytype,
+        elem_type: ast.Type,
+    ) CodegenError!void {
+        // The body sees the captures under their own names and declares its
+        // locals afresh; none of that leaks back into the enclosing function.
+        const prev_var_types = self.var_types;
+        self.var_types = prev_var_types.clone() catch return CodegenError.OutOfMemory;
+        defer {
+            self.var_types.deinit();
+            self.var_types = prev_var_types;
+        }
+        const prev_indent = self.indent_level;
+        self.indent_level = 1;
+        defer self.indent_level = prev_indent;
+        const prev_return = self.current_return;
+        self.current_return = null;
+        defer self.current_return = prev_return;
+
+        try self.emit("static void ");
+        try self.emit(body_fn);
+        try self.emit("(void* __arg, int64_t __lo, int64_t __hi, long __part) {\n");
+        if (captures.len > 0) {
+            try self.emit("    ");
+            try self.emit(ctx_type);
+            try self.emit("* __ctx = (");
+            try self.emit(ctx_type);
+            try self.emit("*)__arg;\n");
+            for (captures) |c| {
+                try self.emit("    ");
+                try self.emitCaptureDeclTo(&self.output, c);
+                try self.emit(" = __ctx->");
+                try self.emit(c.name);
+                try self.emit(";\n");
+            }
+        } else {
+            try self.emit("    (void)__arg;\n");
+        }
+
+        try self.emit("    for (int64_t __i = __lo; __i < __hi; __i++) {\n");
+        self.indent_level += 1;
+        try self.emitIndent();
+        try self.emit(try self.cTypeName(elem_type));
+        try self.emit(" ");
+        try self.emit(fl.variable);
+        switch (iter) {
+            .range => {
+                try self.emit(" = (");
+                try self.emit(try self.cTypeName(elem_type));
+                try self.emit(")__i;\n");
+            },
+            .array => {
+                try self.emit(" = ");
+                try self.emit(self.tree.node(fl.iterable).variable.name);
+                try self.emit("[__i];\n");
+            },
+            .slice => |name| {
+                try self.emit(" = ");
+                try self.emit(name);
+                try self.emit(".data[__i];\n");
             },
+        }
+        self.var_types.put(fl.variable, .{ .known = elem_type }) catch return CodegenError.OutOfMemory;
+
+        try self.pushRangeFact(fl);
+        defer _ = self.range_facts.pop();
+        for (fl.body) |stmt| {
+            try self.emitStmt(stmt);
+        }
+        self.indent_level -= 1;
+        try self.emit("    }\n");
+        for (fl.reductions) |r| {
+            const part = try std.fmt.allocPrint(self.allocator, "__ctx->__red[__part].{s}", .{r.name});
+            defer self.allocator.free(part);
+            try self.emitFmt("    {s} = ", .{part});
+            try self.emitCombine(r, part, r.name);
+            try self.emit(";\n");
+        }
+        if (fl.reductions.len == 0) try self.emit("    (void)__part;\n");
+        try self.emit("}\n\n");
+    }
+
+    /// `T name` for a capture; arrays become a pointer to their elements.
+    fn emitCaptureDeclTo(self: *Codegen, out: *std.ArrayList(u8), c: Capture) CodegenError!void {
+        switch (c.type_info) {
+            .array => |arr| {
+                const ptr = try std.fmt.allocPrint(self.allocator, "(*{s})", .{c.name});
+                defer self.allocator.free(ptr);
+                try self.emitTypeDeclTo(out, arr.elem.*, ptr);
+            },
+            else => try self.emitTypeDeclTo(out, c.type_info, c.name),
+        }
+    }
+
+    /// Appends every variable name read or assigned anywhere in `node`.
+    fn collectNames(self: *Codegen, node: ast.Index, names: *std.ArrayList([]const u8)) CodegenError!void {
+        switch (self.tree.node(node)) {
+            .variable => |v| names.append(self.allocator, v.name) catch return CodegenError.OutOfMemory,
+            .set_assign => |sa| {
+                names.append(self.allocator, sa.name) catch return CodegenError.OutOfMemory;
+                try self.collectNames(sa.value, names);
+            },
+            .typed_assign => |ta| try self.collectNames(ta.value, names),
+            .return_stmt => |rs| if (rs.value) |v| try self.collectNames(v, names),
+            .if_stmt => |is| {
+                try self.collectNames(is.condition, names);
+                for (is.then_body) |stmt| try self.collectNames(stmt, names);
+                for (is.else_ifs) |elif| try self.collectNames(elif, names);
+                if (is.else_body) |else_body| {
+                    for (else_body) |stmt| try self.collectNames(stmt, names);
+                }
+            },
+            .else_if => |elif| {
+                try self.collectNames(elif.condition, names);
+                for (elif.body) |stmt| try self.collectNames(stmt, names);
+            },
+            .while_loop => |wl| {
+                try self.collectNames(wl.condition, names);
+                for (wl.body) |stmt| try self.collectNames(stmt, names);
+            },
+            .for_loop => |fl| {
+                try self.collectNames(fl.iterable, names);
+                if (fl.grain) |grain| try self.collectNames(grain, names);
+                for (fl.reductions) |r| {
+                    names.append(self.allocator, r.name) catch return CodegenError.OutOfMemory;
+                    if (r.identity) |identity| try self.collectNames(identity, names);
+                }
+                for (fl.body) |stmt| try self.collectNames(stmt, names);
+            },
+            .parallel_block => |pb| for (pb.body) |stmt| try self.collectNames(stmt, names),
+            .parallel_assign => |pa| {
+                for (pa.targets) |target| try self.collectNames(target, names);
+                for (pa.calls) |call| try self.collectNames(call, names);
+            },
+            .break_stmt => |bs| if (bs.value) |v| try self.collectNames(v, names),
             .try_catch => |tc| {
-                for (tc.catch_body) |s| if (self.nodeHasParallel(s)) return true;
+                try self.collectNames(tc.try_expr, names);
+                for (tc.catch_body) |stmt| try self.collectNames(stmt, names);
+            },
+            .try_expr => |te| try self.collectNames(te.expr, names),
+            .spawn_expr => |se| try self.collectNames(se.call, names),
+            .await_expr => |ae| try self.collectNames(ae.expr, names),
+            .expr_stmt => |es| try self.collectNames(es.expr, names),
+            .call => |c| for (c.args) |arg| try self.collectNames(arg, names),
+            .interpolation => |ip| for (ip.parts) |part| try self.collectNames(part, names),
+            .binary_op => |b| {
+                try self.collectNames(b.left, names);
+                try self.collectNames(b.right, names);
+            },
+            .unary_op => |u| try self.collectNames(u.operand, names),
+            .array_literal => |lit| for (lit.elements) |elem| try self.collectNames(elem, names),
+            .index_expr => |ie| {
+                try self.collectNames(ie.target, names);
+                try self.collectNames(ie.index, names);
+            },
+            .index_assign => |ia| {
+                try self.collectNames(ia.target, names);
+                try self.collectNames(ia.value, names);
+            },
+            .range => |r| {
+                try self.collectNames(r.start, names);
+                try self.collectNames(r.end, names);
+            },
+            else => {},
+        }
+    }
+
+    /// Each call becomes a task on the runtime's pool; the block returns
+    /// once all of them have finished.
+    fn emitParallelBlock(self: *Codegen, pb: ast.ParallelBlock) CodegenError!void {
+        var calls: std.ArrayList(ast.Index) = .empty;
+        defer calls.deinit(self.allocator);
+        for (pb.body) |stmt| {
+            const es = switch (self.tree.node(stmt)) {
+                .expr_stmt => |es| es,
+                else => return CodegenError.UnsupportedNode,
+            };
+            if (self.tree.tags[es.expr] != .call) return CodegenError.UnsupportedNode;
+            calls.append(self.allocator, es.expr) catch return CodegenError.OutOfMemory;
+        }
+        try self.emitParallelCalls(calls.items, &.{});
+    }
+
+    /// Runs `calls` as the tasks of one group. Each call gets a lifted thunk
+    /// and an argument struct, filled in by this thread, that also receives
+    /// the result when it is bound to one of `targets`. Results are bound
+    /// once every call is done. If a call returns an error, it cancels the
+    /// calls not yet started, and the error is returned as by `try`.
+    fn emitParallelCalls(self: *Codegen, calls: []const ast.Index, targets: []const ast.Index) CodegenError!void {
+        const group = try self.nextTmpName("par_group");
+        const task_name = try self.nextTmpName("par_tasks");
+        const thunks = self.allocator.alloc([]const u8, calls.len) catch return CodegenError.OutOfMemory;
+        defer self.allocator.free(thunks);
+        const args = self.allocator.alloc(?[]const u8, calls.len) catch return CodegenError.OutOfMemory;
+        defer self.allocator.free(args);
+
+        try self.emitIndent();
+        try self.emitFmt("__1im_group {s} = {{ 0 }};\n", .{group});
+        for (calls, 0..) |call_node, i| {
+            const c = self.tree.node(call_node).call;
+            const ret = self.typeOf(call_node);
+            if (ret != .known or ret.known == .array) return CodegenError.UnsupportedNode;
+            const bound = i < targets.len;
+            const fails = bound and ret.known == .error_union;
+            thunks[i] = try self.nextTmpName("par_call");
+            const args_type = if (c.args.len > 0 or bound) try self.nextTmpName("par_args") else null;
+
+            // Argument struct and thunk, written aside and then lifted.
+            var lifted_out: std.ArrayList(u8) = .empty;
+            defer lifted_out.deinit(self.allocator);
+            std.mem.swap(std.ArrayList(u8), &self.output, &lifted_out);
+            const emitted = self.emitCallThunk(c, ret.known, thunks[i], args_type, bound, fails, null);
+            std.mem.swap(std.ArrayList(u8), &self.output, &lifted_out);
+            try emitted;
+            try self.emitTo(&self.lifted, lifted_out.items);
+
+            args[i] = null;
+            const at = args_type orelse continue;
+            const name = try self.nextTmpName("par_arg");
+            args[i] = name;
+            try self.emitIndent();
+            try self.emitFmt("{s} {s} = {{ ", .{ at, name });
+            for (c.args, 0..) |arg, j| {
+                if (j > 0) try self.emit(", ");
+                try self.emitFmt(".a{d} = ", .{j});
+                try self.emitCopiedValue(arg);
+            }
+            if (fails) {
+                if (c.args.len > 0) try self.emit(", ");
+                try self.emitFmt(".ret = {{ .ok = true }}, .group = &{s}", .{group});
+            }
+            try self.emit(" };\n");
+        }
+
+        try self.emitIndent();
+        try self.emitFmt("__1im_task {s}[{d}] = {{ ", .{ task_name, calls.len });
+        for (thunks, args, 0..) |thunk, arg, i| {
+            if (i > 0) try self.emit(", ");
+            if (arg) |name| {
+                try self.emitFmt("{{ {s}, &{s}, NULL }}", .{ thunk, name });
+            } else {
+                try self.emitFmt("{{ {s}, NULL, NULL }}", .{thunk});
+            }
+        }
+        try self.emit(" };\n");
+        try self.emitIndent();
+        try self.emitFmt("__1im_par_run(&{s}, {s}, {d});\n", .{ group, task_name, calls.len });
+
+        // Errors first, so that nothing is bound when one is returned.
+        for (targets, 0..) |_, i| {
+            if (self.typeOf(calls[i]).known != .error_union) continue;
+            const ret_type = self.current_return orelse return CodegenError.UnsupportedNode;
+            if (ret_type != .error_union) return CodegenError.UnsupportedNode;
+            const ret_name = try self.errorUnionTypeName(ret_type);
+            try self.emitIndent();
+            try self.emitFmt("if (!{0s}.ret.ok) return {1s}_err({0s}.ret.err);\n", .{ args[i].?, ret_name });
+        }
+        for (targets, 0..) |target, i| {
+            const name = self.tree.node(target).variable.name;
+            const ret = self.typeOf(calls[i]).known;
+            const value_type = if (ret == .error_union) ret.error_union.ok.* else ret;
+            const field = if (ret == .error_union) ".ret.value" else ".ret";
+
+            try self.emitIndent();
+            if (self.var_types.get(name)) |existing| {
+                if (existing == .known and existing.known == .error_union) {
+                    try self.emitFmt("{s} = {s}_ok({s}{s});\n", .{ name, try self.errorUnionTypeName(existing.known), args[i].?, field });
+                    continue;
+                }
+                try self.emitFmt("{s} = {s}{s};\n", .{ name, args[i].?, field });
+            } else {
+                self.var_types.put(name, .{ .known = value_type }) catch return CodegenError.OutOfMemory;
+                try self.emitFmt("{s} {s} = {s}{s};\n", .{ try self.cTypeName(value_type), name, args[i].?, field });
+            }
+        }
+    }
+
+    /// `static void thunk(void* arg)` calling `c` with the arguments stored
+    /// in its `args_type` struct. With `future`, the struct starts with that
+    /// future struct, which receives the result.
+    fn emitCallThunk(
+        self: *Codegen,
+        c: ast.Call,
+        ret: ast.Type,
+        thunk: []const u8,
+        args_type: ?[]const u8,
+        bound: bool,
+        fails: bool,
+        future: ?[]const u8,
+    ) CodegenError!void {
+        if (args_type) |at| {
+            try self.emit("typedef struct {\n");
+            if (future) |f| try self.emitFmt("    {s} f;\n", .{f});
+            for (c.args, 0..) |arg, j| {
+                const arg_type = self.typeOf(arg);
+                if (arg_type != .known) return CodegenError.UnsupportedNode;
+                const field = try std.fmt.allocPrint(self.allocator, "a{d}", .{j});
+                defer self.allocator.free(field);
+                try self.emit("    ");
+                try self.emitCaptureDeclTo(&self.output, .{ .name = field, .type_info = arg_type.known });
+                try self.emit(";\n");
+            }
+            if (bound) {
+                try self.emit("    ");
+                try self.emitTypeDeclTo(&self.output, ret, "ret");
+                try self.emit(";\n");
+            }
+            if (fails) try self.emit("    __1im_group* group;\n");
+            try self.emitFmt("}} {s};\n\n", .{at});
+        }
+
+        try self.emitFmt("static void {s}(void* __arg) {{\n", .{thunk});
+        if (args_type) |at| {
+            try self.emitFmt("    {0s}* __a = ({0s}*)__arg;\n", .{at});
+        } else {
+            try self.emit("    (void)__arg;\n");
+        }
+        if (bound) {
+            try self.emit("    __a->ret = ");
+        } else if (future != null and ret != .void) {
+            try self.emit("    __a->f.ret = ");
+        } else {
+            try self.emit("    ");
+        }
+        try self.emitSymbol(c.callee);
+        try self.emit("(");
+        for (c.args, 0..) |_, j| {
+            if (j > 0) try self.emit(", ");
+            try self.emitFmt("__a->a{d}", .{j});
+        }
+        try self.emit(");\n");
+        if (fails) try self.emit("    if (!__a->ret.ok) __1im_cancel(__a->group);\n");
+        try self.emit("}\n\n");
+    }
+
+    /// `spawn` allocates a future holding the call's arguments and result,
+    /// fills in the arguments and submits the call as a task; `name` gets a
+    /// pointer to the future.
+    fn emitSpawnAssign(self: *Codegen, name: []const u8, spawn_node: ast.Index) CodegenError!void {
+        const future_type = self.typeOf(spawn_node);
+        if (future_type != .known or future_type.known != .future) return CodegenError.UnsupportedNode;
+        const c = self.tree.node(self.tree.node(spawn_node).spawn_expr.call).call;
+        const handle_type = try self.cTypeName(future_type.known);
+        const task_type = try std.fmt.allocPrint(self.allocator, "{s}_task", .{handle_type});
+        defer self.allocator.free(task_type);
+        const thunk = try self.nextTmpName("spawn_call");
+        const args_type = try self.nextTmpName("spawn_args");
+
+        var lifted_out: std.ArrayList(u8) = .empty;
+        defer lifted_out.deinit(self.allocator);
+        std.mem.swap(std.ArrayList(u8), &self.output, &lifted_out);
+        const emitted = self.emitCallThunk(c, future_type.known.future.result.*, thunk, args_type, false, false, task_type);
+        std.mem.swap(std.ArrayList(u8), &self.output, &lifted_out);
+        try emitted;
+        try self.emitTo(&self.lifted, lifted_out.items);
+
+        const tmp = try self.nextTmpName("spawn");
+        try self.emitIndent();
+        try self.emitFmt("{0s}* {1s} = __1im_future_new(sizeof({0s}));\n", .{ args_type, tmp });
+        for (c.args, 0..) |arg, j| {
+            try self.emitIndent();
+            try self.emitFmt("{s}->a{d} = ", .{ tmp, j });
+            try self.emitCopiedValue(arg);
+            try self.emit(";\n");
+        }
+        try self.emitIndent();
+        try self.emitFmt("__1im_spawn(&{s}->f.head, {s});\n", .{ tmp, thunk });
+
+        try self.emitIndent();
+        if (self.var_types.contains(name)) {
+            try self.emitFmt("{s} = ({s}){{ .task = &{s}->f }};\n", .{ name, handle_type, tmp });
+        } else {
+            self.var_types.put(name, future_type) catch return CodegenError.OutOfMemory;
+            try self.emitFmt("{s} {s} = {{ .task = &{s}->f }};\n", .{ handle_type, name, tmp });
+        }
+    }
+
+    /// Whether the program runs tasks or declares atomics, mutexes or
+    /// channels, whose operations are in `runtime.decls`.
+    fn programUsesRuntime(tree: *const ast.Tree) bool {
+        for (tree.rootStmts()) |stmt| {
+            if (nodeUsesRuntime(tree, stmt)) return true;
+        }
+        return false;
+    }
+
+    fn nodeUsesRuntime(tree: *const ast.Tree, node: ast.Index) bool {
+        return switch (tree.node(node)) {
+            .parallel_block, .parallel_assign => true,
+            // Atomics, mutexes and channels are only made here or passed in;
+            // a channel may also come back from a call.
+            .set_assign => |sa| switch (tree.node(sa.value)) {
+                .spawn_expr => true,
+                .call => |c| std.mem.eql(u8, c.callee, "mutex"),
+                else => false,
+            },
+            .typed_assign => |ta| isSyncType(ta.type_info),
+            .if_stmt => |is| blk: {
+                for (is.then_body) |s| if (nodeUsesRuntime(tree, s)) break :blk true;
+                for (is.else_ifs) |elif| {
+                    for (tree.node(elif).else_if.body) |s| if (nodeUsesRuntime(tree, s)) break :blk true;
+                }
+                if (is.else_body) |else_body| {
+                    for (else_body) |s| if (nodeUsesRuntime(tree, s)) break :blk true;
+                }
+                break :blk false;
+            },
+            .while_loop => |wl| {
+                for (wl.body) |s| if (nodeUsesRuntime(tree, s)) return true;
+                return false;
+            },
+            .for_loop => |fl| {
+                if (fl.parallel) return true;
+                for (fl.body) |s| if (nodeUsesRuntime(tree, s)) return true;
+                return false;
+            },
+            .try_catch => |tc| {
+                for (tc.catch_body) |s| if (nodeUsesRuntime(tree, s)) return true;
                 return false;
             },
             .function_def => |fd| {
-                for (fd.body) |s| if (self.nodeHasParallel(s)) return true;
+                for (fd.params) |p| if (isSyncType(p.type_info)) return true;
+                if (fd.return_type) |ret| if (ret == .channel) return true;
+                for (fd.body) |s| if (nodeUsesRuntime(tree, s)) return true;
                 return false;
             },
             else => false,
         };
     }
 
+    fn isSyncType(t: ast.Type) bool {
+        return t == .atomic or t == .mutex or t == .channel;
+    }
+
     fn emitInt(self: *Codegen, value: usize) CodegenError!void {
         var buf: [32]u8 = undefined;
         const s = std.fmt.bufPrint(&buf, "{d}", .{value}) catch return CodegenError.OutOfMemory;
@@ -1221,7 +2283,7 @@ pub const Codegen = struct {
     }
 
     fn emitTryCatch(self: *Codegen, tc: ast.TryCatch) CodegenError!void {
-        const try_type = self.inferType(tc.try_expr.*);
+        const try_type = self.typeOf(tc.try_expr);
         if (try_type != .known or try_type.known != .error_union) {
             return CodegenError.UnsupportedNode;
         }
@@ -1237,7 +2299,7 @@ pub const Codegen = struct {
         try self.emit(" ");
         try self.emit(tmp);
         try self.emit(" = ");
-        try self.emitExpr(tc.try_expr.*);
+        try self.emitExpr(tc.try_expr);
         try self.emit(";\n");
 
         try self.emitIndent();
@@ -1284,12 +2346,12 @@ pub const Codegen = struct {
     }
 
     fn emitExprStmt(self: *Codegen, es: ast.ExprStmt) CodegenError!void {
-        switch (es.expr.*) {
+        switch (self.tree.node(es.expr)) {
             .call => |c| try self.emitCall(c),
             .try_expr => |te| try self.emitTryExprStmt(te),
             else => {
                 try self.emitIndent();
-                try self.emitExpr(es.expr.*);
+                try self.emitExpr(es.expr);
                 try self.emit(";\n");
             },
         }
@@ -1300,86 +2362,155 @@ pub const Codegen = struct {
             try self.emitPrint(call);
         } else if (std.mem.eql(u8, call.callee, "len")) {
             return CodegenError.UnsupportedNode;
+        } else if (ast.SyncBuiltin.of(call.callee)) |builtin| {
+            try self.emitIndent();
+            try self.emitSyncCall(builtin, call);
+            try self.emit(";\n");
+        } else if (ast.AllocBuiltin.of(call.callee)) |builtin| {
+            try self.emitAllocStmt(builtin, call);
         } else {
             // Generic function call
             try self.emitIndent();
-            try self.emit(call.callee);
+            try self.emitSymbol(call.callee);
             try self.emit("(");
             for (call.args, 0..) |arg, i| {
                 if (i > 0) try self.emit(", ");
-                try self.emitExpr(arg);
+                try self.emitCopiedValue(arg);
             }
             try self.emit(");\n");
         }
     }
 
+    /// Atomic operations are C11 <stdatomic.h> calls, apart from the
+    /// runtime's `__1im_cas_*`; mutexes are the runtime's futex locks and
+    /// channels its ring buffers of `__1im_word`s.
+    fn emitSyncCall(self: *Codegen, builtin: ast.SyncBuiltin, call: ast.Call) CodegenError!void {
+        const values: usize = switch (builtin) {
+            .mutex => return self.emit("&(__1im_mutex){0}"),
+            .channel => {
+                try self.emit("__1im_channel_new(");
+                try self.emitExpr(call.args[0]);
+                return self.emit(")");
+            },
+            .send => {
+                try self.emit("__1im_send(");
+                try self.emitExpr(call.args[0]);
+                try self.emitFmt(", (__1im_word){{ .{s} = ", .{try self.channelField(call.args[0])});
+                try self.emitExpr(call.args[1]);
+                return self.emit(" })");
+            },
+            .receive => {
+                try self.emit("__1im_receive(");
+                try self.emitExpr(call.args[0]);
+                return self.emitFmt(").{s}", .{try self.channelField(call.args[0])});
+            },
+            .lock, .unlock => {
+                try self.emitFmt("__1im_{s}(", .{@tagName(builtin)});
+                try self.emitExpr(call.args[0]);
+                return self.emit(")");
+            },
+            .atomic_load => blk: {
+                try self.emit("atomic_load_explicit(");
+                break :blk 0;
+            },
+            .atomic_store => blk: {
+                try self.emit("atomic_store_explicit(");
+                break :blk 1;
+            },
+            .atomic_add => blk: {
+                try self.emit("atomic_fetch_add_explicit(");
+                break :blk 1;
+            },
+            .atomic_cas => blk: {
+                const t = self.typeOf(call.args[0]);
+                if (t != .known or t.known != .atomic) return CodegenError.UnsupportedNode;
+                try self.emitFmt("__1im_cas_{s}(", .{@tagName(t.known.atomic.elem.*)});
+                break :blk 2;
+            },
+        };
+        for (call.args[0 .. values + 1]) |arg| {
+            try self.emitExpr(arg);
+            try self.emit(", ");
+        }
+        var order: ast.MemoryOrder = .seq_cst;
+        if (call.args.len > values + 1) {
+            const lit = self.tree.node(call.args[values + 1]).string_literal;
+            order = ast.MemoryOrder.of(lit.value) orelse return CodegenError.UnsupportedNode;
+        }
+        try self.emitFmt("memory_order_{s}", .{@tagName(order)});
+        if (builtin == .atomic_cas) {
+            // The order when the comparison fails, which stores nothing.
+            const failure: ast.MemoryOrder = switch (order) {
+                .release => .relaxed,
+                .acq_rel => .acquire,
+                else => order,
+            };
+            try self.emitFmt(", memory_order_{s}", .{@tagName(failure)});
+        }
+        try self.emit(")");
+    }
+
+    /// The `__1im_word` member that carries the channel's messages.
+    fn channelField(self: *Codegen, channel: ast.Index) CodegenError![]const u8 {
+        const t = self.typeOf(channel);
+        if (t != .known or t.known != .channel) return CodegenError.UnsupportedNode;
+        return switch (t.known.channel.elem.*) {
+            .i8, .i16, .i32, .i64 => "i",
+            .u8, .u16, .u32, .u64 => "u",
+            .f32, .f64 => "f",
+            .bool => "b",
+            .str => "s",
+            else => CodegenError.UnsupportedNode,
+        };
+    }
+
     fn emitPrint(self: *Codegen, call: ast.Call) CodegenError!void {
         if (call.args.len == 0) {
             try self.emitIndent();
-            try self.emit("printf(\"\\\");");
+            try self.emit("__1im_print_cstr(\"\");\n");
             return;
         }
 
         // Single argument print
         const arg = call.args[0];
-        const arg_type = self.inferType(arg);
+        if (self.tree.node(arg) == .interpolation) {
+            try self.emitIndent();
+            try self.emitInterpolation(self.tree.node(arg).interpolation, true);
+            return self.emit(";\n");
+        }
+        const format = switch (self.typeOf(arg)) {
+            .known => |kt| printFormat(kt) orelse return CodegenError.UnsupportedNode,
+            // Default: try as integer
+            .unknown => printFormat(.i64).?,
+        };
 
         try self.emitIndent();
-        switch (arg_type) {
-            .known => |kt| switch (kt) {
-                .i8, .i16, .i32 => {
-                    try self.emit("printf(\"%d\\n\", (int)");
-                    try self.emitExpr(arg);
-                    try self.emit(");\n");
-                },
-                .i64 => {
-                    try self.emit("printf(\"%\" PRId64 \"\\n\", (int64_t)");
-                    try self.emitExpr(arg);
-                    try self.emit(");\n");
-                },
-                .u8, .u16, .u32 => {
-                    try self.emit("printf(\"%u\\n\", (unsigned int)");
-                    try self.emitExpr(arg);
-                    try self.emit(");\n");
-                },
-                .u64 => {
-                    try self.emit("printf(\"%\" PRIu64 \"\\n\", (uint64_t)");
-                    try self.emitExpr(arg);
-                    try self.emit(");\n");
-                },
-                .f32 => {
-                    try self.emit("printf(\"%f\\n\", (float)");
-                    try self.emitExpr(arg);
-                    try self.emit(");\n");
-                },
-                .f64 => {
-                    try self.emit("printf(\"%f\\n\", (double)");
-                    try self.emitExpr(arg);
-                    try self.emit(");\n");
-                },
-                .bool => {
-                    try self.emit("printf(\"%s\\n\", ");
-                    try self.emitExpr(arg);
-                    try self.emit(" ? \"true\" : \"false\");\n");
-                },
-                .str => {
-                    try self.emit("printf(\"%s\\n\", ");
-                    try self.emitExpr(arg);
-                    try self.emit(");\n");
-                },
-                .array, .slice, .error_union => return CodegenError.UnsupportedNode,
-                .void => return CodegenError.UnsupportedNode,
-            },
-            .unknown => {
-                // Default: try as integer
-                try self.emit("printf(\"%\" PRId64 \"\\n\", (int64_t)");
-                try self.emitExpr(arg);
-                try self.emit(");\n");
-            },
-        }
+        try self.emit(format.open);
+        try self.emitExpr(arg);
+        try self.emit(format.close);
     }
 
-    fn emitArrayDecl(self: *Codegen, t: ast.Type, name: []const u8, value: ast.Node) CodegenError!void {
+    const PrintFormat = struct {
+        open: []const u8,
+        close: []const u8,
+    };
+
+    /// The call that surrounds a value of type `t` in `print`; the
+    /// `__1im_print_*` functions are in `runtime.print_defs`.
+    fn printFormat(t: ast.Type) ?PrintFormat {
+        const close = ");\n";
+        return switch (t) {
+            .i8, .i16, .i32, .i64 => .{ .open = "__1im_print_i64((int64_t)", .close = close },
+            .u8, .u16, .u32, .u64 => .{ .open = "__1im_print_u64((uint64_t)", .close = close },
+            .f32 => .{ .open = "__1im_print_f64((float)", .close = close },
+            .f64 => .{ .open = "__1im_print_f64((double)", .close = close },
+            .bool => .{ .open = "__1im_print_cstr(", .close = " ? \"true\" : \"false\");\n" },
+            .str => .{ .open = "__1im_print_str(", .close = close },
+            .array, .slice, .error_union, .future, .atomic, .mutex, .channel, .arena, .void => null,
+        };
+    }
+
+    fn emitArrayDecl(self: *Codegen, t: ast.Type, name: []const u8, value: ast.Index) CodegenError!void {
         switch (t) {
             .array => {},
             else => return CodegenError.UnsupportedNode,
@@ -1393,7 +2524,7 @@ pub const Codegen = struct {
         try self.emitArrayDims(t);
         try self.emit(" = ");
 
-        switch (value) {
+        switch (self.tree.node(value)) {
             .array_literal => |lit| try self.emitArrayLiteral(lit),
             else => return CodegenError.UnsupportedNode,
         }
@@ -1401,8 +2532,8 @@ pub const Codegen = struct {
         try self.emit(";\n");
     }
 
-    fn emitArrayDeclWithValue(self: *Codegen, t: ast.Type, name: []const u8, value: ast.Node) CodegenError!void {
-        switch (value) {
+    fn emitArrayDeclWithValue(self: *Codegen, t: ast.Type, name: []const u8, value: ast.Index) CodegenError!void {
+        switch (self.tree.tags[value]) {
             .array_literal => {
                 try self.emitArrayDecl(t, name, value);
                 return;
@@ -1433,7 +2564,7 @@ pub const Codegen = struct {
         try self.emit("{");
         for (lit.elements, 0..) |elem, i| {
             if (i > 0) try self.emit(", ");
-            switch (elem) {
+            switch (self.tree.node(elem)) {
                 .array_literal => |inner| try self.emitArrayLiteral(inner),
                 else => try self.emitExpr(elem),
             }
@@ -1441,28 +2572,41 @@ pub const Codegen = struct {
         try self.emit("}");
     }
 
-    fn emitSliceDecl(self: *Codegen, t: ast.Type, name: []const u8, value: ast.Node) CodegenError!void {
+    fn emitSliceDecl(self: *Codegen, t: ast.Type, name: []const u8, value: ast.Index) CodegenError!void {
         const slice = switch (t) {
             .slice => |s| s,
             else => return CodegenError.UnsupportedNode,
         };
 
-        const value_type = self.inferType(value);
+        const value_type = self.typeOf(value);
+        if (self.tree.node(value) == .call and std.mem.eql(u8, self.tree.node(value).call.callee, "alloc")) {
+            return self.emitAllocDecl(t, name, self.tree.node(value).call);
+        }
         if (value_type == .known and value_type.known == .slice) {
             try self.emitIndent();
             try self.emit(try self.cTypeName(t));
             try self.emit(" ");
             try self.emit(name);
             try self.emit(" = ");
-            try self.emitExpr(value);
+            try self.emitCopiedValue(value);
             try self.emit(";\n");
             return;
         }
 
+        // An array variable is viewed in place. An array returned by a call
+        // would not outlive the statement, so it is copied to the stack.
+        if (value_type == .known and value_type.known == .array and self.tree.tags[value] != .call) {
+            try self.emitIndent();
+            try self.emitFmt("{s} {s} = {{ ", .{ try self.cTypeName(t), name });
+            try self.emitExpr(value);
+            try self.emitFmt(", {d}, 0, NULL }};\n", .{value_type.known.array.len});
+            return;
+        }
+
         const data_name = try std.fmt.allocPrint(self.allocator, "{s}_data", .{name});
         defer self.allocator.free(data_name);
 
-        const arr_type = ast.Type{ .array = .{ .len = switch (value) {
+        const arr_type = ast.Type{ .array = .{ .len = switch (self.tree.node(value)) {
             .array_literal => |lit| lit.elements.len,
             else => blk: {
                 if (value_type == .known and value_type.known == .array) {
@@ -1472,7 +2616,7 @@ pub const Codegen = struct {
             },
         }, .elem = slice.elem } };
 
-        if (value == .array_literal) {
+        if (self.tree.tags[value] == .array_literal) {
             try self.emitArrayDecl(arr_type, data_name, value);
         } else if (value_type == .known and value_type.known == .array) {
             try self.emitIndent();
@@ -1508,36 +2652,362 @@ pub const Codegen = struct {
         try self.emit(" };\n");
     }
 
+    /// `set xs as []T to alloc(n[, a])`: the length and arena are evaluated
+    /// once, into temporaries.
+    fn emitAllocDecl(self: *Codegen, t: ast.Type, name: []const u8, call: ast.Call) CodegenError!void {
+        const len_name = try self.nextTmpName("len");
+        defer self.allocator.free(len_name);
+        try self.emitIndent();
+        try self.emitFmt("int64_t {s} = ", .{len_name});
+        try self.emitExpr(call.args[0]);
+        try self.emit(";\n");
+
+        var arena: []const u8 = "NULL";
+        const arena_name = try self.nextTmpName("arena");
+        defer self.allocator.free(arena_name);
+        if (call.args.len > 1) {
+            try self.emitIndent();
+            try self.emitFmt("__1im_arena* {s} = ", .{arena_name});
+            try self.emitExpr(call.args[1]);
+            try self.emit(";\n");
+            arena = arena_name;
+        }
+
+        try self.emitIndent();
+        try self.emitFmt("{s} {s} = {{ __1im_alloc({s}, sizeof({s}), {s}), (size_t){s}, (size_t){s}, {s} }};\n", .{
+            try self.cTypeName(t),
+            name,
+            len_name,
+            try self.cTypeName(t.slice.elem.*),
+            arena,
+            len_name,
+            len_name,
+            arena,
+        });
+    }
+
+    /// `append`, `reserve` and `free` change the slice variable in place.
+    fn emitAllocStmt(self: *Codegen, builtin: ast.AllocBuiltin, call: ast.Call) CodegenError!void {
+        const target = switch (builtin) {
+            .append, .reserve, .free => switch (self.tree.node(call.args[0])) {
+                .variable => |v| v.name,
+                else => "",
+            },
+            else => "",
+        };
+        const t = self.typeOf(call.args[0]);
+        switch (builtin) {
+            .append => {
+                if (t != .known or t.known != .slice) return CodegenError.UnsupportedNode;
+                // The value first: it may read the slice.
+                const value_name = try self.nextTmpName("item");
+                defer self.allocator.free(value_name);
+                try self.emitIndent();
+                try self.emit("{\n");
+                self.indent_level += 1;
+                try self.emitIndent();
+                try self.emitFmt("{s} {s} = ", .{ try self.cTypeName(t.known.slice.elem.*), value_name });
+                try self.emitExpr(call.args[1]);
+                try self.emit(";\n");
+                try self.emitIndent();
+                try self.emitFmt("if ({s}.len >= {s}.cap) {s}.data = __1im_grow({s}.data, {s}.len, &{s}.cap, {s}.arena, sizeof(*{s}.data), {s}.len + 1);\n", .{ target, target, target, target, target, target, target, target, target });
+                try self.emitIndent();
+                try self.emitFmt("{s}.data[{s}.len++] = {s};\n", .{ target, target, value_name });
+                self.indent_level -= 1;
+                try self.emitIndent();
+                try self.emit("}\n");
+            },
+            .reserve => {
+                const want_name = try self.nextTmpName("want");
+                defer self.allocator.free(want_name);
+                try self.emitIndent();
+                try self.emitFmt("int64_t {s} = ", .{want_name});
+                try self.emitExpr(call.args[1]);
+                try self.emit(";\n");
+                try self.emitIndent();
+                try self.emitFmt("if ({s} > 0 && (size_t){s} > {s}.cap) {s}.data = __1im_grow({s}.data, {s}.len, &{s}.cap, {s}.arena, sizeof(*{s}.data), (size_t){s});\n", .{ want_name, want_name, target, target, target, target, target, target, target, want_name });
+            },
+            .free => {
+                try self.emitIndent();
+                if (t == .known and t.known == .arena) {
+                    try self.emit("__1im_arena_free(");
+                    try self.emitExpr(call.args[0]);
+                    return self.emit(");\n");
+                }
+                try self.emitFmt("__1im_release({s}.data, {s}.cap, {s}.arena);\n", .{ target, target, target });
+                try self.emitIndent();
+                try self.emitFmt("{s}.data = NULL;\n", .{target});
+                try self.emitIndent();
+                try self.emitFmt("{s}.len = {s}.cap = 0;\n", .{ target, target });
+            },
+            .reset => {
+                try self.emitIndent();
+                try self.emit("__1im_arena_reset(");
+                try self.emitExpr(call.args[0]);
+                try self.emit(");\n");
+            },
+            .alloc, .arena, .cap, .copy => {
+                try self.emitIndent();
+                try self.emitAllocExpr(builtin, call);
+                try self.emit(";\n");
+            },
+        }
+    }
+
+    /// The builtins with a value: `arena()`, `copy(xs)` and `cap(xs)`. A view of an
+    /// array has no capacity of its own, so its `cap` is its length.
+    fn emitAllocExpr(self: *Codegen, builtin: ast.AllocBuiltin, call: ast.Call) CodegenError!void {
+        switch (builtin) {
+            .arena => try self.emit("__1im_arena_new()"),
+            .copy => {
+                const elem = try self.viewedElem(call.args[0]);
+                try self.emit(try self.cTypeName(.{ .slice = .{ .elem = elem } }));
+                try self.emit("_copy(");
+                try self.emitAsSlice(call.args[0]);
+                try self.emit(")");
+            },
+            .cap => {
+                try self.emit("__1im_cap(");
+                try self.emitExpr(call.args[0]);
+                try self.emit(".len, ");
+                try self.emitExpr(call.args[0]);
+                try self.emit(".cap)");
+            },
+            else => return CodegenError.UnsupportedNode,
+        }
+    }
+
     fn emitIndexAssign(self: *Codegen, ia: ast.IndexAssign) CodegenError!void {
         try self.emitIndent();
-        switch (ia.target.*) {
+        switch (self.tree.node(ia.target)) {
             .index_expr => |ix| try self.emitIndexExpr(ix),
             else => return CodegenError.UnsupportedNode,
         }
         try self.emit(" = ");
-        try self.emitExpr(ia.value.*);
+        try self.emitExpr(ia.value);
         try self.emit(";\n");
     }
 
+    /// `xs[i]`, through `__1im_index` unless bounds checks are off or `i`
+    /// is proven in range.
     fn emitIndexExpr(self: *Codegen, ix: ast.IndexExpr) CodegenError!void {
-        const target_type = self.inferType(ix.target.*);
+        if (self.tree.node(ix.index) == .range) return self.emitSliceRange(ix);
+        const target_type = self.typeOf(ix.target);
+        const checked = self.countCheck(ix) and self.bounds_checks;
         if (target_type == .known and target_type.known == .slice) {
-            try self.emitExpr(ix.target.*);
+            // Anything but a variable is evaluated once, by the `_at` helper.
+            if (checked and self.tree.node(ix.target) != .variable) {
+                try self.emit("(*");
+                try self.emit(try self.cTypeName(target_type.known));
+                try self.emit("_at(");
+                try self.emitExpr(ix.target);
+                try self.emit(", ");
+                try self.emitExpr(ix.index);
+                try self.emit("))");
+                return;
+            }
+            try self.emitExpr(ix.target);
             try self.emit(".data[");
-            try self.emitExpr(ix.index.*);
+            if (checked) try self.emit("__1im_index(");
+            try self.emitExpr(ix.index);
+            if (checked) {
+                try self.emit(", ");
+                try self.emitExpr(ix.target);
+                try self.emit(".len)");
+            }
             try self.emit("]");
             return;
         }
-        try self.emitExpr(ix.target.*);
+        try self.emitExpr(ix.target);
         try self.emit("[");
-        try self.emitExpr(ix.index.*);
+        if (checked) try self.emit("__1im_index(");
+        try self.emitExpr(ix.index);
+        if (checked) try self.emitFmt(", {d})", .{target_type.known.array.len});
         try self.emit("]");
     }
 
+    /// Counts `xs[i]` for the bounds report; true when it needs a check.
+    fn countCheck(self: *Codegen, ix: ast.IndexExpr) bool {
+        const t = self.typeOf(ix.target);
+        if (t != .known or (t.known != .array and t.known != .slice)) return false;
+        if (self.provenInRange(ix)) {
+            self.checks.proven += 1;
+            return false;
+        }
+        self.checks.checked += 1;
+        return true;
+    }
+
+    /// A constant index below an array's length, or the variable of an
+    /// enclosing loop that counts up to the length of what it indexes.
+    fn provenInRange(self: *Codegen, ix: ast.IndexExpr) bool {
+        const t = self.typeOf(ix.target).known;
+        const array_len: ?usize = if (t == .array) t.array.len else null;
+        switch (self.tree.node(ix.index)) {
+            .int_literal => |lit| return array_len != null and lit.value >= 0 and lit.value < array_len.?,
+            .variable => |v| {
+                const fact = self.rangeFact(v.name) orelse return false;
+                if (fact.bound != null and array_len != null and fact.bound.? <= array_len.?) return true;
+                const of = fact.length_of orelse return false;
+                return switch (self.tree.node(ix.target)) {
+                    .variable => |target| std.mem.eql(u8, target.name, of),
+                    else => false,
+                };
+            },
+            else => return false,
+        }
+    }
+
+    fn rangeFact(self: *const Codegen, name: []const u8) ?RangeFact {
+        var i = self.range_facts.items.len;
+        while (i > 0) : (i -= 1) {
+            const fact = self.range_facts.items[i - 1];
+            if (std.mem.eql(u8, fact.variable, name)) return fact;
+        }
+        return null;
+    }
+
+    /// Records what `loop for i in a..b` proves about `i` in its body: with
+    /// `a` a non-negative constant and `i` never assigned there, `i < b`.
+    /// `b` is a constant, `len(xs)` or `len(xs) - k`, and `xs` must not be
+    /// reassigned or freed in the body either; `append` only lengthens it.
+    fn pushRangeFact(self: *Codegen, fl: ast.ForLoop) CodegenError!void {
+        var fact: RangeFact = .{ .variable = fl.variable, .bound = null, .length_of = null };
+        try self.range_facts.ensureUnusedCapacity(self.allocator, 1);
+        defer self.range_facts.appendAssumeCapacity(fact);
+
+        const range = switch (self.tree.node(fl.iterable)) {
+            .range => |r| r,
+            else => return,
+        };
+        switch (self.tree.node(range.start)) {
+            .int_literal => |lit| if (lit.value < 0) return,
+            else => return,
+        }
+        if (self.blockAssigns(fl.body, fl.variable)) return;
+
+        // `..=` reaches one further; `len(xs) - k` stops k earlier.
+        var end = range.end;
+        var slack: i64 = if (range.inclusive) -1 else 0;
+        switch (self.tree.node(end)) {
+            .binary_op => |bin| if (bin.op == .sub and self.tree.node(bin.right) == .int_literal) {
+                end = bin.left;
+                slack += self.tree.node(bin.right).int_literal.value;
+            },
+            else => {},
+        }
+        switch (self.tree.node(end)) {
+            .int_literal => |lit| {
+                const bound = lit.value - slack;
+                if (bound >= 0) fact.bound = @intCast(bound);
+            },
+            .call => |c| {
+                if (!std.mem.eql(u8, c.callee, "len") or c.args.len != 1 or slack < 0) return;
+                const of = switch (self.tree.node(c.args[0])) {
+                    .variable => |v| v.name,
+                    else => return,
+                };
+                if (self.blockAssigns(fl.body, of)) return;
+                fact.length_of = of;
+            },
+            else => {},
+        }
+    }
+
+    /// Whether `stmts` may assign `name`, bind it anew, or free it.
+    fn blockAssigns(self: *const Codegen, stmts: []const ast.Index, name: []const u8) bool {
+        for (stmts) |stmt| {
+            if (self.stmtAssigns(stmt, name)) return true;
+        }
+        return false;
+    }
+
+    fn stmtAssigns(self: *const Codegen, stmt: ast.Index, name: []const u8) bool {
+        return switch (self.tree.node(stmt)) {
+            .set_assign => |sa| std.mem.eql(u8, sa.name, name),
+            .typed_assign => |ta| std.mem.eql(u8, ta.name, name),
+            .parallel_assign => |pa| for (pa.targets) |target| {
+                if (std.mem.eql(u8, self.tree.node(target).variable.name, name)) break true;
+            } else false,
+            .expr_stmt => |es| switch (self.tree.node(es.expr)) {
+                .call => |c| std.mem.eql(u8, c.callee, "free") and c.args.len == 1 and
+                    self.tree.node(c.args[0]) == .variable and std.mem.eql(u8, self.tree.node(c.args[0]).variable.name, name),
+                else => false,
+            },
+            .if_stmt => |is| blk: {
+                if (self.blockAssigns(is.then_body, name)) break :blk true;
+                for (is.else_ifs) |elif_node| {
+                    if (self.blockAssigns(self.tree.node(elif_node).else_if.body, name)) break :blk true;
+                }
+                break :blk if (is.else_body) |else_body| self.blockAssigns(else_body, name) else false;
+            },
+            .while_loop => |wl| self.blockAssigns(wl.body, name),
+            .for_loop => |fl| std.mem.eql(u8, fl.variable, name) or self.blockAssigns(fl.body, name),
+            .parallel_block => |pb| self.blockAssigns(pb.body, name),
+            .try_catch => |tc| (if (tc.catch_var) |v| std.mem.eql(u8, v, name) else false) or self.blockAssigns(tc.catch_body, name),
+            else => false,
+        };
+    }
+
+    /// `xs[a..b]`: `{ data + a, b - a }`, bounds-checked, without copying.
+    fn emitSliceRange(self: *Codegen, ix: ast.IndexExpr) CodegenError!void {
+        const range = self.tree.node(ix.index).range;
+        const elem = try self.viewedElem(ix.target);
+        try self.emit(try self.cTypeName(.{ .slice = .{ .elem = elem } }));
+        try self.emit("_view(");
+        try self.emitAsSlice(ix.target);
+        try self.emit(", ");
+        try self.emitExpr(range.start);
+        try self.emit(", ");
+        try self.emitExpr(range.end);
+        if (range.inclusive) try self.emit(" + 1");
+        try self.emit(")");
+    }
+
+    fn viewedElem(self: *Codegen, node: ast.Index) CodegenError!*const ast.Type {
+        const t = self.typeOf(node);
+        if (t != .known) return CodegenError.UnsupportedNode;
+        return switch (t.known) {
+            .array => |arr| arr.elem,
+            .slice => |sl| sl.elem,
+            else => CodegenError.UnsupportedNode,
+        };
+    }
+
+    /// `node` as a value copied into a parameter or another variable. A
+    /// slice keeps its elements with the variable that owns them: the copy
+    /// is a view (`cap` 0), so `append`, `reserve` and `free` on it leave
+    /// the owner's buffer alone. Slices returned by calls are handed over.
+    fn emitCopiedValue(self: *Codegen, node: ast.Index) CodegenError!void {
+        const t = self.typeOf(node);
+        if (t != .known or t.known != .slice or self.tree.tags[node] == .call) return self.emitExpr(node);
+        try self.emit(try self.cTypeName(t.known));
+        try self.emit("_alias(");
+        try self.emitExpr(node);
+        try self.emit(")");
+    }
+
+    /// An array or slice expression as a slice; an array becomes a view.
+    fn emitAsSlice(self: *Codegen, node: ast.Index) CodegenError!void {
+        const t = self.typeOf(node);
+        if (t != .known or t.known != .array) return self.emitExpr(node);
+        var buf: [32]u8 = undefined;
+        const len_str = std.fmt.bufPrint(&buf, "{d}", .{t.known.array.len}) catch return CodegenError.OutOfMemory;
+        try self.emit("(");
+        try self.emit(try self.cTypeName(.{ .slice = .{ .elem = t.known.array.elem } }));
+        try self.emit("){ ");
+        try self.emitExpr(node);
+        try self.emit(", ");
+        try self.emit(len_str);
+        try self.emit(", 0, NULL }");
+    }
+
+    /// `len(xs)` is signed like the analyzer types it, so `len(xs) - 1` on an
+    /// empty slice is -1 rather than a wrapped size_t.
     fn emitLenExpr(self: *Codegen, call: ast.Call) CodegenError!void {
         if (call.args.len != 1) return CodegenError.UnsupportedNode;
         const arg = call.args[0];
-        const arg_type = self.inferType(arg);
+        const arg_type = self.typeOf(arg);
         if (arg_type != .known) return CodegenError.UnsupportedNode;
 
         switch (arg_type.known) {
@@ -1546,14 +3016,208 @@ pub const Codegen = struct {
                 const s = std.fmt.bufPrint(&buf, "{d}", .{arr.len}) catch return CodegenError.OutOfMemory;
                 try self.emit(s);
             },
-            .slice => {
+            .slice, .str => {
+                try self.emit("((int64_t)");
                 try self.emitExpr(arg);
-                try self.emit(".len");
+                try self.emit(".len)");
             },
             else => return CodegenError.UnsupportedNode,
         }
     }
 
+    fn isStr(self: *const Codegen, node: ast.Index) bool {
+        const t = self.typeOf(node);
+        return t == .known and t.known == .str;
+    }
+
+    /// `+` concatenates strings; comparisons look at their bytes.
+    fn emitStrBinary(self: *Codegen, bin: ast.BinaryOp) CodegenError!void {
+        const sign: []const u8 = switch (bin.op) {
+            .add => return self.emitStrCall("__1im_str_cat(", bin),
+            .eq => return self.emitStrCall("__1im_str_eq(", bin),
+            .neq => return self.emitStrCall("!__1im_str_eq(", bin),
+            .lt => " < 0)",
+            .lte => " <= 0)",
+            .gt => " > 0)",
+            .gte => " >= 0)",
+            else => return CodegenError.UnsupportedNode,
+        };
+        try self.emit("(");
+        try self.emitStrCall("__1im_str_cmp(", bin);
+        try self.emit(sign);
+    }
+
+    fn emitStrCall(self: *Codegen, open: []const u8, bin: ast.BinaryOp) CodegenError!void {
+        try self.emit(open);
+        try self.emitExpr(bin.left);
+        try self.emit(", ");
+        try self.emitExpr(bin.right);
+        try self.emit(")");
+    }
+
+    /// A `__1im_str` holding the literal whose source text, escapes and
+    /// all, is `text`; see `runtime.str_decls`.
+    fn emitStrLiteral(self: *Codegen, text: []const u8) CodegenError!void {
+        const len = literalLength(text) orelse {
+            return self.emitFmt("__1im_str_lit(\"{0s}\", sizeof(\"{0s}\") - 1)", .{text});
+        };
+        const field: []const u8 = if (len < 16) "small" else "ptr";
+        try self.emitFmt("((__1im_str){{ .len = {d}, .{s} = \"{s}\" }})", .{ len, field, text });
+    }
+
+    /// `"text {expr} text"` as a call to a helper made for this string,
+    /// which works out the size of every part, then writes the parts one
+    /// after another into a `str` of exactly that size or, for `print`,
+    /// straight into the output buffer. The formatters are in
+    /// `runtime.str_defs`.
+    ///
+    /// C evaluates arguments in no set order, so when more than one part
+    /// could have side effects or see another's, the parts are first
+    /// evaluated left to right into temporaries in a statement expression.
+    fn emitInterpolation(self: *Codegen, ip: ast.Interpolation, printed: bool) CodegenError!void {
+        const name = try self.nextTmpName("interp");
+        defer self.allocator.free(name);
+        var helper: std.ArrayList(u8) = .empty;
+        defer helper.deinit(self.allocator);
+        std.mem.swap(std.ArrayList(u8), &self.output, &helper);
+        const emitted = self.emitInterpHelper(name, ip, printed);
+        std.mem.swap(std.ArrayList(u8), &self.output, &helper);
+        try emitted;
+        try self.emitTo(&self.lifted, helper.items);
+
+        var unstable: usize = 0;
+        for (ip.parts) |part| {
+            switch (self.tree.tags[part]) {
+                .string_literal, .int_literal, .float_literal, .bool_literal, .variable => {},
+                else => unstable += 1,
+            }
+        }
+        const temps: ?[]const u8 = if (unstable > 1) try self.nextTmpName("part") else null;
+        defer if (temps) |t| self.allocator.free(t);
+        if (temps) |t| {
+            try self.emit("({ ");
+            for (ip.parts, 0..) |part, i| {
+                if (self.tree.tags[part] == .string_literal) continue;
+                try self.emitFmt("{s} {s}_{d} = ", .{ self.typeToCType(self.interpType(part)), t, i });
+                try self.emitExpr(part);
+                try self.emit("; ");
+            }
+        }
+
+        try self.emitFmt("{s}(", .{name});
+        var args: usize = 0;
+        for (ip.parts, 0..) |part, i| {
+            if (self.tree.tags[part] == .string_literal) continue;
+            if (args > 0) try self.emit(", ");
+            args += 1;
+            if (temps) |t| {
+                try self.emitFmt("{s}_{d}", .{ t, i });
+            } else {
+                try self.emitExpr(part);
+            }
+        }
+        try self.emit(")");
+        if (temps != null) try self.emit("; })");
+    }
+
+    /// Value `i` of an interpolation is parameter `v<i>` of its helper,
+    /// `n<i>` bytes long.
+    fn emitInterpHelper(self: *Codegen, name: []const u8, ip: ast.Interpolation, printed: bool) CodegenError!void {
+        try self.emitFmt("static {s} {s}(", .{ if (printed) "void" else "__1im_str", name });
+        var args: usize = 0;
+        for (ip.parts, 0..) |part, i| {
+            if (self.tree.tags[part] == .string_literal) continue;
+            if (args > 0) try self.emit(", ");
+            args += 1;
+            try self.emitFmt("{s} v{d}", .{ self.typeToCType(self.interpType(part)), i });
+        }
+        if (args == 0) try self.emit("void");
+        try self.emit(") {\n");
+
+        // Sizes first; floats are formatted aside to learn theirs.
+        for (ip.parts, 0..) |part, i| {
+            switch (self.interpType(part)) {
+                .i8, .i16, .i32, .i64 => try self.emitFmt("    size_t n{0d} = __1im_size_i64(v{0d});\n", .{i}),
+                .u8, .u16, .u32, .u64 => try self.emitFmt("    size_t n{0d} = __1im_size_u64(v{0d});\n", .{i}),
+                .f32, .f64 => {
+                    try self.emitFmt("    char f{d}[__1IM_F64_MAX];\n", .{i});
+                    try self.emitFmt("    size_t n{0d} = __1im_fmt_f64(f{0d}, v{0d});\n", .{i});
+                },
+                .bool => try self.emitFmt("    size_t n{0d} = v{0d} ? 4 : 5;\n", .{i}),
+                .str => if (self.tree.tags[part] == .string_literal) {
+                    const text = self.tree.node(part).string_literal.value;
+                    if (literalLength(text)) |len| {
+                        try self.emitFmt("    size_t n{d} = {d};\n", .{ i, len });
+                    } else {
+                        try self.emitFmt("    size_t n{d} = sizeof(\"{s}\") - 1;\n", .{ i, text });
+                    }
+                } else {
+                    try self.emitFmt("    size_t n{0d} = v{0d}.len;\n", .{i});
+                },
+                else => return CodegenError.UnsupportedNode,
+            }
+        }
+        try self.emit("    size_t n = ");
+        for (0..ip.parts.len) |i| try self.emitFmt("{s}n{d}", .{ if (i > 0) " + " else "", i });
+        try self.emit(";\n");
+        if (printed) {
+            try self.emit("    char* line = __1im_print_begin(n);\n");
+            try self.emit("    char* p = line;\n");
+        } else {
+            try self.emit("    __1im_str s;\n");
+            try self.emit("    char* p = __1im_str_alloc(&s, n);\n");
+        }
+
+        for (ip.parts, 0..) |part, i| {
+            try self.emit("    ");
+            switch (self.interpType(part)) {
+                .i8, .i16, .i32, .i64 => try self.emitFmt("__1im_fmt_i64(p, v{0d}, n{0d});\n", .{i}),
+                .u8, .u16, .u32, .u64 => try self.emitFmt("__1im_fmt_u64(p, v{0d}, n{0d});\n", .{i}),
+                .f32, .f64 => try self.emitFmt("memcpy(p, f{0d}, n{0d});\n", .{i}),
+                .bool => try self.emitFmt("memcpy(p, v{0d} ? \"true\" : \"false\", n{0d});\n", .{i}),
+                .str => if (self.tree.tags[part] == .string_literal) {
+                    try self.emitFmt("memcpy(p, \"{s}\", n{d});\n", .{ self.tree.node(part).string_literal.value, i });
+                } else {
+                    try self.emitFmt("memcpy(p, __1im_str_data(&v{0d}), n{0d});\n", .{i});
+                },
+                else => return CodegenError.UnsupportedNode,
+            }
+            try self.emitFmt("    p += n{d};\n", .{i});
+        }
+        try self.emit(if (printed) "    __1im_print_end(line, n);\n" else "    return s;\n");
+        try self.emit("}\n\n");
+    }
+
+    /// Type of one part of an interpolation; untyped values are i64, as in
+    /// `print`.
+    fn interpType(self: *const Codegen, part: ast.Index) ast.Type {
+        return switch (self.typeOf(part)) {
+            .known => |kt| kt,
+            .unknown => .i64,
+        };
+    }
+
+    /// Bytes in a string literal, or null for escapes other than a single
+    /// character's, which C reads as more than two characters.
+    fn literalLength(text: []const u8) ?usize {
+        var len: usize = 0;
+        var i: usize = 0;
+        while (i < text.len) : (len += 1) {
+            if (text[i] != '\\') {
+                i += 1;
+                continue;
+            }
+            if (i + 1 >= text.len) return null;
+            switch (text[i + 1]) {
+                'n', 't', 'r', 'a', 'b', 'f', 'v', '\\', '"', '\'', '?' => {},
+                '0' => if (i + 2 < text.len and std.ascii.isDigit(text[i + 2])) return null,
+                else => return null,
+            }
+            i += 2;
+        }
+        return len;
+    }
+
     fn emitArrayDims(self: *Codegen, t: ast.Type) CodegenError!void {
         try self.emitArrayDimsTo(&self.output, t);
     }
@@ -1565,8 +3229,8 @@ pub const Codegen = struct {
         };
     }
 
-    fn emitExpr(self: *Codegen, node: ast.Node) CodegenError!void {
-        switch (node) {
+    fn emitExpr(self: *Codegen, node: ast.Index) CodegenError!void {
+        switch (self.tree.node(node)) {
             .int_literal => |lit| {
                 var buf: [32]u8 = undefined;
                 const s = std.fmt.bufPrint(&buf, "{d}", .{lit.value}) catch return CodegenError.OutOfMemory;
@@ -1577,23 +3241,18 @@ pub const Codegen = struct {
                 const s = std.fmt.bufPrint(&buf, "{d}", .{lit.value}) catch return CodegenError.OutOfMemory;
                 try self.emit(s);
             },
-            .string_literal => |lit| {
-                try self.emit("\"");
-                try self.emit(lit.value);
-                try self.emit("\"");
-            },
+            .string_literal => |lit| try self.emitStrLiteral(lit.value),
+            .interpolation => |ip| try self.emitInterpolation(ip, false),
             .bool_literal => |lit| {
                 try self.emit(if (lit.value) "true" else "false");
             },
-            .null_literal => {
-                try self.emit("NULL");
-            },
             .variable => |v| {
                 try self.emit(v.name);
             },
             .binary_op => |bin| {
+                if (self.isStr(bin.left) or self.isStr(bin.right)) return self.emitStrBinary(bin);
                 try self.emit("(");
-                try self.emitExpr(bin.left.*);
+                try self.emitExpr(bin.left);
                 switch (bin.op) {
                     .add => try self.emit(" + "),
                     .sub => try self.emit(" - "),
@@ -1609,7 +3268,7 @@ pub const Codegen = struct {
                     .bool_and => try self.emit(" && "),
                     .bool_or => try self.emit(" || "),
                 }
-                try self.emitExpr(bin.right.*);
+                try self.emitExpr(bin.right);
                 try self.emit(")");
             },
             .unary_op => |un| {
@@ -1617,12 +3276,16 @@ pub const Codegen = struct {
                     .negate => try self.emit("(-"),
                     .bool_not => try self.emit("(!"),
                 }
-                try self.emitExpr(un.operand.*);
+                try self.emitExpr(un.operand);
                 try self.emit(")");
             },
             .call => |c| {
                 if (std.mem.eql(u8, c.callee, "len")) {
                     try self.emitLenExpr(c);
+                } else if (ast.SyncBuiltin.of(c.callee)) |builtin| {
+                    try self.emitSyncCall(builtin, c);
+                } else if (ast.AllocBuiltin.of(c.callee)) |builtin| {
+                    try self.emitAllocExpr(builtin, c);
                 } else {
                     const ret_type = self.fn_returns.get(c.callee);
                     const wraps_array = if (ret_type) |rt| blk: {
@@ -1630,11 +3293,11 @@ pub const Codegen = struct {
                         break :blk false;
                     } else false;
                     if (wraps_array) try self.emit("(");
-                    try self.emit(c.callee);
+                    try self.emitSymbol(c.callee);
                     try self.emit("(");
                     for (c.args, 0..) |arg, i| {
                         if (i > 0) try self.emit(", ");
-                        try self.emitExpr(arg);
+                        try self.emitCopiedValue(arg);
                     }
                     try self.emit(")");
                     if (wraps_array) try self.emit(").value");
@@ -1642,94 +3305,33 @@ pub const Codegen = struct {
             },
             .array_literal => |lit| try self.emitArrayLiteral(lit),
             .index_expr => |ix| try self.emitIndexExpr(ix),
+            .await_expr => |ae| {
+                const future_type = self.typeOf(ae.expr);
+                if (future_type != .known or future_type.known != .future) return CodegenError.UnsupportedNode;
+                try self.emitFmt("{s}_await(&", .{try self.cTypeName(future_type.known)});
+                try self.emitExpr(ae.expr);
+                try self.emit(")");
+            },
             .try_expr => return CodegenError.UnsupportedNode,
             .range => return CodegenError.UnsupportedNode,
             else => return CodegenError.UnsupportedNode,
         }
     }
 
-    // ── Type inference (minimal) ────────────────────────────────
+    // ── Expression types ────────────────────────────────────────
 
-    fn inferType(self: *Codegen, node: ast.Node) ValueType {
-        return switch (node) {
-            .int_literal => .{ .known = .i32 },
-            .float_literal => .{ .known = .f64 },
-            .string_literal => .{ .known = .str },
-            .bool_literal => .{ .known = .bool },
-            .null_literal => .unknown,
-            .variable => |v| self.var_types.get(v.name) orelse .unknown,
-            .binary_op => |bin| {
-                const lt = self.inferType(bin.left.*);
-                const rt = self.inferType(bin.right.*);
-                if (lt == .known and rt == .known) {
-                    if (self.isFloatType(lt.known) or self.isFloatType(rt.known)) {
-                        if (self.isFloatType(lt.known)) return lt;
-                        return rt;
-                    }
-                    if (self.isInt64(lt.known) or self.isInt64(rt.known)) return lt;
-                    return lt;
-                }
-                return .unknown;
-            },
-            .unary_op => |un| self.inferType(un.operand.*),
-            .call => |c| blk: {
-                if (std.mem.eql(u8, c.callee, "len")) break :blk .{ .known = .i32 };
-                if (self.fn_returns.get(c.callee)) |ret_opt| {
-                    if (ret_opt) |ret_type| {
-                        break :blk .{ .known = ret_type };
-                    }
-                    break :blk .{ .known = .void };
-                }
-                break :blk .unknown;
-            },
-            .array_literal => |lit| self.inferArrayLiteralType(lit),
-            .index_expr => |ix| {
-                const target_t = self.inferType(ix.target.*);
-                if (target_t == .known) {
-                    switch (target_t.known) {
-                        .array => |arr| return .{ .known = arr.elem.* },
-                        .slice => |s| return .{ .known = s.elem.* },
-                        else => return .unknown,
-                    }
-                }
-                return .unknown;
-            },
-            .try_expr => |te| {
-                const inner = self.inferType(te.expr.*);
-                if (inner == .known and inner.known == .error_union) {
-                    return .{ .known = inner.known.error_union.ok.* };
-                }
-                return .unknown;
-            },
-            else => .unknown,
+    /// The analyzer's type for `node`, with untyped literals at their
+    /// defaults.
+    fn typeOf(self: *const Codegen, node: ast.Index) ValueType {
+        const t = self.types.get(node) orelse return .unknown;
+        return switch (t) {
+            .known => |kt| .{ .known = kt },
+            .int_lit => .{ .known = .i32 },
+            .float_lit => .{ .known = .f64 },
+            .null => .unknown,
         };
     }
 
-    fn inferArrayLiteralType(self: *Codegen, lit: ast.ArrayLiteral) ValueType {
-        if (lit.elements.len == 0) return .unknown;
-        const first = self.inferType(lit.elements[0]);
-        if (first != .known) return .unknown;
-        const elem_type = first.known;
-        for (lit.elements[1..]) |elem| {
-            const t = self.inferType(elem);
-            if (t != .known or !self.typeEquals(t.known, elem_type)) {
-                return .unknown;
-            }
-        }
-        const elem_ptr = self.allocType(elem_type) catch return .unknown;
-        return .{ .known = .{ .array = .{ .len = lit.elements.len, .elem = elem_ptr } } };
-    }
-
-    fn isFloatType(self: *const Codegen, t: ast.Type) bool {
-        _ = self;
-        return t == .f32 or t == .f64;
-    }
-
-    fn isInt64(self: *const Codegen, t: ast.Type) bool {
-        _ = self;
-        return t == .i64 or t == .u64;
-    }
-
     fn isArrayType(self: *const Codegen, t: ast.Type) bool {
         _ = self;
         return t == .array;
@@ -1754,18 +3356,12 @@ pub const Codegen = struct {
             .f32 => "float",
             .f64 => "double",
             .bool => "bool",
-            .str => "const char*",
+            .str => "__1im_str",
             .error_union => "void",
             else => "int64_t",
         };
     }
 
-    fn allocType(self: *Codegen, t: ast.Type) CodegenError!*ast.Type {
-        const t_ptr = self.allocator.create(ast.Type) catch return CodegenError.OutOfMemory;
-        t_ptr.* = t;
-        return t_ptr;
-    }
-
     fn typeEquals(self: *Codegen, a: ast.Type, b: ast.Type) bool {
         return switch (a) {
             .error_union => |eu| switch (b) {
@@ -1780,6 +3376,18 @@ pub const Codegen = struct {
                 .slice => |bs| self.typeEquals(s.elem.*, bs.elem.*),
                 else => false,
             },
+            .future => |f| switch (b) {
+                .future => |bf| self.typeEquals(f.result.*, bf.result.*),
+                else => false,
+            },
+            .atomic => |at| switch (b) {
+                .atomic => |bat| self.typeEquals(at.elem.*, bat.elem.*),
+                else => false,
+            },
+            .channel => |ch| switch (b) {
+                .channel => |bch| self.typeEquals(ch.elem.*, bch.elem.*),
+                else => false,
+            },
             else => std.meta.eql(a, b),
         };
     }
@@ -1796,10 +3404,34 @@ pub const Codegen = struct {
         self.output.appendSlice(self.allocator, s) catch return CodegenError.OutOfMemory;
     }
 
+    fn emitFmt(self: *Codegen, comptime fmt: []const u8, args: anytype) CodegenError!void {
+        self.output.print(self.allocator, fmt, args) catch return CodegenError.OutOfMemory;
+    }
+
+    /// Emits the C name of a function: an imported `module.f` and an
+    /// imported module's own `f` are both spelled `module__f`.
+    fn emitSymbol(self: *Codegen, name: []const u8) CodegenError!void {
+        if (std.mem.indexOfScalar(u8, name, '.')) |dot| {
+            try self.emit(name[0..dot]);
+            try self.emit("__");
+            try self.emit(name[dot + 1 ..]);
+            return;
+        }
+        if (self.module_prefix.len > 0) {
+            try self.emit(self.module_prefix);
+            try self.emit("__");
+        }
+        try self.emit(name);
+    }
+
     fn emitTo(self: *Codegen, out: *std.ArrayList(u8), s: []const u8) CodegenError!void {
         out.appendSlice(self.allocator, s) catch return CodegenError.OutOfMemory;
     }
 
+    fn emitFmtTo(self: *Codegen, out: *std.ArrayList(u8), comptime fmt: []const u8, args: anytype) CodegenError!void {
+        out.print(self.allocator, fmt, args) catch return CodegenError.OutOfMemory;
+    }
+
     fn emitArrayDimsTo(self: *Codegen, out: *std.ArrayList(u8), t: ast.Type) CodegenError!void {
         switch (t) {
             .array => |arr| {
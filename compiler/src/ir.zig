@@ -0,0 +1,1299 @@
+/// Typed SSA intermediate representation for 1im.
+///
+/// Functions are lowered from the analyzed AST one at a time using the
+/// on-the-fly SSA construction of Braun et al. (incomplete phis completed
+/// when a block is sealed), then run through a small pass pipeline:
+/// trivial-phi removal, constant folding with branch folding, unreachable
+/// block removal, loop-invariant code motion and dead code elimination.
+///
+/// Only scalar code is lowered for now — integers, floats, bools, strings,
+/// calls, `if`, `loop while` and range `loop for`. Anything else (arrays,
+/// slices, error unions, parallel constructs) fails with `error.Unsupported`
+/// and the caller keeps using the AST → C path for that function.
+///
+/// All memory comes from the arena passed to the lowering functions.
+const std = @import("std");
+const ast = @import("ast.zig");
+const semantic = @import("semantic.zig");
+
+pub const LowerError = error{
+    Unsupported,
+    OutOfMemory,
+};
+
+pub const Value = u32;
+pub const BlockId = u32;
+
+pub const Op = enum {
+    int_const,
+    float_const,
+    bool_const,
+    str_const,
+    undef,
+    param,
+    add,
+    sub,
+    mul,
+    div,
+    mod,
+    eq,
+    neq,
+    lt,
+    lte,
+    gt,
+    gte,
+    neg,
+    not,
+    cast,
+    call,
+    phi,
+};
+
+pub const Inst = struct {
+    op: Op,
+    type_info: ast.Type,
+    block: BlockId,
+    operands: []const Value = &.{},
+    /// Integer constants, stored as the bit pattern wrapped to `type_info`.
+    int_value: i64 = 0,
+    float_value: f64 = 0,
+    /// Callee for calls, raw literal text for strings, name for params.
+    name: []const u8 = "",
+    /// Set when a trivial phi or folded value is replaced by another value.
+    forward: ?Value = null,
+    dead: bool = false,
+};
+
+pub const Branch = struct {
+    cond: Value,
+    then_block: BlockId,
+    else_block: BlockId,
+};
+
+pub const Terminator = union(enum) {
+    none,
+    jump: BlockId,
+    branch: Branch,
+    ret: ?Value,
+};
+
+pub const Block = struct {
+    phis: std.ArrayList(Value) = .empty,
+    insts: std.ArrayList(Value) = .empty,
+    /// Phi operand i flows in from preds[i].
+    preds: std.ArrayList(BlockId) = .empty,
+    term: Terminator = .none,
+    sealed: bool = false,
+    reachable: bool = true,
+};
+
+/// A natural loop recorded during lowering. Its blocks are the ids in
+/// [header, end); the preheader is the single entry edge from outside.
+pub const Loop = struct {
+    preheader: BlockId,
+    header: BlockId,
+    end: BlockId,
+};
+
+pub const Function = struct {
+    name: []const u8,
+    params: []const ast.Param,
+    ret: ?ast.Type,
+    /// True for the implicit `main` built from top-level statements.
+    entry_point: bool,
+    insts: std.ArrayList(Inst),
+    blocks: std.ArrayList(Block),
+    loops: std.ArrayList(Loop),
+    arena: std.mem.Allocator,
+
+    pub fn inst(self: *const Function, v: Value) Inst {
+        return self.insts.items[v];
+    }
+
+    fn resolve(self: *const Function, v: Value) Value {
+        var cur = v;
+        while (self.insts.items[cur].forward) |next| cur = next;
+        return cur;
+    }
+};
+
+pub const Signature = struct {
+    params: []const ast.Param,
+    ret: ?ast.Type,
+};
+
+/// Parameter and return types of every top-level function, keyed by name.
+pub const Signatures = std.StringHashMap(Signature);
+
+pub fn collectSignatures(
+    allocator: std.mem.Allocator,
+    tree: *const ast.Tree,
+    prog: ast.Program,
+    fn_returns: *const std.StringHashMap(?ast.Type),
+) LowerError!Signatures {
+    var sigs = Signatures.init(allocator);
+    for (prog.stmts) |stmt| {
+        if (tree.tags[stmt] != .function_def) continue;
+        const fd = tree.node(stmt).function_def;
+        const ret = fd.return_type orelse (fn_returns.get(fd.name) orelse null);
+        try sigs.put(fd.name, .{ .params = fd.params, .ret = ret });
+    }
+    return sigs;
+}
+
+pub fn lowerFunction(
+    arena: std.mem.Allocator,
+    tree: *const ast.Tree,
+    fd: ast.FunctionDef,
+    sigs: *const Signatures,
+    types: semantic.ExprTypes,
+) LowerError!Function {
+    const sig = sigs.get(fd.name) orelse return LowerError.Unsupported;
+    if (sig.ret) |ret| {
+        if (!isScalar(ret)) return LowerError.Unsupported;
+    }
+
+    var b = try Builder.init(arena, tree, fd.name, fd.params, sig.ret, false, sigs, types);
+    for (fd.params) |param| {
+        if (!isScalar(param.type_info)) return LowerError.Unsupported;
+        const v = try b.emit(.{ .op = .param, .type_info = param.type_info, .block = b.current, .name = param.name });
+        const id = try b.declare(param.name, param.type_info);
+        try b.write(id, b.current, v);
+    }
+    try b.lowerStmts(fd.body);
+    try b.finish();
+    return b.func;
+}
+
+/// Lowers the top-level statements (function definitions excluded) into
+/// the body of the implicit `main`.
+pub fn lowerTopLevel(
+    arena: std.mem.Allocator,
+    tree: *const ast.Tree,
+    prog: ast.Program,
+    sigs: *const Signatures,
+    types: semantic.ExprTypes,
+) LowerError!Function {
+    var b = try Builder.init(arena, tree, "main", &.{}, null, true, sigs, types);
+    for (prog.stmts) |stmt| {
+        switch (tree.tags[stmt]) {
+            .function_def, .import_decl, .affinity_decl => continue,
+            else => {},
+        }
+        try b.lowerStmt(stmt);
+    }
+    try b.finish();
+    return b.func;
+}
+
+const IncompletePhi = struct {
+    block: BlockId,
+    variable: u32,
+    phi: Value,
+};
+
+const LoopTargets = struct {
+    break_block: BlockId,
+    continue_block: BlockId,
+};
+
+const Builder = struct {
+    arena: std.mem.Allocator,
+    tree: *const ast.Tree,
+    func: Function,
+    sigs: *const Signatures,
+    types: semantic.ExprTypes,
+    current: BlockId,
+    /// Declared type of each source variable; ids are per declaration, so
+    /// same-named variables in sibling scopes never share phis.
+    vars: std.ArrayList(ast.Type),
+    scopes: std.ArrayList(std.StringHashMap(u32)),
+    /// Current SSA definition of (variable, block).
+    defs: std.AutoHashMap(u64, Value),
+    incomplete: std.ArrayList(IncompletePhi),
+    loop_targets: std.ArrayList(LoopTargets),
+
+    fn init(
+        arena: std.mem.Allocator,
+        tree: *const ast.Tree,
+        name: []const u8,
+        params: []const ast.Param,
+        ret: ?ast.Type,
+        entry_point: bool,
+        sigs: *const Signatures,
+        types: semantic.ExprTypes,
+    ) LowerError!Builder {
+        var b: Builder = .{
+            .arena = arena,
+            .tree = tree,
+            .func = .{
+                .name = name,
+                .params = params,
+                .ret = ret,
+                .entry_point = entry_point,
+                .insts = .empty,
+                .blocks = .empty,
+                .loops = .empty,
+                .arena = arena,
+            },
+            .sigs = sigs,
+            .types = types,
+            .current = 0,
+            .vars = .empty,
+            .scopes = .empty,
+            .defs = std.AutoHashMap(u64, Value).init(arena),
+            .incomplete = .empty,
+            .loop_targets = .empty,
+        };
+        b.current = try b.newBlock();
+        try b.sealBlock(b.current);
+        try b.pushScope();
+        return b;
+    }
+
+    /// Closes the final block and rewrites operands to their forwarded values.
+    fn finish(self: *Builder) LowerError!void {
+        if (self.isOpen()) {
+            const ret: ?Value = if (self.func.ret) |t| try self.emitUndef(self.current, t) else null;
+            self.terminate(.{ .ret = ret });
+        }
+        try resolveOperands(&self.func);
+    }
+
+    // ── Statements ──────────────────────────────────────────────
+
+    fn lowerStmts(self: *Builder, stmts: []const ast.Index) LowerError!void {
+        try self.pushScope();
+        defer _ = self.scopes.pop();
+        for (stmts) |stmt| try self.lowerStmt(stmt);
+    }
+
+    fn lowerStmt(self: *Builder, node: ast.Index) LowerError!void {
+        switch (self.tree.node(node)) {
+            .set_assign => |sa| try self.lowerAssign(sa.name, null, sa.value),
+            .typed_assign => |ta| try self.lowerAssign(ta.name, ta.type_info, ta.value),
+            .if_stmt => |is| try self.lowerIf(is),
+            .while_loop => |wl| {
+                if (wl.parallel) return LowerError.Unsupported;
+                try self.lowerWhile(wl);
+            },
+            .for_loop => |fl| {
+                if (fl.parallel or self.tree.node(fl.iterable) != .range) return LowerError.Unsupported;
+                try self.lowerRangeFor(fl);
+            },
+            .break_stmt => |bs| {
+                if (bs.value != null) return LowerError.Unsupported;
+                const targets = self.loop_targets.getLastOrNull() orelse return LowerError.Unsupported;
+                try self.jumpAndContinueDead(targets.break_block);
+            },
+            .continue_stmt => {
+                const targets = self.loop_targets.getLastOrNull() orelse return LowerError.Unsupported;
+                try self.jumpAndContinueDead(targets.continue_block);
+            },
+            .return_stmt => |rs| try self.lowerReturn(rs),
+            .expr_stmt => |es| {
+                if (self.tree.tags[es.expr] != .call) return LowerError.Unsupported;
+                _ = try self.lowerCall(self.tree.node(es.expr).call);
+            },
+            else => return LowerError.Unsupported,
+        }
+    }
+
+    fn lowerAssign(self: *Builder, name: []const u8, explicit_type: ?ast.Type, value: ast.Index) LowerError!void {
+        if (explicit_type == null) {
+            if (self.lookup(name)) |id| {
+                const v = try self.lowerExprAs(value, self.vars.items[id]);
+                return self.write(id, self.current, v);
+            }
+        }
+        const t = explicit_type orelse (try self.typeOf(value)) orelse self.untypedDefault(value);
+        if (!isScalar(t)) return LowerError.Unsupported;
+        const v = try self.lowerExprAs(value, t);
+        const id = try self.declare(name, t);
+        try self.write(id, self.current, v);
+    }
+
+    fn lowerReturn(self: *Builder, rs: ast.ReturnStmt) LowerError!void {
+        if (self.func.entry_point) return LowerError.Unsupported;
+        var ret: ?Value = null;
+        if (rs.value) |value| {
+            const t = self.func.ret orelse return LowerError.Unsupported;
+            ret = try self.lowerExprAs(value, t);
+        }
+        self.terminate(.{ .ret = ret });
+        try self.startDeadBlock();
+    }
+
+    fn lowerIf(self: *Builder, is: ast.IfStmt) LowerError!void {
+        const merge = try self.newBlock();
+
+        try self.lowerCondBody(is.condition, is.then_body, merge);
+        for (is.else_ifs) |elif_node| {
+            const elif = self.tree.node(elif_node).else_if;
+            try self.lowerCondBody(elif.condition, elif.body, merge);
+        }
+        if (is.else_body) |else_body| try self.lowerStmts(else_body);
+        try self.jumpIfOpen(merge);
+
+        try self.sealBlock(merge);
+        self.current = merge;
+    }
+
+    /// `if cond then body` — leaves `current` at the false edge.
+    fn lowerCondBody(self: *Builder, cond: ast.Index, body: []const ast.Index, merge: BlockId) LowerError!void {
+        const c = try self.lowerExprAs(cond, .bool);
+        const then_block = try self.newBlock();
+        const else_block = try self.newBlock();
+        try self.branch(c, then_block, else_block);
+        try self.sealBlock(then_block);
+        try self.sealBlock(else_block);
+
+        self.current = then_block;
+        try self.lowerStmts(body);
+        try self.jumpIfOpen(merge);
+        self.current = else_block;
+    }
+
+    fn lowerWhile(self: *Builder, wl: ast.WhileLoop) LowerError!void {
+        const preheader = try self.enterPreheader();
+        const exit = try self.newBlock();
+        const header = try self.newBlock();
+        try self.jump(header);
+
+        self.current = header;
+        const c = try self.lowerExprAs(wl.condition, .bool);
+        const body = try self.newBlock();
+        try self.branch(c, body, exit);
+        try self.sealBlock(body);
+
+        self.current = body;
+        try self.lowerLoopBody(wl.body, .{ .break_block = exit, .continue_block = header });
+        try self.jumpIfOpen(header);
+
+        try self.finishLoop(preheader, header, exit);
+    }
+
+    /// `loop for i in a..b` — `b` is re-evaluated every iteration, as in C.
+    fn lowerRangeFor(self: *Builder, fl: ast.ForLoop) LowerError!void {
+        const range = self.tree.node(fl.iterable).range;
+        const start_type = try self.typeOf(range.start);
+        const end_type = try self.typeOf(range.end);
+        const wide = (start_type != null and isInt64(start_type.?)) or (end_type != null and isInt64(end_type.?));
+        const loop_type: ast.Type = if (wide) .i64 else .i32;
+
+        try self.pushScope();
+        defer _ = self.scopes.pop();
+        const start = try self.lowerExprAs(range.start, loop_type);
+        const id = try self.declare(fl.variable, loop_type);
+        try self.write(id, self.current, start);
+
+        const preheader = try self.enterPreheader();
+        const exit = try self.newBlock();
+        const header = try self.newBlock();
+        const next = try self.newBlock();
+        try self.jump(header);
+
+        self.current = header;
+        const i = try self.read(id, header);
+        const end = try self.lowerExprAs(range.end, loop_type);
+        const c = try self.emitBinary(if (range.inclusive) .lte else .lt, .bool, i, end);
+        const body = try self.newBlock();
+        try self.branch(c, body, exit);
+        try self.sealBlock(body);
+
+        self.current = body;
+        try self.lowerLoopBody(fl.body, .{ .break_block = exit, .continue_block = next });
+        try self.jumpIfOpen(next);
+
+        try self.sealBlock(next);
+        self.current = next;
+        const one = try self.emitInt(loop_type, 1);
+        const inc = try self.emitBinary(.add, loop_type, try self.read(id, next), one);
+        try self.write(id, next, inc);
+        try self.jump(header);
+
+        try self.finishLoop(preheader, header, exit);
+    }
+
+    fn lowerLoopBody(self: *Builder, body: []const ast.Index, targets: LoopTargets) LowerError!void {
+        try self.loop_targets.append(self.arena, targets);
+        defer _ = self.loop_targets.pop();
+        try self.lowerStmts(body);
+    }
+
+    /// Ends the current block with a jump into a fresh preheader block.
+    fn enterPreheader(self: *Builder) LowerError!BlockId {
+        const preheader = try self.newBlock();
+        try self.jumpIfOpen(preheader);
+        try self.sealBlock(preheader);
+        self.current = preheader;
+        return preheader;
+    }
+
+    fn finishLoop(self: *Builder, preheader: BlockId, header: BlockId, exit: BlockId) LowerError!void {
+        try self.sealBlock(header);
+        try self.sealBlock(exit);
+        try self.func.loops.append(self.arena, .{
+            .preheader = preheader,
+            .header = header,
+            .end = @intCast(self.func.blocks.items.len),
+        });
+        self.current = exit;
+    }
+
+    // ── Expressions ─────────────────────────────────────────────
+
+    /// Lowers `node` and converts the result to `t` when they differ.
+    fn lowerExprAs(self: *Builder, node: ast.Index, t: ast.Type) LowerError!Value {
+        const v = try self.lowerExpr(node, t);
+        const vt = self.func.insts.items[v].type_info;
+        if (typeEquals(vt, t)) return v;
+        if (!isNumeric(vt) or !isNumeric(t)) return LowerError.Unsupported;
+        return self.emit(.{ .op = .cast, .type_info = t, .block = self.current, .operands = try self.dupe(&.{v}) });
+    }
+
+    /// `hint` types untyped literals; it never converts typed values.
+    fn lowerExpr(self: *Builder, node: ast.Index, hint: ?ast.Type) LowerError!Value {
+        switch (self.tree.node(node)) {
+            .int_literal => |lit| {
+                const t: ast.Type = if (hint != null and isInteger(hint.?)) hint.? else .i32;
+                return self.emitInt(t, lit.value);
+            },
+            .float_literal => |lit| {
+                const t: ast.Type = if (hint != null and isFloat(hint.?)) hint.? else .f64;
+                return self.emit(.{ .op = .float_const, .type_info = t, .block = self.current, .float_value = roundFloat(t, lit.value) });
+            },
+            .string_literal => |lit| return self.emit(.{ .op = .str_const, .type_info = .str, .block = self.current, .name = lit.value }),
+            .bool_literal => |lit| return self.emitBool(lit.value),
+            .variable => |v| {
+                const id = self.lookup(v.name) orelse return LowerError.Unsupported;
+                return self.read(id, self.current);
+            },
+            .binary_op => |bin| switch (bin.op) {
+                .bool_and, .bool_or => return self.lowerShortCircuit(bin),
+                .add, .sub, .mul, .div, .mod => {
+                    const t = (try self.typeOf(node)) orelse numericHint(hint) orelse self.untypedDefault(node);
+                    if (!isNumeric(t) or (bin.op == .mod and isFloat(t))) return LowerError.Unsupported;
+                    const l = try self.lowerExprAs(bin.left, t);
+                    const r = try self.lowerExprAs(bin.right, t);
+                    return self.emitBinary(binaryOp(bin.op), t, l, r);
+                },
+                else => {
+                    const t = (try self.operandType(bin)) orelse self.untypedDefault(bin.left);
+                    if (t == .str) return LowerError.Unsupported;
+                    const l = try self.lowerExprAs(bin.left, t);
+                    const r = try self.lowerExprAs(bin.right, t);
+                    return self.emitBinary(binaryOp(bin.op), .bool, l, r);
+                },
+            },
+            .unary_op => |un| switch (un.op) {
+                .negate => {
+                    const t = (try self.typeOf(node)) orelse numericHint(hint) orelse self.untypedDefault(node);
+                    if (!isNumeric(t)) return LowerError.Unsupported;
+                    const x = try self.lowerExprAs(un.operand, t);
+                    return self.emit(.{ .op = .neg, .type_info = t, .block = self.current, .operands = try self.dupe(&.{x}) });
+                },
+                .bool_not => {
+                    const x = try self.lowerExprAs(un.operand, .bool);
+                    return self.emit(.{ .op = .not, .type_info = .bool, .block = self.current, .operands = try self.dupe(&.{x}) });
+                },
+            },
+            .call => |c| return self.lowerCall(c),
+            else => return LowerError.Unsupported,
+        }
+    }
+
+    /// `a and b` / `a or b` as control flow joined by a bool phi.
+    fn lowerShortCircuit(self: *Builder, bin: ast.BinaryOp) LowerError!Value {
+        const is_and = bin.op == .bool_and;
+        const l = try self.lowerExprAs(bin.left, .bool);
+        const short = try self.emitBool(!is_and);
+        const from_left = self.current;
+
+        const rhs = try self.newBlock();
+        const merge = try self.newBlock();
+        if (is_and) try self.branch(l, rhs, merge) else try self.branch(l, merge, rhs);
+        try self.sealBlock(rhs);
+
+        self.current = rhs;
+        const r = try self.lowerExprAs(bin.right, .bool);
+        try self.jump(merge);
+
+        // Operand order follows the order the edges were added.
+        const blk = &self.func.blocks.items[merge];
+        const first_is_left = blk.preds.items[0] == from_left;
+        try self.sealBlock(merge);
+        self.current = merge;
+        const operands = if (first_is_left) try self.dupe(&.{ short, r }) else try self.dupe(&.{ r, short });
+        return self.newPhi(merge, .bool, operands);
+    }
+
+    fn lowerCall(self: *Builder, c: ast.Call) LowerError!Value {
+        if (std.mem.eql(u8, c.callee, "print")) {
+            if (c.args.len != 1) return LowerError.Unsupported;
+            const t = (try self.typeOf(c.args[0])) orelse self.untypedDefault(c.args[0]);
+            if (!isScalar(t)) return LowerError.Unsupported;
+            const v = try self.lowerExprAs(c.args[0], t);
+            return self.emit(.{ .op = .call, .type_info = .void, .block = self.current, .operands = try self.dupe(&.{v}), .name = c.callee });
+        }
+
+        const sig = self.sigs.get(c.callee) orelse return LowerError.Unsupported;
+        if (sig.params.len != c.args.len) return LowerError.Unsupported;
+        if (sig.ret) |ret| {
+            if (!isScalar(ret)) return LowerError.Unsupported;
+        }
+
+        const args = try self.arena.alloc(Value, c.args.len);
+        for (c.args, sig.params, 0..) |arg, param, i| {
+            if (!isScalar(param.type_info)) return LowerError.Unsupported;
+            args[i] = try self.lowerExprAs(arg, param.type_info);
+        }
+        return self.emit(.{ .op = .call, .type_info = sig.ret orelse .void, .block = self.current, .operands = args, .name = c.callee });
+    }
+
+    /// The analyzer's type for an expression, or null while it is made only
+    /// of untyped literals and takes its type from context.
+    fn typeOf(self: *Builder, node: ast.Index) LowerError!?ast.Type {
+        const t = self.types.get(node) orelse return LowerError.Unsupported;
+        return switch (t) {
+            .known => |kt| kt,
+            .int_lit, .float_lit => null,
+            .null => LowerError.Unsupported,
+        };
+    }
+
+    /// Type an expression made only of literals defaults to.
+    fn untypedDefault(self: *Builder, node: ast.Index) ast.Type {
+        const t = self.types.get(node) orelse return .i32;
+        return if (t == .float_lit) .f64 else .i32;
+    }
+
+    fn operandType(self: *Builder, bin: ast.BinaryOp) LowerError!?ast.Type {
+        return (try self.typeOf(bin.left)) orelse try self.typeOf(bin.right);
+    }
+
+    // ── SSA construction ────────────────────────────────────────
+
+    fn declare(self: *Builder, name: []const u8, t: ast.Type) LowerError!u32 {
+        const id: u32 = @intCast(self.vars.items.len);
+        try self.vars.append(self.arena, t);
+        try self.scopes.items[self.scopes.items.len - 1].put(name, id);
+        return id;
+    }
+
+    fn lookup(self: *Builder, name: []const u8) ?u32 {
+        var i = self.scopes.items.len;
+        while (i > 0) {
+            i -= 1;
+            if (self.scopes.items[i].get(name)) |id| return id;
+        }
+        return null;
+    }
+
+    fn pushScope(self: *Builder) LowerError!void {
+        try self.scopes.append(self.arena, std.StringHashMap(u32).init(self.arena));
+    }
+
+    fn defKey(variable: u32, block: BlockId) u64 {
+        return (@as(u64, variable) << 32) | block;
+    }
+
+    fn write(self: *Builder, variable: u32, block: BlockId, v: Value) LowerError!void {
+        try self.defs.put(defKey(variable, block), v);
+    }
+
+    fn read(self: *Builder, variable: u32, block: BlockId) LowerError!Value {
+        if (self.defs.get(defKey(variable, block))) |v| return self.func.resolve(v);
+
+        const t = self.vars.items[variable];
+        const blk = self.func.blocks.items[block];
+        var v: Value = undefined;
+        if (!blk.sealed) {
+            v = try self.newPhi(block, t, &.{});
+            try self.incomplete.append(self.arena, .{ .block = block, .variable = variable, .phi = v });
+        } else if (blk.preds.items.len == 0) {
+            v = try self.emitUndef(block, t);
+        } else if (blk.preds.items.len == 1) {
+            v = try self.read(variable, blk.preds.items[0]);
+        } else {
+            const phi = try self.newPhi(block, t, &.{});
+            try self.write(variable, block, phi);
+            v = try self.addPhiOperands(variable, phi);
+        }
+        try self.write(variable, block, v);
+        return v;
+    }
+
+    fn addPhiOperands(self: *Builder, variable: u32, phi: Value) LowerError!Value {
+        const block = self.func.insts.items[phi].block;
+        const preds = self.func.blocks.items[block].preds.items;
+        const operands = try self.arena.alloc(Value, preds.len);
+        for (preds, 0..) |pred, i| {
+            operands[i] = try self.read(variable, pred);
+        }
+        self.func.insts.items[phi].operands = operands;
+        return (try removeTrivialPhi(&self.func, phi)) orelse phi;
+    }
+
+    fn sealBlock(self: *Builder, block: BlockId) LowerError!void {
+        var i: usize = 0;
+        while (i < self.incomplete.items.len) {
+            const entry = self.incomplete.items[i];
+            if (entry.block != block) {
+                i += 1;
+                continue;
+            }
+            _ = self.incomplete.swapRemove(i);
+            _ = try self.addPhiOperands(entry.variable, entry.phi);
+        }
+        self.func.blocks.items[block].sealed = true;
+    }
+
+    // ── Blocks and instructions ─────────────────────────────────
+
+    fn newBlock(self: *Builder) LowerError!BlockId {
+        try self.func.blocks.append(self.arena, .{});
+        return @intCast(self.func.blocks.items.len - 1);
+    }
+
+    fn isOpen(self: *Builder) bool {
+        return self.func.blocks.items[self.current].term == .none;
+    }
+
+    fn terminate(self: *Builder, term: Terminator) void {
+        self.func.blocks.items[self.current].term = term;
+    }
+
+    fn addEdge(self: *Builder, from: BlockId, to: BlockId) LowerError!void {
+        try self.func.blocks.items[to].preds.append(self.arena, from);
+    }
+
+    fn jump(self: *Builder, target: BlockId) LowerError!void {
+        self.terminate(.{ .jump = target });
+        try self.addEdge(self.current, target);
+    }
+
+    fn jumpIfOpen(self: *Builder, target: BlockId) LowerError!void {
+        if (self.isOpen()) try self.jump(target);
+    }
+
+    fn branch(self: *Builder, cond: Value, then_block: BlockId, else_block: BlockId) LowerError!void {
+        self.terminate(.{ .branch = .{ .cond = cond, .then_block = then_block, .else_block = else_block } });
+        try self.addEdge(self.current, then_block);
+        try self.addEdge(self.current, else_block);
+    }
+
+    /// Statements after break/continue/return land in an unreachable block
+    /// that the optimizer drops.
+    fn jumpAndContinueDead(self: *Builder, target: BlockId) LowerError!void {
+        try self.jump(target);
+        try self.startDeadBlock();
+    }
+
+    fn startDeadBlock(self: *Builder) LowerError!void {
+        self.current = try self.newBlock();
+        try self.sealBlock(self.current);
+    }
+
+    fn dupe(self: *Builder, values: []const Value) LowerError![]const Value {
+        return self.arena.dupe(Value, values);
+    }
+
+    fn emit(self: *Builder, i: Inst) LowerError!Value {
+        const v: Value = @intCast(self.func.insts.items.len);
+        try self.func.insts.append(self.arena, i);
+        try self.func.blocks.items[i.block].insts.append(self.arena, v);
+        return v;
+    }
+
+    fn emitInt(self: *Builder, t: ast.Type, value: i64) LowerError!Value {
+        return self.emit(.{ .op = .int_const, .type_info = t, .block = self.current, .int_value = wrapInt(t, value) });
+    }
+
+    fn emitBool(self: *Builder, value: bool) LowerError!Value {
+        return self.emit(.{ .op = .bool_const, .type_info = .bool, .block = self.current, .int_value = @intFromBool(value) });
+    }
+
+    fn emitUndef(self: *Builder, block: BlockId, t: ast.Type) LowerError!Value {
+        return self.emit(.{ .op = .undef, .type_info = t, .block = block });
+    }
+
+    fn emitBinary(self: *Builder, op: Op, t: ast.Type, l: Value, r: Value) LowerError!Value {
+        return self.emit(.{ .op = op, .type_info = t, .block = self.current, .operands = try self.dupe(&.{ l, r }) });
+    }
+
+    fn newPhi(self: *Builder, block: BlockId, t: ast.Type, operands: []const Value) LowerError!Value {
+        const v: Value = @intCast(self.func.insts.items.len);
+        try self.func.insts.append(self.arena, .{ .op = .phi, .type_info = t, .block = block, .operands = operands });
+        try self.func.blocks.items[block].phis.append(self.arena, v);
+        return v;
+    }
+};
+
+// ── Passes ──────────────────────────────────────────────────────
+
+/// Runs the optimization pipeline to a fixed point (bounded).
+pub fn optimize(f: *Function) LowerError!void {
+    var round: usize = 0;
+    while (round < 8) : (round += 1) {
+        var changed = try simplifyPhis(f);
+        if (try foldConstants(f)) changed = true;
+        if (try removeUnreachable(f)) changed = true;
+        try resolveOperands(f);
+        if (!changed) break;
+    }
+    try hoistLoopInvariants(f);
+    try eliminateDeadCode(f);
+}
+
+/// A phi whose operands are all the same value (or itself) is replaced
+/// by that value. Returns the replacement, or null if the phi is needed.
+fn removeTrivialPhi(f: *Function, phi: Value) LowerError!?Value {
+    var same: ?Value = null;
+    for (f.insts.items[phi].operands) |raw| {
+        const op = f.resolve(raw);
+        if (op == phi or (same != null and op == same.?)) continue;
+        if (same != null) return null;
+        same = op;
+    }
+    const block = f.insts.items[phi].block;
+    const replacement = same orelse blk: {
+        const v: Value = @intCast(f.insts.items.len);
+        const t = f.insts.items[phi].type_info;
+        try f.insts.append(f.arena, .{ .op = .undef, .type_info = t, .block = block });
+        try f.blocks.items[block].insts.insert(f.arena, 0, v);
+        break :blk v;
+    };
+    f.insts.items[phi].forward = replacement;
+    f.insts.items[phi].dead = true;
+    removeValue(&f.blocks.items[block].phis, phi);
+    return replacement;
+}
+
+fn simplifyPhis(f: *Function) LowerError!bool {
+    var changed = false;
+    var progress = true;
+    while (progress) {
+        progress = false;
+        for (f.blocks.items) |*blk| {
+            var i: usize = 0;
+            while (i < blk.phis.items.len) {
+                const before = blk.phis.items.len;
+                _ = try removeTrivialPhi(f, blk.phis.items[i]);
+                if (blk.phis.items.len < before) {
+                    progress = true;
+                    changed = true;
+                } else {
+                    i += 1;
+                }
+            }
+        }
+    }
+    return changed;
+}
+
+/// Folds constant operands (wrapping to the value's type, as C does on
+/// store), simple identities, and branches on constant conditions.
+fn foldConstants(f: *Function) LowerError!bool {
+    var changed = false;
+    for (f.blocks.items, 0..) |*blk, block_index| {
+        if (!blk.reachable) continue;
+        for (blk.insts.items) |v| {
+            if (foldInst(f, v)) changed = true;
+        }
+        switch (blk.term) {
+            .branch => |br| {
+                const cond = f.insts.items[f.resolve(br.cond)];
+                if (cond.op != .bool_const) continue;
+                const taken = if (cond.int_value != 0) br.then_block else br.else_block;
+                const dropped = if (cond.int_value != 0) br.else_block else br.then_block;
+                blk.term = .{ .jump = taken };
+                removePred(f, dropped, @intCast(block_index));
+                changed = true;
+            },
+            else => {},
+        }
+    }
+    return changed;
+}
+
+fn foldInst(f: *Function, v: Value) bool {
+    const i = f.insts.items[v];
+    if (i.dead or i.forward != null) return false;
+
+    switch (i.op) {
+        .add, .sub, .mul, .div, .mod, .eq, .neq, .lt, .lte, .gt, .gte => {
+            const l = f.insts.items[f.resolve(i.operands[0])];
+            const r = f.insts.items[f.resolve(i.operands[1])];
+            if (isConst(l) and isConst(r)) return foldBinary(f, v, l, r);
+
+            // x + 0, x - 0, x * 1 → x for integers.
+            if (isInteger(i.type_info) and r.op == .int_const) {
+                const identity = switch (i.op) {
+                    .add, .sub => r.int_value == 0,
+                    .mul, .div => r.int_value == 1,
+                    else => false,
+                };
+                if (identity) {
+                    f.insts.items[v].forward = f.resolve(i.operands[0]);
+                    f.insts.items[v].dead = true;
+                    return true;
+                }
+            }
+            return false;
+        },
+        .neg, .not, .cast => {
+            const x = f.insts.items[f.resolve(i.operands[0])];
+            if (!isConst(x)) return false;
+            const inst = &f.insts.items[v];
+            switch (i.op) {
+                .neg => if (x.op == .int_const) {
+                    setInt(inst, 0 -% x.int_value);
+                } else {
+                    setFloat(inst, -x.float_value);
+                },
+                .not => setBool(inst, x.int_value == 0),
+                .cast => {
+                    if (isFloat(i.type_info)) {
+                        const value: f64 = if (x.op == .float_const) x.float_value else intToFloat(x.type_info, x.int_value);
+                        setFloat(inst, value);
+                    } else if (x.op == .int_const) {
+                        setInt(inst, x.int_value);
+                    } else {
+                        return false;
+                    }
+                },
+                else => unreachable,
+            }
+            return true;
+        },
+        else => return false,
+    }
+}
+
+fn foldBinary(f: *Function, v: Value, l: Inst, r: Inst) bool {
+    const inst = &f.insts.items[v];
+    const op = inst.op;
+
+    if (l.op == .float_const and r.op == .float_const) {
+        const a = l.float_value;
+        const b = r.float_value;
+        switch (op) {
+            .add, .sub, .mul, .div => {
+                const result = switch (op) {
+                    .add => a + b,
+                    .sub => a - b,
+                    .mul => a * b,
+                    .div => a / b,
+                    else => unreachable,
+                };
+                if (!std.math.isFinite(result)) return false;
+                setFloat(inst, result);
+            },
+            .mod => return false,
+            else => setBool(inst, compare(op, std.math.order(a, b))),
+        }
+        return true;
+    }
+
+    if (l.op == .int_const and r.op == .int_const) {
+        const unsigned = isUnsigned(l.type_info);
+        const a = l.int_value;
+        const b = r.int_value;
+        switch (op) {
+            .add => setInt(inst, a +% b),
+            .sub => setInt(inst, a -% b),
+            .mul => setInt(inst, a *% b),
+            .div, .mod => {
+                if (b == 0) return false;
+                if (unsigned) {
+                    const ua: u64 = @bitCast(a);
+                    const ub: u64 = @bitCast(b);
+                    setInt(inst, @bitCast(if (op == .div) ua / ub else ua % ub));
+                } else {
+                    if (a == std.math.minInt(i64) and b == -1) return false;
+                    setInt(inst, if (op == .div) @divTrunc(a, b) else @rem(a, b));
+                }
+            },
+            else => {
+                const order = if (unsigned)
+                    std.math.order(@as(u64, @bitCast(a)), @as(u64, @bitCast(b)))
+                else
+                    std.math.order(a, b);
+                setBool(inst, compare(op, order));
+            },
+        }
+        return true;
+    }
+
+    if (l.op == .bool_const and r.op == .bool_const and (op == .eq or op == .neq)) {
+        setBool(inst, (l.int_value == r.int_value) == (op == .eq));
+        return true;
+    }
+    return false;
+}
+
+fn compare(op: Op, order: std.math.Order) bool {
+    return switch (op) {
+        .eq => order == .eq,
+        .neq => order != .eq,
+        .lt => order == .lt,
+        .lte => order != .gt,
+        .gt => order == .gt,
+        .gte => order != .lt,
+        else => unreachable,
+    };
+}
+
+fn setInt(inst: *Inst, value: i64) void {
+    inst.op = .int_const;
+    inst.int_value = wrapInt(inst.type_info, value);
+    inst.operands = &.{};
+}
+
+fn setFloat(inst: *Inst, value: f64) void {
+    inst.op = .float_const;
+    inst.float_value = roundFloat(inst.type_info, value);
+    inst.operands = &.{};
+}
+
+fn setBool(inst: *Inst, value: bool) void {
+    inst.op = .bool_const;
+    inst.int_value = @intFromBool(value);
+    inst.operands = &.{};
+}
+
+/// Drops blocks no longer reachable from the entry, along with their
+/// incoming phi operands in surviving blocks.
+fn removeUnreachable(f: *Function) LowerError!bool {
+    const reached = f.blocks.items.len;
+    var seen = try std.DynamicBitSet.initEmpty(f.arena, reached);
+    defer seen.deinit();
+
+    var stack: std.ArrayList(BlockId) = .empty;
+    defer stack.deinit(f.arena);
+    try stack.append(f.arena, 0);
+    seen.set(0);
+    while (stack.pop()) |block| {
+        for (successors(f.blocks.items[block].term)) |succ_opt| {
+            const succ = succ_opt orelse continue;
+            if (seen.isSet(succ)) continue;
+            seen.set(succ);
+            try stack.append(f.arena, succ);
+        }
+    }
+
+    var changed = false;
+    for (f.blocks.items, 0..) |*blk, block_index| {
+        if (seen.isSet(block_index) or !blk.reachable) continue;
+        blk.reachable = false;
+        changed = true;
+        for (successors(blk.term)) |succ_opt| {
+            if (succ_opt) |succ| removePred(f, succ, @intCast(block_index));
+        }
+        for (blk.insts.items) |v| f.insts.items[v].dead = true;
+        for (blk.phis.items) |v| f.insts.items[v].dead = true;
+        blk.insts.clearRetainingCapacity();
+        blk.phis.clearRetainingCapacity();
+        blk.term = .none;
+    }
+    return changed;
+}
+
+fn removePred(f: *Function, block: BlockId, pred: BlockId) void {
+    const blk = &f.blocks.items[block];
+    const index = std.mem.indexOfScalar(BlockId, blk.preds.items, pred) orelse return;
+    _ = blk.preds.orderedRemove(index);
+    for (blk.phis.items) |phi| {
+        const inst = &f.insts.items[phi];
+        const ops: []Value = @constCast(inst.operands);
+        std.mem.copyForwards(Value, ops[index..], ops[index + 1 ..]);
+        inst.operands = ops[0 .. ops.len - 1];
+    }
+}
+
+/// Moves pure instructions whose operands are all defined outside a loop
+/// into its preheader. Inner loops were recorded first, so invariants
+/// bubble outwards through nested loops. Division is only hoisted when the
+/// divisor is a constant that cannot trap.
+fn hoistLoopInvariants(f: *Function) LowerError!void {
+    for (f.loops.items) |loop| {
+        if (!f.blocks.items[loop.header].reachable) continue;
+        const pre = &f.blocks.items[loop.preheader];
+        if (!pre.reachable) continue;
+
+        var moved = true;
+        while (moved) {
+            moved = false;
+            var block = loop.header;
+            while (block < loop.end) : (block += 1) {
+                const blk = &f.blocks.items[block];
+                if (!blk.reachable) continue;
+                var i: usize = 0;
+                while (i < blk.insts.items.len) {
+                    const v = blk.insts.items[i];
+                    if (!isHoistable(f, v, loop)) {
+                        i += 1;
+                        continue;
+                    }
+                    _ = blk.insts.orderedRemove(i);
+                    f.insts.items[v].block = loop.preheader;
+                    try f.blocks.items[loop.preheader].insts.append(f.arena, v);
+                    moved = true;
+                }
+            }
+        }
+    }
+}
+
+fn isHoistable(f: *Function, v: Value, loop: Loop) bool {
+    const i = f.insts.items[v];
+    switch (i.op) {
+        .add, .sub, .mul, .eq, .neq, .lt, .lte, .gt, .gte, .neg, .not, .cast => {},
+        .div, .mod => {
+            const divisor = f.insts.items[f.resolve(i.operands[1])];
+            if (divisor.op != .int_const and divisor.op != .float_const) return false;
+            if (divisor.op == .int_const and (divisor.int_value == 0 or divisor.int_value == -1)) return false;
+        },
+        else => return false,
+    }
+    for (i.operands) |op| {
+        const def = f.insts.items[f.resolve(op)].block;
+        if (def >= loop.header and def < loop.end) return false;
+    }
+    return true;
+}
+
+/// Keeps calls, terminator operands and everything they transitively use.
+fn eliminateDeadCode(f: *Function) LowerError!void {
+    const live = try f.arena.alloc(bool, f.insts.items.len);
+    @memset(live, false);
+
+    var work: std.ArrayList(Value) = .empty;
+    for (f.blocks.items) |blk| {
+        if (!blk.reachable) continue;
+        for (blk.insts.items) |v| {
+            if (f.insts.items[v].op == .call) try work.append(f.arena, v);
+        }
+        switch (blk.term) {
+            .branch => |br| try work.append(f.arena, br.cond),
+            .ret => |ret| if (ret) |r| try work.append(f.arena, r),
+            else => {},
+        }
+    }
+    while (work.pop()) |v| {
+        if (live[v]) continue;
+        live[v] = true;
+        for (f.insts.items[v].operands) |op| try work.append(f.arena, op);
+    }
+
+    for (f.blocks.items) |*blk| {
+        filterLive(f, &blk.insts, live);
+        filterLive(f, &blk.phis, live);
+    }
+}
+
+fn filterLive(f: *Function, list: *std.ArrayList(Value), live: []const bool) void {
+    var kept: usize = 0;
+    for (list.items) |v| {
+        if (live[v]) {
+            list.items[kept] = v;
+            kept += 1;
+        } else {
+            f.insts.items[v].dead = true;
+        }
+    }
+    list.shrinkRetainingCapacity(kept);
+}
+
+/// Rewrites every operand and terminator to the value it forwards to.
+fn resolveOperands(f: *Function) LowerError!void {
+    for (f.insts.items) |*i| {
+        if (i.operands.len == 0) continue;
+        // Operand slices are arena-owned; rewriting in place is enough.
+        const ops: []Value = @constCast(i.operands);
+        for (ops) |*op| op.* = f.resolve(op.*);
+    }
+    for (f.blocks.items) |*blk| {
+        switch (blk.term) {
+            .branch => |*br| br.cond = f.resolve(br.cond),
+            .ret => |*ret| if (ret.*) |r| {
+                ret.* = f.resolve(r);
+            },
+            else => {},
+        }
+    }
+}
+
+pub fn successors(term: Terminator) [2]?BlockId {
+    return switch (term) {
+        .jump => |target| .{ target, null },
+        .branch => |br| .{ br.then_block, br.else_block },
+        else => .{ null, null },
+    };
+}
+
+fn removeValue(list: *std.ArrayList(Value), v: Value) void {
+    const index = std.mem.indexOfScalar(Value, list.items, v) orelse return;
+    _ = list.orderedRemove(index);
+}
+
+// ── Dump (--emit-ir) ────────────────────────────────────────────
+
+pub fn dump(f: *const Function, allocator: std.mem.Allocator, out: *std.ArrayList(u8)) LowerError!void {
+    try out.print(allocator, "fn {s}(", .{f.name});
+    for (f.params, 0..) |param, i| {
+        if (i > 0) try out.appendSlice(allocator, ", ");
+        try out.print(allocator, "{s}: {s}", .{ param.name, @tagName(param.type_info) });
+    }
+    try out.print(allocator, ") -> {s}\n", .{if (f.ret) |t| @tagName(t) else "void"});
+
+    for (f.blocks.items, 0..) |blk, block_index| {
+        if (!blk.reachable) continue;
+        try out.print(allocator, "bb{d}:", .{block_index});
+        if (blk.preds.items.len > 0) {
+            try out.appendSlice(allocator, " ; preds");
+            for (blk.preds.items) |pred| try out.print(allocator, " bb{d}", .{pred});
+        }
+        for (f.loops.items) |loop| {
+            if (loop.header == block_index) try out.appendSlice(allocator, " ; loop header");
+        }
+        try out.appendSlice(allocator, "\n");
+
+        for (blk.phis.items) |v| {
+            const i = f.insts.items[v];
+            try out.print(allocator, "    %{d} = phi {s}", .{ v, @tagName(i.type_info) });
+            for (i.operands, 0..) |op, j| {
+                try out.print(allocator, "{s} [%{d}, bb{d}]", .{ if (j == 0) "" else ",", op, blk.preds.items[j] });
+            }
+            try out.appendSlice(allocator, "\n");
+        }
+        for (blk.insts.items) |v| try dumpInst(f, v, allocator, out);
+
+        switch (blk.term) {
+            .none => {},
+            .jump => |target| try out.print(allocator, "    jmp bb{d}\n", .{target}),
+            .branch => |br| try out.print(allocator, "    br %{d}, bb{d}, bb{d}\n", .{ br.cond, br.then_block, br.else_block }),
+            .ret => |ret| if (ret) |r| {
+                try out.print(allocator, "    ret %{d}\n", .{r});
+            } else {
+                try out.appendSlice(allocator, "    ret\n");
+            },
+        }
+    }
+    try out.appendSlice(allocator, "\n");
+}
+
+fn dumpInst(f: *const Function, v: Value, allocator: std.mem.Allocator, out: *std.ArrayList(u8)) LowerError!void {
+    const i = f.insts.items[v];
+    if (i.type_info == .void) {
+        try out.appendSlice(allocator, "    ");
+    } else {
+        try out.print(allocator, "    %{d} = ", .{v});
+    }
+    try out.print(allocator, "{s} {s}", .{ @tagName(i.op), @tagName(i.type_info) });
+    switch (i.op) {
+        .int_const => if (isUnsigned(i.type_info)) {
+            try out.print(allocator, " {d}", .{@as(u64, @bitCast(i.int_value))});
+        } else {
+            try out.print(allocator, " {d}", .{i.int_value});
+        },
+        .float_const => try out.print(allocator, " {e}", .{i.float_value}),
+        .bool_const => try out.appendSlice(allocator, if (i.int_value != 0) " true" else " false"),
+        .str_const => try out.print(allocator, " \"{s}\"", .{i.name}),
+        .param, .call => try out.print(allocator, " {s}", .{i.name}),
+        else => {},
+    }
+    for (i.operands, 0..) |op, j| {
+        try out.print(allocator, "{s} %{d}", .{ if (j == 0) "" else ",", op });
+    }
+    try out.appendSlice(allocator, "\n");
+}
+
+// ── Types ───────────────────────────────────────────────────────
+
+pub fn isConst(i: Inst) bool {
+    return switch (i.op) {
+        .int_const, .float_const, .bool_const => true,
+        else => false,
+    };
+}
+
+fn binaryOp(op: ast.BinaryOp.Op) Op {
+    return switch (op) {
+        .add => .add,
+        .sub => .sub,
+        .mul => .mul,
+        .div => .div,
+        .mod => .mod,
+        .eq => .eq,
+        .neq => .neq,
+        .lt => .lt,
+        .lte => .lte,
+        .gt => .gt,
+        .gte => .gte,
+        .bool_and, .bool_or => unreachable,
+    };
+}
+
+fn numericHint(hint: ?ast.Type) ?ast.Type {
+    const t = hint orelse return null;
+    return if (isNumeric(t)) t else null;
+}
+
+/// Truncates to the width of `t` and sign- or zero-extends back to i64.
+fn wrapInt(t: ast.Type, value: i64) i64 {
+    return switch (t) {
+        .i8 => @as(i8, @truncate(value)),
+        .i16 => @as(i16, @truncate(value)),
+        .i32 => @as(i32, @truncate(value)),
+        .u8 => @as(u8, @truncate(@as(u64, @bitCast(value)))),
+        .u16 => @as(u16, @truncate(@as(u64, @bitCast(value)))),
+        .u32 => @as(u32, @truncate(@as(u64, @bitCast(value)))),
+        else => value,
+    };
+}
+
+fn roundFloat(t: ast.Type, value: f64) f64 {
+    return if (t == .f32) @as(f32, @floatCast(value)) else value;
+}
+
+fn intToFloat(t: ast.Type, value: i64) f64 {
+    if (isUnsigned(t)) return @floatFromInt(@as(u64, @bitCast(value)));
+    return @floatFromInt(value);
+}
+
+pub fn isScalar(t: ast.Type) bool {
+    return isNumeric(t) or t == .bool or t == .str;
+}
+
+fn isNumeric(t: ast.Type) bool {
+    return isInteger(t) or isFloat(t);
+}
+
+fn isInteger(t: ast.Type) bool {
+    return switch (t) {
+        .i8, .i16, .i32, .i64, .u8, .u16, .u32, .u64 => true,
+        else => false,
+    };
+}
+
+pub fn isUnsigned(t: ast.Type) bool {
+    return switch (t) {
+        .u8, .u16, .u32, .u64 => true,
+        else => false,
+    };
+}
+
+fn isFloat(t: ast.Type) bool {
+    return t == .f32 or t == .f64;
+}
+
+fn isInt64(t: ast.Type) bool {
+    return t == .i64 or t == .u64;
+}
+
+fn typeEquals(a: ast.Type, b: ast.Type) bool {
+    if (!isScalar(a) or !isScalar(b)) return false;
+    return std.meta.activeTag(a) == std.meta.activeTag(b);
+}
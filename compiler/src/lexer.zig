@@ -8,169 +8,131 @@ pub const LexerError = error{
     OutOfMemory,
 };
 
+/// Produces one token per `next` call. The lexer holds no state beyond its
+/// position, so a copy of it can be used to look ahead and restoring a copy
+/// backtracks. Offsets are u32; sources are capped well below 4 GiB.
 pub const Lexer = struct {
     source: []const u8,
     pos: usize,
-    line: usize,
-    col: usize,
-    tokens: std.ArrayList(Token),
-    allocator: std.mem.Allocator,
 
-    pub fn init(allocator: std.mem.Allocator, source: []const u8) Lexer {
+    pub fn init(source: []const u8) Lexer {
         return .{
             .source = source,
             .pos = 0,
-            .line = 1,
-            .col = 1,
-            .tokens = .empty,
-            .allocator = allocator,
         };
     }
 
-    pub fn deinit(self: *Lexer) void {
-        self.tokens.deinit(self.allocator);
+    /// Lexes the whole source into an array; the parser pulls tokens with
+    /// `next` instead. Caller owns the returned slice.
+    pub fn tokenize(self: *Lexer, allocator: std.mem.Allocator) LexerError![]Token {
+        var tokens: std.ArrayList(Token) = .empty;
+        errdefer tokens.deinit(allocator);
+        while (true) {
+            const tok = try self.next();
+            tokens.append(allocator, tok) catch return LexerError.OutOfMemory;
+            if (tok.tag == .eof) break;
+        }
+        return tokens.toOwnedSlice(allocator) catch return LexerError.OutOfMemory;
     }
 
-    pub fn tokenize(self: *Lexer) LexerError![]const Token {
+    /// Returns the next token, or `.eof` (repeatedly) at the end of the source.
+    /// On error `pos` is left on the offending character.
+    pub fn next(self: *Lexer) LexerError!Token {
         while (self.pos < self.source.len) {
-            const c = self.source[self.pos];
-
-            // Skip spaces (not newlines)
-            if (c == ' ') {
-                self.advance();
-                continue;
+            switch (self.source[self.pos]) {
+                // Skip spaces and carriage returns (not newlines), and tabs
+                // (technically forbidden in 1im, but let's be lenient for now)
+                ' ', '\r', '\t' => self.pos = self.scanWhile(self.pos, .blank),
+                // Comments
+                '#' => self.skipComment(),
+                else => break,
             }
+        }
 
-            // Skip carriage return
-            if (c == '\r') {
-                self.advance();
-                continue;
-            }
+        const start = self.pos;
+        if (start >= self.source.len) return make(.eof, start);
+        const c = self.source[start];
 
-            // Skip tabs (technically forbidden in 1im, but let's be lenient for now)
-            if (c == '\t') {
-                self.advance();
-                continue;
-            }
+        // Newlines
+        if (c == '\n') {
+            self.pos += 1;
+            return make(.newline, start);
+        }
 
-            // Comments
-            if (c == '#') {
-                self.skipComment();
-                continue;
-            }
+        // Strings
+        if (c == '"') return self.readString();
 
-            // Newlines
-            if (c == '\n') {
-                try self.addToken(.newline, "\n");
-                self.pos += 1;
-                self.line += 1;
-                self.col = 1;
-                continue;
-            }
+        // Numbers
+        if (std.ascii.isDigit(c)) return self.readNumber();
 
-            // Strings
-            if (c == '"') {
-                try self.readString();
-                continue;
-            }
-
-            // Numbers
-            if (std.ascii.isDigit(c)) {
-                try self.readNumber();
-                continue;
-            }
+        // Identifiers and keywords
+        if (std.ascii.isAlphabetic(c) or c == '_') return self.readName();
 
-            // Identifiers and keywords
-            if (std.ascii.isAlphabetic(c) or c == '_') {
-                try self.readName();
-                continue;
-            }
+        // Three-char operators (check before two-char)
+        if (c == '.' and self.peek(1) == '.' and self.peek(2) == '=') {
+            self.pos += 3;
+            return make(.dot_dot_eq, start);
+        }
 
-            // Three-char operators (check before two-char)
-            if (c == '.' and self.peek(1) == '.' and self.peek(2) == '=') {
-                const start_col = self.col;
-                try self.addTokenAt(.dot_dot_eq, "..=", start_col);
-                self.advance();
-                self.advance();
-                self.advance();
-                continue;
-            }
+        // Two-char operators (check before single-char)
+        const next_c = self.peek(1);
+        const double_tag: ?TokenType = switch (c) {
+            '.' => if (next_c == '.') .dot_dot else null,
+            '=' => if (next_c == '=') .eq_eq else null,
+            '!' => if (next_c == '=') .bang_eq else null,
+            '<' => if (next_c == '=') .lt_eq else null,
+            '>' => if (next_c == '=') .gt_eq else null,
+            else => null,
+        };
 
-            // Two-char operators (check before single-char)
-            if (c == '.' and self.peek(1) == '.') {
-                const start_col = self.col;
-                try self.addTokenAt(.dot_dot, "..", start_col);
-                self.advance();
-                self.advance();
-                continue;
-            }
-            if (c == '=' and self.peek(1) == '=') {
-                const start_col = self.col;
-                try self.addTokenAt(.eq_eq, "==", start_col);
-                self.advance();
-                self.advance();
-                continue;
-            }
-            if (c == '!' and self.peek(1) == '=') {
-                const start_col = self.col;
-                try self.addTokenAt(.bang_eq, "!=", start_col);
-                self.advance();
-                self.advance();
-                continue;
-            }
-            if (c == '<' and self.peek(1) == '=') {
-                const start_col = self.col;
-                try self.addTokenAt(.lt_eq, "<=", start_col);
-                self.advance();
-                self.advance();
-                continue;
-            }
-            if (c == '>' and self.peek(1) == '=') {
-                const start_col = self.col;
-                try self.addTokenAt(.gt_eq, ">=", start_col);
-                self.advance();
-                self.advance();
-                continue;
-            }
+        if (double_tag) |tag| {
+            self.pos += 2;
+            return make(tag, start);
+        }
 
-            // Single-char tokens
-            const single_tag: ?TokenType = switch (c) {
-                '(' => .lparen,
-                ')' => .rparen,
-                '[' => .lbracket,
-                ']' => .rbracket,
-                '{' => .lbrace,
-                '}' => .rbrace,
-                ',' => .comma,
-                '.' => .dot,
-                ':' => .colon,
-                '+' => .plus,
-                '-' => .minus,
-                '*' => .star,
-                '/' => .slash,
-                '%' => .percent,
-                '!' => .bang,
-                '<' => .lt,
-                '>' => .gt,
-                else => null,
-            };
-
-            if (single_tag) |tag| {
-                try self.addToken(tag, self.source[self.pos .. self.pos + 1]);
-                self.advance();
-                continue;
-            }
+        // Single-char tokens
+        const single_tag: ?TokenType = switch (c) {
+            '(' => .lparen,
+            ')' => .rparen,
+            '[' => .lbracket,
+            ']' => .rbracket,
+            '{' => .lbrace,
+            '}' => .rbrace,
+            ',' => .comma,
+            '.' => .dot,
+            ':' => .colon,
+            '+' => .plus,
+            '-' => .minus,
+            '*' => .star,
+            '/' => .slash,
+            '%' => .percent,
+            '!' => .bang,
+            '<' => .lt,
+            '>' => .gt,
+            else => null,
+        };
 
-            return LexerError.UnexpectedCharacter;
+        if (single_tag) |tag| {
+            self.pos += 1;
+            return make(tag, start);
         }
 
-        try self.addToken(.eof, "");
-        return self.tokens.items;
+        return LexerError.UnexpectedCharacter;
+    }
+
+    /// Source text of a token produced from `source`, found by lexing it
+    /// again from its start. String literals exclude their quotes.
+    pub fn lexeme(source: []const u8, tok: Token) []const u8 {
+        if (tok.tag == .eof) return "";
+        var relex: Lexer = .{ .source = source, .pos = tok.start };
+        // The token was lexed successfully once already.
+        _ = relex.next() catch unreachable;
+        if (tok.tag == .string_literal) return source[tok.start + 1 .. relex.pos - 1];
+        return source[tok.start..relex.pos];
     }
 
-    fn advance(self: *Lexer) void {
-        self.pos += 1;
-        self.col += 1;
+    fn make(tag: TokenType, start: usize) Token {
+        return .{ .tag = tag, .start = @intCast(start) };
     }
 
     fn peek(self: *const Lexer, offset: usize) ?u8 {
@@ -179,113 +141,203 @@ pub const Lexer = struct {
         return null;
     }
 
-    fn addToken(self: *Lexer, tag: TokenType, lexeme: []const u8) LexerError!void {
-        try self.addTokenAt(tag, lexeme, self.col);
-    }
-
-    fn addTokenAt(self: *Lexer, tag: TokenType, lexeme: []const u8, col: usize) LexerError!void {
-        self.tokens.append(self.allocator, .{
-            .tag = tag,
-            .lexeme = lexeme,
-            .line = self.line,
-            .col = col,
-        }) catch return LexerError.OutOfMemory;
-    }
-
     fn skipComment(self: *Lexer) void {
-        while (self.pos < self.source.len and self.source[self.pos] != '\n') {
-            self.advance();
-        }
+        self.pos = self.scanWhile(self.pos, .not_newline);
     }
 
-    fn readString(self: *Lexer) LexerError!void {
-        const start_col = self.col;
-        self.advance(); // skip opening "
+    fn readString(self: *Lexer) LexerError!Token {
         const start = self.pos;
-        while (self.pos < self.source.len and self.source[self.pos] != '"') {
-            if (self.source[self.pos] == '\\') self.advance(); // skip escape
-            self.advance();
+        self.pos += 1; // skip opening "
+        while (true) {
+            self.pos = self.scanWhile(self.pos, .string_body);
+            if (self.pos >= self.source.len or self.source[self.pos] == '"') break;
+            self.pos += 2; // skip escape
         }
-        if (self.pos >= self.source.len) return LexerError.UnterminatedString;
-        const lexeme = self.source[start..self.pos];
-        try self.addTokenAt(.string_literal, lexeme, start_col);
-        self.advance(); // skip closing "
+        if (self.pos >= self.source.len) {
+            self.pos = start;
+            return LexerError.UnterminatedString;
+        }
+        self.pos += 1; // skip closing "
+        return make(.string_literal, start);
     }
 
-    fn readNumber(self: *Lexer) LexerError!void {
+    fn readNumber(self: *Lexer) Token {
         const start = self.pos;
-        const start_col = self.col;
-        while (self.pos < self.source.len and std.ascii.isDigit(self.source[self.pos])) {
-            self.advance();
-        }
+        self.pos = self.scanWhile(self.pos, .digit);
         // Check for float (only if '.' is followed by a digit)
         if (self.pos < self.source.len and self.source[self.pos] == '.' and
             self.peek(1) != null and std.ascii.isDigit(self.peek(1).?))
         {
-            self.advance();
-            while (self.pos < self.source.len and std.ascii.isDigit(self.source[self.pos])) {
-                self.advance();
-            }
-            try self.addTokenAt(.float_literal, self.source[start..self.pos], start_col);
-        } else {
-            try self.addTokenAt(.int_literal, self.source[start..self.pos], start_col);
+            self.pos = self.scanWhile(self.pos + 1, .digit);
+            return make(.float_literal, start);
         }
+        return make(.int_literal, start);
     }
 
-    fn readName(self: *Lexer) LexerError!void {
+    fn readName(self: *Lexer) Token {
         const start = self.pos;
-        const start_col = self.col;
-        while (self.pos < self.source.len and
-            (std.ascii.isAlphanumeric(self.source[self.pos]) or self.source[self.pos] == '_'))
-        {
-            self.advance();
+        self.pos = self.scanWhile(self.pos, .name);
+        const tag = keywordTag(self.source[start..self.pos]) orelse TokenType.name;
+        return make(tag, start);
+    }
+
+    /// End of the run of `class` bytes starting at `from`. Whole vectors are
+    /// classified at once; the tail shorter than a vector is done bytewise.
+    fn scanWhile(self: *const Lexer, from: usize, comptime class: Class) usize {
+        var i = from;
+        while (i + vec_len <= self.source.len) : (i += vec_len) {
+            const chunk: Chunk = self.source[i..][0..vec_len].*;
+            if (std.simd.firstIndexOfValue(class.matchVector(chunk), false)) |miss| {
+                return i + miss;
+            }
         }
-        const lexeme = self.source[start..self.pos];
-        const tag = keyword_map.get(lexeme) orelse TokenType.name;
-        try self.addTokenAt(tag, lexeme, start_col);
+        while (i < self.source.len and class.matchByte(self.source[i])) i += 1;
+        return i;
+    }
+};
+
+const keywords = [_]struct { []const u8, TokenType }{
+    .{ "set", .kw_set },
+    .{ "to", .kw_to },
+    .{ "with", .kw_with },
+    .{ "as", .kw_as },
+    .{ "returns", .kw_returns },
+    .{ "return", .kw_return },
+    .{ "if", .kw_if },
+    .{ "then", .kw_then },
+    .{ "else", .kw_else },
+    .{ "loop", .kw_loop },
+    .{ "while", .kw_while },
+    .{ "for", .kw_for },
+    .{ "in", .kw_in },
+    .{ "break", .kw_break },
+    .{ "continue", .kw_continue },
+    .{ "import", .kw_import },
+    .{ "from", .kw_from },
+    .{ "parallel", .kw_parallel },
+    .{ "spawn", .kw_spawn },
+    .{ "await", .kw_await },
+    .{ "fun", .kw_fun },
+    .{ "true", .kw_true },
+    .{ "false", .kw_false },
+    .{ "null", .kw_null },
+    .{ "and", .kw_and },
+    .{ "or", .kw_or },
+    .{ "not", .kw_not },
+    .{ "try", .kw_try },
+    .{ "catch", .kw_catch },
+    .{ "fn", .kw_fn },
+    .{ "i8", .kw_i8 },
+    .{ "i16", .kw_i16 },
+    .{ "i32", .kw_i32 },
+    .{ "i64", .kw_i64 },
+    .{ "u8", .kw_u8 },
+    .{ "u16", .kw_u16 },
+    .{ "u32", .kw_u32 },
+    .{ "u64", .kw_u64 },
+    .{ "f32", .kw_f32 },
+    .{ "f64", .kw_f64 },
+    .{ "bool", .kw_bool },
+    .{ "str", .kw_str },
+    .{ "void", .kw_void },
+};
+
+/// Keywords are recognized by a perfect hash of their length, first and
+/// last byte: `keyword_table.mult` is searched for at comptime so that every
+/// keyword gets its own slot, and one comparison confirms a hit.
+fn keywordTag(text: []const u8) ?TokenType {
+    if (text.len > keyword_table.max_len) return null;
+    const index = keyword_table.slots[keywordSlot(text, keyword_table.mult)];
+    if (index == KeywordTable.empty) return null;
+    const kw = keywords[index];
+    return if (std.mem.eql(u8, kw[0], text)) kw[1] else null;
+}
+
+fn keywordSlot(text: []const u8, mult: u32) u8 {
+    const key = (@as(u32, @intCast(text.len)) << 16) | (@as(u32, text[0]) << 8) | text[text.len - 1];
+    return @intCast((key *% mult) >> 24);
+}
+
+const KeywordTable = struct {
+    mult: u32,
+    max_len: usize,
+    /// Index into `keywords`, or `empty`.
+    slots: [256]u8,
+
+    const empty = 0xff;
+};
+
+const keyword_table: KeywordTable = blk: {
+    @setEvalBranchQuota(100_000);
+    var max_len: usize = 0;
+    for (keywords) |kw| max_len = @max(max_len, kw[0].len);
+
+    var seed: u32 = 0;
+    while (true) : (seed += 1) {
+        const mult = (0x9E3779B1 +% seed *% 0x78DDE6E4) | 1;
+        var slots = [_]u8{KeywordTable.empty} ** 256;
+        const ok = for (keywords, 0..) |kw, index| {
+            const slot = keywordSlot(kw[0], mult);
+            if (slots[slot] != KeywordTable.empty) break false;
+            slots[slot] = index;
+        } else true;
+        if (ok) break :blk .{ .mult = mult, .max_len = max_len, .slots = slots };
+    }
+};
+
+const vec_len = std.simd.suggestVectorLength(u8) orelse 16;
+const Chunk = @Vector(vec_len, u8);
+const Mask = @Vector(vec_len, bool);
+
+/// Byte classes the lexer skips over in runs.
+const Class = enum {
+    /// ' ', '\r' and '\t'
+    blank,
+    /// Anything but '\n' (comment bodies)
+    not_newline,
+    /// Anything but '"' and '\\' (string literal bodies)
+    string_body,
+    digit,
+    /// Identifier continuation: letters, digits and '_'
+    name,
+
+    fn matchByte(comptime class: Class, c: u8) bool {
+        return switch (class) {
+            .blank => c == ' ' or c == '\r' or c == '\t',
+            .not_newline => c != '\n',
+            .string_body => c != '"' and c != '\\',
+            .digit => std.ascii.isDigit(c),
+            .name => std.ascii.isAlphanumeric(c) or c == '_',
+        };
+    }
+
+    fn matchVector(comptime class: Class, chunk: Chunk) Mask {
+        return switch (class) {
+            .blank => either(either(chunk == splat(' '), chunk == splat('\r')), chunk == splat('\t')),
+            .not_newline => chunk != splat('\n'),
+            .string_body => both(chunk != splat('"'), chunk != splat('\\')),
+            .digit => isDigit(chunk),
+            // Setting bit 5 folds 'A'-'Z' onto 'a'-'z' and maps no other byte there.
+            .name => either(
+                either(isDigit(chunk), chunk == splat('_')),
+                (chunk | splat(0x20)) -% splat('a') < splat(26),
+            ),
+        };
+    }
+
+    fn isDigit(chunk: Chunk) Mask {
+        return chunk -% splat('0') < splat(10);
+    }
+
+    fn either(a: Mask, b: Mask) Mask {
+        return @select(bool, a, a, b);
+    }
+
+    fn both(a: Mask, b: Mask) Mask {
+        return @select(bool, a, b, a);
     }
 
-    const keyword_map = std.StaticStringMap(TokenType).initComptime(.{
-        .{ "set", .kw_set },
-        .{ "to", .kw_to },
-        .{ "with", .kw_with },
-        .{ "as", .kw_as },
-        .{ "returns", .kw_returns },
-        .{ "return", .kw_return },
-        .{ "if", .kw_if },
-        .{ "then", .kw_then },
-        .{ "else", .kw_else },
-        .{ "loop", .kw_loop },
-        .{ "while", .kw_while },
-        .{ "for", .kw_for },
-        .{ "in", .kw_in },
-        .{ "break", .kw_break },
-        .{ "continue", .kw_continue },
-        .{ "import", .kw_import },
-        .{ "from", .kw_from },
-        .{ "parallel", .kw_parallel },
-        .{ "fun", .kw_fun },
-        .{ "true", .kw_true },
-        .{ "false", .kw_false },
-        .{ "null", .kw_null },
-        .{ "and", .kw_and },
-        .{ "or", .kw_or },
-        .{ "not", .kw_not },
-        .{ "try", .kw_try },
-        .{ "catch", .kw_catch },
-        .{ "fn", .kw_fn },
-        .{ "i8", .kw_i8 },
-        .{ "i16", .kw_i16 },
-        .{ "i32", .kw_i32 },
-        .{ "i64", .kw_i64 },
-        .{ "u8", .kw_u8 },
-        .{ "u16", .kw_u16 },
-        .{ "u32", .kw_u32 },
-        .{ "u64", .kw_u64 },
-        .{ "f32", .kw_f32 },
-        .{ "f64", .kw_f64 },
-        .{ "bool", .kw_bool },
-        .{ "str", .kw_str },
-        .{ "void", .kw_void },
-    });
+    fn splat(c: u8) Chunk {
+        return @splat(c);
+    }
 };
@@ -1,32 +1,105 @@
 /// 1im compiler — main entry point.
-/// Usage: 1im <source.1im>
+/// Usage: 1im [--no-cache] [--fast-start] [--backend=c|native] [--mode=safe|fast] [--bounds-report] <source.1im>
+///        1im --emit-ir|--emit-c [--mode=safe|fast] [--bounds-report] <source.1im>
+///        1im --cache-stats
 ///
-/// Pipeline: source → lexer → parser → C codegen → cc → run
+/// Pipeline: source → imports → [cache] → lexer → parser → C codegen → cc → run
+/// Imported modules are parsed and lowered in parallel and each becomes its
+/// own C translation unit.
+/// With --fast-start the C is piped to `tcc` (or `cc -O0`) instead.
+/// With --backend=native the AST is lowered straight to an x86-64 ELF.
+/// With --emit-ir (--emit-c) the optimized SSA IR (generated C) is printed
+/// instead of compiling.
+/// --mode=safe (the default) checks array and slice indexes the compiler
+/// cannot prove in range; --mode=fast checks none. --bounds-report prints
+/// how many were checked and proven per function.
 const std = @import("std");
-const Lexer = @import("lexer.zig").Lexer;
-const Parser = @import("parser.zig").Parser;
-const Codegen = @import("codegen.zig").Codegen;
-const Analyzer = @import("semantic.zig").Analyzer;
+const NativeGen = @import("native.zig").NativeGen;
+const Program = @import("modules.zig").Program;
+const Emit = @import("modules.zig").Emit;
+const Cache = @import("cache.zig").Cache;
+
+const usage_text = "usage: 1im [--no-cache] [--fast-start] [--backend=c|native] [--mode=safe|fast] [--bounds-report] <source.1im>\n       1im --emit-ir|--emit-c [--mode=safe|fast] [--bounds-report] <source.1im>\n       1im --cache-stats\n";
+
+const Backend = enum { c, native };
+
+/// Whether generated C checks array and slice indexes.
+const Mode = enum { safe, fast };
+
+/// Flags passed to `cc`; part of the compile cache key.
+const cc_flags = [_][]const u8{ "-O3", "-march=native", "-pthread" };
+
+/// `--fast-start` fallback flags when tcc is unavailable or fails: skip
+/// optimization so short scripts spend as little time as possible in the C
+/// compiler.
+const fast_cc_flags = [_][]const u8{ "-O0", "-pthread" };
+
+/// Cache key flags for the native backend, which never runs `cc`.
+const native_flags = [_][]const u8{"--backend=native"};
 
 pub fn main() !void {
     var gpa_state: std.heap.GeneralPurposeAllocator(.{}) = .init;
     defer _ = gpa_state.deinit();
     const gpa = gpa_state.allocator();
 
-    var arena_state = std.heap.ArenaAllocator.init(gpa);
-    defer arena_state.deinit();
-    const arena = arena_state.allocator();
-
     // ── Parse CLI args ──────────────────────────────────────────
     const args = try std.process.argsAlloc(gpa);
     defer std.process.argsFree(gpa, args);
 
-    if (args.len < 2) {
-        try std.fs.File.stderr().writeAll("usage: 1im <source.1im>\n");
-        std.process.exit(1);
+    var source_arg: ?[]const u8 = null;
+    var use_cache = true;
+    var show_cache_stats = false;
+    var fast_start = false;
+    var emit_ir = false;
+    var emit_c = false;
+    var backend: Backend = .c;
+    var mode: Mode = .safe;
+    var bounds_report = false;
+    for (args[1..]) |arg| {
+        if (std.mem.eql(u8, arg, "--no-cache")) {
+            use_cache = false;
+        } else if (std.mem.eql(u8, arg, "--fast-start")) {
+            fast_start = true;
+        } else if (std.mem.eql(u8, arg, "--emit-ir")) {
+            emit_ir = true;
+        } else if (std.mem.eql(u8, arg, "--emit-c")) {
+            emit_c = true;
+        } else if (std.mem.eql(u8, arg, "--cache-stats")) {
+            show_cache_stats = true;
+        } else if (std.mem.eql(u8, arg, "--bounds-report")) {
+            bounds_report = true;
+        } else if (std.mem.startsWith(u8, arg, "--mode=")) {
+            mode = std.meta.stringToEnum(Mode, arg["--mode=".len..]) orelse {
+                try std.fs.File.stderr().writeAll(usage_text);
+                std.process.exit(1);
+            };
+        } else if (std.mem.startsWith(u8, arg, "--backend=")) {
+            backend = std.meta.stringToEnum(Backend, arg["--backend=".len..]) orelse {
+                try std.fs.File.stderr().writeAll(usage_text);
+                std.process.exit(1);
+            };
+        } else if (std.mem.startsWith(u8, arg, "--") or source_arg != null) {
+            try std.fs.File.stderr().writeAll(usage_text);
+            std.process.exit(1);
+        } else {
+            source_arg = arg;
+        }
     }
 
-    const source_path = args[1];
+    // `--emit-*` never runs the program, so it must not be answered from the
+    // cache; nor can the bounds report, which comes from code generation.
+    var cache: ?Cache = if (use_cache and !emit_ir and !emit_c and !bounds_report) Cache.open(gpa) catch null else null;
+    defer if (cache) |*c| c.close();
+
+    if (show_cache_stats) {
+        printCacheStats(if (cache) |*c| c else null);
+        return;
+    }
+
+    const source_path = source_arg orelse {
+        try std.fs.File.stderr().writeAll(usage_text);
+        std.process.exit(1);
+    };
 
     // ── Read source file ────────────────────────────────────────
     const source = std.fs.cwd().readFileAlloc(gpa, source_path, 10 * 1024 * 1024) catch |err| {
@@ -37,52 +110,70 @@ pub fn main() !void {
     };
     defer gpa.free(source);
 
-    // ── Lex ─────────────────────────────────────────────────────
-    var lexer = Lexer.init(gpa, source);
-    defer lexer.deinit();
+    // ── Load imported modules ───────────────────────────────────
+    var program = try Program.load(gpa, source_path, source);
+    defer program.deinit();
+    if (program.firstError()) |msg| fail(msg);
 
-    const tokens = lexer.tokenize() catch |err| {
-        var buf: [256]u8 = undefined;
-        const msg = std.fmt.bufPrint(&buf, "lexer error: {s}\n", .{@errorName(err)}) catch "lexer error\n";
-        std.fs.File.stderr().writeAll(msg) catch {};
-        std.process.exit(1);
-    };
-
-    // ── Parse ───────────────────────────────────────────────────
-    var parser = Parser.init(arena, tokens);
-
-    const program = parser.parse() catch |err| {
-        var buf: [256]u8 = undefined;
-        const msg = std.fmt.bufPrint(&buf, "parse error at line {d}:{d}: {s}\n", .{
-            parser.currentLine(),
-            parser.currentCol(),
-            @errorName(err),
-        }) catch "parse error\n";
-        std.fs.File.stderr().writeAll(msg) catch {};
-        std.process.exit(1);
-    };
+    // ── Compile cache lookup ────────────────────────────────────
+    const key_flags: []const []const u8 = if (backend == .native)
+        native_flags[0..]
+    else if (fast_start)
+        fast_cc_flags[0..]
+    else
+        cc_flags[0..];
+    const sources = try program.sources(gpa);
+    defer gpa.free(sources);
+    var key_args: std.ArrayList([]const u8) = .empty;
+    defer key_args.deinit(gpa);
+    try key_args.appendSlice(gpa, key_flags);
+    if (mode == .fast) try key_args.append(gpa, "--mode=fast");
+    const cache_key = Cache.computeKey(sources, key_args.items);
+    if (cache) |*c| {
+        if (c.lookup(&cache_key) catch null) |cached_bin| {
+            defer gpa.free(cached_bin);
+            try runBinary(gpa, cached_bin);
 
-    // ── Semantic Analysis ───────────────────────────────────────
-    var analyzer = Analyzer.init(gpa);
-    defer analyzer.deinit();
+            var buf: [1024]u8 = undefined;
+            const msg = std.fmt.bufPrint(&buf, "Cached binary: {s}\n", .{cached_bin}) catch "Cached binary\n";
+            std.fs.File.stderr().writeAll(msg) catch {};
+            return;
+        }
+    }
 
-    _ = analyzer.analyze(program) catch {
-        const msg = if (analyzer.last_error.len > 0) analyzer.last_error else "semantic error\n";
-        std.fs.File.stderr().writeAll(msg) catch {};
-        std.fs.File.stderr().writeAll("\n") catch {};
-        std.process.exit(1);
-    };
+    if (backend == .native and program.modules.items.len > 1) {
+        fail("native backend: imports are not supported yet");
+    }
 
-    // ── Generate C ──────────────────────────────────────────────
-    var codegen = Codegen.init(gpa);
-    defer codegen.deinit();
+    // ── Lex + Parse + Semantic Analysis + Codegen ───────────────
+    // The parser pulls tokens from the lexer as it goes; no token array is
+    // built. Modules are parsed in parallel, then analyzed and lowered in
+    // import order (see modules.zig).
+    const emit: Emit = if (emit_ir) .ir else if (emit_c or backend == .c) .c else .none;
+    program.bounds_checks = mode == .safe;
+    try program.compile(emit);
+    if (program.firstError()) |msg| fail(msg);
+    const entry = &program.modules.items[0];
+    if (bounds_report and emit == .c) printBoundsReport(&program, mode);
 
-    const c_source = codegen.generate(program) catch |err| {
-        var buf: [256]u8 = undefined;
-        const msg = std.fmt.bufPrint(&buf, "codegen error: {s}\n", .{@errorName(err)}) catch "codegen error\n";
-        std.fs.File.stderr().writeAll(msg) catch {};
-        std.process.exit(1);
-    };
+    if (emit_ir or emit_c) {
+        const stdout = std.fs.File.stdout();
+        if (program.modules.items.len == 1) {
+            try stdout.writeAll(entry.output);
+            return;
+        }
+        for (program.modules.items) |m| {
+            var buf: [256]u8 = undefined;
+            const header = if (emit_ir)
+                std.fmt.bufPrint(&buf, "; module {s}\n", .{m.name}) catch "; module\n"
+            else
+                std.fmt.bufPrint(&buf, "/* module {s} */\n", .{m.name}) catch "/* module */\n";
+            try stdout.writeAll(header);
+            try stdout.writeAll(m.output);
+            try stdout.writeAll("\n");
+        }
+        return;
+    }
 
     // ── Write C to examples/codegen/ ───────────────────────────
     // Extract basename from source path (e.g., "examples/hello.1im" → "hello")
@@ -122,30 +213,129 @@ pub fn main() !void {
     };
     defer gpa.free(bin_path);
 
-    {
-        const c_file = try std.fs.cwd().createFile(c_path, .{});
-        defer c_file.close();
-        try c_file.writeAll(c_source);
+    // ── Native backend: AST → x86-64 ELF, no C compiler ────────
+    if (backend == .native) {
+        var native = NativeGen.init(gpa, &entry.analyzer.inferred_returns);
+        defer native.deinit();
+        native.bounds_checks = mode == .safe;
+
+        const image = native.generate(&entry.tree) catch |err| {
+            var buf: [256]u8 = undefined;
+            const msg = std.fmt.bufPrint(&buf, "native codegen error: {s}\n", .{@errorName(err)}) catch "native codegen error\n";
+            std.fs.File.stderr().writeAll(msg) catch {};
+            std.process.exit(1);
+        };
+
+        // Separate name so both backends' binaries can sit side by side.
+        const native_path = try std.fmt.allocPrint(gpa, "{s}.native", .{bin_path});
+        defer gpa.free(native_path);
+        {
+            const bin_file = try std.fs.cwd().createFile(native_path, .{ .mode = 0o755 });
+            defer bin_file.close();
+            try bin_file.writeAll(image);
+        }
+
+        if (cache) |*c| {
+            c.store(&cache_key, native_path) catch {};
+        }
+        try runBinary(gpa, native_path);
+
+        var buf: [1024]u8 = undefined;
+        const msg = std.fmt.bufPrint(&buf, "Native binary: {s}\n", .{native_path}) catch "Native binary\n";
+        std.fs.File.stderr().writeAll(msg) catch {};
+        return;
     }
 
-    // ── Compile C → binary ──────────────────────────────────────
-    const compile_result = std.process.Child.run(.{
-        .allocator = gpa,
-        .argv = &.{ "cc", "-o", bin_path, c_path, "-O3", "-march=native", "-pthread" },
-    }) catch |err| {
+    // ── Multiple modules: one C file and object each, then link ──
+    if (program.modules.items.len > 1) {
+        try buildModules(gpa, &program, codegen_dir, basename, bin_path, key_flags);
+    } else if (fast_start) {
+        // ── Fast start: compile without writing C to disk ──────
+        try fastStart(gpa, entry.output, bin_path, entry.codegen.?.needs_runtime);
+        if (cache) |*c| {
+            c.store(&cache_key, bin_path) catch {};
+        }
+        try runBinary(gpa, bin_path);
+        return;
+    } else {
+        {
+            const c_file = try std.fs.cwd().createFile(c_path, .{});
+            defer c_file.close();
+            try c_file.writeAll(entry.output);
+        }
+
+        // ── Compile C → binary ──────────────────────────────────
+        var cc_argv: std.ArrayList([]const u8) = .empty;
+        defer cc_argv.deinit(gpa);
+        try cc_argv.appendSlice(gpa, &.{ "cc", "-o", bin_path, c_path });
+        try cc_argv.appendSlice(gpa, &cc_flags);
+        runCc(gpa, cc_argv.items);
+    }
+
+    if (cache) |*c| {
+        c.store(&cache_key, bin_path) catch {};
+    }
+
+    // ── Run the binary ──────────────────────────────────────────
+    try runBinary(gpa, bin_path);
+
+    //– Cleanup temp files ──────────────────────────────────────
+    // Keep C file and binary for inspection
+    // std.fs.cwd().deleteFile(c_path) catch {};
+    // std.fs.cwd().deleteFile(bin_path) catch {};
+
+    // Print location of generated files for debugging
+    var buf: [1024]u8 = undefined;
+    const msg = std.fmt.bufPrint(&buf, "Generated C code: {s}\nCompiled binary: {s}\n", .{ c_path, bin_path }) catch unreachable;
+    std.fs.File.stderr().writeAll(msg) catch {};
+}
+
+/// Runs the compiled program with our stdio and exits with its status when
+/// it fails, so a failed bounds check or a crash is seen by the caller; a
+/// signal becomes status 128 + its number, as in the shell.
+fn runBinary(gpa: std.mem.Allocator, bin_path: []const u8) !void {
+    var child = std.process.Child.init(&.{bin_path}, gpa);
+    const term = child.spawnAndWait() catch |err| {
         var buf: [256]u8 = undefined;
-        const msg = std.fmt.bufPrint(&buf, "failed to invoke C compiler: {s}\n", .{@errorName(err)}) catch "failed to invoke C compiler\n";
+        const msg = std.fmt.bufPrint(&buf, "failed to run compiled binary: {s}\n", .{@errorName(err)}) catch "failed to run binary\n";
         std.fs.File.stderr().writeAll(msg) catch {};
         std.process.exit(1);
     };
-    defer gpa.free(compile_result.stdout);
-    defer gpa.free(compile_result.stderr);
+    switch (term) {
+        .Exited => |code| if (code != 0) std.process.exit(code),
+        .Signal => |sig| std.process.exit(@truncate(128 + sig)),
+        else => std.process.exit(1),
+    }
+}
 
-    switch (compile_result.term) {
+/// Prints `msg` and a newline to stderr and exits with status 1.
+fn fail(msg: []const u8) noreturn {
+    std.fs.File.stderr().writeAll(msg) catch {};
+    std.fs.File.stderr().writeAll("\n") catch {};
+    std.process.exit(1);
+}
+
+fn ccInvokeFailed(err: anyerror) noreturn {
+    var buf: [256]u8 = undefined;
+    const msg = std.fmt.bufPrint(&buf, "failed to invoke C compiler: {s}\n", .{@errorName(err)}) catch "failed to invoke C compiler\n";
+    std.fs.File.stderr().writeAll(msg) catch {};
+    std.process.exit(1);
+}
+
+/// Runs the C compiler with `argv`, exiting with its diagnostics on failure.
+fn runCc(gpa: std.mem.Allocator, argv: []const []const u8) void {
+    const result = std.process.Child.run(.{
+        .allocator = gpa,
+        .argv = argv,
+    }) catch |err| ccInvokeFailed(err);
+    defer gpa.free(result.stdout);
+    defer gpa.free(result.stderr);
+
+    switch (result.term) {
         .Exited => |code| {
             if (code != 0) {
                 std.fs.File.stderr().writeAll("C compilation failed:\n") catch {};
-                std.fs.File.stderr().writeAll(compile_result.stderr) catch {};
+                std.fs.File.stderr().writeAll(result.stderr) catch {};
                 std.process.exit(1);
             }
         },
@@ -154,35 +344,154 @@ pub fn main() !void {
             std.process.exit(1);
         },
     }
+}
 
-    // ── Run the binary ──────────────────────────────────────────
-    const run_result = std.process.Child.run(.{
-        .allocator = gpa,
-        .argv = &.{bin_path},
-    }) catch |err| {
-        var buf: [256]u8 = undefined;
-        const msg = std.fmt.bufPrint(&buf, "failed to run compiled binary: {s}\n", .{@errorName(err)}) catch "failed to run binary\n";
-        std.fs.File.stderr().writeAll(msg) catch {};
+/// Builds a program with imports: every module's C goes to its own file
+/// (`<basename>.c` for the entry, `<basename>.<module>.c` for the others),
+/// the files are compiled to objects by up to one `cc -c` per CPU at a
+/// time, and the objects are linked into `bin_path`.
+fn buildModules(
+    gpa: std.mem.Allocator,
+    program: *const Program,
+    codegen_dir: []const u8,
+    basename: []const u8,
+    bin_path: []const u8,
+    flags: []const []const u8,
+) !void {
+    var arena_state = std.heap.ArenaAllocator.init(gpa);
+    defer arena_state.deinit();
+    const a = arena_state.allocator();
+
+    const modules = program.modules.items;
+    const objects = try a.alloc([]const u8, modules.len);
+    const jobs = try a.alloc(std.process.Child, modules.len);
+    for (modules, objects, jobs) |m, *obj, *job| {
+        const stem = if (m.entry) basename else try std.fmt.allocPrint(a, "{s}.{s}", .{ basename, m.name });
+        const c_path = try std.fmt.allocPrint(a, "{s}/{s}.c", .{ codegen_dir, stem });
+        obj.* = try std.fmt.allocPrint(a, "{s}/{s}.o", .{ codegen_dir, stem });
+        {
+            const c_file = try std.fs.cwd().createFile(c_path, .{});
+            defer c_file.close();
+            try c_file.writeAll(m.output);
+        }
+
+        var argv: std.ArrayList([]const u8) = .empty;
+        try argv.appendSlice(a, &.{ "cc", "-c", "-o", obj.*, c_path });
+        try argv.appendSlice(a, flags);
+        job.* = std.process.Child.init(argv.items, gpa);
+    }
+
+    // Diagnostics go straight to our stderr, so no pipe can fill up while
+    // we wait on another compiler.
+    const width = @max(std.Thread.getCpuCount() catch 1, 1);
+    var started: usize = 0;
+    var failed = false;
+    for (jobs, 0..) |*job, i| {
+        while (started < jobs.len and started < i + width) : (started += 1) {
+            jobs[started].spawn() catch |err| ccInvokeFailed(err);
+        }
+        const term = job.wait() catch |err| ccInvokeFailed(err);
+        if (term != .Exited or term.Exited != 0) failed = true;
+    }
+    if (failed) {
+        std.fs.File.stderr().writeAll("C compilation failed\n") catch {};
         std.process.exit(1);
-    };
-    defer gpa.free(run_result.stdout);
-    defer gpa.free(run_result.stderr);
+    }
 
-    // Print program output
-    if (run_result.stdout.len > 0) {
-        try std.fs.File.stdout().writeAll(run_result.stdout);
+    var link_argv: std.ArrayList([]const u8) = .empty;
+    try link_argv.appendSlice(a, &.{ "cc", "-o", bin_path });
+    try link_argv.appendSlice(a, objects);
+    try link_argv.appendSlice(a, flags);
+    runCc(gpa, link_argv.items);
+}
+
+/// Builds `bin_path` from `c_source` without writing the C to disk, with
+/// `tcc` (or `$ONEIM_FAST_CC`) reading it from stdin. Falls back to `cc -O0`
+/// when tcc is not installed or rejects the program, and skips tcc for
+/// programs that start threads, since it has no `_Thread_local`.
+fn fastStart(gpa: std.mem.Allocator, c_source: []const u8, bin_path: []const u8, threaded: bool) !void {
+    if (!threaded) {
+        const tcc = std.posix.getenv("ONEIM_FAST_CC") orelse "tcc";
+        // Only cc's diagnostics are shown; tcc failing just means falling back.
+        if (pipeToChild(gpa, &.{ tcc, "-pthread", "-o", bin_path, "-" }, c_source, .Ignore)) |term| {
+            if (term == .Exited and term.Exited == 0) return;
+        } else |err| switch (err) {
+            error.FileNotFound => {},
+            else => return err,
+        }
+    }
+
+    var argv: std.ArrayList([]const u8) = .empty;
+    defer argv.deinit(gpa);
+    try argv.appendSlice(gpa, &.{ "cc", "-o", bin_path, "-x", "c", "-" });
+    try argv.appendSlice(gpa, &fast_cc_flags);
+
+    const term = pipeToChild(gpa, argv.items, c_source, .Inherit) catch |err| ccInvokeFailed(err);
+    if (term != .Exited or term.Exited != 0) {
+        std.fs.File.stderr().writeAll("C compilation failed\n") catch {};
+        std.process.exit(1);
     }
-    if (run_result.stderr.len > 0) {
-        try std.fs.File.stderr().writeAll(run_result.stderr);
+}
+
+/// Spawns `argv` with `input` on stdin, stdout inherited and stderr as
+/// given.
+fn pipeToChild(gpa: std.mem.Allocator, argv: []const []const u8, input: []const u8, stderr: std.process.Child.StdIo) !std.process.Child.Term {
+    var child = std.process.Child.init(argv, gpa);
+    child.stdin_behavior = .Pipe;
+    child.stderr_behavior = stderr;
+    try child.spawn();
+
+    // A compiler that dies early closes its end; wait() reports the failure.
+    child.stdin.?.writeAll(input) catch {};
+    child.stdin.?.close();
+    child.stdin = null;
+    return child.wait();
+}
+
+/// One line per function that indexes an array or slice: how many indexes
+/// are checked and how many were proven in range, so left unchecked.
+fn printBoundsReport(program: *const Program, mode: Mode) void {
+    const stderr = std.fs.File.stderr();
+    stderr.writeAll(if (mode == .safe) "bounds checks:\n" else "bounds checks (off with --mode=fast):\n") catch {};
+    for (program.modules.items) |m| {
+        const cg = m.codegen orelse continue;
+        for (cg.bounds_report.items) |count| {
+            var buf: [512]u8 = undefined;
+            const line = if (m.entry)
+                std.fmt.bufPrint(&buf, "  {s}: {d} checked, {d} proven in range\n", .{ count.function, count.checked, count.proven })
+            else
+                std.fmt.bufPrint(&buf, "  {s}.{s}: {d} checked, {d} proven in range\n", .{ m.name, count.function, count.checked, count.proven });
+            stderr.writeAll(line catch continue) catch {};
+        }
     }
+}
 
-    //– Cleanup temp files ──────────────────────────────────────
-    // Keep C file and binary for inspection
-    // std.fs.cwd().deleteFile(c_path) catch {};
-    // std.fs.cwd().deleteFile(bin_path) catch {};
+fn printCacheStats(cache: ?*Cache) void {
+    const c = cache orelse {
+        std.fs.File.stderr().writeAll("compile cache disabled (set $ONEIM_CACHE_DIR or $HOME)\n") catch {};
+        return;
+    };
+    const usage = c.usage() catch Cache.Usage{ .entries = 0, .bytes = 0 };
+    const lookups = c.stats.hits + c.stats.misses;
+    const hit_rate: f64 = if (lookups == 0) 0 else @as(f64, @floatFromInt(c.stats.hits)) * 100.0 / @as(f64, @floatFromInt(lookups));
 
-    // Print location of generated files for debugging
     var buf: [1024]u8 = undefined;
-    const msg = std.fmt.bufPrint(&buf, "Generated C code: {s}\nCompiled binary: {s}\n", .{ c_path, bin_path }) catch unreachable;
-    std.fs.File.stderr().writeAll(msg) catch {};
+    const msg = std.fmt.bufPrint(&buf,
+        \\cache dir:  {s}
+        \\entries:    {d} ({d} / {d} KiB)
+        \\hits:       {d}
+        \\misses:     {d} ({d:.1}% hit rate)
+        \\evictions:  {d}
+        \\
+    , .{
+        c.dir_path,
+        usage.entries,
+        usage.bytes / 1024,
+        c.max_bytes / 1024,
+        c.stats.hits,
+        c.stats.misses,
+        hit_rate,
+        c.stats.evictions,
+    }) catch return;
+    std.fs.File.stdout().writeAll(msg) catch {};
 }
@@ -0,0 +1,319 @@
+/// Multi-file programs: module discovery and the parallel front end.
+///
+/// `import NAME` loads `NAME.1im` from the importing file's directory. An
+/// imported module may only contain functions and imports; its importer
+/// calls them as `NAME.f(...)`. All modules are parsed concurrently on a
+/// thread pool, then analyzed and lowered in dependency order, running every
+/// module whose imports are done at the same time. Each module becomes its
+/// own C translation unit, in which its functions are named `NAME__f`.
+const std = @import("std");
+const ast = @import("ast.zig");
+const Lexer = @import("lexer.zig").Lexer;
+const Parser = @import("parser.zig").Parser;
+const Analyzer = @import("semantic.zig").Analyzer;
+const Codegen = @import("codegen.zig").Codegen;
+const Imported = @import("codegen.zig").Imported;
+
+/// What `Program.compile` produces for each module after analysis.
+pub const Emit = enum { none, c, ir };
+
+pub const Module = struct {
+    /// Import name; the entry module's is its file's basename.
+    name: []const u8,
+    path: []const u8,
+    source: []const u8,
+    entry: bool,
+    /// Indices into `Program.modules` of the modules this one imports.
+    imports: std.ArrayList(usize),
+    /// 0 without imports, else one more than the deepest import. Modules on
+    /// the same level never depend on each other.
+    level: usize,
+    /// Owns the tree and names; only touched by the thread compiling this module.
+    arena: std.heap.ArenaAllocator,
+    tree: ast.Tree,
+    analyzer: Analyzer,
+    codegen: ?Codegen,
+    /// Generated C, or the IR dump; empty with `Emit.none`.
+    output: []const u8,
+    /// First error hit while compiling this module.
+    err_msg: ?[]const u8,
+
+    fn fail(self: *Module, comptime fmt: []const u8, args: anytype) void {
+        const a = self.arena.allocator();
+        const msg = std.fmt.allocPrint(a, fmt, args) catch "error: out of memory";
+        self.err_msg = if (self.entry) msg else std.fmt.allocPrint(a, "{s}: {s}", .{ self.path, msg }) catch msg;
+    }
+};
+
+pub const Program = struct {
+    gpa: std.mem.Allocator,
+    /// Paths, names and imported sources.
+    arena: std.heap.ArenaAllocator,
+    /// `modules[0]` is the entry module. Fixed once `load` returns, so
+    /// pointers into it stay valid while modules compile.
+    modules: std.ArrayList(Module),
+    /// Whether generated C checks array and slice indexes (`--mode=safe`).
+    bounds_checks: bool,
+
+    /// Reads every module reachable from the entry file. Unreadable imports
+    /// and import cycles are reported through `firstError`. `entry_source`
+    /// is borrowed.
+    pub fn load(gpa: std.mem.Allocator, entry_path: []const u8, entry_source: []const u8) error{OutOfMemory}!Program {
+        var program: Program = .{
+            .gpa = gpa,
+            .arena = std.heap.ArenaAllocator.init(gpa),
+            .modules = .empty,
+            .bounds_checks = true,
+        };
+        errdefer program.deinit();
+
+        const file = std.fs.path.basename(entry_path);
+        const name = file[0 .. std.mem.lastIndexOfScalar(u8, file, '.') orelse file.len];
+        try program.addModule(name, entry_path, entry_source);
+
+        // Appending while walking by index reaches modules found along the way.
+        var i: usize = 0;
+        while (i < program.modules.items.len) : (i += 1) {
+            try program.resolveImports(i);
+            if (program.firstError() != null) return program;
+        }
+        program.computeLevels();
+        return program;
+    }
+
+    pub fn deinit(self: *Program) void {
+        for (self.modules.items) |*m| {
+            if (m.codegen) |*cg| cg.deinit();
+            m.analyzer.deinit();
+            m.imports.deinit(self.gpa);
+            m.arena.deinit();
+        }
+        self.modules.deinit(self.gpa);
+        self.arena.deinit();
+    }
+
+    /// The first error in module order, ready to print.
+    pub fn firstError(self: *const Program) ?[]const u8 {
+        for (self.modules.items) |m| {
+            if (m.err_msg) |msg| return msg;
+        }
+        return null;
+    }
+
+    /// Sources of every module, for the compile cache key. Caller frees.
+    pub fn sources(self: *const Program, allocator: std.mem.Allocator) error{OutOfMemory}![]const []const u8 {
+        const list = try allocator.alloc([]const u8, self.modules.items.len);
+        for (self.modules.items, list) |m, *src| src.* = m.source;
+        return list;
+    }
+
+    /// Parses every module, then analyzes and lowers them level by level.
+    /// Stops at the first phase with an error; see `firstError`.
+    pub fn compile(self: *Program, emit: Emit) error{OutOfMemory}!void {
+        if (self.modules.items.len == 1) {
+            self.parseModule(0);
+            if (self.firstError() == null) self.lowerModule(0, emit);
+            return;
+        }
+
+        var pool: std.Thread.Pool = undefined;
+        pool.init(.{ .allocator = self.gpa }) catch return error.OutOfMemory;
+        defer pool.deinit();
+
+        {
+            var wg: std.Thread.WaitGroup = .{};
+            for (0..self.modules.items.len) |i| pool.spawnWg(&wg, parseModule, .{ self, i });
+            pool.waitAndWork(&wg);
+        }
+        if (self.firstError() != null) return;
+
+        var max_level: usize = 0;
+        for (self.modules.items) |m| max_level = @max(max_level, m.level);
+        for (0..max_level + 1) |level| {
+            var wg: std.Thread.WaitGroup = .{};
+            for (self.modules.items, 0..) |m, i| {
+                if (m.level == level) pool.spawnWg(&wg, lowerModule, .{ self, i, emit });
+            }
+            pool.waitAndWork(&wg);
+            if (self.firstError() != null) return;
+        }
+    }
+
+    fn addModule(self: *Program, name: []const u8, path: []const u8, source: []const u8) error{OutOfMemory}!void {
+        try self.modules.append(self.gpa, .{
+            .name = name,
+            .path = path,
+            .source = source,
+            .entry = self.modules.items.len == 0,
+            .imports = .empty,
+            .level = 0,
+            .arena = std.heap.ArenaAllocator.init(self.gpa),
+            .tree = undefined,
+            .analyzer = Analyzer.init(self.gpa),
+            .codegen = null,
+            .output = "",
+            .err_msg = null,
+        });
+    }
+
+    /// Finds `import NAME` lines in module `index` and loads each module not
+    /// seen yet from the importer's directory.
+    fn resolveImports(self: *Program, index: usize) error{OutOfMemory}!void {
+        const a = self.arena.allocator();
+        const importer = self.modules.items[index];
+        const dir = std.fs.path.dirname(importer.path) orelse ".";
+
+        var lexer = Lexer.init(importer.source);
+        var line_start = true;
+        while (true) {
+            // Lexer errors end the scan; the parser reports them.
+            const tok = lexer.next() catch return;
+            switch (tok.tag) {
+                .eof => return,
+                .newline => {
+                    line_start = true;
+                    continue;
+                },
+                .kw_import => if (line_start) {
+                    const name_tok = lexer.next() catch return;
+                    if (name_tok.tag == .name) {
+                        const name = Lexer.lexeme(importer.source, name_tok);
+                        const path = try std.fmt.allocPrint(a, "{s}/{s}.1im", .{ dir, name });
+                        const dep = try self.findOrLoad(index, name, path) orelse return;
+                        try self.modules.items[index].imports.append(self.gpa, dep);
+                    }
+                },
+                else => {},
+            }
+            line_start = false;
+        }
+    }
+
+    /// Index of module `name`, loading it from `path` on first sight. Null
+    /// after recording an error on the importer.
+    fn findOrLoad(self: *Program, importer: usize, name: []const u8, path: []const u8) error{OutOfMemory}!?usize {
+        for (self.modules.items, 0..) |m, i| {
+            if (!std.mem.eql(u8, m.name, name)) continue;
+            if (m.entry or !std.mem.eql(u8, m.path, path)) {
+                self.modules.items[importer].fail("error: module '{s}' is also defined by '{s}'", .{ name, m.path });
+                return null;
+            }
+            return i;
+        }
+
+        const source = std.fs.cwd().readFileAlloc(self.arena.allocator(), path, 10 * 1024 * 1024) catch |err| switch (err) {
+            error.OutOfMemory => return error.OutOfMemory,
+            else => {
+                self.modules.items[importer].fail("error: cannot import '{s}': cannot read '{s}': {s}", .{ name, path, @errorName(err) });
+                return null;
+            },
+        };
+        try self.addModule(name, path, source);
+        return self.modules.items.len - 1;
+    }
+
+    fn computeLevels(self: *Program) void {
+        const State = enum { unvisited, visiting, done };
+        const states = self.gpa.alloc(State, self.modules.items.len) catch {
+            self.modules.items[0].fail("error: out of memory", .{});
+            return;
+        };
+        defer self.gpa.free(states);
+        @memset(states, .unvisited);
+        _ = self.visit(0, states);
+    }
+
+    /// Depth-first level assignment; false once an import cycle is found.
+    fn visit(self: *Program, index: usize, states: anytype) bool {
+        switch (states[index]) {
+            .done => return true,
+            .visiting => {
+                const m = &self.modules.items[index];
+                m.fail("error: import cycle through module '{s}'", .{m.name});
+                return false;
+            },
+            .unvisited => {},
+        }
+        states[index] = .visiting;
+        var level: usize = 0;
+        for (self.modules.items[index].imports.items) |dep| {
+            if (!self.visit(dep, states)) return false;
+            level = @max(level, self.modules.items[dep].level + 1);
+        }
+        self.modules.items[index].level = level;
+        states[index] = .done;
+        return true;
+    }
+
+    fn parseModule(self: *Program, index: usize) void {
+        const m = &self.modules.items[index];
+        var parser = Parser.init(m.arena.allocator(), m.source);
+        m.tree = parser.parse() catch |err| {
+            const loc = parser.errorLocation();
+            const stage = if (parser.lex_error_at != null) "lexer" else "parse";
+            m.fail("{s} error at line {d}:{d}: {s}", .{ stage, loc.line, loc.col, @errorName(err) });
+            return;
+        };
+
+        if (m.entry) return;
+        for (m.tree.rootStmts()) |stmt| {
+            switch (m.tree.tags[stmt]) {
+                .function_def, .import_decl => {},
+                else => {
+                    m.fail("semantic error: an imported module can only contain functions and imports", .{});
+                    return;
+                },
+            }
+        }
+    }
+
+    /// Analyzes module `index` against the signatures of the modules it
+    /// imports, which are on lower levels and therefore done, then emits it.
+    fn lowerModule(self: *Program, index: usize, emit: Emit) void {
+        const m = &self.modules.items[index];
+        const a = m.arena.allocator();
+
+        var imported: std.ArrayList(Imported) = .empty;
+        for (m.imports.items) |dep_index| {
+            const dep = &self.modules.items[dep_index];
+            for (dep.tree.rootStmts()) |stmt| {
+                if (dep.tree.tags[stmt] != .function_def) continue;
+                const fd = dep.tree.node(stmt).function_def;
+                const name = std.fmt.allocPrint(a, "{s}.{s}", .{ dep.name, fd.name }) catch return m.fail("error: out of memory", .{});
+                imported.append(a, .{ .name = name, .sig = .{
+                    .params = fd.params,
+                    .ret = fd.return_type orelse dep.analyzer.inferred_returns.get(fd.name),
+                } }) catch return m.fail("error: out of memory", .{});
+            }
+        }
+
+        for (imported.items) |imp| {
+            m.analyzer.declareImported(imp.name, imp.sig.params, imp.sig.ret) catch return m.fail("{s}", .{m.analyzer.last_error});
+        }
+        m.analyzer.analyze(&m.tree) catch {
+            const msg = if (m.analyzer.last_error.len > 0) m.analyzer.last_error else "semantic error";
+            return m.fail("{s}", .{msg});
+        };
+        if (emit == .none) return;
+
+        m.codegen = Codegen.init(self.gpa, m.analyzer.exprTypes(), &m.analyzer.inferred_returns);
+        const cg = &m.codegen.?;
+        if (!m.entry) cg.module_prefix = m.name;
+        cg.bounds_checks = self.bounds_checks;
+        // Every other module is imported, directly or not, and already generated.
+        if (m.entry) {
+            for (self.modules.items) |other| {
+                if (other.codegen) |other_cg| cg.needs_runtime = cg.needs_runtime or other_cg.needs_runtime;
+            }
+        }
+        for (imported.items) |imp| {
+            cg.declareImported(imp.name, imp.sig) catch return m.fail("error: out of memory", .{});
+        }
+        const generated = switch (emit) {
+            .c => cg.generate(&m.tree),
+            .ir => cg.dumpIr(&m.tree),
+            .none => unreachable,
+        };
+        m.output = generated catch |err| return m.fail("codegen error: {s}", .{@errorName(err)});
+    }
+};
@@ -0,0 +1,1759 @@
+/// Native x86-64 backend for 1im.
+/// Lowers the AST straight to machine code and writes a static Linux ELF
+/// executable, so no C compiler is involved.
+///
+/// The lowering is deliberately simple: every value lives in 8-byte stack
+/// slots addressed from rbp, and expressions are evaluated into registers —
+/// scalars in rax, slices in rax:rdx (ptr:len), error unions in
+/// rax:rdx:rcx (ok:value:err), arrays as their address in rax. Floats are
+/// carried as f64 bit patterns. `parallel` blocks, loops and assignments run
+/// in order, and `spawn` makes its call on the spot: a future holds the
+/// call's result, which `await` reads.
+const std = @import("std");
+const ast = @import("ast.zig");
+
+pub const NativeError = error{
+    UnsupportedNode,
+    OutOfMemory,
+};
+
+/// Load address of the read-only, executable segment; code follows the ELF
+/// headers. Bss gets a writable, non-executable segment on the next page.
+const base_addr: u64 = 0x400000;
+const page_size = 0x1000;
+const elf_header_size = 64;
+const program_header_size = 56;
+
+const Reg = enum(u8) {
+    rax = 0,
+    rcx = 1,
+    rdx = 2,
+    rbx = 3,
+    rsp = 4,
+    rbp = 5,
+    rsi = 6,
+    rdi = 7,
+};
+
+/// x86 condition codes as encoded in jcc/setcc.
+const Cond = enum(u8) {
+    b = 0x2,
+    ae = 0x3,
+    e = 0x4,
+    ne = 0x5,
+    be = 0x6,
+    a = 0x7,
+    ns = 0x9,
+    l = 0xC,
+    ge = 0xD,
+    le = 0xE,
+    g = 0xF,
+};
+
+/// Register-register ALU opcodes (`op r/m64, r64`).
+const Alu = enum(u8) {
+    add = 0x01,
+    or_ = 0x09,
+    sub = 0x29,
+    xor_ = 0x31,
+    cmp = 0x39,
+    test_ = 0x85,
+};
+
+const Label = usize;
+
+const Fixup = struct {
+    /// Offset of a rel32 field in `code`, relative to the next instruction.
+    at: usize,
+    label: Label,
+};
+
+const StringData = struct {
+    label: Label,
+    bytes: []const u8,
+};
+
+const BssData = struct {
+    label: Label,
+    size: usize,
+};
+
+const Local = struct {
+    /// rbp-relative offset of the first slot.
+    offset: i32,
+    type_info: ast.Type,
+    /// Array parameters hold the caller's array address, not the elements.
+    indirect: bool,
+};
+
+const Function = struct {
+    def: ast.FunctionDef,
+    ret: ?ast.Type,
+    label: Label,
+    /// Arrays cannot come back in registers, so array-returning functions
+    /// copy their result into a static buffer and return its address.
+    ret_buffer: ?Label,
+};
+
+const Loop = struct {
+    break_label: Label,
+    continue_label: Label,
+};
+
+const Runtime = struct {
+    print_int: Label,
+    print_uint: Label,
+    print_float: Label,
+    print_bool: Label,
+    print_str: Label,
+    index_fail: Label,
+    str_true: Label,
+    str_false: Label,
+    str_null: Label,
+    str_newline: Label,
+};
+
+pub const NativeGen = struct {
+    /// The program being compiled; set by `generate`.
+    tree: *const ast.Tree,
+    code: std.ArrayList(u8),
+    image: std.ArrayList(u8),
+    labels: std.ArrayList(?usize),
+    fixups: std.ArrayList(Fixup),
+    strings: std.ArrayList(StringData),
+    bss: std.ArrayList(BssData),
+    functions: std.StringHashMap(Function),
+    locals: std.StringHashMap(Local),
+    loops: std.ArrayList(Loop),
+    inferred_returns: *const std.StringHashMap(ast.Type),
+    frame_size: usize,
+    current_return: ?ast.Type,
+    current_ret_buffer: ?Label,
+    rt: Runtime,
+    /// Whether `xs[i]` checks `i` against the length (`--mode=safe`).
+    bounds_checks: bool,
+    arena: std.heap.ArenaAllocator,
+    allocator: std.mem.Allocator,
+
+    /// `inferred_returns` is the analyzer's map of functions whose return
+    /// type was inferred rather than declared.
+    pub fn init(allocator: std.mem.Allocator, inferred_returns: *const std.StringHashMap(ast.Type)) NativeGen {
+        return .{
+            .tree = undefined,
+            .code = .empty,
+            .image = .empty,
+            .labels = .empty,
+            .fixups = .empty,
+            .strings = .empty,
+            .bss = .empty,
+            .functions = std.StringHashMap(Function).init(allocator),
+            .locals = std.StringHashMap(Local).init(allocator),
+            .loops = .empty,
+            .inferred_returns = inferred_returns,
+            .frame_size = 0,
+            .current_return = null,
+            .current_ret_buffer = null,
+            .rt = undefined,
+            .bounds_checks = true,
+            .arena = std.heap.ArenaAllocator.init(allocator),
+            .allocator = allocator,
+        };
+    }
+
+    pub fn deinit(self: *NativeGen) void {
+        self.code.deinit(self.allocator);
+        self.image.deinit(self.allocator);
+        self.labels.deinit(self.allocator);
+        self.fixups.deinit(self.allocator);
+        self.strings.deinit(self.allocator);
+        self.bss.deinit(self.allocator);
+        self.functions.deinit();
+        self.locals.deinit();
+        self.loops.deinit(self.allocator);
+        self.arena.deinit();
+    }
+
+    /// Returns the complete ELF image, owned by the generator.
+    pub fn generate(self: *NativeGen, tree: *const ast.Tree) NativeError![]const u8 {
+        self.tree = tree;
+        const stmts = tree.rootStmts();
+
+        self.rt = .{
+            .print_int = try self.newLabel(),
+            .print_uint = try self.newLabel(),
+            .print_float = try self.newLabel(),
+            .print_bool = try self.newLabel(),
+            .print_str = try self.newLabel(),
+            .index_fail = try self.newLabel(),
+            .str_true = try self.internBytes("true\n"),
+            .str_false = try self.internBytes("false\n"),
+            .str_null = try self.internBytes("(null)\x00"),
+            .str_newline = try self.internBytes("\n"),
+        };
+
+        var has_main = false;
+        for (stmts) |stmt| {
+            if (tree.tags[stmt] != .function_def) continue;
+            const fd = tree.node(stmt).function_def;
+            if (std.mem.eql(u8, fd.name, "main")) has_main = true;
+
+            const ret = fd.return_type orelse self.inferred_returns.get(fd.name);
+            const ret_buffer: ?Label = if (ret != null and ret.? == .array)
+                try self.newBss(slotCount(ret.?) * 8)
+            else
+                null;
+            self.functions.put(fd.name, .{
+                .def = fd,
+                .ret = ret,
+                .label = try self.newLabel(),
+                .ret_buffer = ret_buffer,
+            }) catch return NativeError.OutOfMemory;
+        }
+
+        // Entry point: top-level statements run in the _start frame.
+        const frame_patch = try self.emitPrologue();
+        for (stmts) |stmt| {
+            if (tree.tags[stmt] != .function_def) try self.genStmt(stmt);
+        }
+        if (has_main) try self.call(self.functions.get("main").?.label);
+        try self.movImm(.rax, 60); // exit
+        try self.zero(.rdi);
+        try self.emit(&.{ 0x0F, 0x05 });
+        self.patchFrame(frame_patch);
+
+        for (stmts) |stmt| {
+            if (tree.tags[stmt] == .function_def) {
+                try self.genFunction(self.functions.get(tree.node(stmt).function_def.name).?);
+            }
+        }
+
+        try self.emitRuntime();
+        return self.link();
+    }
+
+    // ── Functions ───────────────────────────────────────────────
+
+    fn genFunction(self: *NativeGen, f: Function) NativeError!void {
+        self.bind(f.label);
+
+        const prev_locals = self.locals;
+        self.locals = std.StringHashMap(Local).init(self.allocator);
+        defer {
+            self.locals.deinit();
+            self.locals = prev_locals;
+        }
+        const prev_frame = self.frame_size;
+        self.frame_size = 0;
+        defer self.frame_size = prev_frame;
+        const prev_return = self.current_return;
+        const prev_buffer = self.current_ret_buffer;
+        self.current_return = f.ret;
+        self.current_ret_buffer = f.ret_buffer;
+        defer {
+            self.current_return = prev_return;
+            self.current_ret_buffer = prev_buffer;
+        }
+
+        const frame_patch = try self.emitPrologue();
+
+        // Arguments were pushed left to right, so the last word is at [rbp+16].
+        var total_words: usize = 0;
+        for (f.def.params) |param| total_words += argWords(param.type_info);
+
+        var word: usize = 0;
+        for (f.def.params) |param| {
+            const words = argWords(param.type_info);
+            const local = try self.declareLocal(param.name, param.type_info, param.type_info == .array);
+            for (0..words) |w| {
+                const src: i32 = @intCast(16 + 8 * (total_words - 1 - (word + w)));
+                try self.loadRbp(.rax, src);
+                try self.storeRbp(local.offset + @as(i32, @intCast(8 * w)), .rax);
+            }
+            word += words;
+        }
+
+        for (f.def.body) |stmt| {
+            try self.genStmt(stmt);
+        }
+
+        try self.emitEpilogue();
+        self.patchFrame(frame_patch);
+    }
+
+    /// `push rbp; mov rbp, rsp; sub rsp, imm32` — returns the imm32 offset,
+    /// patched once the frame size is known.
+    fn emitPrologue(self: *NativeGen) NativeError!usize {
+        try self.push(.rbp);
+        try self.movRR(.rbp, .rsp);
+        try self.emit(&.{ 0x48, 0x81, 0xEC });
+        const at = self.code.items.len;
+        try self.emitInt(u32, 0);
+        return at;
+    }
+
+    fn patchFrame(self: *NativeGen, at: usize) void {
+        const size: u32 = @intCast(std.mem.alignForward(usize, self.frame_size, 16));
+        std.mem.writeInt(u32, self.code.items[at..][0..4], size, .little);
+    }
+
+    fn emitEpilogue(self: *NativeGen) NativeError!void {
+        try self.movRR(.rsp, .rbp);
+        try self.pop(.rbp);
+        try self.emit(&.{0xC3});
+    }
+
+    // ── Statements ──────────────────────────────────────────────
+
+    fn genStmt(self: *NativeGen, node: ast.Index) NativeError!void {
+        switch (self.tree.node(node)) {
+            .affinity_decl => {}, // no threads to place
+            .set_assign => |sa| try self.genAssign(sa.name, null, sa.value),
+            .typed_assign => |ta| try self.genAssign(ta.name, ta.type_info, ta.value),
+            .index_assign => |ia| try self.genIndexAssign(ia),
+            .return_stmt => |rs| try self.genReturn(rs),
+            .if_stmt => |is| try self.genIf(is),
+            .while_loop => |wl| try self.genWhile(wl),
+            .for_loop => |fl| try self.genFor(fl),
+            .parallel_block => |pb| for (pb.body) |stmt| try self.genStmt(stmt),
+            .parallel_assign => |pa| for (pa.targets, pa.calls) |target, call| {
+                const name = self.tree.node(target).variable.name;
+                if (try self.exprType(call) == .error_union) {
+                    try self.genTryAssign(name, null, .{ .expr = call });
+                } else {
+                    try self.genAssign(name, null, call);
+                }
+            },
+            .break_stmt => try self.jmp((try self.currentLoop()).break_label),
+            .continue_stmt => try self.jmp((try self.currentLoop()).continue_label),
+            .try_catch => |tc| try self.genTryCatch(tc),
+            .expr_stmt => |es| switch (self.tree.node(es.expr)) {
+                .try_expr => |te| try self.genTryCheck(te),
+                else => try self.genExpr(es.expr),
+            },
+            else => return NativeError.UnsupportedNode,
+        }
+    }
+
+    fn genAssign(self: *NativeGen, name: []const u8, explicit_type: ?ast.Type, value: ast.Index) NativeError!void {
+        if (self.tree.tags[value] == .try_expr) {
+            return self.genTryAssign(name, explicit_type, self.tree.node(value).try_expr);
+        }
+        if (self.locals.get(name)) |local| {
+            try self.genValueFor(local.type_info, value);
+            return self.storeLocal(local);
+        }
+
+        const t = explicit_type orelse try self.exprType(value);
+        if (t == .void and self.tree.tags[value] != .spawn_expr) return NativeError.UnsupportedNode;
+        const local = try self.declareLocal(name, t, false);
+        try self.genValueFor(t, value);
+        try self.storeLocal(local);
+    }
+
+    fn genIndexAssign(self: *NativeGen, ia: ast.IndexAssign) NativeError!void {
+        const ix = switch (self.tree.node(ia.target)) {
+            .index_expr => |ix| ix,
+            else => return NativeError.UnsupportedNode,
+        };
+        const elem_type = try self.genElemAddr(ix);
+        if (elem_type == .array) return NativeError.UnsupportedNode;
+        try self.push(.rax);
+        try self.genExpr(ia.value);
+        try self.normalize(elem_type);
+        try self.pop(.rcx);
+        try self.storeMem(.rcx, .rax);
+    }
+
+    fn genReturn(self: *NativeGen, rs: ast.ReturnStmt) NativeError!void {
+        const ret = self.current_return orelse {
+            if (rs.value != null) return NativeError.UnsupportedNode;
+            return self.emitEpilogue();
+        };
+        const value = rs.value orelse return NativeError.UnsupportedNode;
+
+        if (self.tree.tags[value] == .try_expr) {
+            if (ret != .error_union) return NativeError.UnsupportedNode;
+            try self.genTryCheck(self.tree.node(value).try_expr);
+            try self.movImm(.rax, 1);
+            try self.zero(.rcx);
+            return self.emitEpilogue();
+        }
+
+        try self.genValueFor(ret, value);
+        if (ret == .array) {
+            const buffer = self.current_ret_buffer orelse return NativeError.UnsupportedNode;
+            try self.movRR(.rsi, .rax);
+            try self.leaLabel(.rdi, buffer);
+            try self.copyWords(slotCount(ret));
+            try self.leaLabel(.rax, buffer);
+        }
+        try self.emitEpilogue();
+    }
+
+    fn genIf(self: *NativeGen, is: ast.IfStmt) NativeError!void {
+        const end = try self.newLabel();
+        var next = try self.newLabel();
+
+        try self.genCondJump(is.condition, next);
+        for (is.then_body) |stmt| try self.genStmt(stmt);
+        try self.jmp(end);
+
+        for (is.else_ifs) |elif_node| {
+            const elif = self.tree.node(elif_node).else_if;
+            self.bind(next);
+            next = try self.newLabel();
+            try self.genCondJump(elif.condition, next);
+            for (elif.body) |stmt| try self.genStmt(stmt);
+            try self.jmp(end);
+        }
+
+        self.bind(next);
+        if (is.else_body) |else_body| {
+            for (else_body) |stmt| try self.genStmt(stmt);
+        }
+        self.bind(end);
+    }
+
+    /// Evaluates a bool condition and jumps to `if_false` when it is false.
+    fn genCondJump(self: *NativeGen, cond: ast.Index, if_false: Label) NativeError!void {
+        try self.genExpr(cond);
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.e, if_false);
+    }
+
+    fn genWhile(self: *NativeGen, wl: ast.WhileLoop) NativeError!void {
+        const top = try self.newLabel();
+        const exit = try self.newLabel();
+
+        self.bind(top);
+        try self.genCondJump(wl.condition, exit);
+        try self.genLoopBody(wl.body, .{ .break_label = exit, .continue_label = top });
+        try self.jmp(top);
+        self.bind(exit);
+    }
+
+    fn genFor(self: *NativeGen, fl: ast.ForLoop) NativeError!void {
+        const top = try self.newLabel();
+        const next = try self.newLabel();
+        const exit = try self.newLabel();
+
+        switch (self.tree.node(fl.iterable)) {
+            .range => |range| {
+                const start_type = try self.exprType(range.start);
+                const end_type = try self.exprType(range.end);
+                const loop_type: ast.Type = if (isInt64(start_type) or isInt64(end_type)) .i64 else .i32;
+                const local = try self.declareLocal(fl.variable, loop_type, false);
+
+                try self.genExpr(range.start);
+                try self.storeRbp(local.offset, .rax);
+
+                self.bind(top);
+                try self.loadRbp(.rax, local.offset);
+                try self.push(.rax);
+                try self.genExpr(range.end);
+                try self.movRR(.rcx, .rax);
+                try self.pop(.rax);
+                try self.alu(.cmp, .rax, .rcx);
+                try self.jcc(if (range.inclusive) .g else .ge, exit);
+
+                try self.genLoopBody(fl.body, .{ .break_label = exit, .continue_label = next });
+
+                self.bind(next);
+                try self.loadRbp(.rax, local.offset);
+                try self.emit(&.{ 0x48, 0x83, 0xC0, 0x01 }); // add rax, 1
+                try self.normalize(loop_type);
+                try self.storeRbp(local.offset, .rax);
+                try self.jmp(top);
+            },
+            else => {
+                const iter_type = try self.exprType(fl.iterable);
+                const elem_type = switch (iter_type) {
+                    .array => |arr| arr.elem.*,
+                    .slice => |s| s.elem.*,
+                    else => return NativeError.UnsupportedNode,
+                };
+                if (elem_type == .array) return NativeError.UnsupportedNode;
+
+                const base = self.allocSlots(1);
+                const len = self.allocSlots(1);
+                const idx = self.allocSlots(1);
+
+                try self.genExpr(fl.iterable);
+                if (iter_type == .array) try self.movImm(.rdx, iter_type.array.len);
+                try self.storeRbp(base, .rax);
+                try self.storeRbp(len, .rdx);
+                try self.zero(.rax);
+                try self.storeRbp(idx, .rax);
+
+                const local = try self.declareLocal(fl.variable, elem_type, false);
+
+                self.bind(top);
+                try self.loadRbp(.rax, idx);
+                try self.loadRbp(.rcx, len);
+                try self.alu(.cmp, .rax, .rcx);
+                try self.jcc(.ae, exit);
+                try self.loadRbp(.rcx, base);
+                try self.emit(&.{ 0x48, 0x8B, 0x04, 0xC1 }); // mov rax, [rcx+rax*8]
+                try self.storeRbp(local.offset, .rax);
+
+                try self.genLoopBody(fl.body, .{ .break_label = exit, .continue_label = next });
+
+                self.bind(next);
+                try self.loadRbp(.rax, idx);
+                try self.emit(&.{ 0x48, 0x83, 0xC0, 0x01 }); // add rax, 1
+                try self.storeRbp(idx, .rax);
+                try self.jmp(top);
+            },
+        }
+        self.bind(exit);
+    }
+
+    fn genLoopBody(self: *NativeGen, body: []const ast.Index, loop: Loop) NativeError!void {
+        self.loops.append(self.allocator, loop) catch return NativeError.OutOfMemory;
+        defer _ = self.loops.pop();
+        for (body) |stmt| try self.genStmt(stmt);
+    }
+
+    fn currentLoop(self: *NativeGen) NativeError!Loop {
+        return self.loops.getLastOrNull() orelse NativeError.UnsupportedNode;
+    }
+
+    fn genTryCatch(self: *NativeGen, tc: ast.TryCatch) NativeError!void {
+        const try_type = try self.exprType(tc.try_expr);
+        if (try_type != .error_union) return NativeError.UnsupportedNode;
+
+        const end = try self.newLabel();
+        try self.genExpr(tc.try_expr);
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, end);
+
+        if (tc.catch_var) |name| {
+            const local = try self.declareLocal(name, try_type.error_union.err.*, false);
+            try self.storeRbp(local.offset, .rcx);
+        }
+        for (tc.catch_body) |stmt| try self.genStmt(stmt);
+        self.bind(end);
+    }
+
+    fn genTryAssign(self: *NativeGen, name: []const u8, explicit_type: ?ast.Type, te: ast.TryExpr) NativeError!void {
+        const inner = try self.exprType(te.expr);
+        if (inner != .error_union) return NativeError.UnsupportedNode;
+
+        const local = self.locals.get(name) orelse
+            try self.declareLocal(name, explicit_type orelse inner.error_union.ok.*, false);
+
+        try self.genTryCheck(te);
+        if (local.type_info == .error_union) {
+            try self.movImm(.rax, 1);
+            try self.zero(.rcx);
+        } else {
+            try self.movRR(.rax, .rdx);
+            try self.normalize(local.type_info);
+        }
+        try self.storeLocal(local);
+    }
+
+    /// Evaluates an error union and returns its error from the current
+    /// function if it failed; otherwise the ok value is left in rdx.
+    fn genTryCheck(self: *NativeGen, te: ast.TryExpr) NativeError!void {
+        if (self.current_return == null or self.current_return.? != .error_union) {
+            return NativeError.UnsupportedNode;
+        }
+        const ok = try self.newLabel();
+        try self.genExpr(te.expr);
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, ok);
+        try self.zero(.rdx);
+        try self.emitEpilogue();
+        self.bind(ok);
+    }
+
+    // ── Expressions ─────────────────────────────────────────────
+
+    /// Evaluates `value` converted to `t` (error-union wrapping, narrowing,
+    /// array → slice copies) into the registers used for `t`.
+    fn genValueFor(self: *NativeGen, t: ast.Type, value: ast.Index) NativeError!void {
+        switch (t) {
+            .error_union => |eu| try self.genErrorUnionValue(eu, value),
+            .slice => {
+                const value_type = try self.exprType(value);
+                switch (value_type) {
+                    .slice => try self.genExpr(value),
+                    .array => |arr| {
+                        try self.genExpr(value);
+                        // Slices view named arrays, like the C backend; an
+                        // array returned by a call is copied out of its temporary.
+                        if (self.tree.tags[value] == .call) {
+                            const slots = slotCount(value_type);
+                            const copy = self.allocSlots(slots);
+                            try self.movRR(.rsi, .rax);
+                            try self.leaRbp(.rdi, copy);
+                            try self.copyWords(slots);
+                            try self.leaRbp(.rax, copy);
+                        }
+                        try self.movImm(.rdx, arr.len);
+                    },
+                    else => return NativeError.UnsupportedNode,
+                }
+            },
+            .atomic => |at| {
+                if (try self.exprType(value) == .atomic) return self.genExpr(value);
+                // `as atomic T to <value>` makes a new cell; an atomic is its address.
+                const cell = self.allocSlots(1);
+                try self.genExpr(value);
+                try self.normalize(at.elem.*);
+                try self.storeRbp(cell, .rax);
+                try self.leaRbp(.rax, cell);
+            },
+            else => {
+                try self.genExpr(value);
+                try self.normalize(t);
+            },
+        }
+    }
+
+    fn genErrorUnionValue(self: *NativeGen, eu: ast.ErrorUnionType, value: ast.Index) NativeError!void {
+        const value_type = try self.exprType(value);
+        if (value_type == .error_union and typeEquals(value_type, .{ .error_union = eu })) {
+            return self.genExpr(value);
+        }
+        if (valueMatchesType(self.tree.tags[value], value_type, eu.ok.*)) {
+            try self.genExpr(value);
+            try self.normalize(eu.ok.*);
+            try self.movRR(.rdx, .rax);
+            try self.movImm(.rax, 1);
+            try self.zero(.rcx);
+            return;
+        }
+        if (valueMatchesType(self.tree.tags[value], value_type, eu.err.*)) {
+            try self.genExpr(value);
+            try self.normalize(eu.err.*);
+            try self.movRR(.rcx, .rax);
+            try self.zero(.rax);
+            try self.zero(.rdx);
+            return;
+        }
+        return NativeError.UnsupportedNode;
+    }
+
+    fn genExpr(self: *NativeGen, node: ast.Index) NativeError!void {
+        switch (self.tree.node(node)) {
+            .int_literal => |lit| try self.movImm(.rax, @bitCast(lit.value)),
+            .float_literal => |lit| try self.movImm(.rax, @bitCast(lit.value)),
+            .string_literal => |lit| try self.leaLabel(.rax, try self.internString(lit.value)),
+            .bool_literal => |lit| try self.movImm(.rax, @intFromBool(lit.value)),
+            .variable => |v| {
+                const local = self.locals.get(v.name) orelse return NativeError.UnsupportedNode;
+                try self.loadLocal(local);
+            },
+            .binary_op => |bin| try self.genBinary(bin),
+            .unary_op => |un| {
+                try self.genExpr(un.operand);
+                switch (un.op) {
+                    .negate => {
+                        const t = try self.exprType(un.operand);
+                        if (isFloat(t)) {
+                            try self.movImm(.rcx, 0x8000000000000000);
+                            try self.alu(.xor_, .rax, .rcx);
+                        } else {
+                            try self.emit(&.{ 0x48, 0xF7, 0xD8 }); // neg rax
+                            try self.normalize(t);
+                        }
+                    },
+                    .bool_not => try self.emit(&.{ 0x83, 0xF0, 0x01 }), // xor eax, 1
+                }
+            },
+            .call => |c| try self.genCall(c),
+            .array_literal => |lit| {
+                const t = try self.exprType(node);
+                const offset = self.allocSlots(slotCount(t));
+                try self.fillArrayLiteral(lit, t, offset);
+                try self.leaRbp(.rax, offset);
+            },
+            .index_expr => |ix| {
+                const elem_type = try self.genElemAddr(ix);
+                if (elem_type != .array) try self.loadMem(.rax, .rax);
+            },
+            .try_expr => |te| {
+                try self.genTryCheck(te);
+                try self.movRR(.rax, .rdx);
+            },
+            .spawn_expr => |se| try self.genExpr(se.call),
+            .await_expr => |ae| try self.genExpr(ae.expr),
+            else => return NativeError.UnsupportedNode,
+        }
+    }
+
+    fn genBinary(self: *NativeGen, bin: ast.BinaryOp) NativeError!void {
+        switch (bin.op) {
+            .bool_and, .bool_or => {
+                // Bools are always 0/1, so the short-circuited operand is the result.
+                const end = try self.newLabel();
+                try self.genExpr(bin.left);
+                try self.alu(.test_, .rax, .rax);
+                try self.jcc(if (bin.op == .bool_and) .e else .ne, end);
+                try self.genExpr(bin.right);
+                self.bind(end);
+                return;
+            },
+            else => {},
+        }
+
+        const t = try self.operandType(bin);
+        // Strings here are C strings; `+` and comparing bytes need the C runtime.
+        if (t == .str) return NativeError.UnsupportedNode;
+        try self.genExpr(bin.left);
+        try self.push(.rax);
+        try self.genExpr(bin.right);
+        try self.movRR(.rcx, .rax);
+        try self.pop(.rax);
+
+        if (isFloat(t)) {
+            try self.emit(&.{ 0x66, 0x48, 0x0F, 0x6E, 0xC0 }); // movq xmm0, rax
+            try self.emit(&.{ 0x66, 0x48, 0x0F, 0x6E, 0xC9 }); // movq xmm1, rcx
+            const sse_op: ?u8 = switch (bin.op) {
+                .add => 0x58,
+                .sub => 0x5C,
+                .mul => 0x59,
+                .div => 0x5E,
+                else => null,
+            };
+            if (sse_op) |op| {
+                try self.emit(&.{ 0xF2, 0x0F, op, 0xC1 }); // <op>sd xmm0, xmm1
+                try self.emit(&.{ 0x66, 0x48, 0x0F, 0x7E, 0xC0 }); // movq rax, xmm0
+                return self.normalize(t);
+            }
+            if (bin.op == .mod) return NativeError.UnsupportedNode;
+            try self.emit(&.{ 0x66, 0x0F, 0x2E, 0xC1 }); // ucomisd xmm0, xmm1
+            return self.setCond(switch (bin.op) {
+                .eq => .e,
+                .neq => .ne,
+                .lt => .b,
+                .lte => .be,
+                .gt => .a,
+                .gte => .ae,
+                else => unreachable,
+            });
+        }
+
+        const unsigned = isUnsigned(t);
+        switch (bin.op) {
+            .add => try self.alu(.add, .rax, .rcx),
+            .sub => try self.alu(.sub, .rax, .rcx),
+            .mul => try self.emit(&.{ 0x48, 0x0F, 0xAF, 0xC1 }), // imul rax, rcx
+            .div, .mod => {
+                if (unsigned) {
+                    try self.zero(.rdx);
+                    try self.emit(&.{ 0x48, 0xF7, 0xF1 }); // div rcx
+                } else {
+                    try self.emit(&.{ 0x48, 0x99 }); // cqo
+                    try self.emit(&.{ 0x48, 0xF7, 0xF9 }); // idiv rcx
+                }
+                if (bin.op == .mod) try self.movRR(.rax, .rdx);
+            },
+            .eq, .neq, .lt, .lte, .gt, .gte => {
+                try self.alu(.cmp, .rax, .rcx);
+                return self.setCond(switch (bin.op) {
+                    .eq => .e,
+                    .neq => .ne,
+                    .lt => if (unsigned) .b else .l,
+                    .lte => if (unsigned) .be else .le,
+                    .gt => if (unsigned) .a else .g,
+                    .gte => if (unsigned) .ae else .ge,
+                    else => unreachable,
+                });
+            },
+            .bool_and, .bool_or => unreachable,
+        }
+        try self.normalize(t);
+    }
+
+    fn genCall(self: *NativeGen, c: ast.Call) NativeError!void {
+        if (std.mem.eql(u8, c.callee, "print")) {
+            if (c.args.len == 0) {
+                try self.leaLabel(.rsi, self.rt.str_newline);
+                try self.movImm(.rdx, 1);
+                return self.emitWrite();
+            }
+            const t = try self.exprType(c.args[0]);
+            try self.genExpr(c.args[0]);
+            return self.call(switch (t) {
+                .i8, .i16, .i32, .i64 => self.rt.print_int,
+                .u8, .u16, .u32, .u64 => self.rt.print_uint,
+                .f32, .f64 => self.rt.print_float,
+                .bool => self.rt.print_bool,
+                .str => self.rt.print_str,
+                else => return NativeError.UnsupportedNode,
+            });
+        }
+        if (std.mem.eql(u8, c.callee, "len")) {
+            if (c.args.len != 1) return NativeError.UnsupportedNode;
+            switch (try self.exprType(c.args[0])) {
+                .array => |arr| try self.movImm(.rax, arr.len),
+                .slice => {
+                    try self.genExpr(c.args[0]);
+                    try self.movRR(.rax, .rdx);
+                },
+                else => return NativeError.UnsupportedNode,
+            }
+            return;
+        }
+
+        if (ast.SyncBuiltin.of(c.callee)) |builtin| return self.genSyncCall(builtin, c);
+        // Heap slices and arenas need an allocator, which native programs lack.
+        if (ast.AllocBuiltin.of(c.callee) != null) return NativeError.UnsupportedNode;
+
+        const f = self.functions.get(c.callee) orelse return NativeError.UnsupportedNode;
+        if (c.args.len != f.def.params.len) return NativeError.UnsupportedNode;
+
+        var words: usize = 0;
+        for (c.args, f.def.params) |arg, param| {
+            const t = param.type_info;
+            try self.genValueFor(t, arg);
+            switch (t) {
+                .slice => {
+                    try self.push(.rax);
+                    try self.push(.rdx);
+                },
+                .error_union => {
+                    try self.push(.rax);
+                    try self.push(.rdx);
+                    try self.push(.rcx);
+                },
+                else => try self.push(.rax),
+            }
+            words += argWords(t);
+        }
+
+        try self.call(f.label);
+        if (words > 0) {
+            try self.emit(&.{ 0x48, 0x81, 0xC4 }); // add rsp, imm32
+            try self.emitInt(u32, @intCast(words * 8));
+        }
+    }
+
+    /// With a single thread every operation is atomic and a mutex is never
+    /// contended: atomics are plain loads and stores through their address,
+    /// mutexes are a dummy word, and the memory order is ignored. Channels
+    /// need their producers and consumers to run at the same time, which
+    /// parallel calls run one after another cannot do.
+    fn genSyncCall(self: *NativeGen, builtin: ast.SyncBuiltin, c: ast.Call) NativeError!void {
+        switch (builtin) {
+            .mutex, .lock, .unlock => return self.zero(.rax),
+            .channel, .send, .receive => return NativeError.UnsupportedNode,
+            else => {},
+        }
+        const elem = switch (try self.exprType(c.args[0])) {
+            .atomic => |at| at.elem.*,
+            else => return NativeError.UnsupportedNode,
+        };
+        try self.genExpr(c.args[0]);
+        switch (builtin) {
+            .atomic_load => try self.loadMem(.rax, .rax),
+            .atomic_store => {
+                try self.push(.rax);
+                try self.genExpr(c.args[1]);
+                try self.normalize(elem);
+                try self.pop(.rcx);
+                try self.storeMem(.rcx, .rax);
+            },
+            .atomic_add => {
+                try self.push(.rax);
+                try self.genExpr(c.args[1]);
+                try self.pop(.rcx);
+                try self.loadMem(.rdx, .rcx);
+                try self.alu(.add, .rax, .rdx);
+                try self.normalize(elem);
+                try self.storeMem(.rcx, .rax);
+                try self.movRR(.rax, .rdx);
+            },
+            .atomic_cas => {
+                try self.push(.rax);
+                try self.genExpr(c.args[1]);
+                try self.normalize(elem);
+                try self.push(.rax);
+                try self.genExpr(c.args[2]);
+                try self.normalize(elem);
+                try self.movRR(.rdx, .rax);
+                try self.pop(.rcx);
+                try self.pop(.rsi);
+                try self.loadMem(.rdi, .rsi);
+                try self.alu(.cmp, .rdi, .rcx);
+                try self.setCond(.e);
+                const done = try self.newLabel();
+                try self.alu(.test_, .rax, .rax);
+                try self.jcc(.e, done);
+                try self.storeMem(.rsi, .rdx);
+                self.bind(done);
+            },
+            .mutex, .lock, .unlock, .channel, .send, .receive => unreachable,
+        }
+    }
+
+    /// Leaves the element address in rax and returns the element type.
+    fn genElemAddr(self: *NativeGen, ix: ast.IndexExpr) NativeError!ast.Type {
+        // `xs[a..b]` views are C-backend only.
+        if (self.tree.tags[ix.index] == .range or self.tree.tags[ix.index] == .range_inclusive) return NativeError.UnsupportedNode;
+        const target_type = try self.exprType(ix.target);
+        const elem_type = switch (target_type) {
+            .array => |arr| arr.elem.*,
+            .slice => |s| s.elem.*,
+            else => return NativeError.UnsupportedNode,
+        };
+
+        // Like the C backend, a constant index into an array needs no check.
+        const checked = self.bounds_checks and switch (self.tree.node(ix.index)) {
+            .int_literal => |lit| target_type != .array or lit.value < 0 or lit.value >= target_type.array.len,
+            else => true,
+        };
+
+        try self.genExpr(ix.target);
+        try self.push(.rax);
+        if (checked and target_type == .slice) try self.push(.rdx);
+        try self.genExpr(ix.index);
+        if (checked) {
+            // Unsigned, so a negative index fails too.
+            switch (target_type) {
+                .array => |arr| try self.movImm(.rcx, arr.len),
+                else => try self.pop(.rcx),
+            }
+            try self.alu(.cmp, .rax, .rcx);
+            try self.jcc(.ae, self.rt.index_fail);
+        }
+        try self.emit(&.{ 0x48, 0x69, 0xC0 }); // imul rax, rax, imm32
+        try self.emitInt(u32, @intCast(slotCount(elem_type) * 8));
+        try self.pop(.rcx);
+        try self.alu(.add, .rax, .rcx);
+        return elem_type;
+    }
+
+    fn fillArrayLiteral(self: *NativeGen, lit: ast.ArrayLiteral, t: ast.Type, offset: i32) NativeError!void {
+        const elem_type = t.array.elem.*;
+        const stride: i32 = @intCast(slotCount(elem_type) * 8);
+        for (lit.elements, 0..) |elem, i| {
+            const elem_offset = offset + stride * @as(i32, @intCast(i));
+            if (elem_type == .array) {
+                if (self.tree.tags[elem] == .array_literal) {
+                    try self.fillArrayLiteral(self.tree.node(elem).array_literal, elem_type, elem_offset);
+                } else {
+                    try self.genExpr(elem);
+                    try self.movRR(.rsi, .rax);
+                    try self.leaRbp(.rdi, elem_offset);
+                    try self.copyWords(slotCount(elem_type));
+                }
+                continue;
+            }
+            try self.genExpr(elem);
+            try self.normalize(elem_type);
+            try self.storeRbp(elem_offset, .rax);
+        }
+    }
+
+    // ── Locals ──────────────────────────────────────────────────
+
+    fn allocSlots(self: *NativeGen, slots: usize) i32 {
+        self.frame_size += slots * 8;
+        return -@as(i32, @intCast(self.frame_size));
+    }
+
+    /// Always allocates fresh slots, so a later loop or catch variable with
+    /// the same name simply replaces the earlier binding.
+    fn declareLocal(self: *NativeGen, name: []const u8, t: ast.Type, indirect: bool) NativeError!Local {
+        const local: Local = .{
+            .offset = self.allocSlots(if (indirect) 1 else slotCount(t)),
+            .type_info = t,
+            .indirect = indirect,
+        };
+        self.locals.put(name, local) catch return NativeError.OutOfMemory;
+        return local;
+    }
+
+    fn loadLocal(self: *NativeGen, local: Local) NativeError!void {
+        switch (local.type_info) {
+            .array => if (local.indirect) {
+                try self.loadRbp(.rax, local.offset);
+            } else {
+                try self.leaRbp(.rax, local.offset);
+            },
+            .slice => {
+                try self.loadRbp(.rax, local.offset);
+                try self.loadRbp(.rdx, local.offset + 8);
+            },
+            .error_union => {
+                try self.loadRbp(.rax, local.offset);
+                try self.loadRbp(.rdx, local.offset + 8);
+                try self.loadRbp(.rcx, local.offset + 16);
+            },
+            else => try self.loadRbp(.rax, local.offset),
+        }
+    }
+
+    fn storeLocal(self: *NativeGen, local: Local) NativeError!void {
+        switch (local.type_info) {
+            .array => {
+                try self.movRR(.rsi, .rax);
+                if (local.indirect) {
+                    try self.loadRbp(.rdi, local.offset);
+                } else {
+                    try self.leaRbp(.rdi, local.offset);
+                }
+                try self.copyWords(slotCount(local.type_info));
+            },
+            .slice => {
+                try self.storeRbp(local.offset, .rax);
+                try self.storeRbp(local.offset + 8, .rdx);
+            },
+            .error_union => {
+                try self.storeRbp(local.offset, .rax);
+                try self.storeRbp(local.offset + 8, .rdx);
+                try self.storeRbp(local.offset + 16, .rcx);
+            },
+            else => try self.storeRbp(local.offset, .rax),
+        }
+    }
+
+    /// Copies `words` qwords from [rsi] to [rdi].
+    fn copyWords(self: *NativeGen, words: usize) NativeError!void {
+        try self.movImm(.rcx, words);
+        try self.emit(&.{ 0xF3, 0x48, 0xA5 }); // rep movsq
+    }
+
+    /// Wraps rax to the width of `t`, mirroring C's conversion on store.
+    /// f32 values are rounded to single precision but kept as f64 bits.
+    fn normalize(self: *NativeGen, t: ast.Type) NativeError!void {
+        switch (t) {
+            .i8 => try self.emit(&.{ 0x48, 0x0F, 0xBE, 0xC0 }), // movsx rax, al
+            .i16 => try self.emit(&.{ 0x48, 0x0F, 0xBF, 0xC0 }), // movsx rax, ax
+            .i32 => try self.emit(&.{ 0x48, 0x63, 0xC0 }), // movsxd rax, eax
+            .u8 => try self.emit(&.{ 0x0F, 0xB6, 0xC0 }), // movzx eax, al
+            .u16 => try self.emit(&.{ 0x0F, 0xB7, 0xC0 }), // movzx eax, ax
+            .u32 => try self.emit(&.{ 0x89, 0xC0 }), // mov eax, eax
+            .f32 => {
+                try self.emit(&.{ 0x66, 0x48, 0x0F, 0x6E, 0xC0 }); // movq xmm0, rax
+                try self.emit(&.{ 0xF2, 0x0F, 0x5A, 0xC0 }); // cvtsd2ss xmm0, xmm0
+                try self.emit(&.{ 0xF3, 0x0F, 0x5A, 0xC0 }); // cvtss2sd xmm0, xmm0
+                try self.emit(&.{ 0x66, 0x48, 0x0F, 0x7E, 0xC0 }); // movq rax, xmm0
+            },
+            else => {},
+        }
+    }
+
+    // ── Types ───────────────────────────────────────────────────
+
+    fn exprType(self: *NativeGen, node: ast.Index) NativeError!ast.Type {
+        return switch (self.tree.node(node)) {
+            .int_literal => .i32,
+            .float_literal => .f64,
+            .string_literal => .str,
+            .bool_literal => .bool,
+            .variable => |v| (self.locals.get(v.name) orelse return NativeError.UnsupportedNode).type_info,
+            .binary_op => |bin| switch (bin.op) {
+                .add, .sub, .mul, .div, .mod => try self.operandType(bin),
+                else => .bool,
+            },
+            .unary_op => |un| switch (un.op) {
+                .negate => try self.exprType(un.operand),
+                .bool_not => .bool,
+            },
+            .call => |c| blk: {
+                if (std.mem.eql(u8, c.callee, "print")) break :blk .void;
+                if (std.mem.eql(u8, c.callee, "len")) break :blk .i32;
+                if (ast.SyncBuiltin.of(c.callee)) |builtin| break :blk switch (builtin) {
+                    .mutex => .mutex,
+                    .lock, .unlock, .atomic_store => .void,
+                    .atomic_cas => .bool,
+                    .atomic_load, .atomic_add => switch (try self.exprType(c.args[0])) {
+                        .atomic => |at| at.elem.*,
+                        else => return NativeError.UnsupportedNode,
+                    },
+                    .channel, .send, .receive => return NativeError.UnsupportedNode,
+                };
+                if (ast.AllocBuiltin.of(c.callee) != null) return NativeError.UnsupportedNode;
+                const f = self.functions.get(c.callee) orelse return NativeError.UnsupportedNode;
+                break :blk f.ret orelse .void;
+            },
+            .array_literal => |lit| blk: {
+                if (lit.elements.len == 0) return NativeError.UnsupportedNode;
+                const elem = self.arena.allocator().create(ast.Type) catch return NativeError.OutOfMemory;
+                elem.* = try self.exprType(lit.elements[0]);
+                break :blk .{ .array = .{ .len = lit.elements.len, .elem = elem } };
+            },
+            .index_expr => |ix| switch (try self.exprType(ix.target)) {
+                .array => |arr| arr.elem.*,
+                .slice => |s| s.elem.*,
+                else => return NativeError.UnsupportedNode,
+            },
+            .try_expr => |te| switch (try self.exprType(te.expr)) {
+                .error_union => |eu| eu.ok.*,
+                else => return NativeError.UnsupportedNode,
+            },
+            .spawn_expr => |se| try self.exprType(se.call),
+            .await_expr => |ae| try self.exprType(ae.expr),
+            else => return NativeError.UnsupportedNode,
+        };
+    }
+
+    /// Type both operands of an arithmetic or comparison op are computed in.
+    /// Literals adopt the other side's type; otherwise the wider side wins.
+    fn operandType(self: *NativeGen, bin: ast.BinaryOp) NativeError!ast.Type {
+        const lt = try self.exprType(bin.left);
+        const rt = try self.exprType(bin.right);
+        if (isLiteral(self.tree.tags[bin.left])) return rt;
+        if (isLiteral(self.tree.tags[bin.right])) return lt;
+        if (isFloat(rt) and !isFloat(lt)) return rt;
+        if (isInt64(rt) and !isInt64(lt)) return rt;
+        return lt;
+    }
+
+    // ── Runtime ─────────────────────────────────────────────────
+    // Each print routine takes its value in rax and writes one line to
+    // stdout with a single write(2).
+
+    fn emitRuntime(self: *NativeGen) NativeError!void {
+        const core = try self.newLabel();
+        const negative_done = try self.newLabel();
+
+        // print_int: rdi keeps the original value so its sign survives abs().
+        self.bind(self.rt.print_int);
+        try self.movRR(.rdi, .rax);
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ns, core);
+        try self.emit(&.{ 0x48, 0xF7, 0xD8 }); // neg rax
+        try self.jmp(core);
+
+        self.bind(self.rt.print_uint);
+        try self.zero(.rdi);
+
+        self.bind(core);
+        try self.emitBufferPrologue(64);
+        const digits = try self.newLabel();
+        self.bind(digits);
+        try self.emitDigit();
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, digits);
+        try self.emitSign(negative_done);
+        self.bind(negative_done);
+        try self.emitBufferWrite();
+
+        // print_float: printf's "%f", computed exactly from the bits in rax.
+        // The whole part is a little-endian array of 64-bit limbs at
+        // [rbp + float_limbs] that is divided by 10 in place, so even 1e308
+        // prints in full; the six decimals round the exact binary fraction
+        // half to even. The original bits wait at [rbp + float_bits] until
+        // the sign is written.
+        const float_bits = -520;
+        const float_limbs = -512;
+        self.bind(self.rt.print_float);
+        try self.emitBufferPrologue(528);
+        try self.storeRbp(float_bits, .rax);
+        try self.movRR(.rbx, .rax);
+        try self.emit(&.{ 0x48, 0xC1, 0xEB, 52 }); // shr rbx, 52
+        try self.emit(&.{ 0x81, 0xE3, 0xFF, 0x07, 0x00, 0x00 }); // and ebx, 0x7ff
+        try self.emit(&.{ 0x48, 0xC1, 0xE0, 12 }); // shl rax, 12
+        try self.emit(&.{ 0x48, 0xC1, 0xE8, 12 }); // shr rax, 12
+        const float_sign = try self.newLabel();
+        const finite = try self.newLabel();
+        const nan = try self.newLabel();
+        try self.emit(&.{ 0x81, 0xFB, 0xFF, 0x07, 0x00, 0x00 }); // cmp ebx, 0x7ff
+        try self.jcc(.ne, finite);
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, nan);
+        try self.emitPrependStr("inf");
+        try self.jmp(float_sign);
+        self.bind(nan);
+        try self.emitPrependStr("nan");
+        try self.jmp(float_sign);
+
+        // |v| = rax * 2^rbx; subnormals have no implicit bit and exponent 1.
+        self.bind(finite);
+        const normal = try self.newLabel();
+        const scaled = try self.newLabel();
+        try self.alu(.test_, .rbx, .rbx);
+        try self.jcc(.ne, normal);
+        try self.emit(&.{ 0x48, 0xFF, 0xC3 }); // inc rbx
+        try self.jmp(scaled);
+        self.bind(normal);
+        try self.emit(&.{ 0x48, 0x0F, 0xBA, 0xE8, 52 }); // bts rax, 52
+        self.bind(scaled);
+        try self.emit(&.{ 0x48, 0x81, 0xEB }); // sub rbx, 1075
+        try self.emitInt(u32, 1075);
+        const fraction = try self.newLabel();
+        const micros = try self.newLabel();
+        try self.jcc(.l, fraction);
+
+        // An integer: shift the mantissa into the zeroed limbs; rbx ends up
+        // as the index of the top limb and the decimals are all zero.
+        try self.zero(.rdx);
+        try self.movImm(.rcx, 17);
+        const clear = try self.newLabel();
+        self.bind(clear);
+        try self.storeIndexed(float_limbs - 8, .rcx, .rdx);
+        try self.emit(&.{ 0x48, 0xFF, 0xC9 }); // dec rcx
+        try self.jcc(.ne, clear);
+        try self.movRR(.rcx, .rbx);
+        try self.emit(&.{ 0x48, 0xC1, 0xEB, 6 }); // shr rbx, 6
+        try self.emit(&.{ 0x83, 0xE1, 63 }); // and ecx, 63
+        try self.emit(&.{ 0x48, 0x0F, 0xA5, 0xC2 }); // shld rdx, rax, cl
+        try self.emit(&.{ 0x48, 0xD3, 0xE0 }); // shl rax, cl
+        try self.storeIndexed(float_limbs, .rbx, .rax);
+        try self.storeIndexed(float_limbs + 8, .rbx, .rdx);
+        try self.emit(&.{ 0x48, 0xFF, 0xC3 }); // inc rbx
+        try self.zero(.rax);
+        try self.jmp(micros);
+
+        // A fraction: rbx = k = -exponent. The whole part (mantissa >> k)
+        // fits one limb; the rest, times 1e6, is shifted down by k - 1 in
+        // rdx:rax so the last bit out is the rounding bit and rbx collects
+        // the bits below it. Past k = 73 the product is below one half.
+        self.bind(fraction);
+        const wide = try self.newLabel();
+        const no_micros = try self.newLabel();
+        const rounded = try self.newLabel();
+        try self.emit(&.{ 0x48, 0xF7, 0xDB }); // neg rbx
+        try self.zero(.rdx);
+        try self.emit(&.{ 0x48, 0x83, 0xFB, 64 }); // cmp rbx, 64
+        try self.jcc(.ae, wide);
+        try self.emit(&.{ 0x89, 0xD9 }); // mov ecx, ebx
+        try self.movRR(.rdx, .rax);
+        try self.emit(&.{ 0x48, 0xD3, 0xEA }); // shr rdx, cl
+        try self.emit(&.{ 0xF7, 0xD9 }); // neg ecx
+        try self.emit(&.{ 0x48, 0xD3, 0xE0 }); // shl rax, cl
+        try self.emit(&.{ 0x48, 0xD3, 0xE8 }); // shr rax, cl
+        self.bind(wide);
+        try self.storeRbp(float_limbs, .rdx);
+        try self.emit(&.{ 0x48, 0x83, 0xFB, 73 }); // cmp rbx, 73
+        try self.jcc(.a, no_micros);
+        try self.movImm(.rcx, 1_000_000);
+        try self.emit(&.{ 0x48, 0xF7, 0xE1 }); // mul rcx
+        try self.emit(&.{ 0x8D, 0x4B, 0xFF }); // lea ecx, [rbx - 1]
+        try self.zero(.rbx);
+        const shift = try self.newLabel();
+        try self.emit(&.{ 0x83, 0xF9, 64 }); // cmp ecx, 64
+        try self.jcc(.b, shift);
+        try self.movRR(.rbx, .rax);
+        try self.movRR(.rax, .rdx);
+        try self.zero(.rdx);
+        try self.emit(&.{ 0x83, 0xE9, 64 }); // sub ecx, 64
+        self.bind(shift);
+        try self.movRR(.rdi, .rax);
+        try self.emit(&.{ 0x48, 0x0F, 0xAD, 0xD0 }); // shrd rax, rdx, cl
+        // The low cl bits of rdi: shifting by 63 - cl and then 1 clears
+        // them all when cl is 0.
+        try self.emit(&.{ 0xF7, 0xD1 }); // not ecx
+        try self.emit(&.{ 0x48, 0xD3, 0xE7 }); // shl rdi, cl
+        try self.emit(&.{ 0x48, 0xD1, 0xE7 }); // shl rdi, 1
+        try self.alu(.or_, .rbx, .rdi);
+        try self.movRR(.rdx, .rax);
+        try self.emit(&.{ 0x48, 0xD1, 0xE8 }); // shr rax, 1
+        const round_up = try self.newLabel();
+        try self.emit(&.{ 0xF6, 0xC2, 0x01 }); // test dl, 1
+        try self.jcc(.e, rounded);
+        try self.alu(.test_, .rbx, .rbx);
+        try self.jcc(.ne, round_up);
+        try self.emit(&.{ 0xA8, 0x01 }); // test al, 1
+        try self.jcc(.e, rounded);
+        self.bind(round_up);
+        try self.emit(&.{ 0x48, 0xFF, 0xC0 }); // inc rax
+        try self.emit(&.{ 0x48, 0x3D }); // cmp rax, 1000000
+        try self.emitInt(u32, 1_000_000);
+        try self.jcc(.ne, rounded);
+        try self.zero(.rax);
+        try self.emit(&.{ 0x48, 0xFF, 0x85 }); // inc qword [rbp + float_limbs]
+        try self.emitInt(i32, float_limbs);
+        try self.jmp(rounded);
+        self.bind(no_micros);
+        try self.zero(.rax);
+        self.bind(rounded);
+        try self.zero(.rbx);
+
+        // rax holds the decimals, rbx the top limb of the whole part.
+        self.bind(micros);
+        try self.movImm(.rcx, 10);
+        try self.movImm(.rdi, 6);
+        const frac = try self.newLabel();
+        self.bind(frac);
+        try self.emitDigit();
+        try self.emit(&.{ 0x48, 0xFF, 0xCF }); // dec rdi
+        try self.jcc(.ne, frac);
+        try self.emitPrepend('.');
+        const whole = try self.newLabel();
+        const limb = try self.newLabel();
+        const trim = try self.newLabel();
+        self.bind(whole);
+        try self.zero(.rdx);
+        try self.movRR(.rdi, .rbx);
+        self.bind(limb);
+        try self.loadIndexed(.rax, float_limbs, .rdi);
+        try self.emit(&.{ 0x48, 0xF7, 0xF1 }); // div rcx
+        try self.storeIndexed(float_limbs, .rdi, .rax);
+        try self.emit(&.{ 0x48, 0xFF, 0xCF }); // dec rdi
+        try self.jcc(.ns, limb);
+        try self.emit(&.{ 0x80, 0xC2, '0' }); // add dl, '0'
+        try self.emit(&.{ 0x48, 0xFF, 0xCE }); // dec rsi
+        try self.emit(&.{ 0x88, 0x16 }); // mov [rsi], dl
+        // Drop zero limbs from the top; stop once the whole part is 0.
+        self.bind(trim);
+        try self.loadIndexed(.rax, float_limbs, .rbx);
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, whole);
+        try self.alu(.test_, .rbx, .rbx);
+        try self.jcc(.e, float_sign);
+        try self.emit(&.{ 0x48, 0xFF, 0xCB }); // dec rbx
+        try self.jmp(trim);
+
+        self.bind(float_sign);
+        try self.loadRbp(.rdi, float_bits);
+        const float_sign_done = try self.newLabel();
+        try self.emitSign(float_sign_done);
+        self.bind(float_sign_done);
+        try self.emitBufferWrite();
+
+        // print_bool
+        self.bind(self.rt.print_bool);
+        const bool_write = try self.newLabel();
+        try self.alu(.test_, .rax, .rax);
+        try self.leaLabel(.rsi, self.rt.str_true);
+        try self.movImm(.rdx, 5);
+        try self.jcc(.ne, bool_write);
+        try self.leaLabel(.rsi, self.rt.str_false);
+        try self.movImm(.rdx, 6);
+        self.bind(bool_write);
+        try self.emitWrite();
+        try self.emit(&.{0xC3});
+
+        // print_str: strlen, write, then the newline. NULL prints "(null)".
+        self.bind(self.rt.print_str);
+        const non_null = try self.newLabel();
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, non_null);
+        try self.leaLabel(.rax, self.rt.str_null);
+        self.bind(non_null);
+        try self.movRR(.rsi, .rax);
+        try self.zero(.rdx);
+        const scan = try self.newLabel();
+        const scanned = try self.newLabel();
+        self.bind(scan);
+        try self.emit(&.{ 0x80, 0x3C, 0x16, 0x00 }); // cmp byte [rsi+rdx], 0
+        try self.jcc(.e, scanned);
+        try self.emit(&.{ 0x48, 0xFF, 0xC2 }); // inc rdx
+        try self.jmp(scan);
+        self.bind(scanned);
+        try self.emitWrite();
+        try self.leaLabel(.rsi, self.rt.str_newline);
+        try self.movImm(.rdx, 1);
+        try self.emitWrite();
+        try self.emit(&.{0xC3});
+
+        // index_fail: rax is the index and rcx the length. Writes the C
+        // runtime's message to stderr and exits with status 1.
+        self.bind(self.rt.index_fail);
+        try self.movRR(.rbx, .rax);
+        try self.movRR(.rax, .rcx);
+        try self.emitBufferPrologue(128);
+        const len_digits = try self.newLabel();
+        self.bind(len_digits);
+        try self.emitDigit();
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, len_digits);
+        try self.emitPrependStr(" out of range for length ");
+        try self.movRR(.rax, .rbx);
+        try self.movRR(.rdi, .rbx);
+        const index_positive = try self.newLabel();
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ns, index_positive);
+        try self.emit(&.{ 0x48, 0xF7, 0xD8 }); // neg rax
+        self.bind(index_positive);
+        const index_digits = try self.newLabel();
+        self.bind(index_digits);
+        try self.emitDigit();
+        try self.alu(.test_, .rax, .rax);
+        try self.jcc(.ne, index_digits);
+        const index_sign_done = try self.newLabel();
+        try self.emitSign(index_sign_done);
+        self.bind(index_sign_done);
+        try self.emitPrependStr("1im: index ");
+        try self.movRR(.rdx, .rbp);
+        try self.alu(.sub, .rdx, .rsi);
+        try self.movImm(.rax, 1); // write
+        try self.movImm(.rdi, 2);
+        try self.emit(&.{ 0x0F, 0x05 }); // syscall
+        try self.movImm(.rax, 60); // exit
+        try self.movImm(.rdi, 1);
+        try self.emit(&.{ 0x0F, 0x05 }); // syscall
+    }
+
+    /// Opens a frame of `size` bytes whose top byte holds '\n'; digits are
+    /// written backwards from rsi, dividing rax by rcx = 10.
+    fn emitBufferPrologue(self: *NativeGen, size: u32) NativeError!void {
+        try self.push(.rbp);
+        try self.movRR(.rbp, .rsp);
+        try self.emit(&.{ 0x48, 0x81, 0xEC }); // sub rsp, size
+        try self.emitInt(u32, size);
+        try self.leaRbp(.rsi, -1);
+        try self.emit(&.{ 0xC6, 0x06, '\n' }); // mov byte [rsi], '\n'
+        try self.movImm(.rcx, 10);
+    }
+
+    fn emitDigit(self: *NativeGen) NativeError!void {
+        try self.zero(.rdx);
+        try self.emit(&.{ 0x48, 0xF7, 0xF1 }); // div rcx
+        try self.emit(&.{ 0x80, 0xC2, '0' }); // add dl, '0'
+        try self.emit(&.{ 0x48, 0xFF, 0xCE }); // dec rsi
+        try self.emit(&.{ 0x88, 0x16 }); // mov [rsi], dl
+    }
+
+    /// Prepends '-' when rdi (the original value) is negative.
+    fn emitSign(self: *NativeGen, done: Label) NativeError!void {
+        try self.alu(.test_, .rdi, .rdi);
+        try self.jcc(.ns, done);
+        try self.emitPrepend('-');
+    }
+
+    fn emitPrepend(self: *NativeGen, c: u8) NativeError!void {
+        try self.emit(&.{ 0x48, 0xFF, 0xCE }); // dec rsi
+        try self.emit(&.{ 0xC6, 0x06, c }); // mov byte [rsi], c
+    }
+
+    fn emitPrependStr(self: *NativeGen, text: []const u8) NativeError!void {
+        var i = text.len;
+        while (i > 0) {
+            i -= 1;
+            try self.emitPrepend(text[i]);
+        }
+    }
+
+    /// Writes [rsi, rbp) to stdout and returns from the buffer frame.
+    fn emitBufferWrite(self: *NativeGen) NativeError!void {
+        try self.movRR(.rdx, .rbp);
+        try self.alu(.sub, .rdx, .rsi);
+        try self.emitWrite();
+        try self.emitEpilogue();
+    }
+
+    /// write(1, rsi, rdx)
+    fn emitWrite(self: *NativeGen) NativeError!void {
+        try self.movImm(.rax, 1);
+        try self.movImm(.rdi, 1);
+        try self.emit(&.{ 0x0F, 0x05 }); // syscall
+    }
+
+    // ── Data and linking ────────────────────────────────────────
+
+    fn internString(self: *NativeGen, raw: []const u8) NativeError!Label {
+        const arena = self.arena.allocator();
+        var bytes: std.ArrayList(u8) = .empty;
+        var i: usize = 0;
+        while (i < raw.len) : (i += 1) {
+            var c = raw[i];
+            if (c == '\\' and i + 1 < raw.len) {
+                i += 1;
+                c = switch (raw[i]) {
+                    'n' => '\n',
+                    't' => '\t',
+                    'r' => '\r',
+                    '0' => 0,
+                    else => raw[i],
+                };
+            }
+            bytes.append(arena, c) catch return NativeError.OutOfMemory;
+        }
+        bytes.append(arena, 0) catch return NativeError.OutOfMemory;
+        return self.internBytes(bytes.items);
+    }
+
+    fn internBytes(self: *NativeGen, bytes: []const u8) NativeError!Label {
+        const label = try self.newLabel();
+        self.strings.append(self.allocator, .{ .label = label, .bytes = bytes }) catch return NativeError.OutOfMemory;
+        return label;
+    }
+
+    fn newBss(self: *NativeGen, size: usize) NativeError!Label {
+        const label = try self.newLabel();
+        self.bss.append(self.allocator, .{ .label = label, .size = size }) catch return NativeError.OutOfMemory;
+        return label;
+    }
+
+    /// Appends string data after the code, places bss on the first page past
+    /// the file image, resolves rel32 fixups and wraps everything in an ELF.
+    fn link(self: *NativeGen) NativeError![]const u8 {
+        for (self.strings.items) |s| {
+            self.bind(s.label);
+            try self.emit(s.bytes);
+        }
+        while (self.code.items.len % 8 != 0) try self.emit(&.{0});
+
+        var bss_size: usize = 0;
+        for (self.bss.items) |b| bss_size += b.size;
+        const phnum: u16 = if (bss_size > 0) 2 else 1;
+        const code_offset: u64 = elf_header_size + @as(u64, phnum) * program_header_size;
+        const file_size: u64 = code_offset + self.code.items.len;
+        const bss_offset = std.mem.alignForward(u64, file_size, page_size);
+
+        // Labels are code offsets, so bss labels count from the code's start.
+        var bss_at: usize = @intCast(bss_offset - code_offset);
+        for (self.bss.items) |b| {
+            self.labels.items[b.label] = bss_at;
+            bss_at += b.size;
+        }
+
+        for (self.fixups.items) |f| {
+            const target = self.labels.items[f.label] orelse return NativeError.UnsupportedNode;
+            const rel: i32 = @intCast(@as(i64, @intCast(target)) - @as(i64, @intCast(f.at + 4)));
+            std.mem.writeInt(i32, self.code.items[f.at..][0..4], rel, .little);
+        }
+
+        // ELF header
+        self.image.appendSlice(self.allocator, &.{ 0x7F, 'E', 'L', 'F', 2, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0 }) catch return NativeError.OutOfMemory;
+        try self.put(u16, 2); // ET_EXEC
+        try self.put(u16, 0x3E); // EM_X86_64
+        try self.put(u32, 1);
+        try self.put(u64, base_addr + code_offset); // entry
+        try self.put(u64, elf_header_size); // phoff
+        try self.put(u64, 0); // shoff
+        try self.put(u32, 0); // flags
+        try self.put(u16, elf_header_size);
+        try self.put(u16, program_header_size);
+        try self.put(u16, phnum);
+        try self.put(u16, 0); // shentsize
+        try self.put(u16, 0); // shnum
+        try self.put(u16, 0); // shstrndx
+
+        // PT_LOAD for the headers, code and string data.
+        try self.put(u32, 1); // PT_LOAD
+        try self.put(u32, 5); // PF_R | PF_X
+        try self.put(u64, 0); // offset
+        try self.put(u64, base_addr); // vaddr
+        try self.put(u64, base_addr); // paddr
+        try self.put(u64, file_size);
+        try self.put(u64, file_size);
+        try self.put(u64, page_size);
+
+        // PT_LOAD for bss: nothing from the file, zeroed by the kernel.
+        if (bss_size > 0) {
+            try self.put(u32, 1); // PT_LOAD
+            try self.put(u32, 6); // PF_R | PF_W
+            try self.put(u64, 0); // offset
+            try self.put(u64, base_addr + bss_offset); // vaddr
+            try self.put(u64, base_addr + bss_offset); // paddr
+            try self.put(u64, 0);
+            try self.put(u64, bss_size);
+            try self.put(u64, page_size);
+        }
+
+        self.image.appendSlice(self.allocator, self.code.items) catch return NativeError.OutOfMemory;
+        return self.image.items;
+    }
+
+    fn put(self: *NativeGen, comptime T: type, value: T) NativeError!void {
+        var buf: [@sizeOf(T)]u8 = undefined;
+        std.mem.writeInt(T, &buf, value, .little);
+        self.image.appendSlice(self.allocator, &buf) catch return NativeError.OutOfMemory;
+    }
+
+    // ── Labels ──────────────────────────────────────────────────
+
+    fn newLabel(self: *NativeGen) NativeError!Label {
+        self.labels.append(self.allocator, null) catch return NativeError.OutOfMemory;
+        return self.labels.items.len - 1;
+    }
+
+    fn bind(self: *NativeGen, label: Label) void {
+        self.labels.items[label] = self.code.items.len;
+    }
+
+    fn emitRel32(self: *NativeGen, label: Label) NativeError!void {
+        self.fixups.append(self.allocator, .{ .at = self.code.items.len, .label = label }) catch return NativeError.OutOfMemory;
+        try self.emitInt(u32, 0);
+    }
+
+    // ── Instruction encoding ────────────────────────────────────
+    // Only rax..rdi are used, so no REX.R/REX.B bits are ever needed.
+
+    fn emit(self: *NativeGen, bytes: []const u8) NativeError!void {
+        self.code.appendSlice(self.allocator, bytes) catch return NativeError.OutOfMemory;
+    }
+
+    fn emitInt(self: *NativeGen, comptime T: type, value: T) NativeError!void {
+        var buf: [@sizeOf(T)]u8 = undefined;
+        std.mem.writeInt(T, &buf, value, .little);
+        try self.emit(&buf);
+    }
+
+    fn modrm(mod: u8, reg: u8, rm: u8) u8 {
+        return (mod << 6) | (reg << 3) | rm;
+    }
+
+    fn movRR(self: *NativeGen, dst: Reg, src: Reg) NativeError!void {
+        try self.emit(&.{ 0x48, 0x89, modrm(3, @intFromEnum(src), @intFromEnum(dst)) });
+    }
+
+    fn movImm(self: *NativeGen, dst: Reg, value: u64) NativeError!void {
+        if (value <= std.math.maxInt(u32)) {
+            try self.emit(&.{0xB8 + @intFromEnum(dst)}); // mov r32, imm32 (zero-extends)
+            try self.emitInt(u32, @intCast(value));
+        } else {
+            try self.emit(&.{ 0x48, 0xB8 + @intFromEnum(dst) });
+            try self.emitInt(u64, value);
+        }
+    }
+
+    fn zero(self: *NativeGen, reg: Reg) NativeError!void {
+        try self.emit(&.{ 0x31, modrm(3, @intFromEnum(reg), @intFromEnum(reg)) }); // xor r32, r32
+    }
+
+    fn alu(self: *NativeGen, op: Alu, dst: Reg, src: Reg) NativeError!void {
+        try self.emit(&.{ 0x48, @intFromEnum(op), modrm(3, @intFromEnum(src), @intFromEnum(dst)) });
+    }
+
+    fn loadRbp(self: *NativeGen, dst: Reg, disp: i32) NativeError!void {
+        try self.emit(&.{ 0x48, 0x8B, modrm(2, @intFromEnum(dst), @intFromEnum(Reg.rbp)) });
+        try self.emitInt(i32, disp);
+    }
+
+    fn storeRbp(self: *NativeGen, disp: i32, src: Reg) NativeError!void {
+        try self.emit(&.{ 0x48, 0x89, modrm(2, @intFromEnum(src), @intFromEnum(Reg.rbp)) });
+        try self.emitInt(i32, disp);
+    }
+
+    fn leaRbp(self: *NativeGen, dst: Reg, disp: i32) NativeError!void {
+        try self.emit(&.{ 0x48, 0x8D, modrm(2, @intFromEnum(dst), @intFromEnum(Reg.rbp)) });
+        try self.emitInt(i32, disp);
+    }
+
+    /// lea dst, [rip + label]
+    fn leaLabel(self: *NativeGen, dst: Reg, label: Label) NativeError!void {
+        try self.emit(&.{ 0x48, 0x8D, modrm(0, @intFromEnum(dst), 5) });
+        try self.emitRel32(label);
+    }
+
+    /// mov dst, [base] — base must not be rsp or rbp.
+    fn loadMem(self: *NativeGen, dst: Reg, base: Reg) NativeError!void {
+        try self.emit(&.{ 0x48, 0x8B, modrm(0, @intFromEnum(dst), @intFromEnum(base)) });
+    }
+
+    /// mov [base], src — base must not be rsp or rbp.
+    fn storeMem(self: *NativeGen, base: Reg, src: Reg) NativeError!void {
+        try self.emit(&.{ 0x48, 0x89, modrm(0, @intFromEnum(src), @intFromEnum(base)) });
+    }
+
+    /// mov dst, [rbp + index*8 + disp]
+    fn loadIndexed(self: *NativeGen, dst: Reg, disp: i32, index: Reg) NativeError!void {
+        try self.emit(&.{ 0x48, 0x8B, modrm(2, @intFromEnum(dst), 4), sib8(index) });
+        try self.emitInt(i32, disp);
+    }
+
+    /// mov [rbp + index*8 + disp], src
+    fn storeIndexed(self: *NativeGen, disp: i32, index: Reg, src: Reg) NativeError!void {
+        try self.emit(&.{ 0x48, 0x89, modrm(2, @intFromEnum(src), 4), sib8(index) });
+        try self.emitInt(i32, disp);
+    }
+
+    /// SIB byte for [rbp + index*8].
+    fn sib8(index: Reg) u8 {
+        return modrm(3, @intFromEnum(index), @intFromEnum(Reg.rbp));
+    }
+
+    fn push(self: *NativeGen, reg: Reg) NativeError!void {
+        try self.emit(&.{0x50 + @intFromEnum(reg)});
+    }
+
+    fn pop(self: *NativeGen, reg: Reg) NativeError!void {
+        try self.emit(&.{0x58 + @intFromEnum(reg)});
+    }
+
+    /// setcc al; movzx eax, al
+    fn setCond(self: *NativeGen, cond: Cond) NativeError!void {
+        try self.emit(&.{ 0x0F, 0x90 | @intFromEnum(cond), 0xC0 });
+        try self.emit(&.{ 0x0F, 0xB6, 0xC0 });
+    }
+
+    fn jmp(self: *NativeGen, label: Label) NativeError!void {
+        try self.emit(&.{0xE9});
+        try self.emitRel32(label);
+    }
+
+    fn jcc(self: *NativeGen, cond: Cond, label: Label) NativeError!void {
+        try self.emit(&.{ 0x0F, 0x80 | @intFromEnum(cond) });
+        try self.emitRel32(label);
+    }
+
+    fn call(self: *NativeGen, label: Label) NativeError!void {
+        try self.emit(&.{0xE8});
+        try self.emitRel32(label);
+    }
+};
+
+/// Stack slots occupied by a value of type `t`; array elements take one
+/// slot each regardless of their declared width.
+fn slotCount(t: ast.Type) usize {
+    return switch (t) {
+        .array => |arr| arr.len * slotCount(arr.elem.*),
+        .slice => 2,
+        .error_union => 3,
+        else => 1,
+    };
+}
+
+/// Words pushed for an argument; arrays are passed by address like in C.
+fn argWords(t: ast.Type) usize {
+    return switch (t) {
+        .array => 1,
+        else => slotCount(t),
+    };
+}
+
+fn valueMatchesType(value: ast.Tag, value_type: ast.Type, t: ast.Type) bool {
+    return switch (value) {
+        .int_literal => isInteger(t),
+        .float_literal => isFloat(t),
+        else => typeEquals(value_type, t),
+    };
+}
+
+fn isLiteral(tag: ast.Tag) bool {
+    return tag == .int_literal or tag == .float_literal;
+}
+
+fn isInteger(t: ast.Type) bool {
+    return switch (t) {
+        .i8, .i16, .i32, .i64, .u8, .u16, .u32, .u64 => true,
+        else => false,
+    };
+}
+
+fn isUnsigned(t: ast.Type) bool {
+    return switch (t) {
+        .u8, .u16, .u32, .u64 => true,
+        else => false,
+    };
+}
+
+fn isInt64(t: ast.Type) bool {
+    return t == .i64 or t == .u64;
+}
+
+fn isFloat(t: ast.Type) bool {
+    return t == .f32 or t == .f64;
+}
+
+fn typeEquals(a: ast.Type, b: ast.Type) bool {
+    return switch (a) {
+        .error_union => |eu| switch (b) {
+            .error_union => |beu| typeEquals(eu.ok.*, beu.ok.*) and typeEquals(eu.err.*, beu.err.*),
+            else => false,
+        },
+        .array => |arr| switch (b) {
+            .array => |barr| arr.len == barr.len and typeEquals(arr.elem.*, barr.elem.*),
+            else => false,
+        },
+        .slice => |s| switch (b) {
+            .slice => |bs| typeEquals(s.elem.*, bs.elem.*),
+            else => false,
+        },
+        .atomic => |at| switch (b) {
+            .atomic => |bat| typeEquals(at.elem.*, bat.elem.*),
+            else => false,
+        },
+        else => std.meta.eql(a, b),
+    };
+}
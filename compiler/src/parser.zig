@@ -1,60 +1,102 @@
 /// Recursive descent parser for 1im.
-/// Converts a token stream into an AST.
+/// Pulls tokens from the lexer one at a time and builds an AST.
 const std = @import("std");
-const Token = @import("token.zig").Token;
-const TokenType = @import("token.zig").TokenType;
+const token = @import("token.zig");
+const Token = token.Token;
+const TokenType = token.TokenType;
+const Lexer = @import("lexer.zig").Lexer;
+const LexerError = @import("lexer.zig").LexerError;
 const ast = @import("ast.zig");
 
 pub const ParseError = error{
     UnexpectedToken,
     UnexpectedEof,
     InvalidCallTarget,
-    OutOfMemory,
-};
+} || LexerError;
 
 pub const Parser = struct {
-    tokens: []const Token,
-    pos: usize,
+    lexer: Lexer,
+    /// Token under the cursor; `lexer` sits just past it.
+    tok: Token,
+    /// Offset the lexer failed at, reported instead of `tok` on lexer errors.
+    lex_error_at: ?usize,
+    source: []const u8,
     allocator: std.mem.Allocator,
-
-    pub fn init(allocator: std.mem.Allocator, tokens: []const Token) Parser {
+    tags: std.ArrayList(ast.Tag),
+    data: std.ArrayList(ast.Data),
+    extra: std.ArrayList(u32),
+    types: std.ArrayList(ast.Type),
+    params: std.ArrayList(ast.Param),
+    reductions: std.ArrayList(ast.Reduction),
+    /// Child indices of the lists being parsed; each list pushes its items
+    /// here and moves them into `extra` once complete.
+    scratch: std.ArrayList(ast.Index),
+
+    /// Node names point into `source`, which must outlive the tree.
+    pub fn init(allocator: std.mem.Allocator, source: []const u8) Parser {
         return .{
-            .tokens = tokens,
-            .pos = 0,
+            .lexer = Lexer.init(source),
+            .tok = .{ .tag = .eof, .start = 0 },
+            .lex_error_at = null,
+            .source = source,
             .allocator = allocator,
+            .tags = .empty,
+            .data = .empty,
+            .extra = .empty,
+            .types = .empty,
+            .params = .empty,
+            .reductions = .empty,
+            .scratch = .empty,
         };
     }
 
     // ── Public API ──────────────────────────────────────────────
 
-    pub fn parse(self: *Parser) ParseError!ast.Node {
-        var stmts: std.ArrayList(ast.Node) = .empty;
+    pub fn parse(self: *Parser) ParseError!ast.Tree {
+        const top = self.scratch.items.len;
+        try self.advance();
 
         while (self.current().tag != .eof) {
-            self.skipNewlines();
+            try self.skipNewlines();
             if (self.current().tag == .eof) break;
 
-            const stmt = try self.parseStmt();
-            stmts.append(self.allocator, stmt) catch return ParseError.OutOfMemory;
+            const stmt = if (self.current().tag == .kw_import) try self.parseImport() else try self.parseStmt();
+            try self.pushScratch(stmt);
         }
 
-        return .{ .program = .{
-            .stmts = stmts.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
-        } };
-    }
+        const stmts = try self.popScratch(top);
+        const root = try self.addNode(.program, stmts.start, stmts.end);
 
-    /// Report current position for error messages.
-    pub fn currentLine(self: *const Parser) usize {
-        return self.current().line;
+        return .{
+            .tags = self.tags.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
+            .data = self.data.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
+            .extra = self.extra.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
+            .types = self.types.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
+            .params = self.params.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
+            .reductions = self.reductions.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
+            .source = self.source,
+            .root = root,
+        };
     }
 
-    pub fn currentCol(self: *const Parser) usize {
-        return self.current().col;
+    /// Report current position for error messages.
+    pub fn errorLocation(self: *const Parser) token.Location {
+        return token.location(self.source, self.lex_error_at orelse self.tok.start);
     }
 
     // ── Statements ──────────────────────────────────────────────
 
-    fn parseStmt(self: *Parser) ParseError!ast.Node {
+    /// `import NAME`; only allowed at the top level.
+    fn parseImport(self: *Parser) ParseError!ast.Index {
+        try self.expect(.kw_import);
+        const name_tok = self.current();
+        if (name_tok.tag != .name) return ParseError.UnexpectedToken;
+        const name = self.lexeme(name_tok);
+        try self.advance();
+        return self.addNode(.import_decl, self.offsetOf(name), @intCast(name.len));
+    }
+
+    fn parseStmt(self: *Parser) ParseError!ast.Index {
         switch (self.current().tag) {
             .kw_parallel => return self.parseParallel(),
             .kw_set => return self.parseSetOrFunction(),
@@ -65,10 +107,26 @@ pub const Parser = struct {
             .kw_break => return self.parseBreak(),
             .kw_continue => return self.parseContinue(),
             .kw_try => {
-                const saved = self.pos;
+                const saved_lexer = self.lexer;
+                const saved_tok = self.tok;
+                const saved_nodes = self.tags.items.len;
+                const saved_extra = self.extra.items.len;
+                const saved_types = self.types.items.len;
+                const saved_params = self.params.items.len;
+                const saved_reductions = self.reductions.items.len;
+                const saved_scratch = self.scratch.items.len;
                 return self.parseTryCatch() catch |err| {
                     if (err == ParseError.UnexpectedToken) {
-                        self.pos = saved;
+                        // Drop whatever the failed attempt appended.
+                        self.lexer = saved_lexer;
+                        self.tok = saved_tok;
+                        self.tags.shrinkRetainingCapacity(saved_nodes);
+                        self.data.shrinkRetainingCapacity(saved_nodes);
+                        self.extra.shrinkRetainingCapacity(saved_extra);
+                        self.types.shrinkRetainingCapacity(saved_types);
+                        self.params.shrinkRetainingCapacity(saved_params);
+                        self.reductions.shrinkRetainingCapacity(saved_reductions);
+                        self.scratch.shrinkRetainingCapacity(saved_scratch);
                         return self.parseExprStmt();
                     }
                     return err;
@@ -79,35 +137,28 @@ pub const Parser = struct {
     }
 
     /// Parse `set` statement - could be variable assignment or function definition
-    fn parseSetOrFunction(self: *Parser) ParseError!ast.Node {
+    fn parseSetOrFunction(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_set); // consume 'set'
 
+        if (self.current().tag == .lparen) return self.parseParallelAssign();
+
         const name_tok = self.current();
         if (name_tok.tag != .name) return ParseError.UnexpectedToken;
-        const var_name = name_tok.lexeme;
-        self.pos += 1;
+        const var_name = self.lexeme(name_tok);
+        try self.advance();
 
         if (self.current().tag == .lbracket) {
-            var target: ast.Node = .{ .variable = .{ .name = var_name } };
+            var target = try self.addNode(.variable, self.offsetOf(var_name), @intCast(var_name.len));
             while (self.current().tag == .lbracket) {
-                self.pos += 1; // consume '['
+                try self.advance(); // consume '['
                 const index_expr = try self.parseExpr();
                 try self.expect(.rbracket);
-                const target_ptr = try self.allocNode(target);
-                const index_ptr = try self.allocNode(index_expr);
-                target = .{ .index_expr = .{
-                    .target = target_ptr,
-                    .index = index_ptr,
-                } };
+                target = try self.addNode(.index_expr, target, index_expr);
             }
 
             try self.expect(.kw_to);
-            const value_ptr = try self.allocNode(try self.parseExpr());
-            const target_ptr = try self.allocNode(target);
-            return .{ .index_assign = .{
-                .target = target_ptr,
-                .value = value_ptr,
-            } };
+            const value = try self.parseExpr();
+            return self.addNode(.index_assign, target, value);
         }
 
         // Check if it's a function: `set name with...`, `set name returns ...`, or `set name as fn`
@@ -125,94 +176,131 @@ pub const Parser = struct {
         // Regular assignment: `set name to value`
         try self.expect(.kw_to);
 
-        const value_ptr = try self.allocNode(try self.parseExpr());
+        const value = if (self.current().tag == .kw_spawn) try self.parseSpawn() else try self.parseExpr();
+        const name = try self.addExtra(&.{ self.offsetOf(var_name), @intCast(var_name.len) });
+        return self.addNode(.set_assign, value, name);
+    }
+
+    /// `(a, b) to parallel f(x), g(y)`, after `set`.
+    fn parseParallelAssign(self: *Parser) ParseError!ast.Index {
+        try self.expect(.lparen);
+        const top = self.scratch.items.len;
+        while (true) {
+            const name_tok = self.current();
+            if (name_tok.tag != .name) return ParseError.UnexpectedToken;
+            const name = self.lexeme(name_tok);
+            try self.pushScratch(try self.addNode(.variable, self.offsetOf(name), @intCast(name.len)));
+            try self.advance();
+            if (self.current().tag != .comma) break;
+            try self.advance();
+        }
+        try self.expect(.rparen);
+        const targets = try self.popScratch(top);
 
-        return .{ .set_assign = .{
-            .name = var_name,
-            .value = value_ptr,
-        } };
+        try self.expect(.kw_to);
+        try self.expect(.kw_parallel);
+        while (true) {
+            const call = try self.parseExpr();
+            if (self.tags.items[call] != .call) return ParseError.UnexpectedToken;
+            try self.pushScratch(call);
+            if (self.current().tag != .comma) break;
+            try self.advance();
+        }
+        const calls = try self.popScratch(top);
+
+        const info = try self.addExtra(&.{ targets.start, targets.end, calls.start, calls.end });
+        return self.addNode(.parallel_assign, info, 0);
     }
 
-    fn parseTypedAssign(self: *Parser, name: []const u8) ParseError!ast.Node {
+    /// `spawn f(x)`, after `set name to`.
+    fn parseSpawn(self: *Parser) ParseError!ast.Index {
+        try self.expect(.kw_spawn);
+        const call = try self.parseExpr();
+        if (self.tags.items[call] != .call) return ParseError.UnexpectedToken;
+        return self.addNode(.spawn_expr, call, 0);
+    }
+
+    fn parseTypedAssign(self: *Parser, name: []const u8) ParseError!ast.Index {
         try self.expect(.kw_as);
-        const type_info = try self.parseType();
+        const type_info = try self.addType(try self.parseType());
         try self.expect(.kw_to);
 
-        const value_ptr = try self.allocNode(try self.parseExpr());
-
-        return .{ .typed_assign = .{
-            .name = name,
-            .type_info = type_info,
-            .value = value_ptr,
-        } };
+        const value = try self.parseExpr();
+        const info = try self.addExtra(&.{ self.offsetOf(name), @intCast(name.len), type_info });
+        return self.addNode(.typed_assign, value, info);
     }
 
-    fn parseFunDef(self: *Parser) ParseError!ast.Node {
+    fn parseFunDef(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_fun);
         const name_tok = self.current();
         if (name_tok.tag != .name) return ParseError.UnexpectedToken;
-        const name = name_tok.lexeme;
-        self.pos += 1;
+        const name = self.lexeme(name_tok);
+        try self.advance();
         return self.parseFunctionDefAfterName(name);
     }
 
-    fn parseFunctionDef(self: *Parser, name: []const u8) ParseError!ast.Node {
+    fn parseFunctionDef(self: *Parser, name: []const u8) ParseError!ast.Index {
         return self.parseFunctionDefAfterName(name);
     }
 
-    fn parseFunctionDefAfterName(self: *Parser, name: []const u8) ParseError!ast.Node {
-        var params: std.ArrayList(ast.Param) = .empty;
-        var return_type: ?ast.Type = null;
+    fn parseFunctionDefAfterName(self: *Parser, name: []const u8) ParseError!ast.Index {
+        const params_start: u32 = @intCast(self.params.items.len);
+        var return_type: u32 = ast.none;
 
         // Parse parameters if present: `with param1 as type1, param2 as type2`
         if (self.current().tag == .kw_with) {
-            self.pos += 1;
+            try self.advance();
 
             while (true) {
                 const param_name_tok = self.current();
                 if (param_name_tok.tag != .name) return ParseError.UnexpectedToken;
-                self.pos += 1;
+                try self.advance();
 
                 var param_type: ast.Type = .i32;
                 if (self.current().tag == .kw_as) {
-                    self.pos += 1;
+                    try self.advance();
                     param_type = try self.parseType();
                 }
 
-                params.append(self.allocator, .{
-                    .name = param_name_tok.lexeme,
+                self.params.append(self.allocator, .{
+                    .name = self.lexeme(param_name_tok),
                     .type_info = param_type,
                 }) catch return ParseError.OutOfMemory;
 
                 if (self.current().tag != .comma) break;
-                self.pos += 1; // consume comma
+                try self.advance(); // consume comma
             }
         }
+        const params_end: u32 = @intCast(self.params.items.len);
 
         // Parse return type if present: `returns type`
         if (self.current().tag == .kw_returns) {
-            self.pos += 1;
-            return_type = try self.parseType();
+            try self.advance();
+            return_type = try self.addType(try self.parseType());
         }
 
         // Parse function body (must be on next line, indented)
-        self.skipNewlines();
+        try self.skipNewlines();
 
         const body = try self.parseIndentedBlock(&.{});
 
-        return .{ .function_def = .{
-            .name = name,
-            .params = params.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
-            .return_type = return_type,
-            .body = body,
-        } };
+        const info = try self.addExtra(&.{
+            self.offsetOf(name),
+            @intCast(name.len),
+            params_start,
+            params_end,
+            return_type,
+            body.start,
+            body.end,
+        });
+        return self.addNode(.function_def, info, 0);
     }
 
     fn parseType(self: *Parser) ParseError!ast.Type {
         var base = try self.parseTypePrimary();
 
         if (self.current().tag == .bang) {
-            self.pos += 1;
+            try self.advance();
             const err_type = try self.parseType();
             const ok_ptr = try self.allocType(base);
             const err_ptr = try self.allocType(err_type);
@@ -224,11 +312,11 @@ pub const Parser = struct {
 
     fn parseTypePrimary(self: *Parser) ParseError!ast.Type {
         const tok = self.current();
-        self.pos += 1;
+        try self.advance();
 
         if (tok.tag == .lbracket) {
             if (self.current().tag == .rbracket) {
-                self.pos += 1;
+                try self.advance();
                 const elem = try self.parseType();
                 const elem_ptr = try self.allocType(elem);
                 return .{ .slice = .{ .elem = elem_ptr } };
@@ -236,15 +324,31 @@ pub const Parser = struct {
 
             if (self.current().tag != .int_literal) return ParseError.UnexpectedToken;
             const len_tok = self.current();
-            self.pos += 1;
+            try self.advance();
             try self.expect(.rbracket);
 
-            const len = std.fmt.parseInt(usize, len_tok.lexeme, 10) catch return ParseError.UnexpectedToken;
+            const len = std.fmt.parseInt(usize, self.lexeme(len_tok), 10) catch return ParseError.UnexpectedToken;
             const elem = try self.parseType();
             const elem_ptr = try self.allocType(elem);
             return .{ .array = .{ .len = len, .elem = elem_ptr } };
         }
 
+        // `atomic`, `mutex`, `channel` and `arena` are only type names here,
+        // so programs may still use them as variable names.
+        if (tok.tag == .name) {
+            const name = self.lexeme(tok);
+            if (std.mem.eql(u8, name, "atomic")) {
+                const elem = try self.parseTypePrimary();
+                return .{ .atomic = .{ .elem = try self.allocType(elem) } };
+            }
+            if (std.mem.eql(u8, name, "mutex")) return .mutex;
+            if (std.mem.eql(u8, name, "arena")) return .arena;
+            if (std.mem.eql(u8, name, "channel")) {
+                const elem = try self.parseTypePrimary();
+                return .{ .channel = .{ .elem = try self.allocType(elem) } };
+            }
+        }
+
         return switch (tok.tag) {
             .kw_i8 => .i8,
             .kw_i16 => .i16,
@@ -263,68 +367,68 @@ pub const Parser = struct {
         };
     }
 
-    fn parseReturn(self: *Parser) ParseError!ast.Node {
+    fn parseReturn(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_return);
 
         // Check if there's a return value
         if (self.current().tag == .newline or self.current().tag == .eof) {
-            return .{ .return_stmt = .{ .value = null } };
+            return self.addNode(.return_stmt, ast.none, 0);
         }
 
-        const value_ptr = try self.allocNode(try self.parseExpr());
-
-        return .{ .return_stmt = .{ .value = value_ptr } };
+        const value = try self.parseExpr();
+        return self.addNode(.return_stmt, value, 0);
     }
 
-    fn parseIf(self: *Parser) ParseError!ast.Node {
+    fn parseIf(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_if);
 
-        const cond_ptr = try self.allocNode(try self.parseExpr());
+        const cond = try self.parseExpr();
 
         try self.expect(.kw_then);
-        self.skipNewlines();
+        try self.skipNewlines();
 
         const then_body = try self.parseIndentedBlock(&.{.kw_else});
 
         // Parse else if / else
-        var else_ifs: std.ArrayList(ast.ElseIf) = .empty;
-        var else_body: ?[]const ast.Node = null;
+        const top = self.scratch.items.len;
+        var else_body: ?Span = null;
 
         while (self.current().tag == .kw_else) {
-            self.pos += 1; // consume 'else'
+            try self.advance(); // consume 'else'
 
             if (self.current().tag == .kw_if) {
                 // else if
-                self.pos += 1; // consume 'if'
+                try self.advance(); // consume 'if'
 
-                const elif_cond_ptr = try self.allocNode(try self.parseExpr());
+                const elif_cond = try self.parseExpr();
 
                 try self.expect(.kw_then);
-                self.skipNewlines();
+                try self.skipNewlines();
 
                 const elif_body = try self.parseIndentedBlock(&.{.kw_else});
-
-                else_ifs.append(self.allocator, .{
-                    .condition = elif_cond_ptr,
-                    .body = elif_body,
-                }) catch return ParseError.OutOfMemory;
+                const body = try self.addExtra(&.{ elif_body.start, elif_body.end });
+                try self.pushScratch(try self.addNode(.else_if, elif_cond, body));
             } else {
                 // else
-                self.skipNewlines();
+                try self.skipNewlines();
                 else_body = try self.parseIndentedBlock(&.{});
                 break;
             }
         }
 
-        return .{ .if_stmt = .{
-            .condition = cond_ptr,
-            .then_body = then_body,
-            .else_ifs = else_ifs.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
-            .else_body = else_body,
-        } };
+        const else_ifs = try self.popScratch(top);
+        const info = try self.addExtra(&.{
+            then_body.start,
+            then_body.end,
+            else_ifs.start,
+            else_ifs.end,
+            if (else_body) |eb| eb.start else ast.none,
+            if (else_body) |eb| eb.end else ast.none,
+        });
+        return self.addNode(.if_stmt, cond, info);
     }
 
-    fn parseLoop(self: *Parser) ParseError!ast.Node {
+    fn parseLoop(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_loop);
 
         // Check for while or for
@@ -340,50 +444,122 @@ pub const Parser = struct {
         return ParseError.UnexpectedToken;
     }
 
-    fn parseWhileLoop(self: *Parser, parallel: bool) ParseError!ast.Node {
+    fn parseWhileLoop(self: *Parser, parallel: bool) ParseError!ast.Index {
         try self.expect(.kw_while);
 
-        const cond_ptr = try self.allocNode(try self.parseExpr());
+        const cond = try self.parseExpr();
 
-        self.skipNewlines();
+        try self.skipNewlines();
 
         const body = try self.parseIndentedBlock(&.{});
 
-        return .{ .while_loop = .{
-            .condition = cond_ptr,
-            .body = body,
-            .parallel = parallel,
-        } };
+        const info = try self.addExtra(&.{ body.start, body.end, @intFromBool(parallel) });
+        return self.addNode(.while_loop, cond, info);
     }
 
-    fn parseForLoop(self: *Parser, parallel: bool) ParseError!ast.Node {
+    fn parseForLoop(self: *Parser, parallel: bool) ParseError!ast.Index {
         try self.expect(.kw_for);
 
         const var_tok = self.current();
         if (var_tok.tag != .name) return ParseError.UnexpectedToken;
-        self.pos += 1;
+        try self.advance();
 
         try self.expect(.kw_in);
 
-        const iter_ptr = try self.allocNode(try self.parseExpr());
+        const iter = try self.parseExpr();
+
+        var schedule: ast.ForLoop.Schedule = .static;
+        var grain: ast.Index = ast.none;
+        if (parallel and self.current().tag == .kw_with) {
+            try self.advance();
+            const clause = self.current();
+            if (clause.tag != .name) return ParseError.UnexpectedToken;
+            schedule = std.meta.stringToEnum(ast.ForLoop.Schedule, self.lexeme(clause)) orelse return ParseError.UnexpectedToken;
+            try self.advance();
+            if (self.current().tag != .newline and self.current().tag != .eof and !self.atReduce()) {
+                grain = try self.parseExpr();
+            }
+        }
+
+        const reductions_start: u32 = @intCast(self.reductions.items.len);
+        if (parallel and self.atReduce()) {
+            try self.advance();
+            while (true) {
+                try self.parseReduction();
+                if (self.current().tag != .comma) break;
+                try self.advance();
+            }
+        }
+        const reductions_end: u32 = @intCast(self.reductions.items.len);
 
-        self.skipNewlines();
+        try self.skipNewlines();
 
         const body = try self.parseIndentedBlock(&.{});
 
-        return .{ .for_loop = .{
-            .variable = var_tok.lexeme,
-            .iterable = iter_ptr,
-            .body = body,
-            .parallel = parallel,
-        } };
+        const var_name = self.lexeme(var_tok);
+        const info = try self.addExtra(&.{
+            self.offsetOf(var_name),
+            @intCast(var_name.len),
+            body.start,
+            body.end,
+            @intFromBool(parallel),
+            @intFromEnum(schedule),
+            grain,
+            reductions_start,
+            reductions_end,
+        });
+        return self.addNode(.for_loop, iter, info);
     }
 
-    fn parseParallel(self: *Parser) ParseError!ast.Node {
+    /// `reduce` is only a keyword after a parallel loop's iterable.
+    fn atReduce(self: *const Parser) bool {
+        const tok = self.current();
+        return tok.tag == .name and std.mem.eql(u8, self.lexeme(tok), "reduce");
+    }
+
+    /// `sum total`, `min best`, ... or `combine acc from <identity>`.
+    fn parseReduction(self: *Parser) ParseError!void {
+        const op_tok = self.current();
+        if (op_tok.tag != .name) return ParseError.UnexpectedToken;
+        try self.advance();
+        const name_tok = self.current();
+        if (name_tok.tag != .name) return ParseError.UnexpectedToken;
+        try self.advance();
+
+        var reduction: ast.Reduction = .{
+            .op = .custom,
+            .name = self.lexeme(name_tok),
+            .combiner = "",
+            .identity = null,
+        };
+        const op_name = self.lexeme(op_tok);
+        if (std.meta.stringToEnum(ast.Reduction.Op, op_name)) |op| {
+            if (op == .custom) return ParseError.UnexpectedToken;
+            reduction.op = op;
+        } else {
+            reduction.combiner = op_name;
+            try self.expect(.kw_from);
+            reduction.identity = try self.parseExpr();
+        }
+        self.reductions.append(self.allocator, reduction) catch return ParseError.OutOfMemory;
+    }
+
+    fn parseParallel(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_parallel);
 
+        // `parallel affinity <mode>`; the analyzer keeps it to the top level.
+        const next = self.current();
+        if (next.tag == .name and std.mem.eql(u8, self.lexeme(next), "affinity")) {
+            try self.advance();
+            const mode = self.current();
+            if (mode.tag != .name) return ParseError.UnexpectedToken;
+            const affinity = std.meta.stringToEnum(ast.AffinityDecl.Affinity, self.lexeme(mode)) orelse return ParseError.UnexpectedToken;
+            try self.advance();
+            return self.addNode(.affinity_decl, @intFromEnum(affinity), 0);
+        }
+
         if (self.current().tag == .kw_loop) {
-            self.pos += 1;
+            try self.advance();
             if (self.current().tag == .kw_while) {
                 return self.parseWhileLoop(true);
             }
@@ -393,86 +569,85 @@ pub const Parser = struct {
             return ParseError.UnexpectedToken;
         }
 
-        self.skipNewlines();
+        try self.skipNewlines();
         const body = try self.parseIndentedBlock(&.{});
-        return .{ .parallel_block = .{ .body = body } };
+        return self.addNode(.parallel_block, body.start, body.end);
     }
 
-    fn parseBreak(self: *Parser) ParseError!ast.Node {
+    fn parseBreak(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_break);
 
         // Check if there's a break value
         if (self.current().tag == .newline or self.current().tag == .eof) {
-            return .{ .break_stmt = .{ .value = null } };
+            return self.addNode(.break_stmt, ast.none, 0);
         }
 
-        const value_ptr = try self.allocNode(try self.parseExpr());
-
-        return .{ .break_stmt = .{ .value = value_ptr } };
+        const value = try self.parseExpr();
+        return self.addNode(.break_stmt, value, 0);
     }
 
-    fn parseContinue(self: *Parser) ParseError!ast.Node {
+    fn parseContinue(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_continue);
-        return .{ .continue_stmt = .{} };
+        return self.addNode(.continue_stmt, 0, 0);
     }
 
-    fn parseTryCatch(self: *Parser) ParseError!ast.Node {
+    fn parseTryCatch(self: *Parser) ParseError!ast.Index {
         try self.expect(.kw_try);
 
-        const try_ptr = try self.allocNode(try self.parseExpr());
+        const try_expr = try self.parseExpr();
 
         try self.expect(.kw_catch);
 
-        var catch_var: ?[]const u8 = null;
+        var catch_off: u32 = ast.none;
+        var catch_len: u32 = 0;
         if (self.current().tag == .name) {
-            catch_var = self.current().lexeme;
-            self.pos += 1;
+            const catch_name = self.lexeme(self.current());
+            catch_off = self.offsetOf(catch_name);
+            catch_len = @intCast(catch_name.len);
+            try self.advance();
         }
 
-        self.skipNewlines();
+        try self.skipNewlines();
 
         const catch_body = try self.parseIndentedBlock(&.{});
 
-        return .{ .try_catch = .{
-            .try_expr = try_ptr,
-            .catch_var = catch_var,
-            .catch_body = catch_body,
-        } };
+        const info = try self.addExtra(&.{ catch_off, catch_len, catch_body.start, catch_body.end });
+        return self.addNode(.try_catch, try_expr, info);
     }
 
-    fn parseExprStmt(self: *Parser) ParseError!ast.Node {
-        const expr_ptr = try self.allocNode(try self.parseExpr());
-        return .{ .expr_stmt = .{ .expr = expr_ptr } };
+    fn parseExprStmt(self: *Parser) ParseError!ast.Index {
+        const expr = try self.parseExpr();
+        return self.addNode(.expr_stmt, expr, 0);
     }
 
     // ── Expressions ─────────────────────────────────────────────
     // Precedence climbing: or < and < comparison < add < mul < unary < postfix < primary
 
-    fn parseExpr(self: *Parser) ParseError!ast.Node {
+    fn parseExpr(self: *Parser) ParseError!ast.Index {
         return self.parseOr();
     }
 
-    fn parseOr(self: *Parser) ParseError!ast.Node {
+    fn parseOr(self: *Parser) ParseError!ast.Index {
         var left = try self.parseAnd();
         while (self.current().tag == .kw_or) {
-            self.pos += 1;
+            try self.advance();
             const right = try self.parseAnd();
             left = try self.makeBinary(.bool_or, left, right);
         }
         return left;
     }
 
-    fn parseAnd(self: *Parser) ParseError!ast.Node {
+    fn parseAnd(self: *Parser) ParseError!ast.Index {
         var left = try self.parseComparison();
         while (self.current().tag == .kw_and) {
-            self.pos += 1;
+            try self.advance();
             const right = try self.parseComparison();
             left = try self.makeBinary(.bool_and, left, right);
         }
         return left;
     }
 
-    fn parseComparison(self: *Parser) ParseError!ast.Node {
+    fn parseComparison(self: *Parser) ParseError!ast.Index {
         var left = try self.parseRange();
         const cmp_op: ?ast.BinaryOp.Op = switch (self.current().tag) {
             .eq_eq => .eq,
@@ -484,45 +659,38 @@ pub const Parser = struct {
             else => null,
         };
         if (cmp_op) |op| {
-            self.pos += 1;
+            try self.advance();
             const right = try self.parseRange();
             left = try self.makeBinary(op, left, right);
         }
         return left;
     }
 
-    fn parseRange(self: *Parser) ParseError!ast.Node {
+    fn parseRange(self: *Parser) ParseError!ast.Index {
         const left = try self.parseAdd();
 
         const is_range = self.current().tag == .dot_dot or self.current().tag == .dot_dot_eq;
         if (!is_range) return left;
 
         const inclusive = self.current().tag == .dot_dot_eq;
-        self.pos += 1;
+        try self.advance();
 
         const right = try self.parseAdd();
-        const left_ptr = try self.allocNode(left);
-        const right_ptr = try self.allocNode(right);
-
-        return .{ .range = .{
-            .start = left_ptr,
-            .end = right_ptr,
-            .inclusive = inclusive,
-        } };
+        return self.addNode(if (inclusive) .range_inclusive else .range, left, right);
     }
 
-    fn parseAdd(self: *Parser) ParseError!ast.Node {
+    fn parseAdd(self: *Parser) ParseError!ast.Index {
         var left = try self.parseMul();
         while (self.current().tag == .plus or self.current().tag == .minus) {
             const op: ast.BinaryOp.Op = if (self.current().tag == .plus) .add else .sub;
-            self.pos += 1;
+            try self.advance();
             const right = try self.parseMul();
             left = try self.makeBinary(op, left, right);
         }
         return left;
     }
 
-    fn parseMul(self: *Parser) ParseError!ast.Node {
+    fn parseMul(self: *Parser) ParseError!ast.Index {
         var left = try self.parseUnary();
         while (self.current().tag == .star or self.current().tag == .slash or self.current().tag == .percent) {
             const op: ast.BinaryOp.Op = switch (self.current().tag) {
@@ -531,73 +699,72 @@ pub const Parser = struct {
                 .percent => .mod,
                 else => unreachable,
             };
-            self.pos += 1;
+            try self.advance();
             const right = try self.parseUnary();
             left = try self.makeBinary(op, left, right);
         }
         return left;
     }
 
-    fn parseUnary(self: *Parser) ParseError!ast.Node {
+    fn parseUnary(self: *Parser) ParseError!ast.Index {
         if (self.current().tag == .minus) {
-            self.pos += 1;
-            const operand_ptr = try self.allocNode(try self.parseUnary());
-            return .{ .unary_op = .{ .op = .negate, .operand = operand_ptr } };
+            try self.advance();
+            const operand = try self.parseUnary();
+            return self.addNode(.negate, operand, 0);
         }
         if (self.current().tag == .kw_not) {
-            self.pos += 1;
-            const operand_ptr = try self.allocNode(try self.parseUnary());
-            return .{ .unary_op = .{ .op = .bool_not, .operand = operand_ptr } };
+            try self.advance();
+            const operand = try self.parseUnary();
+            return self.addNode(.bool_not, operand, 0);
         }
         if (self.current().tag == .kw_try) {
-            self.pos += 1;
-            const expr_ptr = try self.allocNode(try self.parseUnary());
-            return .{ .try_expr = .{ .expr = expr_ptr } };
+            try self.advance();
+            const expr = try self.parseUnary();
+            return self.addNode(.try_expr, expr, 0);
+        }
+        if (self.current().tag == .kw_await) {
+            try self.advance();
+            const expr = try self.parseUnary();
+            return self.addNode(.await_expr, expr, 0);
         }
         return self.parsePostfix();
     }
 
-    fn parsePostfix(self: *Parser) ParseError!ast.Node {
+    fn parsePostfix(self: *Parser) ParseError!ast.Index {
         var node = try self.parsePrimary();
 
         while (true) {
             if (self.current().tag == .lparen) {
                 // Function call
-                const callee_name = switch (node) {
-                    .variable => |v| v.name,
-                    else => return ParseError.InvalidCallTarget,
-                };
+                if (self.tags.items[node] != .variable) return ParseError.InvalidCallTarget;
+                const callee = self.data.items[node];
 
-                self.pos += 1; // consume '('
-                var args: std.ArrayList(ast.Node) = .empty;
+                try self.advance(); // consume '('
+                const top = self.scratch.items.len;
 
                 if (self.current().tag != .rparen) {
                     const first_arg = try self.parseExpr();
-                    args.append(self.allocator, first_arg) catch return ParseError.OutOfMemory;
+                    try self.pushScratch(first_arg);
 
                     while (self.current().tag == .comma) {
-                        self.pos += 1; // consume ','
+                        try self.advance(); // consume ','
                         const arg = try self.parseExpr();
-                        args.append(self.allocator, arg) catch return ParseError.OutOfMemory;
+                        try self.pushScratch(arg);
                     }
                 }
 
                 try self.expect(.rparen);
 
-                node = .{ .call = .{
-                    .callee = callee_name,
-                    .args = args.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
-                } };
+                // The call reuses the callee's variable node.
+                const args = try self.popScratch(top);
+                const info = try self.addExtra(&.{ callee.lhs, callee.rhs, args.start, args.end });
+                self.tags.items[node] = .call;
+                self.data.items[node] = .{ .lhs = info, .rhs = 0 };
             } else if (self.current().tag == .lbracket) {
-                self.pos += 1; // consume '['
+                try self.advance(); // consume '['
                 const index_expr = try self.parseExpr();
                 try self.expect(.rbracket);
-                const target_ptr = try self.allocNode(node);
-                const index_ptr = try self.allocNode(index_expr);
-                node = .{ .index_expr = .{
-                    .target = target_ptr,
-                    .index = index_ptr,
-                } };
+                node = try self.addNode(.index_expr, node, index_expr);
             } else {
                 break;
             }
@@ -606,121 +773,204 @@ pub const Parser = struct {
         return node;
     }
 
-    fn parsePrimary(self: *Parser) ParseError!ast.Node {
+    fn parsePrimary(self: *Parser) ParseError!ast.Index {
         const tok = self.current();
 
         switch (tok.tag) {
             .int_literal => {
-                self.pos += 1;
-                const value = std.fmt.parseInt(i64, tok.lexeme, 10) catch 0;
-                return .{ .int_literal = .{ .value = value } };
+                try self.advance();
+                const value = std.fmt.parseInt(i64, self.lexeme(tok), 10) catch 0;
+                return self.addWide(.int_literal, @bitCast(value));
             },
             .float_literal => {
-                self.pos += 1;
-                const value = std.fmt.parseFloat(f64, tok.lexeme) catch 0.0;
-                return .{ .float_literal = .{ .value = value } };
+                try self.advance();
+                const value = std.fmt.parseFloat(f64, self.lexeme(tok)) catch 0.0;
+                return self.addWide(.float_literal, @bitCast(value));
             },
             .string_literal => {
-                self.pos += 1;
-                return .{ .string_literal = .{ .value = tok.lexeme } };
+                try self.advance();
+                const text = self.lexeme(tok);
+                if (std.mem.indexOfAny(u8, text, "{}") != null) return self.parseInterpolation(text);
+                return self.addNode(.string_literal, self.offsetOf(text), @intCast(text.len));
             },
             .kw_true => {
-                self.pos += 1;
-                return .{ .bool_literal = .{ .value = true } };
+                try self.advance();
+                return self.addNode(.bool_literal, 1, 0);
             },
             .kw_false => {
-                self.pos += 1;
-                return .{ .bool_literal = .{ .value = false } };
+                try self.advance();
+                return self.addNode(.bool_literal, 0, 0);
             },
             .kw_null => {
-                self.pos += 1;
-                return .{ .null_literal = .{} };
+                try self.advance();
+                return self.addNode(.null_literal, 0, 0);
             },
             .name => {
-                self.pos += 1;
-                return .{ .variable = .{ .name = tok.lexeme } };
+                try self.advance();
+                var text = self.lexeme(tok);
+                // `module.name`, written without spaces, is one qualified name.
+                const end = tok.start + text.len;
+                if (self.current().tag == .dot and self.current().start == end) {
+                    const member = self.peek(1);
+                    if (member.tag == .name and member.start == end + 1) {
+                        try self.advance(); // consume '.'
+                        try self.advance(); // consume member
+                        text = self.source[tok.start .. end + 1 + self.lexeme(member).len];
+                    }
+                }
+                return self.addNode(.variable, self.offsetOf(text), @intCast(text.len));
             },
             .lparen => {
-                self.pos += 1; // consume '('
+                try self.advance(); // consume '('
                 const expr = try self.parseExpr();
                 try self.expect(.rparen);
                 return expr;
             },
             .lbracket => {
-                self.pos += 1; // consume '['
-                var elements: std.ArrayList(ast.Node) = .empty;
+                try self.advance(); // consume '['
+                const top = self.scratch.items.len;
                 if (self.current().tag != .rbracket) {
                     const first = try self.parseExpr();
-                    elements.append(self.allocator, first) catch return ParseError.OutOfMemory;
+                    try self.pushScratch(first);
                     while (self.current().tag == .comma) {
-                        self.pos += 1;
+                        try self.advance();
                         const elem = try self.parseExpr();
-                        elements.append(self.allocator, elem) catch return ParseError.OutOfMemory;
+                        try self.pushScratch(elem);
                     }
                 }
                 try self.expect(.rbracket);
-                return .{ .array_literal = .{
-                    .elements = elements.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory,
-                } };
+                const elements = try self.popScratch(top);
+                return self.addNode(.array_literal, elements.start, elements.end);
             },
             .eof => return ParseError.UnexpectedEof,
             else => return ParseError.UnexpectedToken,
         }
     }
 
+    /// `"text {expr} text"`, whose contents are `text`: each braced part is
+    /// lexed and parsed in place as an expression, and the text around it
+    /// kept as string literals. `{{` and `}}` stand for single braces.
+    fn parseInterpolation(self: *Parser, text: []const u8) ParseError!ast.Index {
+        const saved_lexer = self.lexer;
+        const saved_tok = self.tok;
+        const top = self.scratch.items.len;
+        const end: u32 = self.offsetOf(text) + @as(u32, @intCast(text.len));
+        var text_start = self.offsetOf(text);
+        var i = text_start;
+        while (i < end) {
+            const c = self.source[i];
+            if (c == '\\') {
+                i += 2;
+                continue;
+            }
+            if (c != '{' and c != '}') {
+                i += 1;
+                continue;
+            }
+            const doubled = i + 1 < end and self.source[i + 1] == c;
+            if (!doubled and c == '}') {
+                self.tok = .{ .tag = .rbrace, .start = i };
+                return ParseError.UnexpectedToken;
+            }
+            try self.addTextPart(text_start, i + @intFromBool(doubled));
+            if (doubled) {
+                i += 2;
+                text_start = i;
+                continue;
+            }
+            // The expression must end at a `}` before the closing quote.
+            self.lexer = .{ .source = self.source[0..end], .pos = i + 1 };
+            try self.advance();
+            try self.pushScratch(try self.parseExpr());
+            switch (self.current().tag) {
+                .rbrace => {},
+                .eof => return ParseError.UnexpectedEof,
+                else => return ParseError.UnexpectedToken,
+            }
+            i = self.current().start + 1;
+            text_start = i;
+        }
+        try self.addTextPart(text_start, end);
+        self.lexer = saved_lexer;
+        self.tok = saved_tok;
+        const parts = try self.popScratch(top);
+        return self.addNode(.interpolation, parts.start, parts.end);
+    }
+
+    fn addTextPart(self: *Parser, start: u32, end: u32) ParseError!void {
+        if (end > start) try self.pushScratch(try self.addNode(.string_literal, start, end - start));
+    }
+
     // ── Helpers ─────────────────────────────────────────────────
 
     fn current(self: *const Parser) Token {
-        if (self.pos >= self.tokens.len) {
-            return .{ .tag = .eof, .lexeme = "", .line = 0, .col = 0 };
-        }
-        return self.tokens[self.pos];
+        return self.tok;
+    }
+
+    fn advance(self: *Parser) ParseError!void {
+        self.tok = self.lexer.next() catch |err| {
+            self.lex_error_at = self.lexer.pos;
+            return err;
+        };
     }
 
+    /// Lexes ahead on a copy of the lexer. A lexer error reads as eof here
+    /// and is reported once the parser actually reaches it.
     fn peek(self: *const Parser, offset: usize) Token {
-        const new_pos = self.pos + offset;
-        if (new_pos >= self.tokens.len) {
-            return .{ .tag = .eof, .lexeme = "", .line = 0, .col = 0 };
+        var ahead = self.lexer;
+        var tok = self.tok;
+        for (0..offset) |_| {
+            tok = ahead.next() catch return .{ .tag = .eof, .start = @intCast(ahead.pos) };
         }
-        return self.tokens[new_pos];
+        return tok;
+    }
+
+    fn lexeme(self: *const Parser, tok: Token) []const u8 {
+        return Lexer.lexeme(self.source, tok);
+    }
+
+    /// 1-based column of a token, found by scanning back to its line start.
+    fn column(self: *const Parser, tok: Token) usize {
+        const line_start = if (std.mem.lastIndexOfScalar(u8, self.source[0..tok.start], '\n')) |nl| nl + 1 else 0;
+        return tok.start - line_start + 1;
     }
 
     fn expect(self: *Parser, tag: TokenType) ParseError!void {
         if (self.current().tag != tag) {
             return ParseError.UnexpectedToken;
         }
-        self.pos += 1;
+        try self.advance();
     }
 
-    fn skipNewlines(self: *Parser) void {
-        while (self.pos < self.tokens.len and self.tokens[self.pos].tag == .newline) {
-            self.pos += 1;
+    fn skipNewlines(self: *Parser) ParseError!void {
+        while (self.tok.tag == .newline) {
+            try self.advance();
         }
     }
 
-    fn parseIndentedBlock(self: *Parser, stop_tags: []const TokenType) ParseError![]const ast.Node {
-        var body: std.ArrayList(ast.Node) = .empty;
+    fn parseIndentedBlock(self: *Parser, stop_tags: []const TokenType) ParseError!Span {
+        const top = self.scratch.items.len;
         var first_stmt_col: ?usize = null;
 
         while (self.current().tag != .eof) {
             while (self.current().tag == .newline) {
-                self.pos += 1;
+                try self.advance();
             }
 
             if (self.current().tag == .eof) break;
             if (self.isStopTag(stop_tags, self.current().tag)) break;
 
             if (first_stmt_col) |first_col| {
-                if (self.current().col < first_col) break;
+                if (self.column(self.current()) < first_col) break;
             } else {
-                first_stmt_col = self.current().col;
+                first_stmt_col = self.column(self.current());
             }
 
             const stmt = try self.parseStmt();
-            body.append(self.allocator, stmt) catch return ParseError.OutOfMemory;
+            try self.pushScratch(stmt);
         }
 
-        return body.toOwnedSlice(self.allocator) catch return ParseError.OutOfMemory;
+        return self.popScratch(top);
     }
 
     fn isStopTag(self: *Parser, stop_tags: []const TokenType, tag: TokenType) bool {
@@ -731,20 +981,48 @@ pub const Parser = struct {
         return false;
     }
 
-    fn allocNode(self: *Parser, node: ast.Node) ParseError!*ast.Node {
-        const node_ptr = self.allocator.create(ast.Node) catch return ParseError.OutOfMemory;
-        node_ptr.* = node;
-        return node_ptr;
+    fn addNode(self: *Parser, tag: ast.Tag, lhs: u32, rhs: u32) ParseError!ast.Index {
+        const index: ast.Index = @intCast(self.tags.items.len);
+        self.tags.append(self.allocator, tag) catch return ParseError.OutOfMemory;
+        self.data.append(self.allocator, .{ .lhs = lhs, .rhs = rhs }) catch return ParseError.OutOfMemory;
+        return index;
+    }
+
+    /// Node whose payload is a 64-bit literal split across lhs (low) and rhs (high).
+    fn addWide(self: *Parser, tag: ast.Tag, bits: u64) ParseError!ast.Index {
+        return self.addNode(tag, @truncate(bits), @truncate(bits >> 32));
+    }
+
+    fn addExtra(self: *Parser, words: []const u32) ParseError!u32 {
+        const start: u32 = @intCast(self.extra.items.len);
+        self.extra.appendSlice(self.allocator, words) catch return ParseError.OutOfMemory;
+        return start;
+    }
+
+    fn addType(self: *Parser, t: ast.Type) ParseError!u32 {
+        const index: u32 = @intCast(self.types.items.len);
+        self.types.append(self.allocator, t) catch return ParseError.OutOfMemory;
+        return index;
     }
 
-    fn makeBinary(self: *Parser, op: ast.BinaryOp.Op, left: ast.Node, right: ast.Node) ParseError!ast.Node {
-        const left_ptr = try self.allocNode(left);
-        const right_ptr = try self.allocNode(right);
-        return .{ .binary_op = .{
-            .op = op,
-            .left = left_ptr,
-            .right = right_ptr,
-        } };
+    fn pushScratch(self: *Parser, index: ast.Index) ParseError!void {
+        self.scratch.append(self.allocator, index) catch return ParseError.OutOfMemory;
+    }
+
+    /// Move `scratch[top..]` into `extra` and return where it landed.
+    fn popScratch(self: *Parser, top: usize) ParseError!Span {
+        const start = try self.addExtra(self.scratch.items[top..]);
+        self.scratch.shrinkRetainingCapacity(top);
+        return .{ .start = start, .end = @intCast(self.extra.items.len) };
+    }
+
+    /// Offset of a token lexeme within the source, which is how nodes store names.
+    fn offsetOf(self: *const Parser, lexeme: []const u8) u32 {
+        return @intCast(@intFromPtr(lexeme.ptr) - @intFromPtr(self.source.ptr));
+    }
+
+    fn makeBinary(self: *Parser, op: ast.BinaryOp.Op, left: ast.Index, right: ast.Index) ParseError!ast.Index {
+        return self.addNode(ast.Tag.fromBinaryOp(op), left, right);
     }
 
     fn allocType(self: *Parser, t: ast.Type) ParseError!*ast.Type {
@@ -753,3 +1031,9 @@ pub const Parser = struct {
         return t_ptr;
     }
 };
+
+/// A range of `extra`.
+const Span = struct {
+    start: u32,
+    end: u32,
+};
@@ -0,0 +1,1399 @@
+/// C runtime for `parallel` blocks and loops, emitted into generated
+/// programs that use them.
+///
+/// Tasks run on a pool of one thread per CPU (`$ONEIM_THREADS` overrides),
+/// started on first use and kept for the life of the program. Each thread
+/// owns a Chase-Lev deque: it pushes and takes its own tasks at the bottom
+/// and, when out of work, steals from the top of the others'. A thread that
+/// waits for a group of tasks runs queued tasks meanwhile, so nested
+/// `parallel` blocks never block a worker. Idle threads sleep on a
+/// condition variable. The thread that starts the program is worker 0.
+///
+/// Workers run wherever the OS puts them unless `$ONEIM_AFFINITY`, or else
+/// the program's `parallel affinity`, says `compact` (one per CPU, filling
+/// a NUMA node before the next) or `spread` (one per CPU, alternating
+/// between nodes). Nodes come from sysfs, so pinning is Linux-only. Each
+/// worker allocates and zeroes its own deque after it is placed, so the
+/// pages are first touched from its own node, as are its `print` buffer and
+/// future chunks. `$ONEIM_TOPOLOGY=1` prints the placement on stderr.
+///
+/// Each call of a `parallel` block or `set (...) to parallel` is one task;
+/// its argument struct holds the evaluated arguments and the result. A call
+/// returning an error cancels its group, so the calls not yet started are
+/// skipped.
+///
+/// A parallel loop is one task per worker over a shared `__1im_loop`; the
+/// loop body is a function of a [lo, hi) chunk and a context struct holding
+/// the variables it captures. Each task is a numbered part of the loop and
+/// runs its chunks one after another, so reductions keep one cache-line
+/// padded partial per part and need no atomics.
+///
+/// `spawn` submits one task whose argument struct starts with a
+/// `__1im_future`: the task, a group of one to wait on, its chunk, then the
+/// result. Futures are bump-allocated from per-thread chunks, so a spawn
+/// costs no `malloc`. The first await frees the future, after the caller
+/// has copied the result out; a chunk counts the futures in it still live
+/// and is reused or freed once they are all gone. Awaiting runs queued
+/// tasks until the future's own task is done.
+///
+/// Atomics are C11 `_Atomic` cells and mutexes are futex locks that spin
+/// briefly before sleeping; on systems without futexes a contended lock
+/// yields instead.
+///
+/// Channels are bounded lock-free MPMC ring buffers (Vyukov's queue) of
+/// `__1im_word` messages, with senders and receivers claiming slots on cache
+/// lines of their own. `send` on a full channel and `receive` on an empty
+/// one spin, then yield. A thread waiting on a channel does not run other
+/// tasks, since one started above it could wait for the very sender or
+/// receiver it holds up; instead, once every worker is waiting on a
+/// channel, the pool starts a spare worker to run the queued tasks.
+///
+/// A thread writes its `print` buffer (see `print_defs`) out before
+/// submitting a task and after running one, so everything a task prints
+/// appears together, after what was printed before the task was started
+/// and before whatever its waiter prints next.
+///
+/// `decls` goes into every C file that uses the runtime; `defs` goes into
+/// the entry module's file only, so a program links one pool.
+
+pub const decls =
+    \\#include <stdatomic.h>
+    \\
+    \\typedef struct __1im_group {
+    \\    atomic_long pending;
+    \\    /* Set once a task fails; tasks of the group not yet started are skipped. */
+    \\    atomic_int cancelled;
+    \\} __1im_group;
+    \\
+    \\typedef struct __1im_task {
+    \\    void (*fn)(void*);
+    \\    void* arg;
+    \\    __1im_group* group;
+    \\} __1im_task;
+    \\
+    \\void __1im_submit(__1im_task* task);
+    \\void __1im_wait(__1im_group* group);
+    \\void __1im_par_run(__1im_group* group, __1im_task* tasks, long n);
+    \\
+    \\/* Parallel loops: `body` runs on disjoint [lo, hi) chunks of the range.
+    \\   `part` < __1im_workers() identifies the task running the chunk; no two
+    \\   chunks of the same part run at once. */
+    \\typedef void (*__1im_range_fn)(void* ctx, int64_t lo, int64_t hi, long part);
+    \\enum { __1IM_STATIC, __1IM_DYNAMIC, __1IM_GUIDED };
+    \\void __1im_par_for(int64_t lo, int64_t hi, int schedule, int64_t grain, __1im_range_fn body, void* ctx);
+    \\long __1im_workers(void);
+    \\
+    \\/* `spawn`: generated future structs start with a __1im_future. */
+    \\typedef struct __1im_future {
+    \\    __1im_task task;
+    \\    __1im_group group;
+    \\    struct __1im_chunk* chunk;
+    \\} __1im_future;
+    \\
+    \\void* __1im_future_new(size_t size);
+    \\void __1im_spawn(__1im_future* future, void (*fn)(void*));
+    \\void* __1im_await(__1im_future* future);
+    \\void __1im_future_free(__1im_future* future);
+    \\
+    \\static inline void __1im_cancel(__1im_group* group) {
+    \\    atomic_store_explicit(&group->cancelled, 1, memory_order_relaxed);
+    \\}
+    \\
+    \\/* `atomic_cas`: C11's compare-exchange takes the expected value by address. */
+    \\#define __1IM_CAS(name, T) \
+    \\    static inline bool __1im_cas_##name(_Atomic(T)* a, T expected, T desired, memory_order success, memory_order failure) { \
+    \\        return atomic_compare_exchange_strong_explicit(a, &expected, desired, success, failure); \
+    \\    }
+    \\__1IM_CAS(i8, int8_t)
+    \\__1IM_CAS(i16, int16_t)
+    \\__1IM_CAS(i32, int32_t)
+    \\__1IM_CAS(i64, int64_t)
+    \\__1IM_CAS(u8, uint8_t)
+    \\__1IM_CAS(u16, uint16_t)
+    \\__1IM_CAS(u32, uint32_t)
+    \\__1IM_CAS(u64, uint64_t)
+    \\
+    \\/* `mutex()`: 0 unlocked, 1 locked, 2 locked with threads asleep on it
+    \\   (the futex mutex of Drepper's "Futexes Are Tricky"). Taking and
+    \\   releasing an uncontended mutex is one atomic operation each. */
+    \\typedef struct __1im_mutex {
+    \\    atomic_int state;
+    \\} __1im_mutex;
+    \\
+    \\void __1im_lock_slow(__1im_mutex* m);
+    \\void __1im_wake(__1im_mutex* m);
+    \\
+    \\static inline void __1im_lock(__1im_mutex* m) {
+    \\    int unlocked = 0;
+    \\    if (!atomic_compare_exchange_strong_explicit(&m->state, &unlocked, 1, memory_order_acquire, memory_order_relaxed)) __1im_lock_slow(m);
+    \\}
+    \\
+    \\static inline void __1im_unlock(__1im_mutex* m) {
+    \\    if (atomic_exchange_explicit(&m->state, 0, memory_order_release) == 2) __1im_wake(m);
+    \\}
+    \\
+    \\/* `channel T`: every message is one of these, whatever T is. */
+    \\typedef union {
+    \\    int64_t i;
+    \\    uint64_t u;
+    \\    double f;
+    \\    bool b;
+    \\    __1im_str s;
+    \\} __1im_word;
+    \\
+    \\typedef struct __1im_channel __1im_channel;
+    \\
+    \\__1im_channel* __1im_channel_new(int64_t capacity);
+    \\void __1im_send(__1im_channel* c, __1im_word v);
+    \\__1im_word __1im_receive(__1im_channel* c);
+    \\
+;
+
+pub const defs =
+    \\#include <stdlib.h>
+    \\#include <sched.h>
+    \\#include <unistd.h>
+    \\
+    \\/* Default worker placement; see __1im_place. The program's
+    \\   `parallel affinity` defines it ahead of this file. */
+    \\#ifndef __1IM_AFFINITY
+    \\#define __1IM_AFFINITY "none"
+    \\#endif
+    \\
+    \\/* Chase-Lev deque: the owning worker pushes and takes at the bottom,
+    \\   thieves steal from the top. A full deque runs the task inline. */
+    \\#define __1IM_DEQUE_CAP 1024
+    \\#define __1IM_MAX_WORKERS 256
+    \\#define __1IM_MAX_NODES 64
+    \\
+    \\typedef struct {
+    \\    _Alignas(64) atomic_llong top;
+    \\    _Alignas(64) atomic_llong bottom;
+    \\    _Atomic(__1im_task*) slots[__1IM_DEQUE_CAP];
+    \\} __1im_deque;
+    \\
+    \\/* A CPU a worker may be pinned to. */
+    \\typedef struct {
+    \\    int cpu, node;
+    \\} __1im_cpu;
+    \\
+    \\static struct {
+    \\    pthread_once_t once;
+    \\    /* Worker 0 is the main thread; the pool starts the others. */
+    \\    long workers;
+    \\    /* Workers plus the spares started for threads waiting on channels. */
+    \\    atomic_long threads;
+    \\    /* Threads waiting on a full or empty channel. */
+    \\    atomic_long blocked;
+    \\    /* Each worker allocates and zeroes its own deque, so that its pages are
+    \\       first touched from the worker's NUMA node; NULL until then. */
+    \\    _Atomic(__1im_deque*)* deques;
+    \\    /* CPUs in the order workers are pinned to them; only listed when
+    \\       pinning or dumping the topology. */
+    \\    __1im_cpu* cpus;
+    \\    long ncpus, nodes;
+    \\    const char* affinity;
+    \\    int pin;
+    \\    /* Where each worker ended up, for $ONEIM_TOPOLOGY. */
+    \\    __1im_cpu* placed;
+    \\    atomic_long ready;
+    \\    /* Bumped whenever there may be new work or a finished group. */
+    \\    atomic_long epoch;
+    \\    atomic_long sleepers;
+    \\    pthread_mutex_t lock;
+    \\    pthread_cond_t wake;
+    \\} __1im_pool = { .once = PTHREAD_ONCE_INIT, .lock = PTHREAD_MUTEX_INITIALIZER, .wake = PTHREAD_COND_INITIALIZER };
+    \\
+    \\static _Thread_local long __1im_worker = 0;
+    \\
+    \\static int __1im_push(__1im_deque* d, __1im_task* task) {
+    \\    long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed);
+    \\    long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    \\    if (b - t >= __1IM_DEQUE_CAP) return 0;
+    \\    atomic_store_explicit(&d->slots[b % __1IM_DEQUE_CAP], task, memory_order_relaxed);
+    \\    atomic_store_explicit(&d->bottom, b + 1, memory_order_release);
+    \\    return 1;
+    \\}
+    \\
+    \\static __1im_task* __1im_take(__1im_deque* d) {
+    \\    long long b = atomic_load_explicit(&d->bottom, memory_order_relaxed) - 1;
+    \\    atomic_store_explicit(&d->bottom, b, memory_order_relaxed);
+    \\    atomic_thread_fence(memory_order_seq_cst);
+    \\    long long t = atomic_load_explicit(&d->top, memory_order_relaxed);
+    \\    if (t > b) {
+    \\        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    \\        return NULL;
+    \\    }
+    \\    __1im_task* task = atomic_load_explicit(&d->slots[b % __1IM_DEQUE_CAP], memory_order_relaxed);
+    \\    if (t == b) {
+    \\        /* Last task: race the thieves for it. */
+    \\        if (!atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) task = NULL;
+    \\        atomic_store_explicit(&d->bottom, b + 1, memory_order_relaxed);
+    \\    }
+    \\    return task;
+    \\}
+    \\
+    \\static __1im_task* __1im_steal(__1im_deque* d) {
+    \\    for (;;) {
+    \\        long long t = atomic_load_explicit(&d->top, memory_order_acquire);
+    \\        atomic_thread_fence(memory_order_seq_cst);
+    \\        long long b = atomic_load_explicit(&d->bottom, memory_order_acquire);
+    \\        if (t >= b) return NULL;
+    \\        __1im_task* task = atomic_load_explicit(&d->slots[t % __1IM_DEQUE_CAP], memory_order_relaxed);
+    \\        if (atomic_compare_exchange_strong_explicit(&d->top, &t, t + 1, memory_order_seq_cst, memory_order_relaxed)) return task;
+    \\    }
+    \\}
+    \\
+    \\static void __1im_notify(int all) {
+    \\    atomic_fetch_add(&__1im_pool.epoch, 1);
+    \\    if (atomic_load(&__1im_pool.sleepers) == 0) return;
+    \\    pthread_mutex_lock(&__1im_pool.lock);
+    \\    if (all) pthread_cond_broadcast(&__1im_pool.wake);
+    \\    else pthread_cond_signal(&__1im_pool.wake);
+    \\    pthread_mutex_unlock(&__1im_pool.lock);
+    \\}
+    \\
+    \\static __1im_deque* __1im_deque_of(long worker) {
+    \\    return atomic_load_explicit(&__1im_pool.deques[worker], memory_order_acquire);
+    \\}
+    \\
+    \\/* Own deque first, then the others starting from the next worker. */
+    \\static __1im_task* __1im_find(void) {
+    \\    long self = __1im_worker, n = atomic_load_explicit(&__1im_pool.threads, memory_order_acquire);
+    \\    __1im_task* task = __1im_take(__1im_deque_of(self));
+    \\    for (long i = 1; task == NULL && i < n; i++) {
+    \\        __1im_deque* d = __1im_deque_of((self + i) % n);
+    \\        if (d != NULL) task = __1im_steal(d);
+    \\    }
+    \\    return task;
+    \\}
+    \\
+    \\static void __1im_execute(__1im_task* task) {
+    \\    /* Read before running: the task and its group may be gone afterwards. */
+    \\    __1im_group* group = task->group;
+    \\    if (!atomic_load_explicit(&group->cancelled, memory_order_relaxed)) task->fn(task->arg);
+    \\    /* Before the task counts as done, so its output precedes what waits on it. */
+    \\    __1im_flush();
+    \\    if (atomic_fetch_sub_explicit(&group->pending, 1, memory_order_acq_rel) == 1) __1im_notify(1);
+    \\}
+    \\
+    \\/* Spins briefly, then sleeps until the epoch moves past `seen`. */
+    \\static void __1im_idle(long seen) {
+    \\    for (int spin = 0; spin < 32; spin++) {
+    \\        if (atomic_load_explicit(&__1im_pool.epoch, memory_order_relaxed) != seen) return;
+    \\        sched_yield();
+    \\    }
+    \\    pthread_mutex_lock(&__1im_pool.lock);
+    \\    atomic_fetch_add(&__1im_pool.sleepers, 1);
+    \\    while (atomic_load(&__1im_pool.epoch) == seen) pthread_cond_wait(&__1im_pool.wake, &__1im_pool.lock);
+    \\    atomic_fetch_sub(&__1im_pool.sleepers, 1);
+    \\    pthread_mutex_unlock(&__1im_pool.lock);
+    \\}
+    \\
+    \\#ifdef __linux__
+    \\/* Reads a sysfs cpulist such as "0-3,8-11" into `node_of`. */
+    \\static void __1im_read_cpulist(const char* path, int node, int* node_of) {
+    \\    FILE* f = fopen(path, "r");
+    \\    if (f == NULL) return;
+    \\    int lo, hi;
+    \\    char sep;
+    \\    while (fscanf(f, "%d", &lo) == 1) {
+    \\        hi = lo;
+    \\        if (fscanf(f, "%c", &sep) == 1 && sep == '-') {
+    \\            if (fscanf(f, "%d", &hi) != 1) break;
+    \\            if (fscanf(f, "%c", &sep) != 1) sep = '\n';
+    \\        }
+    \\        for (int c = lo; c <= hi && c < CPU_SETSIZE; c++) {
+    \\            if (c >= 0) node_of[c] = node;
+    \\        }
+    \\        if (sep != ',') break;
+    \\    }
+    \\    fclose(f);
+    \\}
+    \\
+    \\/* Lists the CPUs this process may use in the order workers take them:
+    \\   node by node for "compact"; for "spread", the first CPU of every node,
+    \\   then the second of every node, and so on. CPUs outside the nodes listed
+    \\   in sysfs count as node 0. */
+    \\static void __1im_topology(int spread) {
+    \\    cpu_set_t allowed;
+    \\    if (sched_getaffinity(0, sizeof allowed, &allowed) != 0) return;
+    \\    static int node_of[CPU_SETSIZE];
+    \\    for (int node = 0; node < __1IM_MAX_NODES; node++) {
+    \\        char path[64];
+    \\        snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+    \\        __1im_read_cpulist(path, node, node_of);
+    \\    }
+    \\
+    \\    long total = CPU_COUNT(&allowed), nodes = 0;
+    \\    long start[__1IM_MAX_NODES], count[__1IM_MAX_NODES];
+    \\    __1im_cpu* cpus = malloc(total * sizeof(__1im_cpu));
+    \\    if (cpus == NULL) abort();
+    \\    long next = 0;
+    \\    for (int node = 0; node < __1IM_MAX_NODES; node++) {
+    \\        start[node] = next;
+    \\        for (int c = 0; c < CPU_SETSIZE; c++) {
+    \\            if (CPU_ISSET(c, &allowed) && node_of[c] == node) cpus[next++] = (__1im_cpu){ c, node };
+    \\        }
+    \\        count[node] = next - start[node];
+    \\        if (count[node] > 0) nodes++;
+    \\    }
+    \\
+    \\    if (spread) {
+    \\        __1im_cpu* dealt = malloc(total * sizeof(__1im_cpu));
+    \\        if (dealt == NULL) abort();
+    \\        next = 0;
+    \\        for (long round = 0; next < total; round++) {
+    \\            for (int node = 0; node < __1IM_MAX_NODES; node++) {
+    \\                if (round < count[node]) dealt[next++] = cpus[start[node] + round];
+    \\            }
+    \\        }
+    \\        free(cpus);
+    \\        cpus = dealt;
+    \\    }
+    \\    __1im_pool.cpus = cpus;
+    \\    __1im_pool.ncpus = total;
+    \\    __1im_pool.nodes = nodes;
+    \\}
+    \\
+    \\static int __1im_node_of_cpu(int cpu) {
+    \\    for (long i = 0; i < __1im_pool.ncpus; i++) {
+    \\        if (__1im_pool.cpus[i].cpu == cpu) return __1im_pool.cpus[i].node;
+    \\    }
+    \\    return -1;
+    \\}
+    \\#endif
+    \\
+    \\/* Pins the calling thread as `worker`, if the affinity asks for it, then
+    \\   gives it its deque. */
+    \\static void __1im_place(long worker) {
+    \\    __1im_cpu* placed = &__1im_pool.placed[worker];
+    \\    *placed = (__1im_cpu){ -1, -1 };
+    \\#ifdef __linux__
+    \\    if (__1im_pool.pin && __1im_pool.ncpus > 0) {
+    \\        __1im_cpu target = __1im_pool.cpus[worker % __1im_pool.ncpus];
+    \\        cpu_set_t set;
+    \\        CPU_ZERO(&set);
+    \\        CPU_SET(target.cpu, &set);
+    \\        if (sched_setaffinity(0, sizeof set, &set) == 0) *placed = target;
+    \\    }
+    \\    if (placed->cpu < 0) {
+    \\        int cpu = sched_getcpu();
+    \\        *placed = (__1im_cpu){ cpu, __1im_node_of_cpu(cpu) };
+    \\    }
+    \\#endif
+    \\    __1im_deque* d = aligned_alloc(64, sizeof(__1im_deque));
+    \\    if (d == NULL) abort();
+    \\    memset(d, 0, sizeof(__1im_deque));
+    \\    atomic_store_explicit(&__1im_pool.deques[worker], d, memory_order_release);
+    \\    atomic_fetch_add(&__1im_pool.ready, 1);
+    \\}
+    \\
+    \\static void* __1im_worker_main(void* arg) {
+    \\    __1im_worker = (long)(intptr_t)arg;
+    \\    __1im_place(__1im_worker);
+    \\    for (;;) {
+    \\        long seen = atomic_load(&__1im_pool.epoch);
+    \\        __1im_task* task = __1im_find();
+    \\        if (task) __1im_execute(task);
+    \\        else __1im_idle(seen);
+    \\    }
+    \\    return NULL;
+    \\}
+    \\
+    \\/* $ONEIM_TOPOLOGY=1: reports on stderr where the workers run, once they
+    \\   have all started. */
+    \\static void __1im_dump_topology(long started) {
+    \\    while (atomic_load(&__1im_pool.ready) < started) sched_yield();
+    \\    fprintf(stderr, "1im: %ld workers, affinity %s", started, __1im_pool.affinity);
+    \\    if (__1im_pool.ncpus > 0) fprintf(stderr, ", %ld CPU(s) on %ld NUMA node(s)", __1im_pool.ncpus, __1im_pool.nodes);
+    \\    fprintf(stderr, "\n");
+    \\    for (long i = 0; i < started; i++) {
+    \\        __1im_cpu p = __1im_pool.placed[i];
+    \\        const char* how = __1im_pool.pin ? "pinned to" : "started on";
+    \\        if (p.cpu < 0) fprintf(stderr, "1im:   worker %ld: unknown cpu\n", i);
+    \\        else if (p.node < 0) fprintf(stderr, "1im:   worker %ld: %s cpu %d\n", i, how, p.cpu);
+    \\        else fprintf(stderr, "1im:   worker %ld: %s cpu %d, node %d\n", i, how, p.cpu, p.node);
+    \\    }
+    \\}
+    \\
+    \\/* One worker per online CPU, or $ONEIM_THREADS, placed as $ONEIM_AFFINITY
+    \\   or the program says: "none", "compact" or "spread". */
+    \\static void __1im_start(void) {
+    \\    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    \\    const char* env = getenv("ONEIM_THREADS");
+    \\    if (env && atol(env) > 0) n = atol(env);
+    \\    if (n < 1) n = 1;
+    \\    if (n > __1IM_MAX_WORKERS) n = __1IM_MAX_WORKERS;
+    \\    /* Room for spares too; see __1im_block. */
+    \\    __1im_pool.deques = calloc(__1IM_MAX_WORKERS, sizeof(*__1im_pool.deques));
+    \\    __1im_pool.placed = calloc(__1IM_MAX_WORKERS, sizeof(__1im_cpu));
+    \\    if (__1im_pool.deques == NULL || __1im_pool.placed == NULL) abort();
+    \\    __1im_pool.workers = n;
+    \\
+    \\    const char* affinity = getenv("ONEIM_AFFINITY");
+    \\    if (affinity == NULL || *affinity == '\0') affinity = __1IM_AFFINITY;
+    \\    int spread = strcmp(affinity, "spread") == 0;
+    \\    __1im_pool.pin = spread || strcmp(affinity, "compact") == 0;
+    \\    __1im_pool.affinity = __1im_pool.pin ? affinity : "none";
+    \\    const char* dump = getenv("ONEIM_TOPOLOGY");
+    \\    int dumping = dump && atoi(dump) > 0;
+    \\#ifdef __linux__
+    \\    if (__1im_pool.pin || dumping) __1im_topology(spread);
+    \\#endif
+    \\
+    \\    __1im_place(0);
+    \\    long started = 1;
+    \\    for (; started < n; started++) {
+    \\        pthread_t thread;
+    \\        if (pthread_create(&thread, NULL, __1im_worker_main, (void*)(intptr_t)started) != 0) break;
+    \\        pthread_detach(thread);
+    \\    }
+    \\    atomic_store_explicit(&__1im_pool.threads, started, memory_order_release);
+    \\    if (dumping) __1im_dump_topology(started);
+    \\}
+    \\
+    \\void __1im_submit(__1im_task* task) {
+    \\    pthread_once(&__1im_pool.once, __1im_start);
+    \\    /* What was printed before the task starts comes out before its output. */
+    \\    __1im_flush();
+    \\    atomic_fetch_add_explicit(&task->group->pending, 1, memory_order_relaxed);
+    \\    if (!__1im_push(__1im_deque_of(__1im_worker), task)) {
+    \\        __1im_execute(task);
+    \\        return;
+    \\    }
+    \\    __1im_notify(0);
+    \\}
+    \\
+    \\/* Runs queued tasks, this group's or others', until the group is done. */
+    \\void __1im_wait(__1im_group* group) {
+    \\    pthread_once(&__1im_pool.once, __1im_start);
+    \\    while (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) {
+    \\        long seen = atomic_load(&__1im_pool.epoch);
+    \\        __1im_task* task = __1im_find();
+    \\        if (task) __1im_execute(task);
+    \\        else if (atomic_load_explicit(&group->pending, memory_order_acquire) > 0) __1im_idle(seen);
+    \\    }
+    \\}
+    \\
+    \\/* Runs every task in `group`, which must be zeroed, and returns once all
+    \\   are done; the caller runs the first. */
+    \\void __1im_par_run(__1im_group* group, __1im_task* tasks, long n) {
+    \\    for (long i = 1; i < n; i++) {
+    \\        tasks[i].group = group;
+    \\        __1im_submit(&tasks[i]);
+    \\    }
+    \\    if (n > 0 && !atomic_load_explicit(&group->cancelled, memory_order_relaxed)) tasks[0].fn(tasks[0].arg);
+    \\    __1im_flush();
+    \\    __1im_wait(group);
+    \\}
+    \\
+    \\typedef struct {
+    \\    __1im_range_fn body;
+    \\    void* ctx;
+    \\    int64_t lo, hi, grain;
+    \\    int schedule;
+    \\    long parts;
+    \\    /* First unclaimed iteration, for dynamic and guided loops. */
+    \\    _Alignas(64) atomic_llong next;
+    \\} __1im_loop;
+    \\
+    \\typedef struct {
+    \\    __1im_loop* loop;
+    \\    long part;
+    \\} __1im_loop_part;
+    \\
+    \\static void __1im_loop_chunk(__1im_loop_part* p, int64_t lo, int64_t size) {
+    \\    __1im_loop* l = p->loop;
+    \\    l->body(l->ctx, lo, size < l->hi - lo ? lo + size : l->hi, p->part);
+    \\}
+    \\
+    \\static void __1im_loop_run(void* arg) {
+    \\    __1im_loop_part* p = arg;
+    \\    __1im_loop* l = p->loop;
+    \\    switch (l->schedule) {
+    \\    case __1IM_STATIC:
+    \\        /* Chunk k belongs to part k % parts. */
+    \\        for (int64_t lo = l->lo + p->part * l->grain; lo < l->hi; lo += l->parts * l->grain) {
+    \\            __1im_loop_chunk(p, lo, l->grain);
+    \\        }
+    \\        break;
+    \\    case __1IM_DYNAMIC:
+    \\        for (;;) {
+    \\            int64_t lo = atomic_fetch_add_explicit(&l->next, l->grain, memory_order_relaxed);
+    \\            if (lo >= l->hi) break;
+    \\            __1im_loop_chunk(p, lo, l->grain);
+    \\        }
+    \\        break;
+    \\    default:
+    \\        /* Guided: claim a share of what is left, but at least `grain`. */
+    \\        for (;;) {
+    \\            int64_t lo = atomic_load_explicit(&l->next, memory_order_relaxed), size;
+    \\            do {
+    \\                if (lo >= l->hi) return;
+    \\                size = (l->hi - lo) / (2 * l->parts);
+    \\                if (size < l->grain) size = l->grain;
+    \\            } while (!atomic_compare_exchange_weak_explicit(&l->next, &lo, lo + size, memory_order_relaxed, memory_order_relaxed));
+    \\            __1im_loop_chunk(p, lo, size);
+    \\        }
+    \\    }
+    \\}
+    \\
+    \\/* Runs the range as one task per worker (fewer if there are fewer chunks).
+    \\   Without a grain, static loops give each worker one contiguous block and
+    \\   dynamic loops use chunks of 1/16 of a worker's share. */
+    \\void __1im_par_for(int64_t lo, int64_t hi, int schedule, int64_t grain, __1im_range_fn body, void* ctx) {
+    \\    if (hi <= lo) return;
+    \\    pthread_once(&__1im_pool.once, __1im_start);
+    \\    int64_t n = hi - lo;
+    \\    long workers = __1im_pool.workers;
+    \\    if (grain < 1) {
+    \\        if (schedule == __1IM_STATIC) grain = (n + workers - 1) / workers;
+    \\        else if (schedule == __1IM_DYNAMIC) grain = n / (workers * 16);
+    \\        if (grain < 1) grain = 1;
+    \\    }
+    \\    int64_t chunks = (n - 1) / grain + 1;
+    \\    long parts = chunks < workers ? (long)chunks : workers;
+    \\    if (parts == 1) {
+    \\        body(ctx, lo, hi, 0);
+    \\        return;
+    \\    }
+    \\
+    \\    __1im_loop loop = {
+    \\        .body = body, .ctx = ctx, .lo = lo, .hi = hi, .grain = grain,
+    \\        .schedule = schedule, .parts = parts,
+    \\    };
+    \\    atomic_init(&loop.next, lo);
+    \\    __1im_loop_part part_args[__1IM_MAX_WORKERS];
+    \\    __1im_task tasks[__1IM_MAX_WORKERS];
+    \\    for (long i = 0; i < parts; i++) {
+    \\        part_args[i] = (__1im_loop_part){ &loop, i };
+    \\        tasks[i] = (__1im_task){ __1im_loop_run, &part_args[i], NULL };
+    \\    }
+    \\    __1im_group group = { 0 };
+    \\    __1im_par_run(&group, tasks, parts);
+    \\}
+    \\
+    \\/* Upper bound on the parts of any parallel loop. */
+    \\long __1im_workers(void) {
+    \\    pthread_once(&__1im_pool.once, __1im_start);
+    \\    return __1im_pool.workers;
+    \\}
+    \\
+    \\/* Futures are carved from 64 KiB chunks owned by the spawning thread, each
+    \\   on its own cache lines so that workers finishing neighbouring futures do
+    \\   not contend. `live` counts the chunk's futures not yet freed, plus one
+    \\   while it is its thread's current chunk. A full current chunk with no
+    \\   live futures is refilled from the start; any other goes back to malloc
+    \\   when its count drops to zero. */
+    \\#define __1IM_FUTURE_CHUNK (64 * 1024)
+    \\typedef struct __1im_chunk {
+    \\    _Alignas(64) atomic_long live;
+    \\} __1im_chunk;
+    \\static _Thread_local __1im_chunk* __1im_future_chunk = NULL;
+    \\static _Thread_local char* __1im_future_next = NULL;
+    \\static _Thread_local char* __1im_future_end = NULL;
+    \\
+    \\static void __1im_chunk_drop(__1im_chunk* chunk) {
+    \\    if (atomic_fetch_sub_explicit(&chunk->live, 1, memory_order_acq_rel) == 1) free(chunk);
+    \\}
+    \\
+    \\void* __1im_future_new(size_t size) {
+    \\    size = (size + 63) & ~(size_t)63;
+    \\    __1im_chunk* chunk = __1im_future_chunk;
+    \\    if (chunk == NULL || (size_t)(__1im_future_end - __1im_future_next) < size) {
+    \\        char* start = (char*)(chunk + 1);
+    \\        if (chunk != NULL && atomic_load_explicit(&chunk->live, memory_order_acquire) == 1 &&
+    \\            (size_t)(__1im_future_end - start) >= size) {
+    \\            __1im_future_next = start;
+    \\        } else {
+    \\            size_t bytes = sizeof(__1im_chunk) + size;
+    \\            if (bytes < __1IM_FUTURE_CHUNK) bytes = __1IM_FUTURE_CHUNK;
+    \\            if (chunk != NULL) __1im_chunk_drop(chunk);
+    \\            chunk = aligned_alloc(64, bytes);
+    \\            if (chunk == NULL) abort();
+    \\            atomic_init(&chunk->live, 1);
+    \\            __1im_future_chunk = chunk;
+    \\            __1im_future_next = (char*)(chunk + 1);
+    \\            __1im_future_end = (char*)chunk + bytes;
+    \\        }
+    \\    }
+    \\    __1im_future* future = (__1im_future*)__1im_future_next;
+    \\    __1im_future_next += size;
+    \\    memset(future, 0, size);
+    \\    future->chunk = chunk;
+    \\    atomic_fetch_add_explicit(&chunk->live, 1, memory_order_relaxed);
+    \\    return future;
+    \\}
+    \\
+    \\/* Only once the future has been awaited: its task no longer touches it. */
+    \\void __1im_future_free(__1im_future* future) {
+    \\    __1im_chunk_drop(future->chunk);
+    \\}
+    \\
+    \\/* The future's arguments must be in place: the task may start at once. */
+    \\void __1im_spawn(__1im_future* future, void (*fn)(void*)) {
+    \\    future->task = (__1im_task){ fn, future, &future->group };
+    \\    __1im_submit(&future->task);
+    \\}
+    \\
+    \\/* Returns `future` once its task has finished. */
+    \\void* __1im_await(__1im_future* future) {
+    \\    __1im_wait(&future->group);
+    \\    return future;
+    \\}
+    \\
+    \\#ifdef __linux__
+    \\#include <linux/futex.h>
+    \\#include <sys/syscall.h>
+    \\
+    \\/* Sleeps while `*addr` holds `value`; may return early. */
+    \\static void __1im_futex_wait(atomic_int* addr, int value) {
+    \\    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+    \\}
+    \\
+    \\static void __1im_futex_wake(atomic_int* addr) {
+    \\    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    \\}
+    \\#else
+    \\static void __1im_futex_wait(atomic_int* addr, int value) {
+    \\    (void)addr;
+    \\    (void)value;
+    \\    sched_yield();
+    \\}
+    \\
+    \\static void __1im_futex_wake(atomic_int* addr) {
+    \\    (void)addr;
+    \\}
+    \\#endif
+    \\
+    \\/* Critical sections are short: spin a little before going to sleep. */
+    \\void __1im_lock_slow(__1im_mutex* m) {
+    \\    for (int spin = 0; spin < 100; spin++) {
+    \\        int unlocked = 0;
+    \\        if (atomic_load_explicit(&m->state, memory_order_relaxed) == 0 &&
+    \\            atomic_compare_exchange_weak_explicit(&m->state, &unlocked, 1, memory_order_acquire, memory_order_relaxed)) return;
+    \\    }
+    \\    /* Whoever takes the mutex from here on marks it as having sleepers,
+    \\       so its unlock wakes the next one. */
+    \\    while (atomic_exchange_explicit(&m->state, 2, memory_order_acquire) != 0) __1im_futex_wait(&m->state, 2);
+    \\}
+    \\
+    \\void __1im_wake(__1im_mutex* m) {
+    \\    __1im_futex_wake(&m->state);
+    \\}
+    \\
+    \\/* Vyukov's bounded MPMC queue. Cell k's `seq` is k when it is free for
+    \\   the send claiming position k, k + 1 once that send has stored its
+    \\   message, and k + capacity when the receive of position k has taken it,
+    \\   freeing the cell for the next lap. */
+    \\typedef struct {
+    \\    atomic_size_t seq;
+    \\    __1im_word value;
+    \\} __1im_cell;
+    \\
+    \\struct __1im_channel {
+    \\    /* Next position to send to, and to receive from. */
+    \\    _Alignas(64) atomic_size_t tail;
+    \\    _Alignas(64) atomic_size_t head;
+    \\    _Alignas(64) size_t mask;
+    \\    __1im_cell* cells;
+    \\};
+    \\
+    \\/* Holds at least `capacity` messages, rounded up to a power of two and
+    \\   to whole cache lines of cells. Channels are never freed. */
+    \\__1im_channel* __1im_channel_new(int64_t capacity) {
+    \\    size_t size = 64 / sizeof(__1im_cell);
+    \\    while ((int64_t)size < capacity && size < ((size_t)1 << 40)) size *= 2;
+    \\    __1im_channel* c = aligned_alloc(64, sizeof(__1im_channel));
+    \\    __1im_cell* cells = aligned_alloc(64, size * sizeof(__1im_cell));
+    \\    if (c == NULL || cells == NULL) abort();
+    \\    atomic_init(&c->tail, 0);
+    \\    atomic_init(&c->head, 0);
+    \\    c->mask = size - 1;
+    \\    c->cells = cells;
+    \\    for (size_t k = 0; k < size; k++) atomic_init(&cells[k].seq, k);
+    \\    return c;
+    \\}
+    \\
+    \\static bool __1im_try_send(__1im_channel* c, __1im_word v) {
+    \\    size_t pos = atomic_load_explicit(&c->tail, memory_order_relaxed);
+    \\    for (;;) {
+    \\        __1im_cell* cell = &c->cells[pos & c->mask];
+    \\        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    \\        intptr_t lap = (intptr_t)(seq - pos);
+    \\        if (lap == 0) {
+    \\            if (atomic_compare_exchange_weak_explicit(&c->tail, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+    \\                cell->value = v;
+    \\                atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+    \\                return true;
+    \\            }
+    \\        } else if (lap < 0) {
+    \\            /* Not yet received from on the previous lap: full. */
+    \\            return false;
+    \\        } else {
+    \\            pos = atomic_load_explicit(&c->tail, memory_order_relaxed);
+    \\        }
+    \\    }
+    \\}
+    \\
+    \\static bool __1im_try_receive(__1im_channel* c, __1im_word* v) {
+    \\    size_t pos = atomic_load_explicit(&c->head, memory_order_relaxed);
+    \\    for (;;) {
+    \\        __1im_cell* cell = &c->cells[pos & c->mask];
+    \\        size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+    \\        intptr_t lap = (intptr_t)(seq - (pos + 1));
+    \\        if (lap == 0) {
+    \\            if (atomic_compare_exchange_weak_explicit(&c->head, &pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+    \\                *v = cell->value;
+    \\                atomic_store_explicit(&cell->seq, pos + c->mask + 1, memory_order_release);
+    \\                return true;
+    \\            }
+    \\        } else if (lap < 0) {
+    \\            /* Not yet sent to on this lap: empty. */
+    \\            return false;
+    \\        } else {
+    \\            pos = atomic_load_explicit(&c->head, memory_order_relaxed);
+    \\        }
+    \\    }
+    \\}
+    \\
+    \\/* Counts the caller as waiting on a channel. Once every thread of the
+    \\   pool is, starts a spare worker to run the tasks queued behind them,
+    \\   among which may be the ones they wait for. */
+    \\static void __1im_block(void) {
+    \\    pthread_once(&__1im_pool.once, __1im_start);
+    \\    long blocked = atomic_fetch_add(&__1im_pool.blocked, 1) + 1;
+    \\    if (blocked < atomic_load(&__1im_pool.threads)) return;
+    \\    pthread_mutex_lock(&__1im_pool.lock);
+    \\    long spare = atomic_load(&__1im_pool.threads);
+    \\    if (atomic_load(&__1im_pool.blocked) >= spare && spare < __1IM_MAX_WORKERS) {
+    \\        /* Counted first, so that the spare steals from every deque. */
+    \\        atomic_store_explicit(&__1im_pool.threads, spare + 1, memory_order_release);
+    \\        pthread_t thread;
+    \\        if (pthread_create(&thread, NULL, __1im_worker_main, (void*)(intptr_t)spare) == 0) pthread_detach(thread);
+    \\        else atomic_store_explicit(&__1im_pool.threads, spare, memory_order_release);
+    \\    }
+    \\    pthread_mutex_unlock(&__1im_pool.lock);
+    \\}
+    \\
+    \\/* A full or empty channel: spin a little, then count as blocked and
+    \\   yield until it is not. */
+    \\#define __1IM_CHANNEL_SPINS 64
+    \\
+    \\static void __1im_backoff(int* round) {
+    \\    if (*round < __1IM_CHANNEL_SPINS) {
+    \\        ++*round;
+    \\        return;
+    \\    }
+    \\    if (*round == __1IM_CHANNEL_SPINS) {
+    \\        ++*round;
+    \\        __1im_block();
+    \\    }
+    \\    sched_yield();
+    \\}
+    \\
+    \\static void __1im_unblock(int round) {
+    \\    if (round > __1IM_CHANNEL_SPINS) atomic_fetch_sub(&__1im_pool.blocked, 1);
+    \\}
+    \\
+    \\void __1im_send(__1im_channel* c, __1im_word v) {
+    \\    int round = 0;
+    \\    while (!__1im_try_send(c, v)) __1im_backoff(&round);
+    \\    __1im_unblock(round);
+    \\}
+    \\
+    \\__1im_word __1im_receive(__1im_channel* c) {
+    \\    __1im_word v;
+    \\    int round = 0;
+    \\    while (!__1im_try_receive(c, &v)) __1im_backoff(&round);
+    \\    __1im_unblock(round);
+    \\    return v;
+    \\}
+    \\
+;
+
+/// Output for `print`, emitted into every program whether or not it uses
+/// the task runtime; like `decls` and `defs`, `print_defs` goes into the
+/// entry module's file only.
+///
+/// Each thread appends lines to a 64 KiB buffer of its own and hands it to
+/// write(2) when it fills and at exit, or after every line when stdout is a
+/// terminal. Integers are converted two digits at a time from a table.
+/// Floats get printf's "%f" digits, computed exactly from the double's bits
+/// with 128-bit integer arithmetic; huge values, infinities, NaNs and
+/// compilers without `__int128` use snprintf. An interpolated `print`
+/// takes room for its whole line with `__1im_print_begin` and fills it in
+/// place. The per-thread state is `__1IM_TLS`, which codegen defines as
+/// `_Thread_local` only when the program can have more than one thread.
+pub const print_decls =
+    \\void __1im_print_i64(int64_t v);
+    \\void __1im_print_u64(uint64_t v);
+    \\void __1im_print_f64(double v);
+    \\void __1im_print_bytes(const char* p, size_t n);
+    \\void __1im_print_cstr(const char* s);
+    \\char* __1im_print_begin(size_t n);
+    \\void __1im_print_end(char* line, size_t n);
+    \\void __1im_flush(void);
+    \\
+    \\/* Longest "%f\n" of a double: "-", 309 digits, the point and 6 more. */
+    \\#define __1IM_F64_MAX 320
+    \\
+;
+
+pub const print_defs =
+    \\#include <stdlib.h>
+    \\#include <errno.h>
+    \\#include <unistd.h>
+    \\
+    \\#define __1IM_OUT_CAP (64 * 1024)
+    \\static __1IM_TLS struct {
+    \\    size_t len;
+    \\    char buf[__1IM_OUT_CAP];
+    \\} __1im_out;
+    \\static __1IM_TLS int __1im_out_used = 0;
+    \\static pthread_once_t __1im_out_once = PTHREAD_ONCE_INIT;
+    \\/* Set when stdout is a terminal: every line is written at once. */
+    \\static int __1im_out_lines = 0;
+    \\
+    \\static const char __1im_digit_pairs[] =
+    \\    "0001020304050607080910111213141516171819"
+    \\    "2021222324252627282930313233343536373839"
+    \\    "4041424344454647484950515253545556575859"
+    \\    "6061626364656667686970717273747576777879"
+    \\    "8081828384858687888990919293949596979899";
+    \\
+    \\static void __1im_write(const char* p, size_t n) {
+    \\    while (n > 0) {
+    \\        ssize_t w = write(STDOUT_FILENO, p, n);
+    \\        if (w < 0 && errno == EINTR) continue;
+    \\        if (w <= 0) return;
+    \\        p += w;
+    \\        n -= (size_t)w;
+    \\    }
+    \\}
+    \\
+    \\void __1im_flush(void) {
+    \\    if (__1im_out.len == 0) return;
+    \\    __1im_write(__1im_out.buf, __1im_out.len);
+    \\    __1im_out.len = 0;
+    \\}
+    \\
+    \\static void __1im_out_init(void) {
+    \\    __1im_out_lines = isatty(STDOUT_FILENO);
+    \\    atexit(__1im_flush);
+    \\}
+    \\
+    \\/* Room for `n` bytes at the end of this thread's buffer. */
+    \\static char* __1im_out_reserve(size_t n) {
+    \\    if (!__1im_out_used) {
+    \\        pthread_once(&__1im_out_once, __1im_out_init);
+    \\        __1im_out_used = 1;
+    \\    }
+    \\    if (__1IM_OUT_CAP - __1im_out.len < n) __1im_flush();
+    \\    return __1im_out.buf + __1im_out.len;
+    \\}
+    \\
+    \\/* Keeps the `n` bytes written after __1im_out_reserve, a whole line. */
+    \\static void __1im_out_commit(size_t n) {
+    \\    __1im_out.len += n;
+    \\    if (__1im_out_lines) __1im_flush();
+    \\}
+    \\
+    \\/* Writes the decimal digits of `v` so that they end at `end`. */
+    \\static void __1im_put_digits(char* end, uint64_t v) {
+    \\    while (v >= 100) {
+    \\        end -= 2;
+    \\        memcpy(end, __1im_digit_pairs + (v % 100) * 2, 2);
+    \\        v /= 100;
+    \\    }
+    \\    if (v >= 10) {
+    \\        end -= 2;
+    \\        memcpy(end, __1im_digit_pairs + v * 2, 2);
+    \\    } else {
+    \\        *--end = (char)('0' + v);
+    \\    }
+    \\}
+    \\
+    \\/* Writes the decimal digits of `v` at `p` and returns their count. */
+    \\static size_t __1im_put_u64(char* p, uint64_t v) {
+    \\    size_t n = 1;
+    \\    for (uint64_t t = v; t >= 10; t /= 10) n++;
+    \\    __1im_put_digits(p + n, v);
+    \\    return n;
+    \\}
+    \\
+    \\void __1im_print_u64(uint64_t v) {
+    \\    char* p = __1im_out_reserve(21);
+    \\    size_t n = __1im_put_u64(p, v);
+    \\    p[n++] = '\n';
+    \\    __1im_out_commit(n);
+    \\}
+    \\
+    \\void __1im_print_i64(int64_t v) {
+    \\    char* p = __1im_out_reserve(22);
+    \\    size_t n = 0;
+    \\    if (v < 0) p[n++] = '-';
+    \\    n += __1im_put_u64(p + n, v < 0 ? 0 - (uint64_t)v : (uint64_t)v);
+    \\    p[n++] = '\n';
+    \\    __1im_out_commit(n);
+    \\}
+    \\
+    \\#ifdef __SIZEOF_INT128__
+    \\/* "%f\n" of `v` at `p`, rounding the exact binary value half to even like
+    \\   printf. Returns the length, or 0 for infinities, NaNs and |v| >= 2^64. */
+    \\static size_t __1im_put_f64(char* p, double v) {
+    \\    uint64_t bits;
+    \\    memcpy(&bits, &v, sizeof bits);
+    \\    int biased = (int)(bits >> 52 & 0x7ff);
+    \\    uint64_t mant = bits & ((UINT64_C(1) << 52) - 1);
+    \\    if (biased == 0x7ff) return 0;
+    \\    /* |v| = mant * 2^exp */
+    \\    int exp = biased == 0 ? -1074 : biased - 1075;
+    \\    if (biased != 0) mant |= UINT64_C(1) << 52;
+    \\
+    \\    uint64_t whole, micros = 0;
+    \\    if (exp >= 0) {
+    \\        if (exp > 11) return 0;
+    \\        whole = mant << exp;
+    \\    } else {
+    \\        int k = -exp;
+    \\        whole = k < 64 ? mant >> k : 0;
+    \\        uint64_t frac = k < 64 ? mant & ((UINT64_C(1) << k) - 1) : mant;
+    \\        /* frac < 2^53, so scaled < 2^73 and rounds to 0 once k > 73. */
+    \\        unsigned __int128 scaled = (unsigned __int128)frac * 1000000;
+    \\        if (k <= 73) {
+    \\            unsigned __int128 half = (unsigned __int128)1 << (k - 1);
+    \\            unsigned __int128 rest = scaled & ((half << 1) - 1);
+    \\            micros = (uint64_t)(scaled >> k);
+    \\            if (rest > half || (rest == half && (micros & 1))) micros++;
+    \\            if (micros == 1000000) {
+    \\                micros = 0;
+    \\                whole++;
+    \\            }
+    \\        }
+    \\    }
+    \\
+    \\    size_t n = 0;
+    \\    if (bits >> 63) p[n++] = '-';
+    \\    n += __1im_put_u64(p + n, whole);
+    \\    p[n++] = '.';
+    \\    for (int i = 5; i >= 0; i--) {
+    \\        p[n + i] = (char)('0' + micros % 10);
+    \\        micros /= 10;
+    \\    }
+    \\    n += 6;
+    \\    p[n++] = '\n';
+    \\    return n;
+    \\}
+    \\#endif
+    \\
+    \\void __1im_print_f64(double v) {
+    \\    char* p = __1im_out_reserve(__1IM_F64_MAX);
+    \\    size_t n = 0;
+    \\#ifdef __SIZEOF_INT128__
+    \\    n = __1im_put_f64(p, v);
+    \\#endif
+    \\    if (n == 0) n = (size_t)snprintf(p, __1IM_F64_MAX, "%f\n", v);
+    \\    __1im_out_commit(n);
+    \\}
+    \\
+    \\void __1im_print_bytes(const char* s, size_t n) {
+    \\    if (n >= __1IM_OUT_CAP) {
+    \\        __1im_flush();
+    \\        __1im_write(s, n);
+    \\        __1im_write("\n", 1);
+    \\        return;
+    \\    }
+    \\    char* p = __1im_out_reserve(n + 1);
+    \\    memcpy(p, s, n);
+    \\    p[n] = '\n';
+    \\    __1im_out_commit(n + 1);
+    \\}
+    \\
+    \\void __1im_print_cstr(const char* s) {
+    \\    __1im_print_bytes(s, strlen(s));
+    \\}
+    \\
+    \\/* Room for a line of `n` bytes, which the caller writes and then hands
+    \\   to __1im_print_end. */
+    \\char* __1im_print_begin(size_t n) {
+    \\    if (n < __1IM_OUT_CAP) return __1im_out_reserve(n + 1);
+    \\    char* line = malloc(n + 1);
+    \\    if (line == NULL) abort();
+    \\    return line;
+    \\}
+    \\
+    \\void __1im_print_end(char* line, size_t n) {
+    \\    line[n] = '\n';
+    \\    if (n < __1IM_OUT_CAP) {
+    \\        __1im_out_commit(n + 1);
+    \\        return;
+    \\    }
+    \\    __1im_flush();
+    \\    __1im_write(line, n + 1);
+    \\    free(line);
+    \\}
+    \\
+;
+
+/// The `str` type, emitted into every program like `print_decls`;
+/// `str_defs` goes into the entry module's file only.
+///
+/// A string is its length and its bytes: inline in `small`, NUL-terminated,
+/// when it is shorter than 16 bytes, else at `ptr`, which literals point at
+/// their C string and concatenations at a heap buffer, `buf`. `len` needs
+/// no strlen, `==` compares lengths first, and strings are copied and
+/// passed by value without touching the heap.
+///
+/// `a + b` copies both into a new buffer with room for as much again,
+/// except when `a` ends where its buffer's used part does: then `b` goes
+/// right after it, in place. Bytes before the end of a buffer never change,
+/// so `a` and every other string sharing the buffer still read the same,
+/// and a loop that keeps appending to one string copies each piece once
+/// and reallocates only when the buffer doubles. Claiming the free space is
+/// left to the thread that made the buffer, so tasks appending to a string
+/// they were given copy it into buffers of their own. Buffers are never
+/// freed.
+///
+/// Interpolations size every value before writing any: `__1im_size_*`
+/// counts digits without producing them and `__1im_fmt_*` then writes them
+/// into the exact room left, using the digit table from `print_defs`.
+pub const str_decls =
+    \\typedef struct __1im_strbuf {
+    \\    /* The thread that made the buffer, the only one appending in place. */
+    \\    const char* owner;
+    \\    /* Bytes of `data` taken by strings; the rest is free. */
+    \\    size_t used, cap;
+    \\    char data[];
+    \\} __1im_strbuf;
+    \\
+    \\typedef struct {
+    \\    size_t len;
+    \\    union {
+    \\        struct {
+    \\            const char* ptr;
+    \\            __1im_strbuf* buf;
+    \\        };
+    \\        char small[16];
+    \\    };
+    \\} __1im_str;
+    \\
+    \\extern __1IM_TLS char __1im_str_thread;
+    \\__1im_str __1im_str_join(__1im_str a, __1im_str b);
+    \\
+    \\static inline const char* __1im_str_data(const __1im_str* s) {
+    \\    return s->len < 16 ? s->small : s->ptr;
+    \\}
+    \\
+    \\/* `a + b`: in place when `a` is the end of this thread's buffer and `b`
+    \\   fits after it, else through `__1im_str_join`. */
+    \\static inline __1im_str __1im_str_cat(__1im_str a, __1im_str b) {
+    \\    __1im_strbuf* buf = a.len >= 16 ? a.buf : NULL;
+    \\    if (buf != NULL && buf->owner == &__1im_str_thread) {
+    \\        size_t end = (size_t)(a.ptr - buf->data) + a.len;
+    \\        if (end == buf->used && buf->cap - end >= b.len) {
+    \\            memcpy(buf->data + end, __1im_str_data(&b), b.len);
+    \\            buf->used = end + b.len;
+    \\            a.len += b.len;
+    \\            return a;
+    \\        }
+    \\    }
+    \\    return __1im_str_join(a, b);
+    \\}
+    \\
+    \\/* A literal of `n` bytes whose length the compiler did not work out. */
+    \\static inline __1im_str __1im_str_lit(const char* p, size_t n) {
+    \\    __1im_str s = { n, { { p, NULL } } };
+    \\    if (n < 16) memcpy(s.small, p, n + 1);
+    \\    return s;
+    \\}
+    \\
+    \\static inline bool __1im_str_eq(__1im_str a, __1im_str b) {
+    \\    return a.len == b.len && memcmp(__1im_str_data(&a), __1im_str_data(&b), a.len) == 0;
+    \\}
+    \\
+    \\static inline int __1im_str_cmp(__1im_str a, __1im_str b) {
+    \\    int c = memcmp(__1im_str_data(&a), __1im_str_data(&b), a.len < b.len ? a.len : b.len);
+    \\    return c != 0 ? c : (a.len > b.len) - (a.len < b.len);
+    \\}
+    \\
+    \\static inline void __1im_print_str(__1im_str s) {
+    \\    __1im_print_bytes(__1im_str_data(&s), s.len);
+    \\}
+    \\
+    \\/* Interpolation: a string of `n` bytes for the caller to fill in, and
+    \\   the sizes and bytes of the values between the text. */
+    \\char* __1im_str_alloc(__1im_str* s, size_t n);
+    \\size_t __1im_size_u64(uint64_t v);
+    \\size_t __1im_size_i64(int64_t v);
+    \\void __1im_fmt_u64(char* p, uint64_t v, size_t n);
+    \\void __1im_fmt_i64(char* p, int64_t v, size_t n);
+    \\size_t __1im_fmt_f64(char* p, double v);
+    \\
+;
+
+pub const str_defs =
+    \\__1IM_TLS char __1im_str_thread;
+    \\
+    \\static __1im_strbuf* __1im_strbuf_new(size_t used, size_t cap) {
+    \\    __1im_strbuf* buf = malloc(sizeof(__1im_strbuf) + cap);
+    \\    if (buf == NULL) abort();
+    \\    buf->owner = &__1im_str_thread;
+    \\    buf->used = used;
+    \\    buf->cap = cap;
+    \\    return buf;
+    \\}
+    \\
+    \\/* `a + b` in a new buffer, or inline when short. */
+    \\__1im_str __1im_str_join(__1im_str a, __1im_str b) {
+    \\    size_t n = a.len + b.len;
+    \\    const char* pa = __1im_str_data(&a);
+    \\    const char* pb = __1im_str_data(&b);
+    \\    __1im_str r = { n, { { NULL, NULL } } };
+    \\    if (n < 16) {
+    \\        memcpy(r.small, pa, a.len);
+    \\        memcpy(r.small + a.len, pb, b.len);
+    \\        r.small[n] = '\0';
+    \\        return r;
+    \\    }
+    \\    if (b.len == 0) return a;
+    \\    if (a.len == 0) return b;
+    \\    __1im_strbuf* buf = __1im_strbuf_new(n, n < 32 ? 64 : 2 * n);
+    \\    memcpy(buf->data, pa, a.len);
+    \\    memcpy(buf->data + a.len, pb, b.len);
+    \\    r.ptr = buf->data;
+    \\    r.buf = buf;
+    \\    return r;
+    \\}
+    \\
+    \\char* __1im_str_alloc(__1im_str* s, size_t n) {
+    \\    s->len = n;
+    \\    if (n < 16) {
+    \\        s->small[n] = '\0';
+    \\        return s->small;
+    \\    }
+    \\    __1im_strbuf* buf = __1im_strbuf_new(n, n);
+    \\    s->ptr = buf->data;
+    \\    s->buf = buf;
+    \\    return buf->data;
+    \\}
+    \\
+    \\size_t __1im_size_u64(uint64_t v) {
+    \\    size_t n = 1;
+    \\    for (; v >= 100; v /= 100) n += 2;
+    \\    return n + (v >= 10);
+    \\}
+    \\
+    \\size_t __1im_size_i64(int64_t v) {
+    \\    return v < 0 ? 1 + __1im_size_u64(0 - (uint64_t)v) : __1im_size_u64((uint64_t)v);
+    \\}
+    \\
+    \\/* `n` is the value's size. */
+    \\void __1im_fmt_u64(char* p, uint64_t v, size_t n) {
+    \\    __1im_put_digits(p + n, v);
+    \\}
+    \\
+    \\void __1im_fmt_i64(char* p, int64_t v, size_t n) {
+    \\    if (v < 0) *p = '-';
+    \\    __1im_put_digits(p + n, v < 0 ? 0 - (uint64_t)v : (uint64_t)v);
+    \\}
+    \\
+    \\/* "%f" of `v` at `p`, which has room for __1IM_F64_MAX bytes; returns
+    \\   the length. */
+    \\size_t __1im_fmt_f64(char* p, double v) {
+    \\    size_t n = 0;
+    \\#ifdef __SIZEOF_INT128__
+    \\    n = __1im_put_f64(p, v);
+    \\#endif
+    \\    if (n == 0) n = (size_t)snprintf(p, __1IM_F64_MAX, "%f\n", v);
+    \\    return n - 1;
+    \\}
+    \\
+;
+
+/// Heap slices and arenas, emitted into every program like `print_decls`;
+/// `alloc_defs` goes into the entry module's file only.
+///
+/// A slice struct is `{ data, len, cap, arena }`. Views of arrays, parts
+/// `xs[a..b]` and the copies of a slice that parameters and other variables
+/// get have no capacity (`cap` 0), so the first `append` copies them out.
+/// Slices from `alloc`, `copy` or grown by `append` own `cap` elements,
+/// allocated with malloc when `arena` is NULL and from the arena otherwise.
+/// A full slice grows to twice its size: heap storage with realloc, arena
+/// storage in place when it is the arena's latest allocation and by copying
+/// otherwise, leaving the old copy to the next `reset`.
+///
+/// `xs[a..b]`, and `xs[i]` unless built with `--mode=fast`, check their
+/// bounds and exit with status 1 and a message when they are out of range.
+///
+/// An arena hands out memory from 64 KiB and larger blocks, each twice the
+/// size of the last. `reset` frees every block but the newest and largest
+/// and empties it, so code that resets an arena once per iteration settles
+/// into a single block and stops calling malloc. Arenas themselves, like
+/// channels, are never freed.
+pub const alloc_decls =
+    \\typedef struct __1im_arena __1im_arena;
+    \\
+    \\__1im_arena* __1im_arena_new(void);
+    \\void __1im_arena_reset(__1im_arena* a);
+    \\void __1im_arena_free(__1im_arena* a);
+    \\
+    \\void* __1im_alloc(int64_t len, size_t elem, __1im_arena* arena);
+    \\void* __1im_grow(void* data, size_t len, size_t* cap, __1im_arena* arena, size_t elem, size_t want);
+    \\void __1im_release(void* data, size_t cap, __1im_arena* arena);
+    \\void* __1im_copy(const void* data, size_t len, size_t elem);
+    \\_Noreturn void __1im_range_fail(int64_t lo, int64_t hi, size_t len);
+    \\_Noreturn void __1im_index_fail(int64_t i, size_t len);
+    \\
+    \\static inline size_t __1im_cap(size_t len, size_t cap) {
+    \\    return cap > len ? cap : len;
+    \\}
+    \\
+    \\/* A bounds-checked index; one unsigned compare covers i < 0 too. */
+    \\static inline size_t __1im_index(int64_t i, size_t len) {
+    \\    if ((uint64_t)i >= len) __1im_index_fail(i, len);
+    \\    return (size_t)i;
+    \\}
+    \\
+;
+
+pub const alloc_defs =
+    \\#define __1IM_ARENA_BLOCK (64 * 1024)
+    \\
+    \\typedef struct __1im_arena_block {
+    \\    struct __1im_arena_block* prev;
+    \\    size_t size, used;
+    \\    max_align_t data[];
+    \\} __1im_arena_block;
+    \\
+    \\struct __1im_arena {
+    \\    /* The newest block; allocations come from its unused end. */
+    \\    __1im_arena_block* block;
+    \\};
+    \\
+    \\__1im_arena* __1im_arena_new(void) {
+    \\    __1im_arena* a = malloc(sizeof(__1im_arena));
+    \\    if (a == NULL) abort();
+    \\    a->block = NULL;
+    \\    return a;
+    \\}
+    \\
+    \\static size_t __1im_align(size_t size) {
+    \\    return (size + sizeof(max_align_t) - 1) & ~(sizeof(max_align_t) - 1);
+    \\}
+    \\
+    \\static void* __1im_arena_alloc(__1im_arena* a, size_t size) {
+    \\    size = __1im_align(size);
+    \\    __1im_arena_block* b = a->block;
+    \\    if (b == NULL || b->size - b->used < size) {
+    \\        size_t block = b ? b->size * 2 : __1IM_ARENA_BLOCK;
+    \\        while (block < size) block *= 2;
+    \\        __1im_arena_block* fresh = malloc(sizeof(__1im_arena_block) + block);
+    \\        if (fresh == NULL) abort();
+    \\        *fresh = (__1im_arena_block){ b, block, 0 };
+    \\        a->block = b = fresh;
+    \\    }
+    \\    void* p = (char*)b->data + b->used;
+    \\    b->used += size;
+    \\    return p;
+    \\}
+    \\
+    \\/* Grows the arena's latest allocation, `p` of `old` bytes, to `size`
+    \\   bytes if the block has room; false otherwise. */
+    \\static bool __1im_arena_extend(__1im_arena* a, void* p, size_t old, size_t size) {
+    \\    __1im_arena_block* b = a->block;
+    \\    if (b == NULL || p == NULL) return false;
+    \\    old = __1im_align(old);
+    \\    size = __1im_align(size);
+    \\    if ((char*)p + old != (char*)b->data + b->used || size - old > b->size - b->used) return false;
+    \\    b->used += size - old;
+    \\    return true;
+    \\}
+    \\
+    \\void __1im_arena_reset(__1im_arena* a) {
+    \\    __1im_arena_block* b = a->block;
+    \\    if (b == NULL) return;
+    \\    for (__1im_arena_block* p = b->prev; p != NULL;) {
+    \\        __1im_arena_block* prev = p->prev;
+    \\        free(p);
+    \\        p = prev;
+    \\    }
+    \\    b->prev = NULL;
+    \\    b->used = 0;
+    \\}
+    \\
+    \\/* Frees every block; the arena stays usable. */
+    \\void __1im_arena_free(__1im_arena* a) {
+    \\    __1im_arena_reset(a);
+    \\    free(a->block);
+    \\    a->block = NULL;
+    \\}
+    \\
+    \\static size_t __1im_bytes(size_t n, size_t elem) {
+    \\    if (elem != 0 && n > SIZE_MAX / elem) abort();
+    \\    return n * elem;
+    \\}
+    \\
+    \\/* `len` zeroed elements; NULL when there are none. */
+    \\void* __1im_alloc(int64_t len, size_t elem, __1im_arena* arena) {
+    \\    if (len < 0) abort();
+    \\    if (len == 0) return NULL;
+    \\    size_t size = __1im_bytes((size_t)len, elem);
+    \\    void* p = arena ? __1im_arena_alloc(arena, size) : calloc((size_t)len, elem);
+    \\    if (p == NULL) abort();
+    \\    if (arena) memset(p, 0, size);
+    \\    return p;
+    \\}
+    \\
+    \\/* Moves the `len` elements at `data` to storage for at least `want`,
+    \\   and at least twice as many as before; updates `cap`. */
+    \\void* __1im_grow(void* data, size_t len, size_t* cap, __1im_arena* arena, size_t elem, size_t want) {
+    \\    size_t old = *cap, fresh = (old > len ? old : len) * 2;
+    \\    if (fresh < 8) fresh = 8;
+    \\    if (fresh < want) fresh = want;
+    \\    size_t size = __1im_bytes(fresh, elem);
+    \\    void* p;
+    \\    if (arena != NULL) {
+    \\        if (old > 0 && __1im_arena_extend(arena, data, old * elem, size)) {
+    \\            p = data;
+    \\        } else {
+    \\            p = __1im_arena_alloc(arena, size);
+    \\            if (len > 0) memcpy(p, data, len * elem);
+    \\        }
+    \\    } else if (old > 0) {
+    \\        p = realloc(data, size);
+    \\    } else {
+    \\        /* A view, or nothing yet: the elements are not ours to resize. */
+    \\        p = malloc(size);
+    \\        if (p != NULL && len > 0) memcpy(p, data, len * elem);
+    \\    }
+    \\    if (p == NULL) abort();
+    \\    *cap = fresh;
+    \\    return p;
+    \\}
+    \\
+    \\void __1im_release(void* data, size_t cap, __1im_arena* arena) {
+    \\    if (arena == NULL && cap > 0) free(data);
+    \\}
+    \\
+    \\/* A heap copy of `len` elements, for `copy(xs)`. */
+    \\void* __1im_copy(const void* data, size_t len, size_t elem) {
+    \\    if (len == 0) return NULL;
+    \\    void* p = malloc(__1im_bytes(len, elem));
+    \\    if (p == NULL) abort();
+    \\    memcpy(p, data, len * elem);
+    \\    return p;
+    \\}
+    \\
+    \\_Noreturn void __1im_range_fail(int64_t lo, int64_t hi, size_t len) {
+    \\    fprintf(stderr, "1im: slice [%" PRId64 "..%" PRId64 "] out of range for length %zu\n", lo, hi, len);
+    \\    exit(1);
+    \\}
+    \\
+    \\_Noreturn void __1im_index_fail(int64_t i, size_t len) {
+    \\    fprintf(stderr, "1im: index %" PRId64 " out of range for length %zu\n", i, len);
+    \\    exit(1);
+    \\}
+    \\
+;
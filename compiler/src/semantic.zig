@@ -5,13 +5,27 @@ pub const SemanticError = error{
     Failure,
 };
 
-const SemType = union(enum) {
+/// Type of an expression. Untyped literals stay `int_lit`/`float_lit` until
+/// the context they are used in fixes their type.
+pub const SemType = union(enum) {
     known: ast.Type,
     null,
     int_lit,
     float_lit,
 };
 
+/// The analyzer's type for every expression, indexed by node, so code
+/// generators look types up instead of re-inferring them.
+pub const ExprTypes = struct {
+    items: []const ?SemType,
+
+    /// Null for statements and for expressions analysis never reached.
+    pub fn get(self: ExprTypes, node: ast.Index) ?SemType {
+        if (node >= self.items.len) return null;
+        return self.items[node];
+    }
+};
+
 const FunctionSig = struct {
     params: []const ast.Param,
     return_type: ?ast.Type,
@@ -20,25 +34,44 @@ const FunctionSig = struct {
 pub const Analyzer = struct {
     allocator: std.mem.Allocator,
     arena: std.heap.ArenaAllocator,
+    tree: *const ast.Tree,
     scopes: std.ArrayList(std.StringHashMap(ast.Type)),
     functions: std.StringHashMap(FunctionSig),
     inferred_returns: std.StringHashMap(ast.Type),
+    expr_types: std.ArrayList(?SemType),
     return_stack: std.ArrayList(?ast.Type),
     last_error: []const u8,
     in_function: bool,
     loop_depth: usize,
+    /// Innermost `parallel loop for` being checked, if any.
+    parallel_loop: ?ParallelLoop,
+
+    const ParallelLoop = struct {
+        /// Index in `scopes` of the loop's own scope; names declared below
+        /// it are shared by every iteration.
+        scope: usize,
+        /// `loop_depth` inside the loop, so `break` can tell it apart from
+        /// a nested sequential loop.
+        depth: usize,
+        /// Accumulators the iterations may assign: each thread updates a
+        /// private copy.
+        reductions: []const ast.Reduction,
+    };
 
     pub fn init(allocator: std.mem.Allocator) Analyzer {
         return .{
             .allocator = allocator,
             .arena = std.heap.ArenaAllocator.init(allocator),
+            .tree = undefined,
             .scopes = .empty,
             .functions = std.StringHashMap(FunctionSig).init(allocator),
             .inferred_returns = std.StringHashMap(ast.Type).init(allocator),
+            .expr_types = .empty,
             .return_stack = .empty,
             .last_error = "",
             .in_function = false,
             .loop_depth = 0,
+            .parallel_loop = null,
         };
     }
 
@@ -49,41 +82,65 @@ pub const Analyzer = struct {
         self.scopes.deinit(self.allocator);
         self.functions.deinit();
         self.inferred_returns.deinit();
+        self.expr_types.deinit(self.allocator);
         self.return_stack.deinit(self.allocator);
         self.arena.deinit();
     }
 
-    pub fn analyze(self: *Analyzer, program: ast.Node) SemanticError!void {
-        const prog = switch (program) {
-            .program => |p| p,
-            else => return self.fail("semantic error: expected program root"),
-        };
+    /// Makes an imported module's function callable under its qualified
+    /// name (`module.f`). Must be called before `analyze`.
+    pub fn declareImported(
+        self: *Analyzer,
+        name: []const u8,
+        params: []const ast.Param,
+        return_type: ?ast.Type,
+    ) SemanticError!void {
+        self.functions.put(name, .{
+            .params = params,
+            .return_type = return_type,
+        }) catch return self.fail("semantic error: out of memory");
+    }
+
+    pub fn analyze(self: *Analyzer, tree: *const ast.Tree) SemanticError!void {
+        self.tree = tree;
+        const stmts = tree.rootStmts();
+
+        self.expr_types.appendNTimes(self.allocator, null, tree.nodeCount()) catch return self.fail("semantic error: out of memory");
 
         try self.pushScope();
         defer self.popScope();
 
         // Collect function signatures.
-        for (prog.stmts) |stmt| {
-            if (stmt == .function_def) {
-                if (self.functions.contains(stmt.function_def.name)) {
+        for (stmts) |stmt| {
+            if (tree.tags[stmt] == .function_def) {
+                const fd = tree.node(stmt).function_def;
+                if (self.functions.contains(fd.name)) {
                     return self.fail("semantic error: duplicate function name");
                 }
-                self.functions.put(stmt.function_def.name, .{
-                    .params = stmt.function_def.params,
-                    .return_type = stmt.function_def.return_type,
+                self.functions.put(fd.name, .{
+                    .params = fd.params,
+                    .return_type = fd.return_type,
                 }) catch return self.fail("semantic error: out of memory");
             }
         }
 
-        try self.inferMissingFunctionReturns(prog);
+        try self.inferMissingFunctionReturns(stmts);
 
-        for (prog.stmts) |stmt| {
+        var has_affinity = false;
+        for (stmts) |stmt| {
+            if (tree.tags[stmt] == .affinity_decl) {
+                if (has_affinity) return self.fail("semantic error: parallel affinity is set more than once");
+                has_affinity = true;
+                continue;
+            }
             try self.checkStmt(stmt);
         }
     }
 
-    fn checkStmt(self: *Analyzer, node: ast.Node) SemanticError!void {
-        switch (node) {
+    fn checkStmt(self: *Analyzer, node: ast.Index) SemanticError!void {
+        switch (self.tree.node(node)) {
+            .import_decl => {}, // resolved by the module loader
+            .affinity_decl => return self.fail("semantic error: parallel affinity must be at the top level"),
             .set_assign => |sa| try self.checkSetAssign(sa),
             .typed_assign => |ta| try self.checkTypedAssign(ta),
             .index_assign => |ia| try self.checkIndexAssign(ia),
@@ -93,29 +150,35 @@ pub const Analyzer = struct {
             .while_loop => |wl| try self.checkWhile(wl),
             .for_loop => |fl| try self.checkFor(fl),
             .parallel_block => |pb| try self.checkParallelBlock(pb),
+            .parallel_assign => |pa| try self.checkParallelAssign(pa),
             .break_stmt => try self.checkBreak(),
             .continue_stmt => try self.checkContinue(),
             .try_catch => |tc| try self.checkTryCatch(tc),
             .expr_stmt => |es| {
-                if (self.containsTryExpr(es.expr.*) and es.expr.* != .try_expr) {
+                if (self.containsTryExpr(es.expr) and self.tree.tags[es.expr] != .try_expr) {
                     return self.fail("semantic error: try expression must be used directly in assignment or return");
                 }
-                _ = try self.inferExprType(es.expr.*);
+                _ = try self.inferExprType(es.expr);
             },
             else => return self.fail("semantic error: unsupported statement"),
         }
     }
 
     fn checkSetAssign(self: *Analyzer, sa: ast.SetAssign) SemanticError!void {
-        if (self.containsTryExpr(sa.value.*) and sa.value.* != .try_expr) {
+        if (self.containsTryExpr(sa.value) and self.tree.tags[sa.value] != .try_expr) {
             return self.fail("semantic error: try expression must be used directly in assignment or return");
         }
-        const value_type = try self.inferExprType(sa.value.*);
+        const value_type = try self.inferExprType(sa.value);
 
         if (self.lookupVar(sa.name)) |existing| {
-            if (existing == .array and sa.value.* == .array_literal) {
+            if (self.isCaptured(sa.name)) {
+                return self.fail("semantic error: parallel loop cannot assign to a variable declared outside it");
+            }
+            if (existing == .array and self.tree.tags[sa.value] == .array_literal) {
                 return self.fail("semantic error: array reassignment not supported");
             }
+            if (existing == .atomic) return self.fail("semantic error: atomic variables are written with atomic_store");
+            if (existing == .mutex) return self.fail("semantic error: mutex variables cannot be reassigned");
             try self.ensureAssignable(existing, value_type);
             return;
         }
@@ -137,10 +200,20 @@ pub const Analyzer = struct {
 
         try self.validateType(ta.type_info);
 
-        if (self.containsTryExpr(ta.value.*) and ta.value.* != .try_expr) {
+        if (self.containsTryExpr(ta.value) and self.tree.tags[ta.value] != .try_expr) {
             return self.fail("semantic error: try expression must be used directly in assignment or return");
         }
-        const value_type = try self.inferExprType(ta.value.*);
+        // `channel(n)` and `alloc(n)` take their element type from the
+        // declaration.
+        const made = (ta.type_info == .channel and self.isCallOf(ta.value, "channel")) or
+            (ta.type_info == .slice and self.isCallOf(ta.value, "alloc"));
+        if (made) {
+            const call = self.tree.node(ta.value).call;
+            if (ta.type_info == .channel) try self.checkChannelNew(call) else try self.checkAllocNew(call);
+            self.expr_types.items[ta.value] = .{ .known = ta.type_info };
+            return self.declareVar(ta.name, ta.type_info, true);
+        }
+        const value_type = try self.inferExprType(ta.value);
         if (ta.type_info == .slice) {
             if (ta.type_info.slice.elem.* == .array) {
                 return self.fail("semantic error: slice of arrays not supported");
@@ -161,6 +234,9 @@ pub const Analyzer = struct {
                 },
                 else => return self.fail("semantic error: slice assignment requires array or slice"),
             }
+        } else if (ta.type_info == .atomic) {
+            // A new cell holding the value.
+            try self.ensureAssignable(ta.type_info.atomic.elem.*, value_type);
         } else {
             try self.ensureAssignable(ta.type_info, value_type);
         }
@@ -193,6 +269,10 @@ pub const Analyzer = struct {
 
         if (return_type) |ret_type| {
             try self.validateType(ret_type);
+            // They live in the frame that declared them.
+            if (isShared(ret_type)) {
+                return self.fail("semantic error: functions cannot return atomics or mutexes");
+            }
             if (!self.blockReturns(fd.body)) {
                 return self.fail("semantic error: non-void function must return on all paths");
             }
@@ -206,6 +286,10 @@ pub const Analyzer = struct {
             return self.fail("semantic error: return outside of function");
         }
 
+        if (self.parallel_loop != null) {
+            return self.fail("semantic error: return inside parallel loop");
+        }
+
         const ret_type = self.currentFunctionReturnType() orelse return self.fail("semantic error: return not allowed here");
 
         if (ret_type == null) {
@@ -214,15 +298,15 @@ pub const Analyzer = struct {
         }
 
         if (rs.value == null) return self.fail("semantic error: missing return value");
-        if (self.containsTryExpr(rs.value.?.*) and rs.value.?.* != .try_expr) {
+        if (self.containsTryExpr(rs.value.?) and self.tree.tags[rs.value.?] != .try_expr) {
             return self.fail("semantic error: try expression must be used directly in assignment or return");
         }
-        const value_type = try self.inferExprType(rs.value.?.*);
+        const value_type = try self.inferExprType(rs.value.?);
         try self.ensureAssignable(ret_type.?, value_type);
     }
 
     fn checkIf(self: *Analyzer, is: ast.IfStmt) SemanticError!void {
-        const cond_type = try self.inferExprType(is.condition.*);
+        const cond_type = try self.inferExprType(is.condition);
         try self.ensureBool(cond_type);
 
         try self.pushScope();
@@ -231,8 +315,9 @@ pub const Analyzer = struct {
             try self.checkStmt(stmt);
         }
 
-        for (is.else_ifs) |elif| {
-            const elif_type = try self.inferExprType(elif.condition.*);
+        for (is.else_ifs) |elif_node| {
+            const elif = self.tree.node(elif_node).else_if;
+            const elif_type = try self.inferExprType(elif.condition);
             try self.ensureBool(elif_type);
 
             try self.pushScope();
@@ -255,7 +340,7 @@ pub const Analyzer = struct {
         if (wl.parallel) {
             return self.fail("semantic error: parallel while not supported");
         }
-        const cond_type = try self.inferExprType(wl.condition.*);
+        const cond_type = try self.inferExprType(wl.condition);
         try self.ensureBool(cond_type);
 
         self.loop_depth += 1;
@@ -272,10 +357,10 @@ pub const Analyzer = struct {
     fn checkFor(self: *Analyzer, fl: ast.ForLoop) SemanticError!void {
         var loop_var_type: ast.Type = undefined;
 
-        switch (fl.iterable.*) {
+        switch (self.tree.node(fl.iterable)) {
             .range => |range| {
-                const start_t = try self.inferExprType(range.start.*);
-                const end_t = try self.inferExprType(range.end.*);
+                const start_t = try self.inferExprType(range.start);
+                const end_t = try self.inferExprType(range.end);
                 const start_type = try self.rangeEndpointType(start_t);
                 const end_type = try self.rangeEndpointType(end_t);
                 if (!self.typeEquals(start_type, end_type)) {
@@ -284,11 +369,11 @@ pub const Analyzer = struct {
                 loop_var_type = start_type;
             },
             else => {
-                const iter_type = try self.inferExprType(fl.iterable.*);
+                const iter_type = try self.inferExprType(fl.iterable);
                 const kt = try self.requireKnownType(iter_type, "semantic error: for loop requires array or slice");
                 switch (kt) {
                     .array => |arr| {
-                        if (fl.iterable.* != .variable) {
+                        if (self.tree.tags[fl.iterable] != .variable) {
                             return self.fail("semantic error: for array requires variable iterable");
                         }
                         if (arr.elem.* == .array) {
@@ -311,37 +396,148 @@ pub const Analyzer = struct {
             return self.fail("semantic error: loop variable shadows an existing name");
         }
 
+        if (fl.grain) |grain| {
+            const grain_type = try self.inferExprType(grain);
+            const is_int = switch (grain_type) {
+                .int_lit => true,
+                .known => |kt| self.isInteger(kt),
+                else => false,
+            };
+            if (!is_int) return self.fail("semantic error: parallel loop grain must be an integer");
+        }
+        for (fl.reductions, 0..) |r, i| {
+            try self.checkReduction(r);
+            for (fl.reductions[0..i]) |prev| {
+                if (std.mem.eql(u8, prev.name, r.name)) return self.fail("semantic error: variable reduced twice");
+            }
+        }
+
         self.loop_depth += 1;
         defer self.loop_depth -= 1;
 
         try self.pushScope();
         defer self.popScope();
 
+        const prev_parallel = self.parallel_loop;
+        defer self.parallel_loop = prev_parallel;
+        if (fl.parallel) {
+            self.parallel_loop = .{ .scope = self.scopes.items.len - 1, .depth = self.loop_depth, .reductions = fl.reductions };
+        }
+
         try self.declareVar(fl.variable, loop_var_type, true);
         for (fl.body) |stmt| {
             try self.checkStmt(stmt);
         }
     }
 
+    fn checkReduction(self: *Analyzer, r: ast.Reduction) SemanticError!void {
+        const acc = self.lookupVar(r.name) orelse return self.fail("semantic error: reduction variable is not declared");
+        if (self.isCaptured(r.name)) {
+            return self.fail("semantic error: parallel loop cannot assign to a variable declared outside it");
+        }
+        switch (r.op) {
+            .sum, .product, .min, .max => if (!self.isNumeric(acc)) {
+                return self.fail("semantic error: reduction variable must be numeric");
+            },
+            .custom => {
+                const sig = self.functions.get(r.combiner) orelse return self.fail("semantic error: unknown reduction function");
+                const ret = sig.return_type orelse self.inferred_returns.get(r.combiner);
+                if (sig.params.len != 2 or ret == null or
+                    !self.typeEquals(sig.params[0].type_info, acc) or
+                    !self.typeEquals(sig.params[1].type_info, acc) or
+                    !self.typeEquals(ret.?, acc))
+                {
+                    return self.fail("semantic error: reduction function must take and return two values of the accumulator's type");
+                }
+                if (acc == .array or acc == .slice or acc == .error_union or isHandle(acc)) {
+                    return self.fail("semantic error: reduction variable must be a scalar");
+                }
+                try self.ensureAssignable(acc, try self.inferExprType(r.identity.?));
+            },
+        }
+    }
+
     fn checkParallelBlock(self: *Analyzer, pb: ast.ParallelBlock) SemanticError!void {
         for (pb.body) |stmt| {
-            switch (stmt) {
-                .expr_stmt => |es| switch (es.expr.*) {
+            switch (self.tree.node(stmt)) {
+                .expr_stmt => |es| switch (self.tree.node(es.expr)) {
                     .call => |c| {
-                        if (c.args.len != 0) {
-                            return self.fail("semantic error: parallel block calls cannot take arguments");
-                        }
-                        _ = try self.checkCall(c);
+                        if (isBuiltin(c.callee)) return self.fail("semantic error: parallel calls cannot be builtins");
+                        _ = try self.inferExprType(es.expr);
                     },
                     else => return self.fail("semantic error: parallel block only supports function calls"),
                 },
                 else => return self.fail("semantic error: parallel block only supports function calls"),
             }
         }
+        const calls = self.arena.allocator().alloc(ast.Index, pb.body.len) catch return self.fail("semantic error: out of memory");
+        for (pb.body, calls) |stmt, *call| call.* = self.tree.node(stmt).expr_stmt.expr;
+        try self.checkSharedWrites(calls);
+    }
+
+    /// Calls returning an error union are unwrapped as by `try`: the first
+    /// error cancels the calls not yet started and is returned.
+    fn checkParallelAssign(self: *Analyzer, pa: ast.ParallelAssign) SemanticError!void {
+        for (pa.calls) |call| {
+            if (self.containsTryExpr(call)) {
+                return self.fail("semantic error: try expression must be used directly in assignment or return");
+            }
+            if (self.tree.node(call) == .call and isBuiltin(self.tree.node(call).call.callee)) {
+                return self.fail("semantic error: parallel calls cannot be builtins");
+            }
+            const t = try self.inferExprType(call);
+            if (t != .known or t.known != .error_union) continue;
+            const ret_type = self.currentFunctionReturnType() orelse return self.fail("semantic error: parallel error outside of function");
+            if (ret_type == null or ret_type.? != .error_union) {
+                return self.fail("semantic error: parallel call error requires error-union function return");
+            }
+            if (!self.typeEquals(ret_type.?.error_union.err.*, t.known.error_union.err.*)) {
+                return self.fail("semantic error: parallel call error type must match function error type");
+            }
+        }
+        try self.checkSharedWrites(pa.calls);
+        try self.bindParallelTargets(pa);
+    }
+
+    /// Declares or assigns each target of `pa` with its call's result type.
+    fn bindParallelTargets(self: *Analyzer, pa: ast.ParallelAssign) SemanticError!void {
+        if (pa.targets.len != pa.calls.len) {
+            return self.fail("semantic error: parallel assignment needs one variable per call");
+        }
+        for (pa.targets, 0..) |target, i| {
+            const name = self.tree.node(target).variable.name;
+            for (pa.targets[0..i]) |prev| {
+                if (std.mem.eql(u8, self.tree.node(prev).variable.name, name)) {
+                    return self.fail("semantic error: variable assigned twice in parallel assignment");
+                }
+            }
+            // Arguments are all evaluated before any result is bound.
+            for (pa.calls) |call| {
+                if (self.mentionsVar(call, name)) {
+                    return self.fail("semantic error: parallel call arguments cannot use an assigned variable");
+                }
+            }
+
+            var value_type = try self.inferExprType(pa.calls[i]);
+            if (value_type == .known and value_type.known == .error_union) {
+                value_type = .{ .known = value_type.known.error_union.ok.* };
+            }
+            const kt = try self.requireKnownType(value_type, "semantic error: cannot infer type of parallel call");
+            if (self.typeEquals(kt, .void)) return self.fail("semantic error: cannot assign void value");
+
+            if (self.lookupVar(name)) |existing| {
+                if (self.isCaptured(name)) {
+                    return self.fail("semantic error: parallel loop cannot assign to a variable declared outside it");
+                }
+                try self.ensureAssignable(existing, value_type);
+            } else {
+                try self.declareVar(name, kt, false);
+            }
+        }
     }
 
     fn checkTryCatch(self: *Analyzer, tc: ast.TryCatch) SemanticError!void {
-        const try_type = try self.inferExprType(tc.try_expr.*);
+        const try_type = try self.inferExprType(tc.try_expr);
         const eu = try self.requireErrorUnion(try_type, "semantic error: try requires error union");
 
         try self.pushScope();
@@ -363,6 +559,9 @@ pub const Analyzer = struct {
         if (self.loop_depth == 0) {
             return self.fail("semantic error: break outside of loop");
         }
+        if (self.parallel_loop) |pl| {
+            if (pl.depth == self.loop_depth) return self.fail("semantic error: break inside parallel loop");
+        }
     }
 
     fn checkContinue(self: *Analyzer) SemanticError!void {
@@ -371,15 +570,40 @@ pub const Analyzer = struct {
         }
     }
 
-    fn inferExprType(self: *Analyzer, node: ast.Node) SemanticError!SemType {
-        return switch (node) {
+    /// Types of the analyzed program's expressions; valid after `analyze`.
+    pub fn exprTypes(self: *const Analyzer) ExprTypes {
+        return .{ .items = self.expr_types.items };
+    }
+
+    /// Infers and records the type of `node`. The return-type pre-pass may
+    /// visit an expression before the main pass; the later result wins.
+    fn inferExprType(self: *Analyzer, node: ast.Index) SemanticError!SemType {
+        const t = try self.computeExprType(node);
+        self.expr_types.items[node] = t;
+        return t;
+    }
+
+    fn computeExprType(self: *Analyzer, node: ast.Index) SemanticError!SemType {
+        return switch (self.tree.node(node)) {
             .int_literal => .int_lit,
             .float_literal => .float_lit,
             .string_literal => .{ .known = .str },
+            .interpolation => |ip| blk: {
+                for (ip.parts) |part| {
+                    const t = try self.resolveLiteralType(try self.inferExprType(part), "semantic error: cannot interpolate null");
+                    if (!self.isNumeric(t) and t != .bool and t != .str) {
+                        return self.fail("semantic error: only numbers, bools and strings can be interpolated");
+                    }
+                }
+                break :blk .{ .known = .str };
+            },
             .bool_literal => .{ .known = .bool },
             .null_literal => .null,
             .variable => |v| blk: {
-                if (self.lookupVar(v.name)) |t| break :blk .{ .known = t };
+                if (self.lookupVar(v.name)) |t| {
+                    if (t == .future) return self.fail("semantic error: a future can only be awaited");
+                    break :blk .{ .known = t };
+                }
                 return self.fail("semantic error: undefined variable");
             },
             .binary_op => |bin| try self.checkBinary(bin),
@@ -388,7 +612,7 @@ pub const Analyzer = struct {
             .array_literal => |arr| try self.checkArrayLiteral(arr),
             .index_expr => |ix| try self.checkIndex(ix),
             .try_expr => |te| {
-                const inner = try self.inferExprType(te.expr.*);
+                const inner = try self.inferExprType(te.expr);
                 const eu = try self.requireErrorUnion(inner, "semantic error: try requires error union");
 
                 const ret_type = self.currentFunctionReturnType() orelse return self.fail("semantic error: try outside of function");
@@ -400,17 +624,62 @@ pub const Analyzer = struct {
 
                 return .{ .known = eu.ok.* };
             },
+            .spawn_expr => |se| try self.checkSpawn(se),
+            // The first await frees the future and leaves its result in the
+            // variable, so a future is never copied or awaited by a parallel
+            // loop's iterations at once.
+            .await_expr => |ae| {
+                const name = switch (self.tree.node(ae.expr)) {
+                    .variable => |v| v.name,
+                    else => return self.fail("semantic error: await requires a future variable"),
+                };
+                const kt = self.lookupVar(name) orelse return self.fail("semantic error: undefined variable");
+                if (kt != .future) return self.fail("semantic error: await requires a future");
+                if (self.isCaptured(name)) return self.fail("semantic error: cannot await a future declared outside a parallel loop");
+                self.expr_types.items[ae.expr] = .{ .known = kt };
+                return .{ .known = kt.future.result.* };
+            },
             .range => return self.fail("semantic error: range is only valid in for loop"),
             else => return self.fail("semantic error: unsupported expression"),
         };
     }
 
+    /// Functions the compiler provides, which cannot run as tasks.
+    fn isBuiltin(callee: []const u8) bool {
+        return std.mem.eql(u8, callee, "print") or std.mem.eql(u8, callee, "len") or
+            ast.SyncBuiltin.of(callee) != null or ast.AllocBuiltin.of(callee) != null;
+    }
+
+    /// The call runs as a task; its errors surface where the future is awaited.
+    fn checkSpawn(self: *Analyzer, se: ast.SpawnExpr) SemanticError!SemType {
+        const c = self.tree.node(se.call).call;
+        if (isBuiltin(c.callee)) return self.fail("semantic error: cannot spawn a builtin");
+        const result = try self.requireKnownType(try self.inferExprType(se.call), "semantic error: cannot infer type of spawned call");
+        if (result == .array) return self.fail("semantic error: spawned function cannot return an array");
+        // The task may run after the spawning function has returned, so it
+        // cannot borrow that function's arrays, atomics or mutexes.
+        for (c.args) |arg| {
+            const t = self.expr_types.items[arg] orelse continue;
+            if (t == .known and (t.known == .array or t.known == .slice)) {
+                return self.fail("semantic error: spawned call cannot take array or slice arguments");
+            }
+            if (t == .known and (t.known == .atomic or t.known == .mutex)) {
+                return self.fail("semantic error: spawned call cannot take atomic or mutex arguments");
+            }
+        }
+        return .{ .known = .{ .future = .{ .result = try self.allocType(result) } } };
+    }
+
     fn checkBinary(self: *Analyzer, bin: ast.BinaryOp) SemanticError!SemType {
-        const lt = try self.inferExprType(bin.left.*);
-        const rt = try self.inferExprType(bin.right.*);
+        const lt = try self.inferExprType(bin.left);
+        const rt = try self.inferExprType(bin.right);
 
         switch (bin.op) {
             .add, .sub, .mul, .div, .mod => {
+                if (bin.op == .add and (self.isStrType(lt) or self.isStrType(rt))) {
+                    if (!self.isStrType(lt) or !self.isStrType(rt)) return self.fail("semantic error: + joins a str only to another str");
+                    return .{ .known = .str };
+                }
                 return try self.inferNumericBinary(lt, rt);
             },
             .eq, .neq => {
@@ -430,7 +699,7 @@ pub const Analyzer = struct {
     }
 
     fn checkUnary(self: *Analyzer, un: ast.UnaryOp) SemanticError!SemType {
-        const ot = try self.inferExprType(un.operand.*);
+        const ot = try self.inferExprType(un.operand);
         switch (un.op) {
             .negate => {
                 const t = try self.resolveLiteralType(ot, "unary - requires numeric type");
@@ -462,8 +731,9 @@ pub const Analyzer = struct {
     }
 
     fn checkIndex(self: *Analyzer, ix: ast.IndexExpr) SemanticError!SemType {
-        const target_type = try self.inferExprType(ix.target.*);
-        const index_type = try self.inferExprType(ix.index.*);
+        if (self.tree.node(ix.index) == .range) return self.checkSliceRange(ix);
+        const target_type = try self.inferExprType(ix.target);
+        const index_type = try self.inferExprType(ix.index);
         const index_resolved = try self.resolveLiteralType(index_type, "semantic error: index must be integer");
         if (!self.isInteger(index_resolved)) return self.fail("semantic error: index must be integer");
 
@@ -477,11 +747,49 @@ pub const Analyzer = struct {
         }
     }
 
+    /// `xs[a..b]` and `xs[a..=b]`: a view of part of an array or slice.
+    fn checkSliceRange(self: *Analyzer, ix: ast.IndexExpr) SemanticError!SemType {
+        const range = self.tree.node(ix.index).range;
+        try self.ensureIntegerArg(range.start, "semantic error: slice bounds must be integers");
+        try self.ensureIntegerArg(range.end, "semantic error: slice bounds must be integers");
+        const elem = try self.viewedElem(ix.target, "semantic error: only arrays and slices can be sliced");
+        return .{ .known = .{ .slice = .{ .elem = try self.allocType(elem) } } };
+    }
+
+    /// Element type of `node`, an array or slice that a view or `copy`
+    /// reads. An array has to be a variable or an element of one, since a
+    /// view of a temporary would outlive it.
+    fn viewedElem(self: *Analyzer, node: ast.Index, msg: []const u8) SemanticError!ast.Type {
+        const t = try self.inferExprType(node);
+        if (t != .known) return self.fail(msg);
+        const elem = switch (t.known) {
+            .array => |arr| blk: {
+                if (!self.isArrayPlace(node)) return self.fail("semantic error: only an array variable can be sliced");
+                break :blk arr.elem.*;
+            },
+            .slice => |sl| sl.elem.*,
+            else => return self.fail(msg),
+        };
+        if (elem == .array) return self.fail("semantic error: slice of arrays not supported");
+        return elem;
+    }
+
+    fn isArrayPlace(self: *Analyzer, node: ast.Index) bool {
+        return switch (self.tree.node(node)) {
+            .variable => true,
+            .index_expr => |ix| self.tree.node(ix.index) != .range and self.isArrayPlace(ix.target),
+            else => false,
+        };
+    }
+
     fn checkIndexAssign(self: *Analyzer, ia: ast.IndexAssign) SemanticError!void {
-        const value_type = try self.inferExprType(ia.value.*);
-        switch (ia.target.*) {
-            .index_expr => |ix| {
-                const elem_type = try self.checkIndex(ix);
+        const value_type = try self.inferExprType(ia.value);
+        switch (self.tree.tags[ia.target]) {
+            .index_expr => {
+                if (self.tree.node(self.tree.node(ia.target).index_expr.index) == .range) {
+                    return self.fail("semantic error: cannot assign to a slice range");
+                }
+                const elem_type = try self.inferExprType(ia.target);
                 try self.ensureAssignable(elem_type.known, value_type);
             },
             else => return self.fail("semantic error: cannot assign to non-array"),
@@ -494,7 +802,8 @@ pub const Analyzer = struct {
                 return self.fail("semantic error: print accepts at most one argument");
             }
             if (call.args.len == 1) {
-                _ = try self.inferExprType(call.args[0]);
+                const t = try self.inferExprType(call.args[0]);
+                if (t == .null) return self.fail("semantic error: cannot print null");
             }
             return .{ .known = .void };
         }
@@ -505,13 +814,16 @@ pub const Analyzer = struct {
             const arg_type = try self.inferExprType(call.args[0]);
             switch (arg_type) {
                 .known => |kt| switch (kt) {
-                    .array, .slice => return .{ .known = .i32 },
-                    else => return self.fail("semantic error: len expects array or slice"),
+                    .array, .slice, .str => return .{ .known = .i32 },
+                    else => return self.fail("semantic error: len expects array, slice or str"),
                 },
-                else => return self.fail("semantic error: len expects array or slice"),
+                else => return self.fail("semantic error: len expects array, slice or str"),
             }
         }
 
+        if (ast.SyncBuiltin.of(call.callee)) |builtin| return self.checkSyncCall(builtin, call);
+        if (ast.AllocBuiltin.of(call.callee)) |builtin| return self.checkAllocCall(builtin, call);
+
         const sig = self.functions.get(call.callee) orelse return self.fail("semantic error: unknown function");
         if (call.args.len != sig.params.len) {
             return self.fail("semantic error: incorrect argument count");
@@ -532,6 +844,310 @@ pub const Analyzer = struct {
         return .{ .known = .void };
     }
 
+    fn checkSyncCall(self: *Analyzer, builtin: ast.SyncBuiltin, call: ast.Call) SemanticError!SemType {
+        switch (builtin) {
+            .mutex => {
+                if (call.args.len != 0) return self.fail("semantic error: mutex takes no arguments");
+                return .{ .known = .mutex };
+            },
+            .lock, .unlock => {
+                if (call.args.len != 1) return self.fail("semantic error: lock and unlock take a mutex");
+                const t = try self.inferExprType(call.args[0]);
+                if (t != .known or t.known != .mutex) return self.fail("semantic error: lock and unlock take a mutex");
+                return .{ .known = .void };
+            },
+            .channel => return self.fail("semantic error: channel(...) must be the value of a typed declaration: set ch as channel T to channel(n)"),
+            .send => {
+                if (call.args.len != 2) return self.fail("semantic error: send takes a channel and a value");
+                const elem = try self.channelElem(call.args[0]);
+                try self.ensureAssignable(elem, try self.inferExprType(call.args[1]));
+                return .{ .known = .void };
+            },
+            .receive => {
+                if (call.args.len != 1) return self.fail("semantic error: receive takes a channel");
+                return .{ .known = try self.channelElem(call.args[0]) };
+            },
+            .atomic_load, .atomic_store, .atomic_add, .atomic_cas => {},
+        }
+
+        // Values after the atomic, then the optional memory order.
+        const values: usize = switch (builtin) {
+            .atomic_load => 0,
+            .atomic_cas => 2,
+            else => 1,
+        };
+        if (call.args.len != values + 1 and call.args.len != values + 2) {
+            return self.fail("semantic error: incorrect argument count");
+        }
+        const t = try self.inferExprType(call.args[0]);
+        if (t != .known or t.known != .atomic) return self.fail("semantic error: atomic operation requires an atomic");
+        const elem = t.known.atomic.elem.*;
+        for (call.args[1 .. values + 1]) |arg| {
+            try self.ensureAssignable(elem, try self.inferExprType(arg));
+        }
+        if (call.args.len == values + 2) {
+            const order_node = call.args[values + 1];
+            _ = try self.inferExprType(order_node);
+            const order = switch (self.tree.node(order_node)) {
+                .string_literal => |lit| ast.MemoryOrder.of(lit.value),
+                else => null,
+            } orelse return self.fail("semantic error: memory order must be \"relaxed\", \"acquire\", \"release\", \"acq_rel\" or \"seq_cst\"");
+            // As in C11: loads cannot release and stores cannot acquire.
+            const valid = switch (builtin) {
+                .atomic_load => order != .release and order != .acq_rel,
+                .atomic_store => order != .acquire and order != .acq_rel,
+                else => true,
+            };
+            if (!valid) return self.fail("semantic error: invalid memory order for this atomic operation");
+        }
+
+        return .{ .known = switch (builtin) {
+            .atomic_store => .void,
+            .atomic_cas => .bool,
+            else => elem,
+        } };
+    }
+
+    fn isCallOf(self: *Analyzer, node: ast.Index, callee: []const u8) bool {
+        return switch (self.tree.node(node)) {
+            .call => |c| std.mem.eql(u8, c.callee, callee),
+            else => false,
+        };
+    }
+
+    fn checkChannelNew(self: *Analyzer, call: ast.Call) SemanticError!void {
+        if (call.args.len != 1) return self.fail("semantic error: channel takes a capacity");
+        try self.ensureIntegerArg(call.args[0], "semantic error: channel capacity must be an integer");
+    }
+
+    fn ensureIntegerArg(self: *Analyzer, node: ast.Index, msg: []const u8) SemanticError!void {
+        const ok = switch (try self.inferExprType(node)) {
+            .int_lit => true,
+            .known => |kt| self.isInteger(kt),
+            else => false,
+        };
+        if (!ok) return self.fail(msg);
+    }
+
+    fn checkAllocNew(self: *Analyzer, call: ast.Call) SemanticError!void {
+        if (call.args.len != 1 and call.args.len != 2) return self.fail("semantic error: alloc takes a length and an optional arena");
+        try self.ensureIntegerArg(call.args[0], "semantic error: alloc length must be an integer");
+        if (call.args.len == 2 and !try self.isArena(call.args[1])) return self.fail("semantic error: alloc takes a length and an optional arena");
+    }
+
+    fn checkAllocCall(self: *Analyzer, builtin: ast.AllocBuiltin, call: ast.Call) SemanticError!SemType {
+        switch (builtin) {
+            .alloc => return self.fail("semantic error: alloc(...) must be the value of a typed declaration: set xs as []T to alloc(n)"),
+            .arena => {
+                if (call.args.len != 0) return self.fail("semantic error: arena takes no arguments");
+                return .{ .known = .arena };
+            },
+            .reset => {
+                if (call.args.len != 1 or !try self.isArena(call.args[0])) return self.fail("semantic error: reset takes an arena");
+            },
+            .free => {
+                const msg = "semantic error: free takes a slice variable or an arena";
+                if (call.args.len != 1) return self.fail(msg);
+                if (!try self.isArena(call.args[0])) _ = try self.sliceVar(call.args[0], msg);
+            },
+            .cap => {
+                // A variable, since the generated code reads it twice.
+                if (call.args.len != 1 or self.tree.node(call.args[0]) != .variable) {
+                    return self.fail("semantic error: cap expects a slice variable");
+                }
+                const t = try self.inferExprType(call.args[0]);
+                if (t != .known or t.known != .slice) return self.fail("semantic error: cap expects a slice variable");
+                return .{ .known = .i32 };
+            },
+            .append => {
+                if (call.args.len != 2) return self.fail("semantic error: append takes a slice variable and a value");
+                const elem = try self.sliceVar(call.args[0], "semantic error: append takes a slice variable and a value");
+                try self.ensureAssignable(elem, try self.inferExprType(call.args[1]));
+            },
+            .copy => {
+                if (call.args.len != 1) return self.fail("semantic error: copy takes an array or slice");
+                const elem = try self.viewedElem(call.args[0], "semantic error: copy takes an array or slice");
+                return .{ .known = .{ .slice = .{ .elem = try self.allocType(elem) } } };
+            },
+            .reserve => {
+                if (call.args.len != 2) return self.fail("semantic error: reserve takes a slice variable and a count");
+                _ = try self.sliceVar(call.args[0], "semantic error: reserve takes a slice variable and a count");
+                try self.ensureIntegerArg(call.args[1], "semantic error: reserve count must be an integer");
+            },
+        }
+        return .{ .known = .void };
+    }
+
+    fn isArena(self: *Analyzer, node: ast.Index) SemanticError!bool {
+        const t = try self.inferExprType(node);
+        return t == .known and t.known == .arena;
+    }
+
+    /// Element type of `node`, a slice variable that the call changes in place.
+    fn sliceVar(self: *Analyzer, node: ast.Index, msg: []const u8) SemanticError!ast.Type {
+        const name = switch (self.tree.node(node)) {
+            .variable => |v| v.name,
+            else => return self.fail(msg),
+        };
+        const t = try self.inferExprType(node);
+        if (t != .known or t.known != .slice) return self.fail(msg);
+        if (self.isCaptured(name)) {
+            return self.fail("semantic error: parallel loop cannot assign to a variable declared outside it");
+        }
+        return t.known.slice.elem.*;
+    }
+
+    fn channelElem(self: *Analyzer, node: ast.Index) SemanticError!ast.Type {
+        const t = try self.inferExprType(node);
+        if (t != .known or t.known != .channel) return self.fail("semantic error: send and receive require a channel");
+        return t.known.channel.elem.*;
+    }
+
+    /// Rejects parallel calls that share an array or slice one of them
+    /// writes, unless it only writes it between `lock` and `unlock`. Sharing
+    /// atomics and mutexes is what they are for.
+    fn checkSharedWrites(self: *Analyzer, calls: []const ast.Index) SemanticError!void {
+        for (calls, 0..) |call_node, i| {
+            const call = self.tree.node(call_node).call;
+            for (call.args, 0..) |arg, param| {
+                const name = switch (self.tree.node(arg)) {
+                    .variable => |v| v.name,
+                    else => continue,
+                };
+                const t = self.lookupVar(name) orelse continue;
+                if (t != .array and t != .slice) continue;
+                const shared = for (calls, 0..) |other, j| {
+                    if (j != i and self.mentionsVar(other, name)) break true;
+                } else false;
+                if (!shared) continue;
+
+                var visiting: std.ArrayList(ParamRef) = .empty;
+                defer visiting.deinit(self.allocator);
+                if (try self.writesParam(call.callee, param, &visiting)) {
+                    return self.fail("semantic error: parallel calls cannot share an array that one of them writes");
+                }
+            }
+        }
+    }
+
+    const ParamRef = struct {
+        function: []const u8,
+        index: usize,
+    };
+
+    /// Whether function `callee` may write the elements of its parameter
+    /// `index` outside `lock` ... `unlock`, itself or through the functions
+    /// it passes the parameter to. The bodies of imported functions are not
+    /// available, so they are taken not to.
+    fn writesParam(self: *Analyzer, callee: []const u8, index: usize, visiting: *std.ArrayList(ParamRef)) SemanticError!bool {
+        const fd = for (self.tree.rootStmts()) |stmt| {
+            if (self.tree.tags[stmt] != .function_def) continue;
+            const def = self.tree.node(stmt).function_def;
+            if (std.mem.eql(u8, def.name, callee)) break def;
+        } else return false;
+        if (index >= fd.params.len) return false;
+        // Recursion: the other paths through the function decide.
+        for (visiting.items) |ref| {
+            if (ref.index == index and std.mem.eql(u8, ref.function, callee)) return false;
+        }
+        visiting.append(self.allocator, .{ .function = callee, .index = index }) catch return self.fail("semantic error: out of memory");
+        return self.blockWrites(fd.body, fd.params[index].name, visiting);
+    }
+
+    fn blockWrites(self: *Analyzer, stmts: []const ast.Index, name: []const u8, visiting: *std.ArrayList(ParamRef)) SemanticError!bool {
+        var locked: usize = 0;
+        for (stmts) |stmt| {
+            const callee = switch (self.tree.node(stmt)) {
+                .expr_stmt => |es| switch (self.tree.node(es.expr)) {
+                    .call => |c| c.callee,
+                    else => "",
+                },
+                else => "",
+            };
+            if (std.mem.eql(u8, callee, "lock")) locked += 1;
+            if (std.mem.eql(u8, callee, "unlock")) locked -|= 1;
+            if (locked == 0 and try self.stmtWrites(stmt, name, visiting)) return true;
+        }
+        return false;
+    }
+
+    fn stmtWrites(self: *Analyzer, stmt: ast.Index, name: []const u8, visiting: *std.ArrayList(ParamRef)) SemanticError!bool {
+        return switch (self.tree.node(stmt)) {
+            .index_assign => |ia| blk: {
+                var target = ia.target;
+                while (self.tree.node(target) == .index_expr) target = self.tree.node(target).index_expr.target;
+                if (self.mentionsVar(target, name)) break :blk true;
+                break :blk try self.exprWrites(ia.target, name, visiting) or try self.exprWrites(ia.value, name, visiting);
+            },
+            .set_assign => |sa| self.exprWrites(sa.value, name, visiting),
+            .typed_assign => |ta| self.exprWrites(ta.value, name, visiting),
+            .return_stmt => |rs| if (rs.value) |v| self.exprWrites(v, name, visiting) else false,
+            .expr_stmt => |es| self.exprWrites(es.expr, name, visiting),
+            .if_stmt => |is| blk: {
+                if (try self.exprWrites(is.condition, name, visiting)) break :blk true;
+                if (try self.blockWrites(is.then_body, name, visiting)) break :blk true;
+                for (is.else_ifs) |elif_node| {
+                    const elif = self.tree.node(elif_node).else_if;
+                    if (try self.exprWrites(elif.condition, name, visiting)) break :blk true;
+                    if (try self.blockWrites(elif.body, name, visiting)) break :blk true;
+                }
+                if (is.else_body) |else_body| break :blk self.blockWrites(else_body, name, visiting);
+                break :blk false;
+            },
+            .while_loop => |wl| try self.exprWrites(wl.condition, name, visiting) or try self.blockWrites(wl.body, name, visiting),
+            .for_loop => |fl| try self.blockWrites(fl.body, name, visiting),
+            .parallel_block => |pb| self.blockWrites(pb.body, name, visiting),
+            .parallel_assign => |pa| blk: {
+                for (pa.calls) |call| {
+                    if (try self.exprWrites(call, name, visiting)) break :blk true;
+                }
+                break :blk false;
+            },
+            .try_catch => |tc| try self.exprWrites(tc.try_expr, name, visiting) or try self.blockWrites(tc.catch_body, name, visiting),
+            else => false,
+        };
+    }
+
+    /// Whether a call in `node` is given `name` for a parameter it writes.
+    fn exprWrites(self: *Analyzer, node: ast.Index, name: []const u8, visiting: *std.ArrayList(ParamRef)) SemanticError!bool {
+        return switch (self.tree.node(node)) {
+            .call => |c| blk: {
+                for (c.args, 0..) |arg, i| {
+                    const passed = if (self.viewedVar(arg)) |v| std.mem.eql(u8, v, name) else false;
+                    // Appending writes past the end, into capacity the caller's slice shares.
+                    const mutated = if (ast.AllocBuiltin.of(c.callee)) |builtin| i == 0 and builtin.mutatesSlice() else false;
+                    if (passed and mutated) break :blk true;
+                    if (passed and try self.writesParam(c.callee, i, visiting)) break :blk true;
+                    if (try self.exprWrites(arg, name, visiting)) break :blk true;
+                }
+                break :blk false;
+            },
+            .interpolation => |ip| blk: {
+                for (ip.parts) |part| {
+                    if (try self.exprWrites(part, name, visiting)) break :blk true;
+                }
+                break :blk false;
+            },
+            .binary_op => |bin| try self.exprWrites(bin.left, name, visiting) or try self.exprWrites(bin.right, name, visiting),
+            .unary_op => |un| self.exprWrites(un.operand, name, visiting),
+            .index_expr => |ix| try self.exprWrites(ix.target, name, visiting) or try self.exprWrites(ix.index, name, visiting),
+            .try_expr => |te| self.exprWrites(te.expr, name, visiting),
+            .spawn_expr => |se| self.exprWrites(se.call, name, visiting),
+            .await_expr => |ae| self.exprWrites(ae.expr, name, visiting),
+            else => false,
+        };
+    }
+
+    /// The variable whose elements `node` hands out: a variable itself or a
+    /// view `xs[a..b]` of one.
+    fn viewedVar(self: *Analyzer, node: ast.Index) ?[]const u8 {
+        return switch (self.tree.node(node)) {
+            .variable => |v| v.name,
+            .index_expr => |ix| if (self.tree.node(ix.index) == .range) self.viewedVar(ix.target) else null,
+            else => null,
+        };
+    }
+
     fn ensureBool(self: *Analyzer, t: SemType) SemanticError!void {
         const kt = try self.requireKnownType(t, "expected bool");
         if (!self.typeEquals(kt, .bool)) return self.fail("semantic error: expected bool");
@@ -541,11 +1157,7 @@ pub const Analyzer = struct {
         if (expected == .error_union) {
             const eu = expected.error_union;
             switch (actual) {
-                .null => {
-                    if (self.typeEquals(eu.ok.*, .str)) return;
-                    if (self.typeEquals(eu.err.*, .str)) return;
-                    return self.fail("semantic error: null only assignable to str (for now)");
-                },
+                .null => return self.fail("semantic error: no type can hold null until optional types exist"),
                 .int_lit => {
                     if (self.isInteger(eu.ok.*)) return;
                     return self.fail("semantic error: expected integer type");
@@ -564,11 +1176,7 @@ pub const Analyzer = struct {
         }
 
         switch (actual) {
-            .null => {
-                if (!self.typeEquals(expected, .str)) {
-                    return self.fail("semantic error: null only assignable to str (for now)");
-                }
-            },
+            .null => return self.fail("semantic error: no type can hold null until optional types exist"),
             .int_lit => {
                 if (!self.isInteger(expected)) return self.fail("semantic error: expected integer type");
             },
@@ -662,6 +1270,10 @@ pub const Analyzer = struct {
         }
     }
 
+    fn isStrType(self: *Analyzer, t: SemType) bool {
+        return t == .known and self.typeEquals(t.known, .str);
+    }
+
     fn ensureComparable(self: *Analyzer, lt: SemType, rt: SemType) SemanticError!void {
         switch (lt) {
             .int_lit => switch (rt) {
@@ -728,6 +1340,20 @@ pub const Analyzer = struct {
         return self.lookupVar(name) != null;
     }
 
+    /// Whether `name` is a variable declared outside the innermost parallel
+    /// loop, i.e. one its iterations share, other than its accumulators.
+    fn isCaptured(self: *Analyzer, name: []const u8) bool {
+        const pl = self.parallel_loop orelse return false;
+        for (pl.reductions) |r| {
+            if (std.mem.eql(u8, r.name, name)) return false;
+        }
+        var i: usize = self.scopes.items.len;
+        while (i > 0) : (i -= 1) {
+            if (self.scopes.items[i - 1].contains(name)) return i - 1 < pl.scope;
+        }
+        return false;
+    }
+
     fn pushScope(self: *Analyzer) SemanticError!void {
         const map = std.StringHashMap(ast.Type).init(self.allocator);
         self.scopes.append(self.allocator, map) catch return self.fail("semantic error: out of memory");
@@ -740,18 +1366,18 @@ pub const Analyzer = struct {
         }
     }
 
-    fn blockReturns(self: *Analyzer, stmts: []const ast.Node) bool {
+    fn blockReturns(self: *Analyzer, stmts: []const ast.Index) bool {
         if (stmts.len == 0) return false;
         return self.stmtReturns(stmts[stmts.len - 1]);
     }
 
-    fn stmtReturns(self: *Analyzer, stmt: ast.Node) bool {
-        return switch (stmt) {
+    fn stmtReturns(self: *Analyzer, stmt: ast.Index) bool {
+        return switch (self.tree.node(stmt)) {
             .return_stmt => true,
             .if_stmt => |is| blk: {
                 if (is.else_body == null) break :blk false;
-                for (is.else_ifs) |elif| {
-                    if (!self.blockReturns(elif.body)) break :blk false;
+                for (is.else_ifs) |elif_node| {
+                    if (!self.blockReturns(self.tree.node(elif_node).else_if.body)) break :blk false;
                 }
                 if (!self.blockReturns(is.then_body)) break :blk false;
                 if (!self.blockReturns(is.else_body.?)) break :blk false;
@@ -775,6 +1401,18 @@ pub const Analyzer = struct {
                 .slice => |bs| self.typeEquals(s.elem.*, bs.elem.*),
                 else => false,
             },
+            .future => |f| switch (b) {
+                .future => |bf| self.typeEquals(f.result.*, bf.result.*),
+                else => false,
+            },
+            .atomic => |at| switch (b) {
+                .atomic => |bat| self.typeEquals(at.elem.*, bat.elem.*),
+                else => false,
+            },
+            .channel => |ch| switch (b) {
+                .channel => |bch| self.typeEquals(ch.elem.*, bch.elem.*),
+                else => false,
+            },
             else => std.meta.eql(a, b),
         };
     }
@@ -791,20 +1429,49 @@ pub const Analyzer = struct {
                 if (eu.ok.* == .error_union or eu.err.* == .error_union) {
                     return self.fail("semantic error: nested error unions not supported");
                 }
+                if (isHandle(eu.ok.*) or isHandle(eu.err.*)) {
+                    return self.fail("semantic error: error unions cannot contain atomics, mutexes, channels or arenas");
+                }
                 try self.validateType(eu.ok.*);
                 try self.validateType(eu.err.*);
             },
-            .array => |arr| try self.validateType(arr.elem.*),
+            .array => |arr| {
+                if (isHandle(arr.elem.*)) return self.fail("semantic error: arrays cannot hold atomics, mutexes, channels or arenas");
+                try self.validateType(arr.elem.*);
+            },
             .slice => |s| {
                 if (s.elem.* == .array) {
                     return self.fail("semantic error: slice of arrays not supported");
                 }
+                if (isHandle(s.elem.*)) return self.fail("semantic error: slices cannot hold atomics, mutexes, channels or arenas");
                 try self.validateType(s.elem.*);
             },
+            .future => return self.fail("semantic error: functions cannot return futures"),
+            .atomic => |at| {
+                if (!self.isInteger(at.elem.*)) return self.fail("semantic error: atomic requires an integer type");
+            },
+            .channel => |ch| {
+                // Messages travel in a `__1im_word`.
+                const elem = ch.elem.*;
+                if (!self.isNumeric(elem) and elem != .bool and elem != .str) {
+                    return self.fail("semantic error: channels carry numbers, bools or strings");
+                }
+            },
             else => {},
         }
     }
 
+    /// Types whose values refer to a cell in the declaring frame.
+    fn isShared(t: ast.Type) bool {
+        return t == .atomic or t == .mutex;
+    }
+
+    /// Types whose values refer to synchronization or allocator state;
+    /// containers cannot hold them.
+    fn isHandle(t: ast.Type) bool {
+        return isShared(t) or t == .channel or t == .arena;
+    }
+
     fn requireErrorUnion(self: *Analyzer, t: SemType, msg: []const u8) SemanticError!ast.ErrorUnionType {
         const kt = try self.requireKnownType(t, msg);
         return switch (kt) {
@@ -823,10 +1490,10 @@ pub const Analyzer = struct {
         return SemanticError.Failure;
     }
 
-    fn inferMissingFunctionReturns(self: *Analyzer, prog: ast.Program) SemanticError!void {
-        for (prog.stmts) |stmt| {
-            if (stmt != .function_def) continue;
-            const fd = stmt.function_def;
+    fn inferMissingFunctionReturns(self: *Analyzer, stmts: []const ast.Index) SemanticError!void {
+        for (stmts) |stmt| {
+            if (self.tree.tags[stmt] != .function_def) continue;
+            const fd = self.tree.node(stmt).function_def;
             if (fd.return_type != null) continue;
 
             const inferred = try self.inferFunctionReturnType(fd);
@@ -860,7 +1527,7 @@ pub const Analyzer = struct {
 
     fn inferReturnTypesInBlock(
         self: *Analyzer,
-        stmts: []const ast.Node,
+        stmts: []const ast.Index,
         has_value: *bool,
         has_void: *bool,
         inferred: *ast.Type,
@@ -872,15 +1539,16 @@ pub const Analyzer = struct {
 
     fn collectReturnType(
         self: *Analyzer,
-        stmt: ast.Node,
+        stmt: ast.Index,
         has_value: *bool,
         has_void: *bool,
         inferred: *ast.Type,
     ) SemanticError!void {
-        switch (stmt) {
+        switch (self.tree.node(stmt)) {
             .set_assign => |sa| try self.checkSetAssign(sa),
             .typed_assign => |ta| try self.checkTypedAssign(ta),
             .index_assign => |ia| try self.checkIndexAssign(ia),
+            .parallel_assign => |pa| try self.bindParallelTargets(pa),
             .return_stmt => |rs| {
                 if (rs.value == null) {
                     has_void.* = true;
@@ -888,12 +1556,12 @@ pub const Analyzer = struct {
                 }
 
                 var ret_type: ast.Type = undefined;
-                if (rs.value.?.* == .try_expr) {
-                    const inner = try self.inferExprType(rs.value.?.*.try_expr.expr.*);
+                if (self.tree.tags[rs.value.?] == .try_expr) {
+                    const inner = try self.inferExprType(self.tree.node(rs.value.?).try_expr.expr);
                     const eu = try self.requireErrorUnion(inner, "semantic error: try requires error union");
                     ret_type = .{ .error_union = eu };
                 } else {
-                    const value_type = try self.inferExprType(rs.value.?.*);
+                    const value_type = try self.inferExprType(rs.value.?);
                     ret_type = try self.resolveLiteralType(value_type, "semantic error: cannot infer return type");
                 }
 
@@ -907,12 +1575,13 @@ pub const Analyzer = struct {
                 try self.ensureAssignable(inferred.*, actual);
             },
             .if_stmt => |is| {
-                _ = try self.inferExprType(is.condition.*);
+                _ = try self.inferExprType(is.condition);
                 try self.pushScope();
                 try self.inferReturnTypesInBlock(is.then_body, has_value, has_void, inferred);
                 self.popScope();
-                for (is.else_ifs) |elif| {
-                    _ = try self.inferExprType(elif.condition.*);
+                for (is.else_ifs) |elif_node| {
+                    const elif = self.tree.node(elif_node).else_if;
+                    _ = try self.inferExprType(elif.condition);
                     try self.pushScope();
                     try self.inferReturnTypesInBlock(elif.body, has_value, has_void, inferred);
                     self.popScope();
@@ -924,17 +1593,17 @@ pub const Analyzer = struct {
                 }
             },
             .while_loop => |wl| {
-                _ = try self.inferExprType(wl.condition.*);
+                _ = try self.inferExprType(wl.condition);
                 try self.pushScope();
                 try self.inferReturnTypesInBlock(wl.body, has_value, has_void, inferred);
                 self.popScope();
             },
             .for_loop => |fl| {
                 var loop_type: ast.Type = .i32;
-                if (fl.iterable.* == .range) {
-                    const range = fl.iterable.*.range;
-                    const start_t = try self.inferExprType(range.start.*);
-                    const end_t = try self.inferExprType(range.end.*);
+                if (self.tree.node(fl.iterable) == .range) {
+                    const range = self.tree.node(fl.iterable).range;
+                    const start_t = try self.inferExprType(range.start);
+                    const end_t = try self.inferExprType(range.end);
                     const start_type = try self.rangeEndpointType(start_t);
                     const end_type = try self.rangeEndpointType(end_t);
                     if (!self.typeEquals(start_type, end_type)) {
@@ -942,7 +1611,7 @@ pub const Analyzer = struct {
                     }
                     loop_type = start_type;
                 } else {
-                    const iter_type = try self.inferExprType(fl.iterable.*);
+                    const iter_type = try self.inferExprType(fl.iterable);
                     const kt = try self.requireKnownType(iter_type, "semantic error: for loop requires array or slice");
                     switch (kt) {
                         .array => |arr| loop_type = arr.elem.*,
@@ -956,7 +1625,7 @@ pub const Analyzer = struct {
                 self.popScope();
             },
             .try_catch => |tc| {
-                const try_type = try self.inferExprType(tc.try_expr.*);
+                const try_type = try self.inferExprType(tc.try_expr);
                 const eu = try self.requireErrorUnion(try_type, "semantic error: try requires error union");
                 try self.pushScope();
                 if (tc.catch_var) |name| {
@@ -966,18 +1635,55 @@ pub const Analyzer = struct {
                 self.popScope();
             },
             .expr_stmt => |es| {
-                _ = try self.inferExprType(es.expr.*);
+                _ = try self.inferExprType(es.expr);
             },
             .function_def => {}, // ignore nested function definitions for now
             else => {},
         }
     }
 
-    fn containsTryExpr(self: *Analyzer, node: ast.Node) bool {
-        return switch (node) {
+    fn mentionsVar(self: *Analyzer, node: ast.Index, name: []const u8) bool {
+        return switch (self.tree.node(node)) {
+            .variable => |v| std.mem.eql(u8, v.name, name),
+            .interpolation => |ip| blk: {
+                for (ip.parts) |part| {
+                    if (self.mentionsVar(part, name)) break :blk true;
+                }
+                break :blk false;
+            },
+            .binary_op => |bin| self.mentionsVar(bin.left, name) or self.mentionsVar(bin.right, name),
+            .unary_op => |un| self.mentionsVar(un.operand, name),
+            .call => |c| blk: {
+                for (c.args) |arg| {
+                    if (self.mentionsVar(arg, name)) break :blk true;
+                }
+                break :blk false;
+            },
+            .array_literal => |arr| blk: {
+                for (arr.elements) |elem| {
+                    if (self.mentionsVar(elem, name)) break :blk true;
+                }
+                break :blk false;
+            },
+            .index_expr => |ix| self.mentionsVar(ix.target, name) or self.mentionsVar(ix.index, name),
+            .try_expr => |te| self.mentionsVar(te.expr, name),
+            .spawn_expr => |se| self.mentionsVar(se.call, name),
+            .await_expr => |ae| self.mentionsVar(ae.expr, name),
+            else => false,
+        };
+    }
+
+    fn containsTryExpr(self: *Analyzer, node: ast.Index) bool {
+        return switch (self.tree.node(node)) {
             .try_expr => true,
-            .binary_op => |bin| self.containsTryExpr(bin.left.*) or self.containsTryExpr(bin.right.*),
-            .unary_op => |un| self.containsTryExpr(un.operand.*),
+            .interpolation => |ip| blk: {
+                for (ip.parts) |part| {
+                    if (self.containsTryExpr(part)) break :blk true;
+                }
+                break :blk false;
+            },
+            .binary_op => |bin| self.containsTryExpr(bin.left) or self.containsTryExpr(bin.right),
+            .unary_op => |un| self.containsTryExpr(un.operand),
             .call => |c| blk: {
                 for (c.args) |arg| {
                     if (self.containsTryExpr(arg)) break :blk true;
@@ -990,9 +1696,11 @@ pub const Analyzer = struct {
                 }
                 break :blk false;
             },
-            .index_expr => |ix| self.containsTryExpr(ix.target.*) or self.containsTryExpr(ix.index.*),
-            .index_assign => |ia| self.containsTryExpr(ia.target.*) or self.containsTryExpr(ia.value.*),
-            .range => |r| self.containsTryExpr(r.start.*) or self.containsTryExpr(r.end.*),
+            .index_expr => |ix| self.containsTryExpr(ix.target) or self.containsTryExpr(ix.index),
+            .index_assign => |ia| self.containsTryExpr(ia.target) or self.containsTryExpr(ia.value),
+            .range => |r| self.containsTryExpr(r.start) or self.containsTryExpr(r.end),
+            .spawn_expr => |se| self.containsTryExpr(se.call),
+            .await_expr => |ae| self.containsTryExpr(ae.expr),
             else => false,
         };
     }
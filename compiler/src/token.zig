@@ -1,6 +1,6 @@
 const std = @import("std");
 
-pub const TokenType = enum {
+pub const TokenType = enum(u8) {
     // Keywords
     kw_set,
     kw_to,
@@ -20,6 +20,8 @@ pub const TokenType = enum {
     kw_import,
     kw_from,
     kw_parallel,
+    kw_spawn,
+    kw_await,
     kw_fun,
     kw_true,
     kw_false,
@@ -90,11 +92,12 @@ pub const TokenType = enum {
     }
 };
 
+/// A token is its type and where it starts in the source. The lexeme and
+/// the line/column are recomputed from `start` when needed (see
+/// `Lexer.lexeme` and `location`), so a token is 8 bytes.
 pub const Token = struct {
     tag: TokenType,
-    lexeme: []const u8,
-    line: usize,
-    col: usize,
+    start: u32,
 
     pub fn format(
         self: Token,
@@ -104,11 +107,27 @@ pub const Token = struct {
     ) !void {
         _ = fmt;
         _ = options;
-        try writer.print("{s}(\"{s}\" L{d}:{d})", .{
-            self.tag.name_str(),
-            self.lexeme,
-            self.line,
-            self.col,
-        });
+        try writer.print("{s}(@{d})", .{ self.tag.name_str(), self.start });
     }
 };
+
+/// 1-based line and column of a source offset.
+pub const Location = struct {
+    line: usize,
+    col: usize,
+};
+
+/// Counts lines up to `offset`; only used to report errors.
+pub fn location(source: []const u8, offset: usize) Location {
+    const end = @min(offset, source.len);
+    var loc: Location = .{ .line = 1, .col = 1 };
+    for (source[0..end]) |c| {
+        if (c == '\n') {
+            loc.line += 1;
+            loc.col = 1;
+        } else {
+            loc.col += 1;
+        }
+    }
+    return loc;
+}
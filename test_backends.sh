@@ -0,0 +1,81 @@
+#!/bin/bash
+# Cross-check the C and native backends over all examples.
+# Each example is compiled and run with both; their stdout must match.
+# parallel.1im runs its block on threads under the C backend, so its
+# output is compared order-insensitively. The native backend does not
+# support the programs in C_ONLY, so they only run under the C backend,
+# and their output is compared with examples/expected/NAME.out instead:
+# channels.1im needs its tasks to run at the same time, growable.1im,
+# slice_alias.1im and slice_views.1im allocate and take views of slices,
+# and strings.1im and interpolation.1im build strings. The programs in
+# EXPECT_FAIL must instead exit with status 1 under both backends, after
+# printing the same output.
+
+COMPILER="./compiler/zig-out/bin/1im"
+EXAMPLES_DIR="./examples"
+EXPECTED_DIR="$EXAMPLES_DIR/expected"
+C_ONLY=" channels growable slice_alias slice_views strings interpolation "
+EXPECT_FAIL=" bounds_fail "
+
+GREEN='\033[0;32m'
+RED='\033[0;31m'
+NC='\033[0m' # No Color
+
+if [ ! -f "$COMPILER" ]; then
+    echo -e "${RED}Error: Compiler not found at $COMPILER${NC}"
+    echo "Please build the compiler first with: cd compiler && zig build"
+    exit 1
+fi
+
+total=0
+passed=0
+failed=0
+
+for example in "$EXAMPLES_DIR"/*.1im; do
+    [ -f "$example" ] || continue
+    total=$((total + 1))
+    name=$(basename "$example" .1im)
+
+    c_out=$($COMPILER --no-cache "$example" 2>/dev/null)
+    c_status=$?
+
+    if [[ "$C_ONLY" == *" $name "* ]]; then
+        expected="$EXPECTED_DIR/$name.out"
+        if [ ! -f "$expected" ]; then
+            echo -e "${RED}✗${NC} $name (c only, missing $expected)"
+            failed=$((failed + 1))
+        elif [ $c_status -eq 0 ] && [ "$c_out" = "$(cat "$expected")" ]; then
+            echo -e "${GREEN}✓${NC} $name (c only)"
+            passed=$((passed + 1))
+        else
+            echo -e "${RED}✗${NC} $name (c only, exit $c_status)"
+            diff "$expected" <(echo "$c_out") | sed 's/^/    /'
+            failed=$((failed + 1))
+        fi
+        continue
+    fi
+
+    native_out=$($COMPILER --no-cache --backend=native "$example" 2>/dev/null)
+    native_status=$?
+
+    if [ "$name" = "parallel" ]; then
+        c_out=$(echo "$c_out" | sort)
+        native_out=$(echo "$native_out" | sort)
+    fi
+
+    want_status=0
+    [[ "$EXPECT_FAIL" == *" $name "* ]] && want_status=1
+
+    if [ $c_status -eq $want_status ] && [ $native_status -eq $want_status ] && [ "$c_out" = "$native_out" ]; then
+        echo -e "${GREEN}✓${NC} $name"
+        passed=$((passed + 1))
+    else
+        echo -e "${RED}✗${NC} $name (c exit $c_status, native exit $native_status)"
+        diff <(echo "$c_out") <(echo "$native_out") | sed 's/^/    /'
+        failed=$((failed + 1))
+    fi
+done
+
+echo ""
+echo "Total: $total  Passed: $passed  Failed: $failed"
+[ $failed -eq 0 ]